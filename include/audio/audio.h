@@ -17,6 +17,10 @@ void set_frequency(int hz);
 void set_volume(float volume);
 float volume();
 
+// Emulation speed relative to real time. Samples are time-compressed to
+// match; <= 0 (unthrottled) drops them.
+void set_speed(double speed);
+
 void push_samples(std::span<const int16_t> interleaved_stereo);
 
 struct Sink {
@@ -4,6 +4,7 @@
 #include "cop0.h"
 #include "cop1.h"
 #include "instruction.h"
+#include "utils/state_io.h"
 #include <array>
 #include <cstdint>
 #include <string_view>
@@ -100,6 +101,10 @@ class Cpu {
 
     void execute_instruction(instruction_t inst);
 
+    // GPRs, HI/LO, PC/delay-slot state, COP0 and COP1.
+    void save_state(Utils::StateWriter &w) const;
+    void load_state(Utils::StateReader &r);
+
     // Absolute addresses for the dynarec emitter (singleton layout).
     uint64_t *gpr_data() { return gpr.data(); }
     uint64_t *lo_ptr() { return &lo; }
@@ -160,6 +160,9 @@ constexpr uint8_t SPECIAL_FUNCT_SRA = 0b000011;    // SRA
 constexpr uint8_t SPECIAL_FUNCT_SRAV = 0b000111;   // SRAV
 constexpr uint8_t SPECIAL_FUNCT_SLLV = 0b000100;   // SLLV
 constexpr uint8_t SPECIAL_FUNCT_SRLV = 0b000110;   // SRLV
+constexpr uint8_t SPECIAL_FUNCT_DSLLV = 0b010100;  // DSLLV
+constexpr uint8_t SPECIAL_FUNCT_DSRLV = 0b010110;  // DSRLV
+constexpr uint8_t SPECIAL_FUNCT_DSRAV = 0b010111;  // DSRAV
 constexpr uint8_t SPECIAL_FUNCT_SLT = 0b101010;    // SLT
 constexpr uint8_t SPECIAL_FUNCT_SLTU = 0b101011;   // SLTU
 constexpr uint8_t SPECIAL_FUNCT_AND = 0b100100;    // AND
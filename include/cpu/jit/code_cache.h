@@ -3,7 +3,9 @@
 
 #include "memory/memory_map.h"
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -14,14 +16,74 @@ namespace Jit {
 
 using BlockFn = int (*)();
 
+struct CompiledBlock;
+
+// Static successor of a block. `jmp` is a rel32 JMP in the block's exit path
+// that either points at `unlinked` (return to the dispatcher) or, once
+// linked, straight at the successor's entry.
+struct BlockExit {
+    uint32_t target{0}; // successor paddr
+    uint8_t *jmp{nullptr};
+    uint8_t *unlinked{nullptr};
+    CompiledBlock *linked{nullptr};
+    // Times the block left this way (clean exits only); traces follow the
+    // exit that dominates.
+    uint32_t hits{0};
+};
+
+// An inline fastmem access: code offsets [begin, end) within the block, and
+// the slow path that redoes the whole op through a helper.
+struct FaultSite {
+    uint32_t begin;
+    uint32_t end;
+    uint32_t slow;
+};
+
+// One per IR successor (MAX_SUCCESSORS).
+constexpr int MAX_BLOCK_EXITS = 4;
+
 struct CompiledBlock {
     BlockFn fn{nullptr};
     uint32_t paddr{0};
+    // Guest bytes [begin, end) the code was translated from; begin is paddr
+    // except for a trace, whose later blocks may lie below its entry.
+    uint32_t begin{0};
+    uint32_t end{0};
     uint16_t num_insts{0};
+    // Translation inputs checked before a dropped block is revived.
+    uint32_t vaddr{0};
+    bool fr{false};
+    uint64_t checksum{0};
+    bool is_trace{false};
+    // Total exit hits at which the dispatcher next tries to form a trace.
+    uint32_t trace_at{0};
+    std::array<BlockExit, MAX_BLOCK_EXITS> exits{};
+    // Exits of other blocks currently patched to jump here.
+    std::vector<BlockExit *> incoming;
 };
 
+// Code lives in fixed-size slabs that act as generations: when the byte or
+// block budget is reached, the oldest slab is evicted as a whole (its blocks
+// unlinked and dropped) and reused as the newest. Hot code that was evicted
+// is simply recompiled into the current generation on its next miss.
 class CodeCache {
   public:
+    // Largest single reservation emit_block() makes (a full trace).
+    static constexpr size_t MAX_BLOCK_CODE = 64 * 1024;
+    static constexpr size_t SLAB_SIZE = 2 * 1024 * 1024;
+    static constexpr size_t DEFAULT_MAX_BLOCKS = 8192;
+    static constexpr size_t DEFAULT_MAX_SLAB_BYTES = 32 * 1024 * 1024;
+
+    struct Stats {
+        size_t blocks{0}; // records in all slabs, live or dropped
+        size_t slabs{0};
+        size_t slab_bytes{0};
+        size_t used_bytes{0};
+        uint64_t evicted_slabs{0};
+        uint64_t evicted_blocks{0};
+        uint64_t fault_patches{0};
+    };
+
     CodeCache();
     ~CodeCache();
 
@@ -29,55 +91,123 @@ class CodeCache {
     CodeCache &operator=(const CodeCache &) = delete;
 
     CompiledBlock *lookup(uint32_t paddr);
-    void insert(uint32_t paddr, BlockFn fn, uint16_t num_insts);
-
-    void invalidate_page(uint32_t paddr);
-    void invalidate_range(uint32_t paddr, uint32_t length);
+    // Allocates a block record before emission (the emitter embeds exit
+    // addresses); it becomes visible to lookup() only after insert().
+    CompiledBlock *new_block(uint32_t paddr);
+    void insert(CompiledBlock *block, BlockFn fn, uint16_t num_insts);
+    // A trace covering the guest bytes [begin, end), entered at its paddr.
+    void insert_trace(CompiledBlock *block, BlockFn fn, uint16_t num_insts,
+                      uint32_t begin, uint32_t end);
+
+    // An exit that left through its unlinked stub; linked if the dispatcher
+    // next enters the block it targets. Dropped on flush / invalidation.
+    void set_pending_exit(BlockExit *exit) { pending_exit_ = exit; }
+    bool link_pending(CompiledBlock *to);
+
+    // Forget one block (compiled under assumptions that no longer hold).
+    void drop(CompiledBlock *block);
+    // Drop only the blocks whose guest bytes overlap the write; returns how
+    // many were dropped. Dropped code stays in its slab until that slab is
+    // evicted, so an identical re-translation can revive it.
+    uint32_t invalidate_page(uint32_t paddr);
+    uint32_t invalidate_range(uint32_t paddr, uint32_t length);
     void clear();
 
+    // Last dropped block that started at `paddr`, if its code is still kept.
+    CompiledBlock *find_stale(uint32_t paddr) const;
+    // Make a block from find_stale() visible to lookup() again.
+    void revive(CompiledBlock *block);
+
+    // Budgets for eviction; at least two slabs are always allowed.
+    void set_limits(size_t max_slab_bytes, size_t max_blocks);
+    Stats stats() const;
+    void reset_eviction_counts() {
+        evicted_slabs_ = evicted_blocks_ = 0;
+        fault_patches_ = 0;
+    }
+
     // True if any compiled block lives on the 4KiB page containing paddr.
     bool page_has_code(uint32_t paddr) const;
 
-    // Bump-allocate executable bytes from a shared slab.
+    // Bump-allocate executable bytes from the newest slab. Never evicts;
+    // new_block() does that so block records stay valid during emission.
     uint8_t *alloc_exec(size_t size);
     // After emitting into a reservation, give back unused tail bytes.
     void shrink_last_alloc(size_t reserved, size_t used);
 
+    // Fastmem accesses of a block whose code starts at `code`.
+    void add_fault_sites(const uint8_t *code,
+                         const std::vector<FaultSite> &sites);
+    // A fault at `pc` inside a site: the site's first bytes become a jump to
+    // its slow path, for good, and the slow path's address is returned. 0
+    // if pc is not in a site. Runs in the fault handler and only patches
+    // code and reads the site map.
+    uintptr_t patch_fault_site(uintptr_t pc);
+
   private:
     static constexpr uint32_t PAGE_SHIFT = 12;
     static constexpr uint32_t PAGE_SIZE = 1u << PAGE_SHIFT;
     static constexpr uint32_t WORDS_PER_PAGE = PAGE_SIZE / 4;
     static constexpr uint32_t RDRAM_PAGES = RDRAM_SIZE >> PAGE_SHIFT; // 2048
-    // Guard against unbounded growth when code is invalidated and recompiled.
-    static constexpr size_t MAX_BLOCKS = 8192;
-    static constexpr size_t SLAB_SIZE = 2 * 1024 * 1024;
-    static constexpr size_t MAX_SLAB_BYTES = 32 * 1024 * 1024;
+
+    // Code bitmap granule: one bit of Page::code_mask per 64 bytes.
+    static constexpr uint32_t GRANULE_SHIFT = 6;
 
     struct Page {
         std::vector<CompiledBlock *> entries;
+        // Blocks overlapping this page, including ones that start on the
+        // previous page and run into it through a delay slot.
+        std::vector<CompiledBlock *> spans;
+        uint64_t code_mask{0};
         bool has_code{false};
     };
 
     struct Slab {
-        uint8_t *ptr;
-        size_t bytes;
-        size_t used;
+        uint8_t *ptr{nullptr};
+        size_t bytes{0};
+        size_t used{0};
+        // Records of blocks allocated while this was the newest slab; their
+        // code is here or in a newer slab, so evicting oldest-first never
+        // leaves a record pointing at reused memory.
+        std::vector<std::unique_ptr<CompiledBlock>> blocks;
     };
 
-    void maybe_flush();
+    void make_room();
+    void open_slab(size_t bytes);
+    void recycle_oldest_slab();
     void clear_lookup_hint() { last_hit_ = nullptr; }
     Page *get_or_create_page(uint32_t page_idx);
     Page *find_page(uint32_t page_idx) const;
+    void add_spans(CompiledBlock *block);
+    void remove_spans(CompiledBlock *block);
+    void drop_block(CompiledBlock *block);
+    // Patch `exit` to jump directly into `to`. No-op if out of rel32 range.
+    bool link(BlockExit &exit, CompiledBlock *to);
+    void retire(CompiledBlock *block);
+    static void unlink(BlockExit &exit);
 
     // Hot path: guest code almost always lives in RDRAM.
     std::array<Page *, RDRAM_PAGES> rdram_pages_{};
     std::unordered_map<uint32_t, std::unique_ptr<Page>> other_pages_;
     std::vector<std::unique_ptr<Page>> page_storage_;
-    std::vector<std::unique_ptr<CompiledBlock>> blocks_;
-    std::vector<Slab> slabs_;
+    std::unordered_map<uint32_t, CompiledBlock *> stale_;
+    std::vector<std::unique_ptr<Slab>> slabs_; // oldest first
+    // Fastmem sites by host address of their first byte.
+    struct HostSite {
+        uintptr_t end;
+        uintptr_t slow;
+    };
+    std::map<uintptr_t, HostSite> fault_sites_;
     size_t total_slab_bytes_{0};
+    size_t num_blocks_{0};
+    size_t max_slab_bytes_{DEFAULT_MAX_SLAB_BYTES};
+    size_t max_blocks_{DEFAULT_MAX_BLOCKS};
+    uint64_t evicted_slabs_{0};
+    uint64_t evicted_blocks_{0};
+    uint64_t fault_patches_{0};
     // One-entry cache: tight loops re-enter the same block constantly.
     CompiledBlock *last_hit_{nullptr};
+    BlockExit *pending_exit_{nullptr};
 };
 
 } // namespace Jit
@@ -0,0 +1,92 @@
+#ifndef CPU_JIT_COMPILE_WORKER_H
+#define CPU_JIT_COMPILE_WORKER_H
+
+#include "cpu/jit/code_cache.h"
+#include "cpu/jit/ir.h"
+#include "cpu/jit/ir_opt.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace N64 {
+namespace Cpu {
+namespace Jit {
+
+// imm64 operand at code offset `at` holding the record address + `addend`.
+struct RecordRef {
+    uint32_t at;
+    uint32_t addend;
+};
+
+// A block emitted off the emulation thread, into plain memory and against a
+// placeholder record. place_block() copies it into the cache and retargets
+// it at the real record.
+struct DetachedBlock {
+    std::vector<uint8_t> code;
+    CompiledBlock record;
+    std::vector<RecordRef> record_refs;
+    std::vector<FaultSite> fault_sites;
+};
+
+// One hot block handed to the compile thread. Inputs are filled in by the
+// emulation thread, which never touches the job again until it comes back
+// from take_finished(); `cancelled` is the only field both sides use.
+struct CompileJob {
+    uint32_t vaddr{0};
+    uint32_t paddr{0};
+    bool fr{false};
+    bool optimize{true};
+    // Guest words from paddr, read when the job was queued.
+    std::vector<uint32_t> words;
+    // Set when the IR came from the disk cache; translation is skipped.
+    bool have_ir{false};
+    std::atomic<bool> cancelled{false};
+
+    // Results.
+    bool ok{false};
+    IrBlock translated; // before optimization, for the disk cache
+    IrBlock ir;
+    IrOptStats opt;
+    DetachedBlock block;
+};
+
+// Translates, optimizes and emits queued jobs on a background thread. The
+// thread starts with the first job.
+class CompileWorker {
+  public:
+    CompileWorker() = default;
+    ~CompileWorker();
+
+    CompileWorker(const CompileWorker &) = delete;
+    CompileWorker &operator=(const CompileWorker &) = delete;
+
+    void submit(std::unique_ptr<CompileJob> job);
+    bool has_finished() const {
+        return has_finished_.load(std::memory_order_acquire);
+    }
+    // Done jobs, in completion order; the mutex orders their results.
+    std::vector<std::unique_ptr<CompileJob>> take_finished();
+
+  private:
+    void loop();
+    static void run(CompileJob &job);
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::unique_ptr<CompileJob>> queue_;
+    std::vector<std::unique_ptr<CompileJob>> finished_;
+    std::atomic<bool> has_finished_{false};
+    bool quit_{false};
+};
+
+} // namespace Jit
+} // namespace Cpu
+} // namespace N64
+
+#endif
@@ -7,12 +7,27 @@ namespace N64 {
 namespace Cpu {
 namespace Jit {
 
+struct BlockExit;
+struct CompiledBlock;
+
 // Shared state for the currently executing compiled block.
 struct ExecState {
     int cycles_done{0};
     bool aborted{false}; // exception / early exit
     // Set by branch-likely when the delay slot is annulled (not taken).
     bool annul_delay_slot{false};
+
+    // Native block linking: a linked exit jumps straight into the next block
+    // while link_budget stays positive and nothing below asks to stop.
+    // A helper touched MMIO / COP0 / COMPARE; let the dispatcher look.
+    bool link_break{false};
+    int32_t link_budget{0};
+    int32_t linked_cycles{0}; // earlier blocks of the current chain
+    uint32_t links_taken{0};
+    BlockExit *link_exit{nullptr}; // static exit taken while still unlinked
+    // Block stopped before an op it cannot run natively (COP1 guard); the
+    // dispatcher interprets that op.
+    CompiledBlock *bail_block{nullptr};
 };
 
 ExecState &exec_state();
@@ -45,10 +60,8 @@ void set_hi(uint64_t v);
 void set_lo(uint64_t v);
 uint64_t get_pc();
 
-void do_mult(uint8_t rs, uint8_t rt);
-void do_multu(uint8_t rs, uint8_t rt);
-void do_div(uint8_t rs, uint8_t rt);
-void do_divu(uint8_t rs, uint8_t rt);
+// DDIV by zero or INT64_MIN / -1; the emitter divides everything else.
+void do_ddiv(uint8_t rs, uint8_t rt);
 
 // Memory helpers. On TLB miss they take the exception and set aborted.
 void do_lb(uint8_t rt, uint8_t base, int16_t offset);
@@ -66,6 +79,14 @@ void do_sw(uint8_t rt, uint8_t base, int16_t offset);
 void do_sd(uint8_t rt, uint8_t base, int16_t offset);
 void do_swl(uint8_t rt, uint8_t base, int16_t offset);
 void do_swr(uint8_t rt, uint8_t base, int16_t offset);
+void do_ldl(uint8_t rt, uint8_t base, int16_t offset);
+void do_ldr(uint8_t rt, uint8_t base, int16_t offset);
+void do_sdl(uint8_t rt, uint8_t base, int16_t offset);
+void do_sdr(uint8_t rt, uint8_t base, int16_t offset);
+void do_ll(uint8_t rt, uint8_t base, int16_t offset);
+void do_lld(uint8_t rt, uint8_t base, int16_t offset);
+void do_sc(uint8_t rt, uint8_t base, int16_t offset);
+void do_scd(uint8_t rt, uint8_t base, int16_t offset);
 
 void do_mfc0(uint8_t rt, uint8_t rd);
 void do_mtc0(uint8_t rt, uint8_t rd);
@@ -74,8 +95,6 @@ void do_dmtc0(uint8_t rt, uint8_t rd);
 
 // COP1 / LWC1 / SWC1 / … via existing FpuImpl. Sets aborted on exception.
 void do_fpu(uint32_t raw);
-// BC1 with annul flag synced for Bc1l.
-void do_bc1(uint32_t raw);
 
 } // namespace Jit
 } // namespace Cpu
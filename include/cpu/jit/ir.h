@@ -9,6 +9,12 @@ namespace Cpu {
 namespace Jit {
 
 constexpr int MAX_BLOCK_INSNS = 64;
+// Traces: blocks joined along their usual path (see Dynarec::form_trace).
+constexpr int MAX_TRACE_BLOCKS = 4;
+constexpr int MAX_TRACE_INSNS = 2 * MAX_BLOCK_INSNS;
+// Taken target + fall-through of a conditional branch, plus the side exits
+// a trace collects.
+constexpr int MAX_SUCCESSORS = 4;
 
 enum class IrOpKind : uint8_t {
     Nop,
@@ -39,6 +45,9 @@ enum class IrOpKind : uint8_t {
     Dsll32,
     Dsrl32,
     Dsra32,
+    Dsllv,
+    Dsrlv,
+    Dsrav,
     // immediate (ADDI/DADDI match interpreter: overflow not trapped)
     Addiu,
     Andi,
@@ -77,12 +86,20 @@ enum class IrOpKind : uint8_t {
     Ld,
     Lwl,
     Lwr,
+    Ldl,
+    Ldr,
+    Ll,
+    Lld,
     Sb,
     Sh,
     Sw,
     Sd,
     Swl,
     Swr,
+    Sdl,
+    Sdr,
+    Sc,
+    Scd,
     // hi/lo
     Mfhi,
     Mflo,
@@ -92,6 +109,10 @@ enum class IrOpKind : uint8_t {
     Multu,
     Div,
     Divu,
+    Dmult,
+    Dmultu,
+    Ddiv,
+    Ddivu,
     // COP0
     Mfc0,
     Mtc0,
@@ -99,8 +120,26 @@ enum class IrOpKind : uint8_t {
     Dmtc0,
     // COP1 / FPU (helper-call; raw instruction in IrOp::target)
     Fpu,
+    // COP1 lowered natively; Status.CU1/FR checked once per block.
+    // Bc1/Bc1l: rt = nd/tf, imm = offset.
     Bc1,
     Bc1l,
+    // rs = base, rt = ft, imm = offset (raw in target for the slow path)
+    Lwc1,
+    Ldc1,
+    Swc1,
+    Sdc1,
+    // rt = GPR, rd = fs
+    Mfc1,
+    Mtc1,
+    Dmfc1,
+    Dmtc1,
+    // sa = fmt, imm = funct, rd = fd, rs = fs, rt = ft
+    Cop1Arith,
+    // Optimizer output: rd = sign-extended `target`.
+    LoadConst,
+    // Number of kinds; not an op.
+    Count,
 };
 
 struct IrOp {
@@ -110,8 +149,26 @@ struct IrOp {
     uint8_t rt{0};
     uint8_t sa{0};
     uint16_t imm{0};
-    // J/JAL target field, or raw instruction word for Fpu/Bc1/Bc1l helpers.
+    // J/JAL target field, raw instruction word for Fpu/Bc1/Bc1l helpers, or
+    // the LoadConst value.
     uint32_t target{0};
+    // Memory ops: the optimizer proved the address is this KSEG0/KSEG1
+    // RDRAM location, so the emitter skips the segment and soft-TLB checks.
+    bool const_paddr{false};
+    uint32_t paddr{0};
+};
+
+// Statically known next block (direct branch target or fall-through).
+struct IrSuccessor {
+    uint32_t vaddr{0};
+    uint32_t paddr{0};
+};
+
+// In a trace, ops from `op` on belong to the block at `vaddr`; they only run
+// if the previous block left towards it.
+struct IrSeam {
+    uint16_t op{0};
+    uint32_t vaddr{0};
 };
 
 struct IrBlock {
@@ -120,6 +177,13 @@ struct IrBlock {
     std::vector<IrOp> ops;
     // true if block ends because of branch/jump (delay slot included)
     bool ends_with_branch{false};
+    // Status.FR at translation; native COP1 register addressing assumes it.
+    bool fr{false};
+    // Direct-mapped successors the emitter may link to natively.
+    IrSuccessor successors[MAX_SUCCESSORS]{};
+    uint8_t num_successors{0};
+    // Empty unless this is a trace.
+    std::vector<IrSeam> seams;
 };
 
 } // namespace Jit
@@ -0,0 +1,55 @@
+#ifndef CPU_JIT_IR_DISK_CACHE_H
+#define CPU_JIT_IR_DISK_CACHE_H
+
+#include "cpu/jit/ir.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace N64 {
+namespace Cpu {
+namespace Jit {
+
+// Translated IR kept across runs, one file per ROM (header CRC1/CRC2) with
+// entries keyed by block paddr. The emitter still runs on every boot, so
+// this run's host addresses are baked in and no relocation is needed; what
+// is skipped is decoding the guest words. Callers validate an entry against
+// the current guest code with its checksum before using it.
+class IrDiskCache {
+  public:
+    struct Entry {
+        IrBlock ir;
+        uint64_t checksum{0};
+    };
+
+    ~IrDiskCache() { close(); }
+
+    // Empty path disables the cache. The file is read on the first find().
+    void open(const std::string &path, uint32_t crc1, uint32_t crc2);
+    // Writes new entries back, if any, and forgets everything.
+    void close();
+    bool enabled() const { return !path_.empty(); }
+
+    const Entry *find(uint32_t paddr);
+    void store(const IrBlock &ir, uint64_t checksum);
+    // Writes the file if anything was stored since it was read.
+    bool save();
+
+    size_t size() const { return entries_.size(); }
+
+  private:
+    void load();
+
+    std::string path_;
+    uint32_t crc1_{0};
+    uint32_t crc2_{0};
+    bool loaded_{false};
+    bool dirty_{false};
+    std::unordered_map<uint32_t, Entry> entries_;
+};
+
+} // namespace Jit
+} // namespace Cpu
+} // namespace N64
+
+#endif
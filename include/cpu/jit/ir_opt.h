@@ -0,0 +1,30 @@
+#ifndef CPU_JIT_IR_OPT_H
+#define CPU_JIT_IR_OPT_H
+
+#include "cpu/jit/ir.h"
+#include <cstdint>
+
+namespace N64 {
+namespace Cpu {
+namespace Jit {
+
+// Per-pass counters, summed over every optimized block.
+struct IrOptStats {
+    uint64_t blocks{0};
+    uint64_t ops{0};
+    uint64_t r0_folded{0};     // pure writes to $zero dropped
+    uint64_t consts_folded{0}; // ops turned into LoadConst
+    uint64_t copies{0};        // operands renamed through a register copy
+    uint64_t dead_writes{0};   // GPR writes overwritten before any read
+    uint64_t const_addrs{0};   // memory ops given a fixed RDRAM paddr
+};
+
+// Rewrites `block` in place; op count and order never change (dropped ops
+// become Nop), so per-op cycle and PC accounting are unaffected.
+void optimize_block(IrBlock &block, IrOptStats *stats = nullptr);
+
+} // namespace Jit
+} // namespace Cpu
+} // namespace N64
+
+#endif
@@ -2,8 +2,14 @@
 #define CPU_JIT_JIT_H
 
 #include "cpu/jit/code_cache.h"
+#include "cpu/jit/compile_worker.h"
 #include "cpu/jit/ir.h"
+#include "cpu/jit/ir_disk_cache.h"
+#include "cpu/jit/ir_opt.h"
 #include <cstdint>
+#include <span>
+#include <string>
+#include <unordered_map>
 
 namespace N64 {
 namespace Cpu {
@@ -13,10 +19,36 @@ class Dynarec {
   public:
     void reset();
 
-    // Soft-chain blocks up to `budget` cycles; advances RSP + scheduler after
-    // each unit. Always returns >= 1 with matching machine advance.
+    // Run blocks up to `budget` cycles; advances RSP + scheduler after each
+    // unit. Blocks with static successors jump into each other natively
+    // until the link budget runs out. Always returns >= 1 with matching
+    // machine advance.
     int run(int budget);
 
+    // Off: every block returns to the dispatcher (soft chaining only).
+    void set_linking(bool on) { linking_ = on; }
+    // Off: IR goes to the emitter as translated (see ir_opt.h).
+    void set_optimize(bool on) { optimize_ = on; }
+    // >0: cold code runs on the decode-cache interpreter and a block is
+    // compiled on the compile thread once entered this many times. 0: every
+    // miss compiles synchronously.
+    void set_tiering(unsigned threshold) { tier_threshold_ = threshold; }
+    // On: blocks that keep leaving the same way are recompiled together
+    // with their successors as one trace.
+    void set_tracing(bool on) { tracing_ = on; }
+    void set_cache_limits(size_t code_bytes, size_t blocks) {
+        cache_.set_limits(code_bytes, blocks);
+    }
+    CodeCache::Stats cache_stats() const { return cache_.stats(); }
+    void reset_cache_counters() { cache_.reset_eviction_counts(); }
+    // Persistent IR for this ROM (empty path: off). Opening another file
+    // saves the previous one first.
+    void open_disk_cache(const std::string &path, uint32_t crc1,
+                         uint32_t crc2) {
+        disk_cache_.open(path, crc1, crc2);
+    }
+    void save_disk_cache() { disk_cache_.save(); }
+
     void invalidate_page(uint32_t paddr);
     void invalidate_range(uint32_t paddr, uint32_t length);
 
@@ -30,9 +62,38 @@ class Dynarec {
     Dynarec() = default;
 
     CompiledBlock *compile(uint32_t vaddr, uint32_t paddr);
+    // A dropped block whose guest words and translation state are unchanged.
+    CompiledBlock *revalidate(uint32_t vaddr, uint32_t paddr);
+    CompiledBlock *build(uint32_t vaddr, uint32_t paddr, IrOptStats *stats);
+    // Tiered mode: count an entry into cold code, queueing it once hot.
+    void note_cold(uint32_t vaddr, uint32_t paddr);
+    // Safe point: move finished background compiles into the cache.
+    void publish_compiled();
+    bool publish_one(CompileJob &job);
+    void cancel_queued(uint32_t paddr, uint32_t length);
+    // Interpret one block's worth of cold code.
+    int run_cold();
+    // Join `head` with the blocks its dominant exits lead to; returns the
+    // trace now at head's paddr, or head if none formed.
+    CompiledBlock *form_trace(CompiledBlock *head);
+    // IR of a live (non-trace) block, as it was compiled.
+    bool retranslate(const CompiledBlock &block, IrBlock &out);
+    // Cached translation still matching the guest words and Status.FR.
+    bool load_disk_ir(uint32_t vaddr, uint32_t paddr, IrBlock &out,
+                      uint64_t &checksum);
     int run_interpreter_fallback();
 
     CodeCache cache_;
+    IrDiskCache disk_cache_;
+    bool linking_{true};
+    bool optimize_{true};
+    unsigned tier_threshold_{0};
+    bool tracing_{true};
+    // Entries into cold code, by block paddr.
+    std::unordered_map<uint32_t, uint32_t> heat_;
+    // Jobs handed to worker_ and not yet published, by block paddr.
+    std::unordered_map<uint32_t, CompileJob *> queued_;
+    CompileWorker worker_;
     static Dynarec instance_;
 };
 
@@ -43,11 +104,38 @@ void invalidate_code_page(uint32_t paddr);
 void invalidate_code_range(uint32_t paddr, uint32_t length);
 
 bool translate_block(uint32_t vaddr, uint32_t paddr, IrBlock &out);
-BlockFn emit_block(const IrBlock &block, CodeCache &cache);
+// Same, from a snapshot of the guest words at `paddr` (compile thread).
+bool translate_block(uint32_t vaddr, uint32_t paddr, bool fr,
+                     std::span<const uint32_t> words, IrBlock &out);
+// Fills out.exits with the block's patchable successor jumps.
+BlockFn emit_block(const IrBlock &block, CodeCache &cache, CompiledBlock &out);
+
+// See DetachedBlock. Emission itself only reads fixed host addresses, so it
+// is safe on the compile thread.
+bool emit_block_detached(const IrBlock &block, DetachedBlock &out);
+BlockFn place_block(const DetachedBlock &block, CodeCache &cache,
+                    CompiledBlock &out);
 
 // Dumps + resets JIT timing counters (N64_PROFILE_FRAME or N64_PROFILE_JIT).
 void jit_profile_dump();
 
+struct JitProfileTotals {
+    double compile_ms = 0; // emulation thread only
+    uint64_t compiles = 0;
+    uint64_t traces = 0;
+    uint64_t native_calls = 0;
+    uint64_t native_cycles = 0;
+    uint64_t fallback_calls = 0;
+    uint64_t fallback_cycles = 0;
+    uint64_t code_bytes = 0; // live, not reset
+};
+
+// Counts without the env vars (kamo64-bench); N64_PROFILE_JIT_TIMES still
+// gates the per-call timers.
+void jit_profile_enable();
+// Same counters as jit_profile_dump, returned instead of logged.
+JitProfileTotals jit_profile_take();
+
 } // namespace Jit
 } // namespace Cpu
 } // namespace N64
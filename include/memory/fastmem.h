@@ -0,0 +1,50 @@
+#ifndef MEMORY_FASTMEM_H
+#define MEMORY_FASTMEM_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace N64 {
+namespace Fastmem {
+
+// Optional host view of the guest physical address space: a 4 GiB
+// reservation with RDRAM mapped at offset 0 and everything else left
+// inaccessible, so base() + paddr either is RDRAM or faults. RDRAM pages
+// that hold compiled or decoded code are read-only in this view; the
+// regular RDRAM pointer (Memory::get_rdram) aliases the same pages and
+// always stays writable.
+
+// Zero-filled backing store for RDRAM. Shared memory where fastmem is
+// supported so the arena can map the same pages; plain heap otherwise.
+uint8_t *alloc_rdram(size_t size);
+
+// Reserves the arena and installs the fault handler on first use. Returns
+// false (with a warning) on hosts without support (Windows, non-x86-64);
+// fastmem then stays off. Turning it off drops all code-page protection.
+bool set_enabled(bool on);
+bool enabled();
+// Start of the arena; valid once set_enabled(true) has succeeded.
+uint8_t *base();
+
+// A page is read-only in the arena while any owner holds it.
+enum CodeOwner : uint8_t {
+    CODE_JIT = 1,
+    CODE_DECODE = 2,
+};
+void set_code_page(uint32_t paddr, CodeOwner owner, bool on);
+void clear_code_pages(CodeOwner owner);
+
+// False only when fastmem is on and paddr's RDRAM page holds no code, so
+// a store there cannot need a code-cache probe.
+bool may_hold_code(uint32_t paddr);
+
+// Called from the fault handler for an access inside the arena. Returns
+// where to resume, or 0 if `pc` is not a known fastmem access (the fault
+// is then passed to the previous handler). Must be async-signal-safe.
+using FaultFixup = uintptr_t (*)(uintptr_t pc);
+void set_fault_fixup(FaultFixup fixup);
+
+} // namespace Fastmem
+} // namespace N64
+
+#endif
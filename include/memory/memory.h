@@ -3,7 +3,9 @@
 
 #include "ri.h"
 #include "rom.h"
+#include "utils/state_io.h"
 #include <cstdint>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -11,7 +13,8 @@ namespace N64 {
 namespace Memory {
 
 class Memory {
-    std::vector<uint8_t> rdram;
+    // Fixed for the process lifetime (see Fastmem::alloc_rdram).
+    std::span<uint8_t> rdram;
     std::vector<uint8_t> sram;
     std::string data_dir{"."};
     std::string sram_path;
@@ -26,22 +29,33 @@ class Memory {
 
     // Root app folder (e.g. ~/.local/share/kamo64). Saves go under save/.
     void set_data_dir(const std::string &dir);
+    const std::string &get_data_dir() const { return data_dir; }
 
     void load_rom(const std::string &rom_filepath);
 
     // Write cartridge SRAM to disk if allocated (no-op otherwise).
     void persist_sram();
 
+    // Per-game file under the save directory (save/<title>/<filename>).
+    std::string cart_save_path(const char *filename) const;
+
+    // RI, RDRAM and SRAM. Loading copies and invalidates only RDRAM pages
+    // whose contents differ, so code caches for unchanged pages survive.
+    void save_state(Utils::StateWriter &w) const;
+    void load_state(Utils::StateReader &r);
+    // Reads a section as load_state would, failing where it would, without
+    // applying anything.
+    void check_state(Utils::StateReader &r) const;
+
     static Memory &get_instance();
 
-    std::vector<uint8_t> &get_rdram();
+    const std::span<uint8_t> &get_rdram();
 
     std::vector<uint8_t> &get_sram();
 
   private:
     void allocate_sram();
     void load_sram_file();
-    std::string cart_save_path(const char *filename) const;
 
     static Memory instance;
 };
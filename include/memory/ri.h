@@ -1,6 +1,7 @@
 #ifndef ri_H
 #define ri_H
 
+#include "utils/state_io.h"
 #include <cstdint>
 
 namespace N64 {
@@ -30,6 +31,9 @@ class RI {
     uint32_t read_paddr32(uint32_t paddr) const;
 
     void write_paddr32(uint32_t paddr, uint32_t value);
+
+    void save_state(Utils::StateWriter &w) const;
+    void load_state(Utils::StateReader &r);
 };
 
 } // namespace Memory
@@ -83,6 +83,10 @@ class Rom {
 
     SaveType get_save_type() const;
 
+    // Header checksums (ROM identity for save states and caches).
+    uint32_t get_crc1() const;
+    uint32_t get_crc2() const;
+
     std::vector<uint8_t> &get_raw_data();
 
     // Trimmed cartidge title from the ROM header (20-char image_name field).
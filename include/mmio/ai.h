@@ -1,6 +1,7 @@
 ﻿#ifndef AI_H
 #define AI_H
 
+#include "utils/state_io.h"
 #include <cstdint>
 
 namespace N64 {
@@ -65,6 +66,9 @@ class AI {
 
     int get_fifo_count() const { return fifo_count; }
 
+    void save_state(Utils::StateWriter &w) const;
+    void load_state(Utils::StateReader &r);
+
     static AI &get_instance();
 
   private:
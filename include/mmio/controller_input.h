@@ -16,6 +16,15 @@ void poll_host();
 void set_controller_state(int channel, const Mmio::N64ControllerState &state);
 Mmio::N64ControllerState get_controller_state(int channel);
 
+// Sees every Joybus controller read with the live host state and returns
+// what the game gets instead (movie record / playback).
+using PifReadHookFn = Mmio::N64ControllerState (*)(
+    int channel, const Mmio::N64ControllerState &live);
+void set_pif_read_hook(PifReadHookFn fn);
+
+// Host refresh, then `channel` through the read hook.
+Mmio::N64ControllerState read_for_pif(int channel);
+
 } // namespace Input
 } // namespace N64
 
@@ -2,6 +2,7 @@
 #define MI_H
 
 #include "utils/pack.h"
+#include "utils/state_io.h"
 #include <cstdint>
 
 namespace N64 {
@@ -89,6 +90,9 @@ class MI {
 
     mi_intr_mask_t &get_reg_intr_mask() { return reg_intr_mask; }
 
+    void save_state(Utils::StateWriter &w) const;
+    void load_state(Utils::StateReader &r);
+
     inline static MI &get_instance() { return instance; }
 };
 
@@ -1,6 +1,7 @@
 ﻿#ifndef PI_H
 #define PI_H
 
+#include "utils/state_io.h"
 #include <cstdint>
 
 namespace N64 {
@@ -80,6 +81,9 @@ class PI {
 
     void write_paddr32(uint32_t paddr, uint32_t value);
 
+    void save_state(Utils::StateWriter &w) const;
+    void load_state(Utils::StateReader &r);
+
     inline static PI &get_instance() { return instance; }
 
   private:
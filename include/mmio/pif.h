@@ -101,7 +101,7 @@ class Pif {
   private:
     void process_controller_command(int channel, uint8_t *cmd);
 
-    N64ControllerState poll_n64_controller() const;
+    N64ControllerState poll_n64_controller(int channel) const;
 };
 
 } // namespace Mmio
@@ -2,6 +2,7 @@
 #define SI_H
 
 #include "mmio/pif.h"
+#include "utils/state_io.h"
 #include <cstdint>
 
 namespace N64 {
@@ -38,6 +39,10 @@ class SI {
 
     void dma_from_dram_to_pif();
 
+    // Includes PIF RAM.
+    void save_state(Utils::StateWriter &w) const;
+    void load_state(Utils::StateReader &r);
+
     inline static SI &get_instance() { return instance; }
 
     Pif pif;
@@ -1,6 +1,7 @@
 ﻿#ifndef VI_H
 #define VI_H
 
+#include "utils/state_io.h"
 #include <cstdint>
 
 namespace N64 {
@@ -75,6 +76,9 @@ class VI {
 
     int get_num_fields() const;
 
+    void save_state(Utils::StateWriter &w) const;
+    void load_state(Utils::StateReader &r);
+
     inline static VI &get_instance() { return instance; }
 };
 
@@ -9,20 +9,33 @@ namespace N64 {
 namespace Mmu {
 
 // Direct-mapped VA page -> PA page cache for JIT / interpreter memory helpers.
-// Invalidated on every TLBWI/TLBWR/reset. Only caches RDRAM-backed pages.
+// Entries are tagged with the ASID they were filled under, so switching
+// address spaces keeps them; a TLBWI/TLBWR drops only the pages of the
+// entry it replaces and the one it writes. Only caches RDRAM-backed pages.
 struct SoftTlbEntry {
-    uint32_t vpn{0xFFFFFFFFu}; // vaddr >> 12; 0xFFFFFFFF = empty
+    uint32_t tag{0xFFFFFFFFu}; // ASID << 20 | vaddr >> 12; ~0 = empty
     uint32_t pa_page{0};       // paddr & ~0xFFFu
 };
 
 constexpr uint32_t SOFT_TLB_BITS = 12;
 constexpr uint32_t SOFT_TLB_SIZE = 1u << SOFT_TLB_BITS;
 constexpr uint32_t SOFT_TLB_MASK = SOFT_TLB_SIZE - 1;
+constexpr uint32_t SOFT_TLB_ASID_SHIFT = 20;
+constexpr uint32_t SOFT_TLB_VPN_MASK = (1u << SOFT_TLB_ASID_SHIFT) - 1;
 
 SoftTlbEntry *soft_tlb_load_table();
 SoftTlbEntry *soft_tlb_store_table();
 
+// Tag of a VA page under the current EntryHi.ASID.
+inline uint32_t soft_tlb_tag(uint32_t vaddr) {
+    const uint32_t asid = static_cast<uint32_t>(
+        Cpu::Cpu::get_instance().cop0.reg.entry_hi.asid);
+    return (asid << SOFT_TLB_ASID_SHIFT) | (vaddr >> 12);
+}
+
 void soft_tlb_invalidate();
+// Drop every cached page in [vaddr, vaddr + length), whatever its ASID.
+void soft_tlb_invalidate_range(uint32_t vaddr, uint64_t length);
 
 // Update after a successful resolve to RDRAM (page-aligned mapping).
 void soft_tlb_note_load(uint32_t vaddr, uint32_t paddr);
@@ -39,7 +52,7 @@ inline std::optional<uint32_t> soft_tlb_lookup(uint32_t vaddr,
     const SoftTlbEntry &e =
         is_store ? soft_tlb_store_table()[vpn & SOFT_TLB_MASK]
                  : soft_tlb_load_table()[vpn & SOFT_TLB_MASK];
-    if (e.vpn != vpn)
+    if (e.tag != soft_tlb_tag(vaddr))
         return std::nullopt;
     return e.pa_page | (vaddr & 0xFFFu);
 }
@@ -3,6 +3,7 @@
 
 #include "cpu/cop0.h"
 #include "cpu/cpu.h"
+#include "utils/state_io.h"
 #include <cstdint>
 #include <optional>
 
@@ -78,16 +79,35 @@ class TLB {
 
     const TLBEntry &entry_at(int index) const { return entries[index & 0x1f]; }
 
+    // Loading drops the soft TLB; it refills on the next miss.
+    void save_state(Utils::StateWriter &w) const;
+    void load_state(Utils::StateReader &r);
+
     inline static TLB &get_instance() { return instance; }
 
   private:
+    // Valid entries indexed by page size and hashed VPN2, so a lookup only
+    // compares the few entries that can match.
+    static constexpr int PAGE_SIZES = 7; // 4 KiB .. 16 MiB
+    static constexpr uint32_t VPN_BUCKETS = 64;
+
     TLBEntry entries[32];
     TLBError error;
+    uint32_t by_vpn[PAGE_SIZES][VPN_BUCKETS]{}; // entry bitmasks
+    uint32_t by_size[PAGE_SIZES]{};
+    // Entries with a PageMask no write produces (old save states).
+    uint32_t odd_masks{0};
 
     static TLB instance;
 
     static uint64_t calculate_vpn(uint64_t vaddr, uint32_t page_mask);
     static uint64_t sign_extend_vaddr32(uint32_t vaddr);
+    static uint32_t vpn_bucket(uint64_t vpn, int size);
+    void index_add(int index);
+    void index_remove(int index);
+    void rebuild_index();
+    // Soft-TLB pages the entry maps.
+    static void invalidate_soft_tlb(const TLBEntry &entry);
 };
 
 } // namespace Mmu
@@ -36,14 +36,69 @@ struct Config {
 #else
     CpuBackend cpu_backend{CpuBackend::Interpreter};
 #endif
+    // Dynarec: jump between blocks natively instead of via the dispatcher.
+    bool jit_link{true};
+    // Dynarec: constant/copy propagation and dead-write elimination on IR.
+    bool jit_opt{true};
+    // Dynarec code cache budget; the oldest 2 MiB slab is evicted beyond it.
+    unsigned jit_cache_mb{32};
+    unsigned jit_cache_blocks{8192};
+    // Dynarec: >0 interprets cold code and compiles a block on a background
+    // thread after this many entries; 0 compiles every block on first use.
+    unsigned jit_tier{0};
+    // Dynarec: recompile hot block sequences as single traces.
+    bool jit_trace{true};
+    // Dynarec: keep translated IR on disk across runs, per ROM. Empty dir:
+    // <app data>/jitcache.
+    bool jit_disk_cache{false};
+    std::string jit_disk_cache_dir{};
+    // Map RDRAM into a reserved 4 GiB host range: the dynarec and the decode
+    // interpreter access base + paddr, and faults divert MMIO and stores to
+    // code pages (Linux/macOS x86-64).
+    bool fastmem{false};
     // No SDL window / Vulkan present (for CPU tests and CI).
     bool headless{false};
+    // Headless: >0 stops after this many VI fields and logs state_hash().
+    unsigned max_fields{0};
+    // Field pacing relative to real time (1.0 = 60 fields/s).
+    // 0 = unthrottled: no pacing, audio output muted.
+    double speed{1.0};
+    // Defer RSP tasks until the CPU can observe them (same timing as eager).
+    bool rsp_lazy{false};
+    // Recompile RSP microcode to x86-64 (interpreter elsewhere).
+    bool rsp_jit{false};
+    // SIMD VU kernels when built with N64_RSP_SIMD; off runs the scalar path.
+    bool rsp_simd{true};
+    // Run deferred RSP tasks on a worker thread, overlapping the CPU.
+    bool rsp_threaded{false};
+    // Threaded, and replay every worker run to prove it matches (slow).
+    bool rsp_threaded_check{false};
+    // Run standard audio ucode tasks natively (LLE for anything else).
+    bool audio_hle{false};
+    // Run audio tasks both ways and report where HLE differs (LLE is kept).
+    bool audio_hle_compare{false};
+    // Headless: rasterize RDP commands on the CPU (no Vulkan needed).
+    bool soft_rdp{false};
+    // Headless: write every VI field as DIR/frame_NNNNNN.ppm (implies soft_rdp).
+    std::string dump_frames_dir{};
+    // Headless: drive controller 1 from this script (see --input-script).
+    std::string input_script{};
     unsigned upscale{4};
     // Frame interpolation (duplicate VI fields -> intermediates).
     bool frame_interp{false};
     FrameInterpMode frame_interp_mode{FrameInterpMode::OpticalFlow};
     // Preferred Vulkan physical device UUID (hex). Empty = auto-select.
     std::string vulkan_device{};
+    // Record every controller read to this movie file.
+    std::string movie_record{};
+    // Start the recording from this save state instead of power-on.
+    std::string movie_state{};
+    // Replay controller reads from this movie file (overrides host input).
+    std::string movie_play{};
+    // Start from this save state instead of power-on.
+    std::string start_state{};
+    // Headless with max_fields: write a save state here when the run stops.
+    std::string final_state{};
 };
 
 } // namespace N64System
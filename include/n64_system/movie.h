@@ -0,0 +1,43 @@
+#ifndef N64_SYSTEM_MOVIE_H
+#define N64_SYSTEM_MOVIE_H
+
+#include <cstdint>
+#include <string>
+
+namespace N64 {
+namespace Movie {
+
+// Bump whenever the header or record layout changes.
+constexpr uint32_t MOVIE_VERSION = 1;
+
+// A movie is a start point (power-on, or an embedded snapshot) followed by
+// every Joybus controller read on all 4 channels, keyed by VI field and
+// read index within that field. Replaying it from the same start point
+// feeds the game the same input at the same reads.
+
+// Starts recording after N64System::set_up. With a non-empty `state_path`
+// the machine first loads that snapshot and the movie embeds it. Records
+// are appended as they happen, so a killed run keeps what it recorded.
+bool start_recording(const std::string &path, const std::string &state_path);
+
+// Loads `path` and applies its start point. The ROM must already be set up
+// from power-on; a snapshot movie then loads its embedded state.
+bool start_playback(const std::string &path);
+
+// Closes a recording / drops a playback and unhooks controller reads.
+void stop();
+
+bool recording();
+bool playing();
+// Playback has used every record; later reads see a released controller.
+bool finished();
+
+// Called once per VI field by N64System::step.
+void on_field();
+// Fields since the movie started.
+uint64_t field();
+
+} // namespace Movie
+} // namespace N64
+
+#endif
@@ -35,6 +35,16 @@ void set_present_stats_fn(PresentStatsFn fn);
 
 void step(Config &config);
 
+// FNV-1a over RDRAM, SP DMEM and SP IMEM once any deferred RSP task has
+// caught up; equal across CPU/RSP backends for the same run. Only valid
+// between step() calls.
+uint64_t state_hash();
+
+// Runtime fast-forward (GUI hotkey): while on, fields run unthrottled
+// regardless of Config::speed.
+void set_fast_forward(bool on);
+bool fast_forward();
+
 } // namespace N64System
 } // namespace N64
 
@@ -0,0 +1,33 @@
+#ifndef N64_SYSTEM_SAVE_STATE_H
+#define N64_SYSTEM_SAVE_STATE_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace N64 {
+namespace N64System {
+
+// Bump whenever any section layout changes; older snapshots are rejected.
+constexpr uint32_t SAVE_STATE_VERSION = 3;
+
+// Whole-machine snapshot: header (magic, version, ROM CRC1/CRC2) followed by
+// tagged sections (CPU, TLB, RSP, DPC, PI, SI, AI, VI, MI, scheduler, memory).
+// Only valid between N64System::step() calls.
+void save_state(std::vector<uint8_t> &out);
+
+// Returns false without touching the machine if the snapshot doesn't match
+// this build: the header, every section's framing and every section's
+// contents (sizes and the values its loader rejects) are checked before
+// anything is applied. Derived caches (JIT, decode cache, RSP IMEM decode)
+// are dropped or refilled lazily, never rebuilt here.
+bool load_state(std::span<const uint8_t> in);
+
+bool save_state_file(const std::string &path);
+bool load_state_file(const std::string &path);
+
+} // namespace N64System
+} // namespace N64
+
+#endif
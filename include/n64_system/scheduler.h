@@ -1,57 +1,49 @@
 ﻿#ifndef SCHEDULER_H
 #define SCHEDULER_H
 
+#include "utils/state_io.h"
+#include <array>
+#include <cstddef>
 #include <cstdint>
-#include <functional>
-#include <queue>
-#include <utility>
-#include <vector>
 
 namespace N64 {
 namespace N64System {
 
-class Event {
-  private:
-    std::function<void()> f;
-
-  public:
-    Event(std::function<void()> callback) : f(std::move(callback)) {}
-
-    void perform() { f(); }
-};
-
-using scheduled_event_t = std::pair<uint64_t, Event>;
-
-struct ScheduledEventEarlier {
-    bool operator()(const scheduled_event_t &a,
-                    const scheduled_event_t &b) const {
-        return a.first > b.first;
-    }
-};
-
-enum class NamedEventId : int {
-    Sp = 0,
-    SpDma = 1,
-    Count = 2,
+// Timer events are identified by kind rather than a callback so pending
+// events can be written to a save state. Handlers live in scheduler.cpp.
+// Kind also breaks ties between events due at the same cycle.
+enum class EventKind : uint8_t {
+    AiDmaComplete = 0,
+    PiDmaWriteComplete = 1,
+    PiDmaReadComplete = 2,
+    SpTask = 3,
+    Count = 4,
 };
 
 class Scheduler {
   private:
     static Scheduler instance;
 
-    std::priority_queue<scheduled_event_t, std::vector<scheduled_event_t>,
-                        ScheduledEventEarlier>
-        event_queue;
-
-    struct NamedEvent {
-        bool enabled = false;
-        uint64_t at = 0;
-        std::function<void()> cb;
+    struct Pending {
+        uint64_t at;
+        EventKind kind;
     };
-    NamedEvent named_[static_cast<int>(NamedEventId::Count)]{};
+    // Upper bound on simultaneously pending events: AI queues two DMAs,
+    // every other kind has at most one in flight.
+    static constexpr size_t MAX_PENDING = 8;
+
+    // Sorted latest first, so the next event is at the back.
+    std::array<Pending, MAX_PENDING> pending_{};
+    size_t num_pending_{0};
+    uint64_t next_at_{UINT64_MAX};
 
     uint64_t current_time;
 
+    void insert(uint64_t at, EventKind kind);
+    void remove_kind(EventKind kind);
+    void update_next() {
+        next_at_ = num_pending_ ? pending_[num_pending_ - 1].at : UINT64_MAX;
+    }
     bool dispatch_one_due();
 
   public:
@@ -59,15 +51,46 @@ class Scheduler {
 
     void init();
 
-    void set_timer(uint64_t cycles, Event event);
-    void schedule_named(NamedEventId id, uint64_t cycles,
-                        std::function<void()> cb);
-    void cancel_named(NamedEventId id);
+    // Adds an event; several of one kind may be pending.
+    void set_timer(uint64_t cycles, EventKind kind);
+    // Single-instance events: rescheduling replaces the pending one.
+    void schedule(EventKind kind, uint64_t cycles);
+    // Absolute time; may already be due (dispatched on the next tick).
+    void schedule_at(EventKind kind, uint64_t at);
+    void cancel(EventKind kind);
 
     void tick(uint64_t cycles = 1);
 
     uint64_t get_current_time() const { return current_time; }
-    uint64_t cycles_until_next_event() const;
+    uint64_t cycles_until_next_event() const {
+        if (next_at_ == UINT64_MAX)
+            return UINT64_MAX;
+        return next_at_ <= current_time ? 0 : next_at_ - current_time;
+    }
+
+    void save_state(Utils::StateWriter &w) const;
+    void load_state(Utils::StateReader &r);
+    // Reads a section as load_state would, failing where it would, without
+    // applying anything.
+    static void check_state(Utils::StateReader &r);
+
+    // Scoped: work done for an RSP task reads and schedules relative to the
+    // task's own time, which may be ahead of the CPU (eager) or behind it
+    // (deferred). Nothing may tick inside the scope.
+    class TimeShift {
+      public:
+        TimeShift(Scheduler &s, uint64_t time)
+            : s_(s), saved_(s.current_time) {
+            s_.current_time = time;
+        }
+        ~TimeShift() { s_.current_time = saved_; }
+        TimeShift(const TimeShift &) = delete;
+        TimeShift &operator=(const TimeShift &) = delete;
+
+      private:
+        Scheduler &s_;
+        uint64_t saved_;
+    };
 
     inline static Scheduler &get_instance() { return instance; }
 };
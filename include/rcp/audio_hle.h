@@ -0,0 +1,38 @@
+#ifndef RCP_AUDIO_HLE_H
+#define RCP_AUDIO_HLE_H
+
+#include <cstdint>
+#include <span>
+
+namespace N64 {
+namespace Rsp {
+
+// High-level emulation of audio tasks (OSTask type 2) for the standard
+// libultra audio ucode (ABI1). The ucode is identified by its data segment
+// and cached by a hash of its text and data; anything else stays LLE.
+//
+// Compare mode runs each recognised task natively, records what it would
+// have written with SAVEBUFF, undoes its RDRAM writes and lets LLE run the
+// task. When the LLE run ends, its output is checked against the record.
+void set_audio_hle(bool on, bool compare);
+bool audio_hle();
+
+// Called when the CPU starts a task. Returns the task's estimated RSP
+// cycles if it ran natively, or 0 to run it through LLE (always 0 in
+// compare mode).
+uint32_t audio_hle_task(std::span<const uint8_t> dmem);
+
+// Compare mode: the LLE run of the last recorded task has ended.
+void audio_hle_check();
+
+// Compare mode: logs how many checked tasks differed and returns false if
+// any did. Always true outside compare mode.
+bool audio_hle_compare_passed();
+
+// Drops per-session state (identified ucodes, a pending comparison).
+void audio_hle_reset();
+
+} // namespace Rsp
+} // namespace N64
+
+#endif
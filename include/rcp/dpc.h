@@ -2,6 +2,7 @@
 #define DPC_H
 
 #include "utils/pack.h"
+#include "utils/state_io.h"
 #include <cstdint>
 
 namespace N64 {
@@ -61,6 +62,13 @@ class Dpc {
     uint32_t get_end() const { return end; }
     uint32_t get_current() const { return current; }
 
+    // Includes the partial command carried across submissions.
+    void save_state(Utils::StateWriter &w) const;
+    void load_state(Utils::StateReader &r);
+    // Reads a section as load_state would, failing where it would, without
+    // applying anything.
+    static void check_state(Utils::StateReader &r);
+
     inline static Dpc &get_instance() { return instance; }
 
   private:
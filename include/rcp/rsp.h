@@ -1,9 +1,15 @@
 #ifndef RSP_H
 #define RSP_H
 
+#include "memory/memory_map.h"
+#include "rcp/rsp_worker.h"
+#include "rcp/vu_profile.h"
 #include "utils/pack.h"
+#include "utils/state_io.h"
 #include <array>
+#include <bitset>
 #include <cstdint>
+#include <vector>
 
 namespace N64 {
 namespace Rsp {
@@ -148,7 +154,13 @@ struct AccRegs {
     VuReg l{};
 };
 
+class RspJit;
+class RspEmitter;
+
 class Rsp {
+    friend class RspJit;
+    friend class RspEmitter;
+
   public:
     using ImemFn = void (*)(Rsp &, uint32_t);
 
@@ -175,6 +187,8 @@ class Rsp {
 
     bool sync_point_{false};
     bool broken_{false};
+    // The current task ran through audio HLE; it ends at its SpTask event.
+    bool hle_task_{false};
     bool task_halted_{false};
     bool running_task_{false};
     bool run_after_dma_{false};
@@ -182,6 +196,36 @@ class Rsp {
     uint32_t last_dpc_busy_{0};
     uint64_t task_cycle_counter_{0};
 
+    // Lazy mode: do_task() only records the task start; it runs at the first
+    // point the CPU could tell the difference (see sync* below).
+    bool lazy_{false};
+    // Run tasks through the recompiler (rsp_jit.cpp) where it can.
+    bool jit_{false};
+    bool task_pending_{false};
+    // Threaded mode: a deferred slice starts on worker_ right away and runs
+    // until its next COP0 access, the only instructions that reach outside
+    // the RSP. poll_worker() performs that access on the CPU thread and
+    // hands the rest back; observation points finish the slice as in lazy
+    // mode. Check mode replays every worker run from a snapshot.
+    bool threaded_{false};
+    bool thread_check_{false};
+    bool slice_begun_{false};
+    bool slice_ended_{false};
+    bool worker_pending_{false};
+    uint32_t slice_insns_{0};
+    uint32_t check_insns_{0};
+    // Profile tallies of the current slice, kept here so the worker never
+    // touches the shared profiles; see flush_profile().
+    uint64_t slice_vu_ops_{0};
+    VuProfileCounts vu_counts_{};
+    std::vector<uint8_t> check_snapshot_;
+    RspWorker worker_;
+    uint64_t task_start_{0};
+    // RDRAM pages any SP DMA has touched, plus the buffers named by each
+    // task's OSTask header. A CPU read of one of them is an observation
+    // point while a task is pending; any CPU write is one.
+    std::bitset<RDRAM_SIZE / 0x1000> dma_pages_{};
+
     std::array<uint32_t, 32> gpr_{};
     std::array<VuReg, 32> vpr_{};
     AccRegs acc_{};
@@ -209,12 +253,54 @@ class Rsp {
     bool running_task() const { return running_task_; }
     void request_sync_point() { sync_point_ = true; }
 
+    void set_lazy(bool on) { lazy_ = on; }
+    void set_jit(bool on);
+    void set_threaded(bool on, bool check);
+    bool task_pending() const { return task_pending_; }
+    // For the dynarec, whose inline RDRAM accesses take the slow path (and
+    // so sync_rdram) while this byte is set.
+    const bool *task_pending_flag() const { return &task_pending_; }
+    // Observation points for a deferred task. sync(): CPU access to SP/DPC/MI
+    // registers or SP memory. sync_before(): a scheduler event at `time` is
+    // about to fire. sync_rdram(): CPU read of RDRAM at `paddr`.
+    // sync_rdram_write(): CPU write to RDRAM anywhere, as the task may reach
+    // any page through pointers it has yet to load.
+    // sync_if_interruptible(): SP/DP interrupts just became takeable.
+    void sync() {
+        if (task_pending_)
+            run_deferred_now();
+    }
+    void sync_before(uint64_t time) {
+        if (task_pending_)
+            run_deferred(time);
+    }
+    void sync_rdram(uint32_t paddr) {
+        if (task_pending_ && dma_pages_.test((paddr >> 12) % dma_pages_.size()))
+            run_deferred_now();
+    }
+    void sync_rdram_write() {
+        if (task_pending_)
+            run_deferred_now();
+    }
+    void sync_if_interruptible();
+    // CPU thread, once per scheduler tick: serve a parked worker.
+    void poll_worker() {
+        if (worker_pending_ && !worker_.busy())
+            service_worker();
+    }
+    // Drops a deferred task without running it (reset, loading a state).
+    void abandon_task();
+
     std::array<uint8_t, SP_DMEM_SIZE> &get_sp_dmem() { return sp_dmem; }
     std::array<uint8_t, SP_IMEM_SIZE> &get_sp_imem() { return sp_imem; }
 
     // Re-decode IMEM words after CPU/DMA writes (offset within IMEM).
     void note_imem_written(uint16_t offset, uint32_t length);
 
+    // Loading leaves IMEM undecoded; words decode on first execution.
+    void save_state(Utils::StateWriter &w) const;
+    void load_state(Utils::StateReader &r);
+
     uint32_t read_paddr32(uint32_t paddr) const;
     void write_paddr32(uint32_t paddr, uint32_t value);
     void status_reg_write(uint32_t value);
@@ -248,6 +334,9 @@ class Rsp {
         acc_.l.set_lane(i, static_cast<uint16_t>(v & 0xFFFF));
     }
 
+    void count_vu_ops(uint64_t n) { slice_vu_ops_ += n; }
+    VuProfileCounts &vu_profile_counts() { return vu_counts_; }
+
     VuReg &vreg(int i) { return vpr_[static_cast<size_t>(i)]; }
     const VuReg &vreg(int i) const { return vpr_[static_cast<size_t>(i)]; }
     uint16_t &vcc_ref() { return vcc_; }
@@ -275,10 +364,32 @@ class Rsp {
   private:
     void dma_read();
     void dma_write();
+    void note_dma_pages(uint32_t dram_address, uint32_t length);
+    void note_task_pages();
     uint64_t run_until_sync();
+    void begin_run();
+    bool slice_done() const;
+    bool run_insns(bool private_only);
+    uint64_t finish_run();
+    void flush_profile();
+    // CPU cycles the task has run so far (RSP cycles * 1.5).
+    uint64_t task_elapsed() const { return (task_cycle_counter_ * 3) / 2; }
+    uint64_t finish_slice();
+    void launch_worker();
+    void collect_worker();
+    void service_worker();
+    void verify_worker_run();
+    void start_task(uint64_t start);
+    // False while an SP DMA is in flight (the task starts after it).
+    bool begin_task_slice();
+    // Returns true if the task continues with another slice.
+    bool end_task_slice();
+    void run_deferred(uint64_t limit);
+    void run_deferred_now();
 
     void refresh_imem_word(uint16_t addr);
     void rebuild_imem_cache();
+    void invalidate_imem_cache();
     static ImemFn decode_opcode(uint32_t opcode);
     static void init_decode_tables();
 
@@ -315,6 +426,8 @@ class Rsp {
     static void op_lwc2(Rsp &r, uint32_t inst);
     static void op_swc2(Rsp &r, uint32_t inst);
     static void op_reserved(Rsp &r, uint32_t inst);
+    // Placeholder entry: `inst` is the IMEM word index to decode.
+    static void op_undecoded(Rsp &r, uint32_t word_index);
 
     static void spec_sll(Rsp &r, uint32_t inst);
     static void spec_srl(Rsp &r, uint32_t inst);
@@ -345,13 +458,42 @@ class Rsp {
 
 void vu_execute_compute(Rsp &rsp, uint32_t inst);
 void vu_execute_compute_scalar(Rsp &rsp, uint32_t inst);
+// Scalar VU even in N64_RSP_SIMD builds (A/B runs); no-op without SIMD.
+void set_vu_simd(bool on);
+bool vu_simd();
+void vu_load_scalar(Rsp &rsp, uint32_t inst);
+void vu_store_scalar(Rsp &rsp, uint32_t inst);
 #if N64_RSP_SIMD
+// rsp_vector_simd.cpp is built once per ISA (sse41, plus avx2 and avx512
+// where the compiler targets x86); each build exports one of these.
+struct VuKernels {
+    const char *name;
+    // 16-bit lanes in a native EVE register of the build (8 for SSE4.1, 16
+    // for AVX2, 32 for AVX-512).
+    int lanes;
+    void (*compute)(Rsp &rsp, uint32_t inst);
+    void (*load)(Rsp &rsp, uint32_t inst);
+    void (*store)(Rsp &rsp, uint32_t inst);
+};
+
+// Picks the widest build this CPU runs (cpuid), unless the N64_VU_ISA
+// environment variable names another one; logs the choice. Runs once, from
+// the first set_vu_simd(true).
+void vu_select_isa();
+// Switches to the named build; false if it is missing or the CPU lacks it.
+bool set_vu_isa(const char *name);
+const char *vu_isa();
+int vu_lanes();
+
+// The selected build's kernels.
 void vu_execute_compute_simd(Rsp &rsp, uint32_t inst);
+void vu_load_simd(Rsp &rsp, uint32_t inst);
+void vu_store_simd(Rsp &rsp, uint32_t inst);
 #endif
+// LWC2/SWC2 entry points; SIMD or scalar per set_vu_simd.
 void vu_load(Rsp &rsp, uint32_t inst);
 void vu_store(Rsp &rsp, uint32_t inst);
 
-
 } // namespace Rsp
 
 Rsp::Rsp &g_rsp();
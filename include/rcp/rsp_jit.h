@@ -0,0 +1,79 @@
+#ifndef RCP_RSP_JIT_H
+#define RCP_RSP_JIT_H
+
+#include "rcp/rsp.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace N64 {
+namespace Rsp {
+
+class RspEmitter;
+
+// x86-64 recompiler for RSP microcode. Blocks run straight-line up to a
+// branch + delay slot or the next COP0 access; scalar ops, the common VU
+// multiply/add/logical ops and aligned LQV/SQV are native, everything else
+// calls the interpreter op.
+// Code is grouped by a hash of the whole IMEM, so swapping microcode back
+// in (audio <-> graphics) finds the blocks compiled the last time.
+class RspJit {
+  public:
+    using BlockFn = uint32_t (*)(); // instructions executed
+
+    static constexpr uint32_t MAX_BLOCK_INSNS = 64;
+
+    struct Block {
+        BlockFn fn{nullptr}; // nullptr: interpret this PC
+        uint8_t num_insns{0};
+        // Native VU compute ops among the first n instructions (profiling).
+        std::array<uint8_t, MAX_BLOCK_INSNS + 1> vu_ops_upto{};
+    };
+
+    RspJit();
+    ~RspJit();
+
+    RspJit(const RspJit &) = delete;
+    RspJit &operator=(const RspJit &) = delete;
+
+    // False if the host lacks SSSE3/SSE4.1; the RSP then stays interpreted.
+    bool supported() const;
+
+    // Compiled block at `pc` for the current IMEM, compiling on first use.
+    const Block &lookup(Rsp &rsp, uint16_t pc);
+
+    // IMEM changed; the next lookup rehashes it.
+    void note_imem_written() { imem_dirty_ = true; }
+    void clear();
+
+    static RspJit &get_instance();
+
+  private:
+    struct CodeSet {
+        uint64_t hash{0};
+        std::array<uint8_t, SP_IMEM_SIZE> imem{};
+        std::array<Block *, SP_IMEM_WORDS> blocks{};
+        std::vector<std::unique_ptr<Block>> storage;
+        uint64_t last_used{0};
+    };
+
+    // Sets kept before the least recently used is dropped.
+    static constexpr size_t MAX_CODE_SETS = 16;
+
+    void select_code_set(const Rsp &rsp);
+    Block *compile(const Rsp &rsp, uint16_t pc);
+
+    std::unique_ptr<RspEmitter> emitter_;
+    std::vector<std::unique_ptr<CodeSet>> sets_;
+    CodeSet *current_{nullptr};
+    bool imem_dirty_{true};
+    uint64_t use_clock_{0};
+};
+
+inline RspJit &g_rsp_jit() { return RspJit::get_instance(); }
+
+} // namespace Rsp
+} // namespace N64
+
+#endif
@@ -5,18 +5,136 @@
 
 #if N64_RSP_SIMD
 
+// Only rsp_vector_simd.cpp includes this, once per ISA build with
+// N64_VU_BUILD_ISA set (sse41, avx2, avx512). Every build is compiled with
+// the baseline flags. EVE and the kernels are compiled inside
+// N64_VU_TARGET_BEGIN/END for the build's ISA, EVE under a per-ISA name so
+// its templates never merge across builds. The standard library and rsp.h
+// are included before the region and stay baseline, so whichever copy of
+// their inline code the linker keeps runs on any CPU.
+#ifndef N64_VU_BUILD_ISA
+#define N64_VU_BUILD_ISA sse41
+#endif
+#define N64_VU_CAT_(a, b) a##b
+#define N64_VU_CAT(a, b) N64_VU_CAT_(a, b)
+#define N64_VU_STR_(a) #a
+#define N64_VU_STR(a) N64_VU_STR_(a)
+#define N64_VU_NS N64_VU_CAT(vu_, N64_VU_BUILD_ISA)
+
+#define N64_VU_ISA_sse41 1
+#define N64_VU_ISA_avx2 2
+#define N64_VU_ISA_avx512 3
+#define N64_VU_ISA N64_VU_CAT(N64_VU_ISA_, N64_VU_BUILD_ISA)
+
+// N64_VU_LANES: 16-bit lanes in one native register of the build's ISA.
+#if N64_VU_ISA == N64_VU_ISA_avx512
+#define N64_VU_TARGET "avx512f,avx512cd,avx512bw,avx512dq,avx512vl"
+#define N64_VU_LANES 32
+#elif N64_VU_ISA == N64_VU_ISA_avx2
+#define N64_VU_TARGET "avx2"
+#define N64_VU_LANES 16
+#else
+#define N64_VU_TARGET "sse4.1"
+#define N64_VU_LANES 8
+#endif
+
+#define N64_VU_PRAGMA_(x) _Pragma(#x)
+#define N64_VU_PRAGMA(x) N64_VU_PRAGMA_(x)
+#if defined(__clang__)
+#define N64_VU_TARGET_BEGIN                                                   \
+    N64_VU_PRAGMA(clang attribute push(                                       \
+        __attribute__((target(N64_VU_TARGET))), apply_to = function))
+#define N64_VU_TARGET_END _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define N64_VU_TARGET_BEGIN                                                   \
+    _Pragma("GCC push_options") N64_VU_PRAGMA(GCC target(N64_VU_TARGET))
+#define N64_VU_TARGET_END _Pragma("GCC pop_options")
+#else
+#define N64_VU_TARGET_BEGIN
+#define N64_VU_TARGET_END
+#endif
+
+// The standard headers EVE uses, so none of them is first seen inside the
+// target region.
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <bitset>
+#include <cmath>
+#include <compare>
+#include <concepts>
+#include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <functional>
+#include <immintrin.h>
+#include <initializer_list>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+N64_VU_TARGET_BEGIN
+
+// Neither target pragma defines the ISA macros EVE picks its ABI from, so
+// define the missing ones for the EVE headers only.
+#if N64_VU_ISA >= N64_VU_ISA_avx2
+#ifndef __AVX__
+#define N64_VU_DEFINED_AVX 1
+#define __AVX__ 1
+#endif
+#ifndef __AVX2__
+#define N64_VU_DEFINED_AVX2 1
+#define __AVX2__ 1
+#endif
+#endif
+#if N64_VU_ISA == N64_VU_ISA_avx512 && !defined(__AVX512F__)
+#define N64_VU_DEFINED_AVX512 1
+#define __AVX512F__ 1
+#define __AVX512CD__ 1
+#define __AVX512BW__ 1
+#define __AVX512DQ__ 1
+#define __AVX512VL__ 1
+#endif
+
+#define eve N64_VU_CAT(eve_, N64_VU_BUILD_ISA)
 #include <eve/module/core.hpp>
 #include <eve/wide.hpp>
-#include <tmmintrin.h> // SSSE3: _mm_shuffle_epi8
-#include <smmintrin.h> // SSE4.1: _mm_blendv_epi8
+
+#if N64_VU_DEFINED_AVX
+#undef __AVX__
+#endif
+#if N64_VU_DEFINED_AVX2
+#undef __AVX2__
+#endif
+#if N64_VU_DEFINED_AVX512
+#undef __AVX512F__
+#undef __AVX512CD__
+#undef __AVX512BW__
+#undef __AVX512DQ__
+#undef __AVX512VL__
+#endif
+
+// A wider baseline (-march=native) may give the sse41 build more.
+static_assert(eve::wide<std::int16_t>::size() >= N64_VU_LANES,
+              "EVE does not target this build's ISA");
 
 namespace N64 {
 namespace Rsp {
+namespace N64_VU_NS {
 namespace Simd {
 
+// A VU register is eight 16-bit lanes in every build; the 32- and 64-bit
+// intermediates fill one AVX2 or AVX-512 register where the build has it.
 using Vu16 = eve::wide<std::uint16_t, eve::fixed<8>>;
 using Vi16 = eve::wide<std::int16_t, eve::fixed<8>>;
 using Vu32 = eve::wide<std::uint32_t, eve::fixed<8>>;
@@ -149,13 +267,32 @@ inline uint16_t logical_to_bits(eve::logical<Vu16> mask) {
     return static_cast<uint16_t>(mask.bitmap().to_ulong() & 0xFFu);
 }
 
-inline Vi16 vco_lo_as_i16(uint16_t vco) {
-    // 0 or 1 per lane — VADD/VSUB add this as carry-in.
-    const __m128i bits = _mm_set1_epi16(static_cast<int>(vco));
+// Lane i is 0xFFFF when bit i of `bits` is set (flag register halves).
+inline __m128i flag_mask(uint32_t bits) {
+#if N64_VU_ISA == N64_VU_ISA_avx512
+    return _mm_movm_epi16(static_cast<__mmask8>(bits));
+#else
+    const __m128i b = _mm_set1_epi16(static_cast<short>(bits & 0xFF));
     const __m128i lane = _mm_set_epi16(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02,
                                        0x01);
-    const __m128i hit = _mm_cmpeq_epi16(_mm_and_si128(bits, lane), lane);
-    return as_i16(from_m128(_mm_and_si128(hit, _mm_set1_epi16(1))));
+    return _mm_cmpeq_epi16(_mm_and_si128(b, lane), lane);
+#endif
+}
+
+// Inverse of flag_mask: bit i set when lane i is 0xFFFF.
+inline uint16_t mask_flags(__m128i mask) {
+#if N64_VU_ISA == N64_VU_ISA_avx512
+    return _mm_movepi16_mask(mask);
+#else
+    return static_cast<uint16_t>(
+        _mm_movemask_epi8(_mm_packs_epi16(mask, _mm_setzero_si128())) & 0xFF);
+#endif
+}
+
+inline Vi16 vco_lo_as_i16(uint16_t vco) {
+    // 0 or 1 per lane — VADD/VSUB add this as carry-in.
+    return as_i16(
+        from_m128(_mm_and_si128(flag_mask(vco), _mm_set1_epi16(1))));
 }
 
 inline Vu16 vco_lo_as_u16(uint16_t vco) {
@@ -164,11 +301,8 @@ inline Vu16 vco_lo_as_u16(uint16_t vco) {
 }
 
 inline Vu16 vcc_lo_as_u16(uint16_t vcc) {
-    const __m128i bits = _mm_set1_epi16(static_cast<int>(vcc));
-    const __m128i lane = _mm_set_epi16(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02,
-                                       0x01);
     // Full 0xFFFF masks; VMRG tests != 0.
-    return from_m128(_mm_cmpeq_epi16(_mm_and_si128(bits, lane), lane));
+    return from_m128(flag_mask(vcc));
 }
 
 inline Vu16 vcc_hi_as_u16(uint16_t vcc) {
@@ -187,9 +321,12 @@ inline Vu16 clamp_signed_to_u16(Vi64 v) {
 }
 
 } // namespace Simd
+} // namespace N64_VU_NS
 } // namespace Rsp
 } // namespace N64
 
+N64_VU_TARGET_END
+
 #endif // N64_RSP_SIMD
 
 #endif
@@ -0,0 +1,43 @@
+#ifndef RCP_RSP_WORKER_H
+#define RCP_RSP_WORKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace N64 {
+namespace Rsp {
+
+// Background thread for the threaded RSP mode. The CPU thread hands over one
+// job at a time; start() and wait() order all memory accesses between the two
+// threads, so the job may use RSP state without further locking.
+class RspWorker {
+  public:
+    RspWorker() = default;
+    ~RspWorker();
+
+    RspWorker(const RspWorker &) = delete;
+    RspWorker &operator=(const RspWorker &) = delete;
+
+    // The previous job must have finished (see wait()).
+    void start(std::function<void()> job);
+    void wait();
+    bool busy() const { return busy_.load(std::memory_order_acquire); }
+
+  private:
+    void loop();
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::function<void()> job_;
+    std::atomic<bool> busy_{false};
+    bool quit_{false};
+};
+
+} // namespace Rsp
+} // namespace N64
+
+#endif
@@ -1,17 +1,33 @@
 #ifndef RCP_VU_PROFILE_H
 #define RCP_VU_PROFILE_H
 
+#include <array>
 #include <cstdint>
 
 namespace N64 {
 namespace Rsp {
 
+// One RSP's tallies. The thread running a task bumps them; the CPU thread
+// folds them into the totals with vu_profile_merge() after the run.
+struct VuProfileCounts {
+    std::array<uint64_t, 64> compute{};
+    std::array<uint64_t, 64> compute_scalar{};
+    std::array<uint64_t, 16> lwc2{};
+    std::array<uint64_t, 16> lwc2_scalar{};
+    std::array<uint64_t, 16> swc2{};
+    std::array<uint64_t, 16> swc2_scalar{};
+    std::array<uint64_t, 8> cop2_move{}; // by rs sub
+    uint64_t total_compute{0};
+};
+
 // Enabled when N64_PROFILE_VU is set (non-empty, not "0").
 bool vu_profile_enabled();
-void vu_profile_compute(uint32_t inst, bool used_simd);
-void vu_profile_lwc2(uint32_t inst);
-void vu_profile_swc2(uint32_t inst);
-void vu_profile_cop2_move(uint8_t sub);
+void vu_profile_compute(VuProfileCounts &c, uint32_t inst, bool used_simd);
+void vu_profile_lwc2(VuProfileCounts &c, uint32_t inst, bool used_simd);
+void vu_profile_swc2(VuProfileCounts &c, uint32_t inst, bool used_simd);
+void vu_profile_cop2_move(VuProfileCounts &c, uint8_t sub);
+// Adds `c` to the totals and clears it.
+void vu_profile_merge(VuProfileCounts &c);
 void vu_profile_dump();
 
 } // namespace Rsp
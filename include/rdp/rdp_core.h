@@ -4,6 +4,7 @@
 #include "rdp_renderer.hpp"
 #include <cstdint>
 #include <mutex>
+#include <vector>
 
 namespace Vulkan {
 class Device;
@@ -15,6 +16,8 @@ namespace Rdp {
 std::recursive_mutex &mutex();
 
 void init(Vulkan::Device &device, uint8_t *rdram, unsigned upscale);
+// CPU rasterizer instead of Parallel-RDP (headless hosts without Vulkan).
+void init_software(uint8_t *rdram);
 void fini();
 bool ready();
 
@@ -63,5 +66,13 @@ struct ScanoutResult {
 
 ScanoutResult scanout(const ViRegs &vi);
 
+// Software path only: the active VI framebuffer area as packed RGB8.
+struct CpuFrame {
+    uint32_t width{0};
+    uint32_t height{0};
+    std::vector<uint8_t> rgb;
+};
+bool scanout_cpu(const ViRegs &vi, CpuFrame &out);
+
 } // namespace Rdp
 } // namespace N64
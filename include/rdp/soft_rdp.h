@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace N64 {
+namespace Rdp {
+
+class SoftRenderer;
+
+// CPU reference RDP for hosts without Vulkan. Commands are recorded until
+// SyncFull (or a texture load that reads pixels drawn earlier in the same
+// batch), then every worker replays the batch with its own state and TMEM
+// and only rasterizes the scanline bins it owns, so the output does not
+// depend on the thread count.
+class SoftRdp {
+  public:
+    // Scanlines per bin; bins are dealt round-robin to the workers.
+    static constexpr uint32_t BIN_LINES = 8;
+    static constexpr unsigned MAX_THREADS = 8;
+
+    SoftRdp();
+    ~SoftRdp();
+
+    SoftRdp(const SoftRdp &) = delete;
+    SoftRdp &operator=(const SoftRdp &) = delete;
+
+    // threads == 0: pick from hardware_concurrency (N64_SOFT_RDP_THREADS
+    // overrides).
+    void init(uint8_t *rdram, unsigned threads = 0);
+    void fini();
+    bool active() const { return rdram_ != nullptr; }
+    uint8_t *rdram() const { return rdram_; }
+
+    void enqueue(int command_length, const uint32_t *words);
+    // Rasterize everything recorded so far into RDRAM.
+    void flush();
+
+    static SoftRdp &get_instance();
+
+  private:
+    struct Range {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    void track(const uint32_t *words);
+    bool reads_batch_output(uint32_t begin, uint32_t end) const;
+    void add_written(uint32_t begin, uint32_t end);
+    void worker_loop(unsigned index);
+
+    uint8_t *rdram_{nullptr};
+    std::vector<uint32_t> batch_;
+    std::vector<Range> written_;
+    std::vector<std::unique_ptr<SoftRenderer>> renderers_;
+
+    // Front-end copy of the image state, for tracking batch output.
+    uint32_t color_addr_{0};
+    uint32_t color_bytes_{2};
+    uint32_t color_width_{0};
+    uint32_t mask_addr_{0};
+    bool z_enabled_{false};
+    uint32_t scissor_yl_{0};
+    uint32_t tex_addr_{0};
+    uint32_t tex_bytes_{2};
+    uint32_t tex_width_{0};
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable done_cv_;
+    uint64_t generation_{0};
+    unsigned running_{0};
+    bool quit_{false};
+};
+
+inline SoftRdp &g_soft_rdp() { return SoftRdp::get_instance(); }
+
+} // namespace Rdp
+} // namespace N64
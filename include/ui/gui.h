@@ -21,6 +21,9 @@ struct GuiState {
     bool request_start{false};
     bool request_stop{false};
     bool request_quit{false};
+    // Quick slot; handled between fields by the app loop.
+    bool request_save_state{false};
+    bool request_load_state{false};
     // Set by gui_draw: the menu bar is up and needs live redraws.
     bool menu_bar_active{false};
     N64System::Config *config{nullptr};
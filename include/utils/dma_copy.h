@@ -0,0 +1,37 @@
+#ifndef UTILS_DMA_COPY_H
+#define UTILS_DMA_COPY_H
+
+#include <cstdint>
+#include <span>
+
+namespace Utils {
+
+// How one side of a DMA stores its bytes. RDRAM, cartridge ROM and SP IMEM
+// keep 32-bit words in host order (byte n lives at byte_address(n)); SP
+// DMEM, SRAM and PIF RAM keep bytes in N64 order.
+enum class DmaLayout {
+    HostWords,
+    BigEndian,
+};
+
+// Copies `length` bytes from N64 offset `src_addr` of `src` to `dst_addr`
+// of `dst`, converting between layouts. Both ranges must lie inside their
+// spans (a HostWords range up to its enclosing words); callers split
+// transfers where an address wraps. When both offsets share word
+// alignment the body moves whole words, byte-swapped (SIMD where
+// available) if the layouts differ; only the unaligned head and tail, or
+// a misaligned pair, go byte by byte.
+void dma_copy(std::span<uint8_t> dst, uint32_t dst_addr, DmaLayout dst_layout,
+              std::span<const uint8_t> src, uint32_t src_addr,
+              DmaLayout src_layout, uint32_t length);
+
+// As dma_copy, but each offset wraps around the end of its span, the way
+// the PI and SI address RDRAM and SRAM.
+void dma_copy_wrapped(std::span<uint8_t> dst, uint32_t dst_addr,
+                      DmaLayout dst_layout, std::span<const uint8_t> src,
+                      uint32_t src_addr, DmaLayout src_layout,
+                      uint32_t length);
+
+} // namespace Utils
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef UTILS_STATE_IO_H
+#define UTILS_STATE_IO_H
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace Utils {
+
+// Four-character section tag, e.g. state_tag("CPU ").
+constexpr uint32_t state_tag(const char (&s)[5]) {
+    return static_cast<uint32_t>(static_cast<uint8_t>(s[0])) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(s[1])) << 8) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(s[2])) << 16) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(s[3])) << 24);
+}
+
+// Append-only snapshot writer. Host-endian raw copies: snapshots are only
+// meant to be loaded by the same build on the same kind of host.
+class StateWriter {
+  public:
+    explicit StateWriter(std::vector<uint8_t> &out) : out_(out) {}
+
+    void bytes(const void *p, size_t n) {
+        const size_t at = out_.size();
+        out_.resize(at + n);
+        if (n)
+            std::memcpy(out_.data() + at, p, n);
+    }
+
+    template <typename T> void pod(const T &v) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        bytes(&v, sizeof(T));
+    }
+
+    // Tag + u32 payload size; patched by end_section.
+    size_t begin_section(uint32_t tag) {
+        pod(tag);
+        const size_t at = out_.size();
+        pod(uint32_t{0});
+        return at;
+    }
+
+    void end_section(size_t size_at) {
+        const auto size =
+            static_cast<uint32_t>(out_.size() - size_at - sizeof(uint32_t));
+        std::memcpy(out_.data() + size_at, &size, sizeof(size));
+    }
+
+  private:
+    std::vector<uint8_t> &out_;
+};
+
+// Bounds-checked reader. The first short read latches ok() == false and
+// every later read is a no-op, so loaders can check once at the end.
+class StateReader {
+  public:
+    explicit StateReader(std::span<const uint8_t> in) : in_(in) {}
+
+    bool ok() const { return ok_; }
+    void fail() { ok_ = false; }
+    size_t pos() const { return pos_; }
+    size_t remaining() const { return in_.size() - pos_; }
+
+    // Zero-copy view of the next `n` bytes (empty on overrun).
+    std::span<const uint8_t> view(size_t n) {
+        if (!ok_ || n > remaining()) {
+            ok_ = false;
+            return {};
+        }
+        const auto v = in_.subspan(pos_, n);
+        pos_ += n;
+        return v;
+    }
+
+    void bytes(void *p, size_t n) {
+        const auto v = view(n);
+        if (ok_ && n)
+            std::memcpy(p, v.data(), n);
+    }
+
+    template <typename T> void pod(T &v) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        bytes(&v, sizeof(T));
+    }
+
+    // Returns the payload end offset, or 0 (and fails) on a tag mismatch.
+    size_t enter_section(uint32_t tag) {
+        uint32_t got = 0;
+        uint32_t size = 0;
+        pod(got);
+        pod(size);
+        if (!ok_ || got != tag || size > remaining()) {
+            ok_ = false;
+            return 0;
+        }
+        return pos_ + size;
+    }
+
+    // Sections must be consumed exactly; a size mismatch means the layout
+    // changed without a version bump.
+    void leave_section(size_t end) {
+        if (pos_ != end)
+            ok_ = false;
+    }
+
+  private:
+    std::span<const uint8_t> in_;
+    size_t pos_{0};
+    bool ok_{true};
+};
+
+} // namespace Utils
+
+#endif
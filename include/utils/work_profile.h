@@ -8,13 +8,17 @@
 namespace N64 {
 namespace WorkProfile {
 
-// Wall-time buckets for N64_PROFILE_FRAME. Nested: RspTask contains VuCompute;
-// FbCheck may run under CPU and/or RspTask.
+// Wall-time buckets for N64_PROFILE_FRAME. Nested: CpuSlice contains RspTask;
+// RspTask contains VuCompute; FbCheck may run under CPU and/or RspTask;
+// SoftRdp runs under whichever unit wrote DPC_END.
 enum class Bucket : int {
     RspTask = 0,
     VuCompute,
     FbCheck,
     FbFlush,
+    CpuSlice,
+    SoftRdp,
+    Present,
     Count,
 };
 
@@ -25,14 +29,19 @@ struct Totals {
     uint64_t fb_probes{0}; // check_framebuffers entries with sync_signal != 0
 };
 
-inline bool enabled() {
-    static const bool on = [] {
+inline bool &enabled_flag() {
+    static bool on = [] {
         const char *e = std::getenv("N64_PROFILE_FRAME");
         return e && e[0] != '\0' && e[0] != '0';
     }();
     return on;
 }
 
+inline bool enabled() { return enabled_flag(); }
+
+// Collect without the N64_PROFILE_FRAME log (kamo64-bench).
+inline void set_enabled(bool on) { enabled_flag() = on; }
+
 inline Totals &accum() {
     static Totals t;
     return t;
@@ -52,10 +61,10 @@ inline void add_rsp_insns(uint64_t n) {
     accum().rsp_insns += n;
 }
 
-inline void add_vu_op() {
-    if (!enabled())
+inline void add_vu_ops(uint64_t n) {
+    if (!enabled() || n == 0)
         return;
-    accum().events[static_cast<int>(Bucket::VuCompute)] += 1;
+    accum().events[static_cast<int>(Bucket::VuCompute)] += n;
 }
 
 inline void add_fb_probe() {
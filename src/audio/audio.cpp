@@ -27,6 +27,8 @@ int g_guest_frequency = DEFAULT_GUEST_FREQUENCY;
 double g_resample_pos = 0.0;
 bool g_output_paused = false;
 float g_volume = 1.0f;
+// Emulation speed relative to real time; <= 0 mutes (unthrottled).
+double g_speed = 1.0;
 
 std::mutex g_mutex;
 std::atomic<uint64_t> g_sync_wait_ns{0};
@@ -146,6 +148,19 @@ void set_volume(float volume) {
 
 float volume() { return g_volume; }
 
+void set_speed(double speed) {
+    if (speed == g_speed)
+        return;
+    const bool was_muted = g_speed <= 0.0;
+    g_speed = speed;
+    std::lock_guard lock(g_mutex);
+    // Drop backlog produced at the old rate so latency doesn't jump.
+    if (speed <= 0.0 || was_muted)
+        ring_clear_locked();
+    else
+        g_resample_pos = 0.0;
+}
+
 void notify_space() {}
 
 double take_sync_wait_ms() {
@@ -197,7 +212,7 @@ void set_frequency_from_dacrate(uint32_t dacrate) {
 
 void push_samples(std::span<const int16_t> interleaved_stereo) {
     if (!enabled() || interleaved_stereo.size() < 2 || g_host_frequency <= 0 ||
-        g_guest_frequency <= 0)
+        g_guest_frequency <= 0 || g_speed <= 0.0)
         return;
 
     const size_t in_frames = interleaved_stereo.size() / 2;
@@ -207,8 +222,10 @@ void push_samples(std::span<const int16_t> interleaved_stereo) {
     if (g_output_paused)
         set_output_paused(false);
 
+    // Guest audio is produced `g_speed` times faster than real time;
+    // compress it so the queue tracks wall-clock playback.
     const double ratio = static_cast<double>(g_host_frequency) /
-                         static_cast<double>(g_guest_frequency);
+                         (static_cast<double>(g_guest_frequency) * g_speed);
     const size_t out_cap =
         static_cast<size_t>(std::ceil(static_cast<double>(in_frames) * ratio)) +
         2;
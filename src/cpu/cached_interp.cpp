@@ -4,13 +4,19 @@
 #include "cpu_instruction_impl.h"
 #include "fpu_instruction_impl.h"
 #include "cpu/jit/invalidate_hook.h"
+#include "debugger/debugger.h"
 #include "memory/bus.h"
+#include "memory/fastmem.h"
 #include "memory/memory_map.h"
 #include "mmu/mmu.h"
 #include "mmu/soft_tlb.h"
 #include "mmu/tlb.h"
 #include "n64_system/machine_advance.h"
+#include "rcp/rsp.h"
+#include "rdp/rdp_core.h"
+#include "utils/byte_array.h"
 #include "utils/log.h"
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <memory>
@@ -52,29 +58,34 @@ class DecodeCache {
         rdram_pages_.fill(nullptr);
         other_pages_.clear();
         page_storage_.clear();
+        Fastmem::clear_code_pages(Fastmem::CODE_DECODE);
     }
 
     void invalidate_page(uint32_t paddr) {
-        const uint32_t page_idx = paddr >> PAGE_SHIFT;
-        DecodePage *page = find_page(page_idx);
-        if (!page)
-            return;
-        if (last_hit_page_ == page)
-            last_hit_page_ = nullptr;
-        page->entries.fill(CachedWord{});
+        invalidate_range(paddr & ~(PAGE_SIZE - 1), PAGE_SIZE);
     }
 
+    // Only the words the write touched: data stored next to code leaves
+    // the rest of the page decoded.
     void invalidate_range(uint32_t paddr, uint32_t length) {
         if (length == 0)
             return;
-        const uint32_t start = paddr & ~(PAGE_SIZE - 1);
-        const uint64_t end64 =
-            static_cast<uint64_t>(paddr) + static_cast<uint64_t>(length) - 1;
-        const uint32_t end = end64 > 0xffffffffu
-                                 ? 0xffffffffu
-                                 : static_cast<uint32_t>(end64);
-        for (uint64_t p = start; p <= end; p += PAGE_SIZE)
-            invalidate_page(static_cast<uint32_t>(p));
+        const uint64_t end = static_cast<uint64_t>(paddr) + length;
+        for (uint64_t p = paddr & ~uint64_t{PAGE_SIZE - 1}; p < end;
+             p += PAGE_SIZE) {
+            DecodePage *page =
+                find_page(static_cast<uint32_t>(p >> PAGE_SHIFT));
+            if (!page)
+                continue;
+            const uint64_t lo = std::max<uint64_t>(p, paddr);
+            const uint64_t hi = std::min<uint64_t>(p + PAGE_SIZE, end);
+            const auto first = static_cast<size_t>((lo - p) >> 2);
+            const auto last = static_cast<size_t>((hi - p + 3) >> 2);
+            std::fill(page->entries.begin() + first,
+                      page->entries.begin() + last, CachedWord{});
+            if (last_hit_page_ == page)
+                last_hit_page_ = nullptr;
+        }
     }
 
     // Returns entry pointer; caller fills on miss.
@@ -124,6 +135,8 @@ class DecodeCache {
                 auto page = std::make_unique<DecodePage>();
                 slot = page.get();
                 page_storage_.push_back(std::move(page));
+                Fastmem::set_code_page(page_idx << PAGE_SHIFT,
+                                       Fastmem::CODE_DECODE, true);
             }
             return slot;
         }
@@ -192,9 +205,104 @@ void step_one_core(bool do_count) {
         cpu.add_count(CPU_CYCLES_PER_INST);
 }
 
+// Fastmem handlers: a KSEG0/KSEG1 access that stays inside RDRAM is one
+// host access at Fastmem::base() + paddr. Anything else, and stores to a
+// page holding code, take the regular CpuImpl handler.
+template <typename Wire>
+std::optional<uint32_t> fast_paddr(Cpu &cpu, instruction_t inst) {
+    const auto vaddr = static_cast<uint32_t>(
+        cpu.gpr.read(inst.i_type.rs) + static_cast<int16_t>(inst.i_type.imm));
+    const auto paddr = Mmu::try_direct_map(vaddr);
+    if (!paddr || *paddr > RDRAM_SIZE - sizeof(Wire))
+        return std::nullopt;
+    // Watches are checked on the bus path only.
+    if (sizeof(Wire) == 4 && g_debugger().has_watches())
+        return std::nullopt;
+    return paddr;
+}
+
+template <typename Wire> Wire fast_load(uint32_t paddr) {
+    Rdp::check_framebuffers(paddr, static_cast<uint32_t>(sizeof(Wire)));
+    g_rsp().sync_rdram(paddr);
+    return Utils::read_from_byte_array<Wire>(
+        std::span<const uint8_t>(Fastmem::base(), RDRAM_SIZE), paddr);
+}
+
+template <typename Wire> bool fast_store(uint32_t paddr, Wire value) {
+    if (Fastmem::may_hold_code(paddr))
+        return false;
+    Rdp::on_rdram_write(paddr, static_cast<uint32_t>(sizeof(Wire)));
+    g_rsp().sync_rdram_write();
+    const std::span<uint8_t> ram(Fastmem::base(), RDRAM_SIZE);
+    if constexpr (sizeof(Wire) == 1)
+        Utils::write_to_byte_array8(ram, paddr, value);
+    else if constexpr (sizeof(Wire) == 2)
+        Utils::write_to_byte_array16(ram, paddr, value);
+    else if constexpr (sizeof(Wire) == 4)
+        Utils::write_to_byte_array32(ram, paddr, value);
+    else
+        Utils::write_to_byte_array64(ram, paddr, value);
+    return true;
+}
+
+// Result is sign- (Signed) or zero-extended from Wire.
+template <typename Wire, typename Signed, Handler Slow>
+void op_fast_load(Cpu &cpu, instruction_t inst) {
+    const auto paddr = fast_paddr<Wire>(cpu, inst);
+    if (!paddr) {
+        Slow(cpu, inst);
+        return;
+    }
+    const Wire value = fast_load<Wire>(*paddr);
+    cpu.gpr.write(inst.i_type.rt,
+                  static_cast<uint64_t>(static_cast<Signed>(value)));
+}
+
+template <typename Wire, Handler Slow>
+void op_fast_store(Cpu &cpu, instruction_t inst) {
+    const auto paddr = fast_paddr<Wire>(cpu, inst);
+    if (!paddr ||
+        !fast_store<Wire>(*paddr,
+                          static_cast<Wire>(cpu.gpr.read(inst.i_type.rt))))
+        Slow(cpu, inst);
+}
+
+Handler decode_fastmem(instruction_t inst) {
+    switch (inst.op) {
+    case OPCODE_LB:
+        return &op_fast_load<uint8_t, int8_t, &CpuImpl::op_lb>;
+    case OPCODE_LBU:
+        return &op_fast_load<uint8_t, uint8_t, &CpuImpl::op_lbu>;
+    case OPCODE_LH:
+        return &op_fast_load<uint16_t, int16_t, &CpuImpl::op_lh>;
+    case OPCODE_LHU:
+        return &op_fast_load<uint16_t, uint16_t, &CpuImpl::op_lhu>;
+    case OPCODE_LW:
+        return &op_fast_load<uint32_t, int32_t, &CpuImpl::op_lw>;
+    case OPCODE_LWU:
+        return &op_fast_load<uint32_t, uint32_t, &CpuImpl::op_lwu>;
+    case OPCODE_LD:
+        return &op_fast_load<uint64_t, uint64_t, &CpuImpl::op_ld>;
+    case OPCODE_SB:
+        return &op_fast_store<uint8_t, &CpuImpl::op_sb>;
+    case OPCODE_SH:
+        return &op_fast_store<uint16_t, &CpuImpl::op_sh>;
+    case OPCODE_SW:
+        return &op_fast_store<uint32_t, &CpuImpl::op_sw>;
+    case OPCODE_SD:
+        return &op_fast_store<uint64_t, &CpuImpl::op_sd>;
+    default:
+        return nullptr;
+    }
+}
+
 } // namespace
 
 Handler decode(instruction_t inst) {
+    if (Fastmem::enabled()) {
+        if (Handler fast = decode_fastmem(inst))
+            return fast;
+    }
     uint8_t op = inst.op;
     switch (op) {
     case OPCODE_SPECIAL: {
@@ -295,6 +403,12 @@ Handler decode(instruction_t inst) {
             return &CpuImpl::op_dsrl32;
         case SPECIAL_FUNCT_DSRA32:
             return &CpuImpl::op_dsra32;
+        case SPECIAL_FUNCT_DSLLV:
+            return &CpuImpl::op_dsllv;
+        case SPECIAL_FUNCT_DSRLV:
+            return &CpuImpl::op_dsrlv;
+        case SPECIAL_FUNCT_DSRAV:
+            return &CpuImpl::op_dsrav;
         case SPECIAL_FUNCT_SYNC:
             return &CpuImpl::op_sync;
         default:
@@ -1,7 +1,7 @@
 ﻿#include "cpu/cop0.h"
 #include "debugger/debugger.h"
-#include "mmu/soft_tlb.h"
 #include "n64_system/interrupt.h"
+#include "rcp/rsp.h"
 #include "utils/log.h"
 
 namespace N64 {
@@ -41,6 +41,8 @@ uint64_t Cop0::Reg::read(uint8_t reg_num) const {
     case Cop0Reg::STATUS:
         return status.raw;
     case Cop0Reg::CAUSE:
+        // IP2 may be about to change under a deferred RSP task.
+        g_rsp().sync();
         return cause.raw;
     case Cop0Reg::EPC:
         return epc;
@@ -119,7 +121,8 @@ void Cop0::Reg::write(uint8_t reg_num, uint64_t value) {
                 0x1FFFFFFFFULL;
     } break;
     case Cop0Reg::ENTRY_HI: {
-        const uint8_t old_asid = static_cast<uint8_t>(entry_hi.asid);
+        // Soft-TLB entries carry their ASID, so neither VPN2 nor ASID
+        // changes need a flush here.
         if (value <= 0xFFFFFFFFULL) {
             // MTC0: 32-bit write. Derive R from sign bit; VPN2 is 19 bits for
             // 32-bit addresses (do not let sign-extension pollute VPN2[26:19]).
@@ -131,10 +134,6 @@ void Cop0::Reg::write(uint8_t reg_num, uint64_t value) {
         } else {
             entry_hi.raw = value & CP0_ENTRY_HI_WRITE_MASK;
         }
-        // VPN2 updates are frequent during TLB refill; only ASID changes
-        // can make cached translations wrong without a TLBWI.
-        if (static_cast<uint8_t>(entry_hi.asid) != old_asid)
-            Mmu::soft_tlb_invalidate();
     } break;
     case Cop0Reg::COMPARE: {
         // Writing Compare clears the timer interrupt (IP7).
@@ -54,6 +54,38 @@ void Cpu::dump() {
     Utils::info("=========================");
 }
 
+void Cpu::save_state(Utils::StateWriter &w) const {
+    w.bytes(gpr.data(), 32 * sizeof(uint64_t));
+    w.pod(lo);
+    w.pod(hi);
+    w.pod(delay_slot);
+    w.pod(prev_delay_slot);
+    w.pod(prev_pc);
+    w.pod(pc);
+    w.pod(next_pc);
+    w.pod(cop0.reg);
+    w.pod(cop0.llbit);
+    w.pod(cop1.fcr0);
+    w.pod(cop1.fcr31);
+    w.pod(cop1.fgr);
+}
+
+void Cpu::load_state(Utils::StateReader &r) {
+    r.bytes(gpr.data(), 32 * sizeof(uint64_t));
+    r.pod(lo);
+    r.pod(hi);
+    r.pod(delay_slot);
+    r.pod(prev_delay_slot);
+    r.pod(prev_pc);
+    r.pod(pc);
+    r.pod(next_pc);
+    r.pod(cop0.reg);
+    r.pod(cop0.llbit);
+    r.pod(cop1.fcr0);
+    r.pod(cop1.fcr31);
+    r.pod(cop1.fgr);
+}
+
 void Cpu::set_pc64(uint64_t value) {
     prev_pc = pc;
     pc = value;
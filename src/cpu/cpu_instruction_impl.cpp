@@ -4,6 +4,7 @@
 #include "mmu/mmu.h"
 #include "mmu/soft_tlb.h"
 #include "mmu/tlb.h"
+#include "n64_system/interrupt.h"
 #include "utils/log.h"
 #include "utils/stdint.h"
 #include <optional>
@@ -172,7 +173,7 @@ void CpuImpl::op_div(Cpu &cpu, instruction_t inst) {
     Utils::instruction_trace("DIV {}, {}", GPR_NAMES[inst.r_type.rs],
                              GPR_NAMES[inst.r_type.rt]);
     if (divisor == 0) {
-        Utils::warn("division by zero");
+        Utils::debug("division by zero");
         cpu.hi = dividend;
         if (dividend >= 0)
             cpu.lo = (int64_t)-1;
@@ -194,7 +195,7 @@ void CpuImpl::op_divu(Cpu &cpu, instruction_t inst) {
                              GPR_NAMES[inst.r_type.rt]);
 
     if (divisor == 0) {
-        Utils::warn("division by zero");
+        Utils::debug("division by zero");
         cpu.hi = (int32_t)dividend;
         cpu.lo = 0xFFFF'FFFF'FFFF'FFFF;
     } else {
@@ -207,17 +208,22 @@ void CpuImpl::op_divu(Cpu &cpu, instruction_t inst) {
 }
 
 void CpuImpl::op_ddiv(Cpu &cpu, instruction_t inst) {
-    Utils::instruction_trace("DDIVU {}, {}", GPR_NAMES[inst.r_type.rs],
+    Utils::instruction_trace("DDIV {}, {}", GPR_NAMES[inst.r_type.rs],
                              GPR_NAMES[inst.r_type.rt]);
     int64_t dividend = cpu.gpr.read(inst.r_type.rs);
     int64_t divisor = cpu.gpr.read(inst.r_type.rt);
 
     if (divisor == 0) {
-        Utils::unimplemented("DDIV division by zero");
+        Utils::debug("division by zero");
+        cpu.hi = dividend;
+        if (dividend >= 0)
+            cpu.lo = (int64_t)-1;
+        else
+            cpu.lo = (int64_t)1;
     } else if (divisor == -1 && dividend == INT64_MIN) {
-        Utils::unimplemented("DDIV overflow");
-        // cpu.lo = dividend;
-        // cpu.hi = 0;
+        // The quotient does not fit: LO keeps the dividend.
+        cpu.lo = dividend;
+        cpu.hi = 0;
     } else {
         int64_t quotient = (int64_t)(dividend / divisor);
         int64_t remainder = (int64_t)(dividend % divisor);
@@ -434,6 +440,8 @@ void CpuImpl::op_eret(Cpu &cpu, instruction_t inst) {
         cpu.cop0.reg.status.exl = false;
     }
     cpu.cop0.llbit = false;
+    // Leaving EXL/ERL can unmask a pending interrupt.
+    N64System::check_interrupt();
 }
 
 void CpuImpl::op_tlbwi(Cpu &cpu, instruction_t inst) {
@@ -560,6 +568,33 @@ void CpuImpl::op_dsra32(Cpu &cpu, instruction_t inst) {
                              (uint8_t)inst.r_type.sa);
 }
 
+void CpuImpl::op_dsllv(Cpu &cpu, instruction_t inst) {
+    uint64_t value = cpu.gpr.read(inst.r_type.rt);
+    value <<= (cpu.gpr.read(inst.r_type.rs) & 0b111111);
+    cpu.gpr.write(inst.r_type.rd, value);
+    Utils::instruction_trace("DSLLV {}, {}, {}", GPR_NAMES[inst.r_type.rd],
+                             GPR_NAMES[inst.r_type.rt],
+                             GPR_NAMES[inst.r_type.rs]);
+}
+
+void CpuImpl::op_dsrlv(Cpu &cpu, instruction_t inst) {
+    uint64_t value = cpu.gpr.read(inst.r_type.rt);
+    value >>= (cpu.gpr.read(inst.r_type.rs) & 0b111111);
+    cpu.gpr.write(inst.r_type.rd, value);
+    Utils::instruction_trace("DSRLV {}, {}, {}", GPR_NAMES[inst.r_type.rd],
+                             GPR_NAMES[inst.r_type.rt],
+                             GPR_NAMES[inst.r_type.rs]);
+}
+
+void CpuImpl::op_dsrav(Cpu &cpu, instruction_t inst) {
+    int64_t value = cpu.gpr.read(inst.r_type.rt);
+    value >>= (cpu.gpr.read(inst.r_type.rs) & 0b111111);
+    cpu.gpr.write(inst.r_type.rd, value);
+    Utils::instruction_trace("DSRAV {}, {}, {}", GPR_NAMES[inst.r_type.rd],
+                             GPR_NAMES[inst.r_type.rt],
+                             GPR_NAMES[inst.r_type.rs]);
+}
+
 void CpuImpl::op_sync(Cpu &cpu, instruction_t inst) {
     Utils::instruction_trace("SYNC");
 }
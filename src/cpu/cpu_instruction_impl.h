@@ -122,6 +122,12 @@ class CpuImpl {
 
     static void op_dsra32(Cpu &cpu, instruction_t inst);
 
+    static void op_dsllv(Cpu &cpu, instruction_t inst);
+
+    static void op_dsrlv(Cpu &cpu, instruction_t inst);
+
+    static void op_dsrav(Cpu &cpu, instruction_t inst);
+
     static void op_sync(Cpu &cpu, instruction_t inst);
 
     static void op_bltz(Cpu &cpu, instruction_t inst);
@@ -1,5 +1,8 @@
 #include "cpu/jit/code_cache.h"
+#include "memory/fastmem.h"
 #include "utils/log.h"
+#include <algorithm>
+#include <cstring>
 #ifdef _WIN32
 #include <windows.h>
 #else
@@ -33,6 +36,32 @@ void *alloc_rwx(size_t bytes) {
 #endif
 }
 
+void patch_rel32_jmp(uint8_t *jmp, const uint8_t *to) {
+    const int32_t rel = static_cast<int32_t>(to - (jmp + 5));
+    std::memcpy(jmp + 1, &rel, sizeof(rel));
+}
+
+// Calls fn(page_idx, lo, hi) for the part [lo, hi) of each 4 KiB page that
+// [begin, end) overlaps.
+template <typename Fn> void for_each_page(uint32_t begin, uint64_t end, Fn fn) {
+    constexpr uint32_t page_size = 0x1000;
+    for (uint64_t p = begin & ~uint64_t{page_size - 1}; p < end;
+         p += page_size) {
+        const uint64_t lo = std::max<uint64_t>(p, begin);
+        const uint64_t hi = std::min<uint64_t>(p + page_size, end);
+        fn(static_cast<uint32_t>(p >> 12), static_cast<uint32_t>(lo - p),
+           static_cast<uint32_t>(hi - p));
+    }
+}
+
+// Code-mask bits for page offsets [lo, hi), hi > lo.
+uint64_t granule_bits(uint32_t lo, uint32_t hi, uint32_t shift) {
+    const uint32_t first = lo >> shift;
+    const uint32_t last = (hi - 1) >> shift;
+    const uint64_t upto = last >= 63 ? ~uint64_t{0} : (uint64_t{2} << last) - 1;
+    return upto & ~((uint64_t{1} << first) - 1);
+}
+
 void free_rwx(void *ptr, size_t bytes) {
 #ifdef _WIN32
     (void)bytes;
@@ -47,12 +76,84 @@ CodeCache::CodeCache() { rdram_pages_.fill(nullptr); }
 
 CodeCache::~CodeCache() { clear(); }
 
-void CodeCache::maybe_flush() {
-    if (blocks_.size() > MAX_BLOCKS || total_slab_bytes_ > MAX_SLAB_BYTES) {
-        Utils::debug("JIT: flushing code cache (blocks={} slabs_bytes={:#x})",
-                     blocks_.size(), total_slab_bytes_);
-        clear();
+void CodeCache::set_limits(size_t max_slab_bytes, size_t max_blocks) {
+    max_slab_bytes_ = std::max(max_slab_bytes, 2 * SLAB_SIZE);
+    max_blocks_ = std::max<size_t>(max_blocks, 1);
+}
+
+CodeCache::Stats CodeCache::stats() const {
+    Stats s;
+    s.blocks = num_blocks_;
+    s.slabs = slabs_.size();
+    s.slab_bytes = total_slab_bytes_;
+    for (const auto &slab : slabs_)
+        s.used_bytes += slab->used;
+    s.evicted_slabs = evicted_slabs_;
+    s.evicted_blocks = evicted_blocks_;
+    s.fault_patches = fault_patches_;
+    return s;
+}
+
+void CodeCache::make_room() {
+    if (!slabs_.empty()) {
+        const Slab &cur = *slabs_.back();
+        const size_t used = (cur.used + 15) & ~size_t{15};
+        if (num_blocks_ < max_blocks_ && used + MAX_BLOCK_CODE <= cur.bytes)
+            return;
+    }
+    // Start a new generation, reusing the oldest slab once over budget. The
+    // newest generation is never evicted to make room for itself.
+    const bool over_blocks = num_blocks_ >= max_blocks_ && slabs_.size() > 1;
+    if (!slabs_.empty() &&
+        (over_blocks || total_slab_bytes_ + SLAB_SIZE > max_slab_bytes_))
+        recycle_oldest_slab();
+    else
+        open_slab(SLAB_SIZE);
+}
+
+void CodeCache::open_slab(size_t bytes) {
+    void *mem = alloc_rwx(bytes);
+    if (!mem) {
+        Utils::critical("JIT: executable memory allocation failed");
+        Utils::abort("Aborted");
     }
+    auto slab = std::make_unique<Slab>();
+    slab->ptr = static_cast<uint8_t *>(mem);
+    slab->bytes = bytes;
+    slabs_.push_back(std::move(slab));
+    total_slab_bytes_ += bytes;
+}
+
+void CodeCache::recycle_oldest_slab() {
+    std::unique_ptr<Slab> slab = std::move(slabs_.front());
+    slabs_.erase(slabs_.begin());
+    for (auto &b : slab->blocks) {
+        CompiledBlock *block = b.get();
+        Page *page = find_page(block->paddr >> PAGE_SHIFT);
+        CompiledBlock **entry =
+            page ? &page->entries[(block->paddr & (PAGE_SIZE - 1)) >> 2]
+                 : nullptr;
+        if (entry && *entry == block) {
+            *entry = nullptr;
+            retire(block);
+            remove_spans(block);
+        }
+        auto it = stale_.find(block->paddr);
+        if (it != stale_.end() && it->second == block)
+            stale_.erase(it);
+        if (last_hit_ == block)
+            clear_lookup_hint();
+    }
+    evicted_blocks_ += slab->blocks.size();
+    ++evicted_slabs_;
+    num_blocks_ -= slab->blocks.size();
+    Utils::debug("JIT: evicted code slab ({} blocks)", slab->blocks.size());
+    const auto lo = reinterpret_cast<uintptr_t>(slab->ptr);
+    fault_sites_.erase(fault_sites_.lower_bound(lo),
+                       fault_sites_.lower_bound(lo + slab->bytes));
+    slab->blocks.clear();
+    slab->used = 0;
+    slabs_.push_back(std::move(slab));
 }
 
 CodeCache::Page *CodeCache::find_page(uint32_t page_idx) const {
@@ -84,14 +185,12 @@ CodeCache::Page *CodeCache::get_or_create_page(uint32_t page_idx) {
 }
 
 uint8_t *CodeCache::alloc_exec(size_t size) {
-    maybe_flush();
-
     // Align to 16 for x86 call targets / Xbyak.
     const size_t align = 16;
     size = (size + align - 1) & ~(align - 1);
 
     if (!slabs_.empty()) {
-        Slab &cur = slabs_.back();
+        Slab &cur = *slabs_.back();
         const size_t aligned_used = (cur.used + align - 1) & ~(align - 1);
         if (aligned_used + size <= cur.bytes) {
             cur.used = aligned_used + size;
@@ -99,26 +198,20 @@ uint8_t *CodeCache::alloc_exec(size_t size) {
         }
     }
 
+    // Only reached for reservations larger than make_room() guarantees.
     const size_t page = host_page_size();
     size_t total = SLAB_SIZE;
     if (size + align > total)
         total = ((size + align + page - 1) / page) * page;
-
-    void *mem = alloc_rwx(total);
-    if (!mem) {
-        Utils::critical("JIT: executable memory allocation failed");
-        Utils::abort("Aborted");
-    }
-    auto *p = static_cast<uint8_t *>(mem);
-    slabs_.push_back(Slab{p, total, size});
-    total_slab_bytes_ += total;
-    return p;
+    open_slab(total);
+    slabs_.back()->used = size;
+    return slabs_.back()->ptr;
 }
 
 void CodeCache::shrink_last_alloc(size_t reserved, size_t used) {
     if (slabs_.empty())
         return;
-    Slab &cur = slabs_.back();
+    Slab &cur = *slabs_.back();
     if (cur.used < reserved)
         return;
     const size_t align = 16;
@@ -128,6 +221,28 @@ void CodeCache::shrink_last_alloc(size_t reserved, size_t used) {
     cur.used = cur.used - reserved + used_aligned;
 }
 
+void CodeCache::add_fault_sites(const uint8_t *code,
+                                const std::vector<FaultSite> &sites) {
+    const auto base = reinterpret_cast<uintptr_t>(code);
+    for (const FaultSite &site : sites)
+        fault_sites_[base + site.begin] = {base + site.end, base + site.slow};
+}
+
+uintptr_t CodeCache::patch_fault_site(uintptr_t pc) {
+    auto it = fault_sites_.upper_bound(pc);
+    if (it == fault_sites_.begin())
+        return 0;
+    --it;
+    if (pc >= it->second.end)
+        return 0;
+    // Sites start with a MOV of the arena base (5+ bytes): the JMP fits.
+    auto *site = reinterpret_cast<uint8_t *>(it->first);
+    site[0] = 0xE9;
+    patch_rel32_jmp(site, reinterpret_cast<const uint8_t *>(it->second.slow));
+    ++fault_patches_;
+    return it->second.slow;
+}
+
 CompiledBlock *CodeCache::lookup(uint32_t paddr) {
     if (last_hit_ && last_hit_->paddr == paddr)
         return last_hit_;
@@ -148,70 +263,209 @@ bool CodeCache::page_has_code(uint32_t paddr) const {
     return page && page->has_code;
 }
 
-void CodeCache::insert(uint32_t paddr, BlockFn fn, uint16_t num_insts) {
-    const uint32_t page_idx = paddr >> PAGE_SHIFT;
-    const uint32_t word = (paddr & (PAGE_SIZE - 1)) >> 2;
+CompiledBlock *CodeCache::new_block(uint32_t paddr) {
+    make_room();
+    auto block = std::make_unique<CompiledBlock>();
+    block->paddr = paddr;
+    CompiledBlock *raw = block.get();
+    slabs_.back()->blocks.push_back(std::move(block));
+    ++num_blocks_;
+    return raw;
+}
+
+void CodeCache::insert(CompiledBlock *block, BlockFn fn, uint16_t num_insts) {
+    // One IR op per guest word.
+    insert_trace(block, fn, num_insts, block->paddr,
+                 block->paddr + 4u * num_insts);
+}
+
+void CodeCache::insert_trace(CompiledBlock *block, BlockFn fn,
+                             uint16_t num_insts, uint32_t begin,
+                             uint32_t end) {
+    const uint32_t page_idx = block->paddr >> PAGE_SHIFT;
+    const uint32_t word = (block->paddr & (PAGE_SIZE - 1)) >> 2;
 
     Page *page = get_or_create_page(page_idx);
-    auto block = std::make_unique<CompiledBlock>();
     block->fn = fn;
-    block->paddr = paddr;
     block->num_insts = num_insts;
-    CompiledBlock *raw = block.get();
-    blocks_.push_back(std::move(block));
-    page->entries[word] = raw;
-    page->has_code = true;
-    last_hit_ = raw;
+    block->begin = begin;
+    block->end = end;
+    if (CompiledBlock *old = page->entries[word]) {
+        retire(old);
+        remove_spans(old);
+    }
+    page->entries[word] = block;
+    add_spans(block);
+    stale_.erase(block->paddr);
+    last_hit_ = block;
 }
 
-void CodeCache::invalidate_page(uint32_t paddr) {
-    const uint32_t page_idx = paddr >> PAGE_SHIFT;
-    Page *page = find_page(page_idx);
+void CodeCache::add_spans(CompiledBlock *block) {
+    for_each_page(block->begin, block->end,
+                  [&](uint32_t idx, uint32_t lo, uint32_t hi) {
+                      Page *page = get_or_create_page(idx);
+                      page->spans.push_back(block);
+                      page->code_mask |= granule_bits(lo, hi, GRANULE_SHIFT);
+                      if (!page->has_code)
+                          Fastmem::set_code_page(idx << PAGE_SHIFT,
+                                                 Fastmem::CODE_JIT, true);
+                      page->has_code = true;
+                  });
+}
+
+void CodeCache::remove_spans(CompiledBlock *block) {
+    for_each_page(
+        block->begin, block->end, [&](uint32_t idx, uint32_t, uint32_t) {
+            Page *page = find_page(idx);
+            if (!page)
+                return;
+            auto &spans = page->spans;
+            spans.erase(std::remove(spans.begin(), spans.end(), block),
+                        spans.end());
+            // Rebuild from the survivors; spans are short.
+            const uint32_t base = idx << PAGE_SHIFT;
+            page->code_mask = 0;
+            for (CompiledBlock *b : spans) {
+                const uint32_t lo = b->begin > base ? b->begin - base : 0;
+                const uint32_t hi =
+                    std::min<uint64_t>(uint64_t{b->end} - base, PAGE_SIZE);
+                page->code_mask |= granule_bits(lo, hi, GRANULE_SHIFT);
+            }
+            if (page->has_code && spans.empty())
+                Fastmem::set_code_page(idx << PAGE_SHIFT, Fastmem::CODE_JIT,
+                                       false);
+            page->has_code = !spans.empty();
+        });
+}
+
+bool CodeCache::link(BlockExit &exit, CompiledBlock *to) {
+    if (!exit.jmp || exit.linked || to->paddr != exit.target)
+        return false;
+    const auto *entry = reinterpret_cast<const uint8_t *>(to->fn);
+    const int64_t rel = entry - (exit.jmp + 5);
+    if (rel != static_cast<int32_t>(rel))
+        return false;
+    patch_rel32_jmp(exit.jmp, entry);
+    exit.linked = to;
+    to->incoming.push_back(&exit);
+    return true;
+}
+
+bool CodeCache::link_pending(CompiledBlock *to) {
+    BlockExit *exit = pending_exit_;
+    pending_exit_ = nullptr;
+    return exit && link(*exit, to);
+}
+
+void CodeCache::unlink(BlockExit &exit) {
+    patch_rel32_jmp(exit.jmp, exit.unlinked);
+    exit.linked = nullptr;
+}
+
+void CodeCache::retire(CompiledBlock *block) {
+    // Nothing may jump into dropped code, and its own exits must not keep
+    // the targets' incoming lists growing (or, once revived, jump into a
+    // target that has since been dropped).
+    for (BlockExit *e : block->incoming)
+        unlink(*e);
+    block->incoming.clear();
+    for (auto &e : block->exits) {
+        if (pending_exit_ == &e)
+            pending_exit_ = nullptr;
+        if (!e.linked)
+            continue;
+        auto &in = e.linked->incoming;
+        in.erase(std::remove(in.begin(), in.end(), &e), in.end());
+        unlink(e);
+    }
+}
+
+void CodeCache::drop_block(CompiledBlock *block) {
+    Page *page = find_page(block->paddr >> PAGE_SHIFT);
+    if (page) {
+        auto &entry = page->entries[(block->paddr & (PAGE_SIZE - 1)) >> 2];
+        if (entry == block)
+            entry = nullptr;
+    }
     // Data writes (framebuffer etc.) must not touch the lookup hint or we
     // destroy soft-chaining after every store.
-    if (!page || !page->has_code)
+    if (last_hit_ == block)
+        clear_lookup_hint();
+    retire(block);
+    remove_spans(block);
+    stale_[block->paddr] = block;
+}
+
+void CodeCache::drop(CompiledBlock *block) {
+    Page *page = find_page(block->paddr >> PAGE_SHIFT);
+    if (!page)
         return;
-    clear_lookup_hint();
-    for (auto *&e : page->entries)
-        e = nullptr;
-    page->has_code = false;
+    if (page->entries[(block->paddr & (PAGE_SIZE - 1)) >> 2] != block)
+        return;
+    drop_block(block);
 }
 
-void CodeCache::invalidate_range(uint32_t paddr, uint32_t length) {
+uint32_t CodeCache::invalidate_page(uint32_t paddr) {
+    return invalidate_range(paddr & ~(PAGE_SIZE - 1), PAGE_SIZE);
+}
+
+uint32_t CodeCache::invalidate_range(uint32_t paddr, uint32_t length) {
     if (length == 0)
-        return;
-    const uint32_t start = paddr & ~(PAGE_SIZE - 1);
-    const uint64_t end64 =
-        static_cast<uint64_t>(paddr) + static_cast<uint64_t>(length) - 1;
-    const uint32_t end = end64 > 0xffffffffu ? 0xffffffffu
-                                             : static_cast<uint32_t>(end64);
-    bool any = false;
-    for (uint64_t p = start; p <= end; p += PAGE_SIZE) {
-        Page *page = find_page(static_cast<uint32_t>(p) >> PAGE_SHIFT);
-        if (!page || !page->has_code)
-            continue;
-        if (!any) {
-            clear_lookup_hint();
-            any = true;
+        return 0;
+    const uint64_t end = static_cast<uint64_t>(paddr) + length;
+    uint32_t dropped = 0;
+    std::vector<CompiledBlock *> hit;
+    for_each_page(paddr, end, [&](uint32_t idx, uint32_t lo, uint32_t hi) {
+        Page *page = find_page(idx);
+        if (!page ||
+            !(page->code_mask & granule_bits(lo, hi, GRANULE_SHIFT)))
+            return;
+        hit.clear();
+        for (CompiledBlock *b : page->spans) {
+            if (b->begin < end && paddr < b->end)
+                hit.push_back(b);
         }
-        for (auto *&e : page->entries)
-            e = nullptr;
-        page->has_code = false;
+        for (CompiledBlock *b : hit)
+            drop_block(b);
+        dropped += static_cast<uint32_t>(hit.size());
+    });
+    return dropped;
+}
+
+CompiledBlock *CodeCache::find_stale(uint32_t paddr) const {
+    auto it = stale_.find(paddr);
+    return it == stale_.end() ? nullptr : it->second;
+}
+
+void CodeCache::revive(CompiledBlock *block) {
+    stale_.erase(block->paddr);
+    Page *page = get_or_create_page(block->paddr >> PAGE_SHIFT);
+    auto &entry = page->entries[(block->paddr & (PAGE_SIZE - 1)) >> 2];
+    if (entry) {
+        retire(entry);
+        remove_spans(entry);
     }
+    entry = block;
+    add_spans(block);
+    last_hit_ = block;
 }
 
 void CodeCache::clear() {
     clear_lookup_hint();
+    pending_exit_ = nullptr;
+    stale_.clear();
     rdram_pages_.fill(nullptr);
     other_pages_.clear();
     page_storage_.clear();
-    blocks_.clear();
     for (auto &s : slabs_) {
-        if (s.ptr)
-            free_rwx(s.ptr, s.bytes);
+        if (s->ptr)
+            free_rwx(s->ptr, s->bytes);
     }
     slabs_.clear();
+    fault_sites_.clear();
+    Fastmem::clear_code_pages(Fastmem::CODE_JIT);
     total_slab_bytes_ = 0;
+    num_blocks_ = 0;
 }
 
 } // namespace Jit
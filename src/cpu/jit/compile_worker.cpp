@@ -0,0 +1,71 @@
+#include "cpu/jit/compile_worker.h"
+#include "cpu/jit/jit.h"
+
+namespace N64 {
+namespace Cpu {
+namespace Jit {
+
+CompileWorker::~CompileWorker() {
+    if (!thread_.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+void CompileWorker::submit(std::unique_ptr<CompileJob> job) {
+    if (!thread_.joinable())
+        thread_ = std::thread([this] { loop(); });
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(job));
+    }
+    cv_.notify_all();
+}
+
+std::vector<std::unique_ptr<CompileJob>> CompileWorker::take_finished() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_finished_.store(false, std::memory_order_relaxed);
+    return std::move(finished_);
+}
+
+void CompileWorker::loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [this] { return quit_ || !queue_.empty(); });
+        if (quit_)
+            return;
+        std::unique_ptr<CompileJob> job = std::move(queue_.front());
+        queue_.pop_front();
+        lock.unlock();
+        run(*job);
+        lock.lock();
+        finished_.push_back(std::move(job));
+        has_finished_.store(true, std::memory_order_release);
+    }
+}
+
+void CompileWorker::run(CompileJob &job) {
+    if (job.cancelled.load(std::memory_order_relaxed))
+        return;
+    if (!job.have_ir) {
+        if (!translate_block(job.vaddr, job.paddr, job.fr, job.words,
+                             job.translated))
+            return;
+        job.ir = job.translated;
+    }
+    if (job.optimize)
+        optimize_block(job.ir, &job.opt);
+    // Emission is the expensive part; skip it if a guest write already
+    // made the result useless.
+    if (job.cancelled.load(std::memory_order_relaxed))
+        return;
+    job.ok = emit_block_detached(job.ir, job.block);
+}
+
+} // namespace Jit
+} // namespace Cpu
+} // namespace N64
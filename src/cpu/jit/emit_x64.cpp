@@ -3,9 +3,11 @@
 #include "cpu/jit/helpers.h"
 #include "cpu/jit/ir.h"
 #include "cpu/jit/jit.h"
+#include "memory/fastmem.h"
 #include "memory/memory.h"
 #include "memory/memory_map.h"
 #include "mmu/soft_tlb.h"
+#include "rcp/rsp.h"
 #include <xbyak/xbyak.h>
 #include <cstddef>
 #include <cstring>
@@ -64,12 +66,44 @@ bool is_mem_op(IrOpKind k) {
     case IrOpKind::Ld:
     case IrOpKind::Lwl:
     case IrOpKind::Lwr:
+    case IrOpKind::Ldl:
+    case IrOpKind::Ldr:
+    case IrOpKind::Ll:
+    case IrOpKind::Lld:
     case IrOpKind::Sb:
     case IrOpKind::Sh:
     case IrOpKind::Sw:
     case IrOpKind::Sd:
     case IrOpKind::Swl:
     case IrOpKind::Swr:
+    case IrOpKind::Sdl:
+    case IrOpKind::Sdr:
+    case IrOpKind::Sc:
+    case IrOpKind::Scd:
+    case IrOpKind::Lwc1:
+    case IrOpKind::Ldc1:
+    case IrOpKind::Swc1:
+    case IrOpKind::Sdc1:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Ops emitted inline against Status.CU1 / Status.FR as seen at translation.
+bool is_native_cop1(IrOpKind k) {
+    switch (k) {
+    case IrOpKind::Bc1:
+    case IrOpKind::Bc1l:
+    case IrOpKind::Lwc1:
+    case IrOpKind::Ldc1:
+    case IrOpKind::Swc1:
+    case IrOpKind::Sdc1:
+    case IrOpKind::Mfc1:
+    case IrOpKind::Mtc1:
+    case IrOpKind::Dmfc1:
+    case IrOpKind::Dmtc1:
+    case IrOpKind::Cop1Arith:
         return true;
     default:
         return false;
@@ -93,54 +127,233 @@ uint32_t mem_access_size(IrOpKind k) {
     case IrOpKind::Lwr:
     case IrOpKind::Swl:
     case IrOpKind::Swr:
+    case IrOpKind::Ll:
+    case IrOpKind::Sc:
+    case IrOpKind::Lwc1:
+    case IrOpKind::Swc1:
         return 4;
     case IrOpKind::Ld:
     case IrOpKind::Sd:
+    case IrOpKind::Ldl:
+    case IrOpKind::Ldr:
+    case IrOpKind::Sdl:
+    case IrOpKind::Sdr:
+    case IrOpKind::Lld:
+    case IrOpKind::Scd:
+    case IrOpKind::Ldc1:
+    case IrOpKind::Sdc1:
         return 8;
     default:
         return 4;
     }
 }
 
+static_assert(MAX_SUCCESSORS == MAX_BLOCK_EXITS,
+              "one patchable exit per IR successor");
+
+// Host callee-saved registers that hold hot guest GPRs for a whole block.
+constexpr int kCachedRegs = 4;
+
+// Guest GPRs the emitter reads or writes inline for this op; registers only
+// touched inside C++ helpers go through memory anyway and are not counted.
+int inline_gprs(const IrOp &op, uint8_t out[3]) {
+    int n = 0;
+    switch (op.kind) {
+    case IrOpKind::Add:
+    case IrOpKind::Addu:
+    case IrOpKind::Sub:
+    case IrOpKind::Subu:
+    case IrOpKind::And:
+    case IrOpKind::Or:
+    case IrOpKind::Xor:
+    case IrOpKind::Nor:
+    case IrOpKind::Slt:
+    case IrOpKind::Sltu:
+    case IrOpKind::Daddu:
+    case IrOpKind::Dsubu:
+    case IrOpKind::Sllv:
+    case IrOpKind::Srlv:
+    case IrOpKind::Srav:
+    case IrOpKind::Dsllv:
+    case IrOpKind::Dsrlv:
+    case IrOpKind::Dsrav:
+        out[n++] = op.rs;
+        out[n++] = op.rt;
+        out[n++] = op.rd;
+        break;
+    case IrOpKind::Sll:
+    case IrOpKind::Srl:
+    case IrOpKind::Sra:
+    case IrOpKind::Dsll:
+    case IrOpKind::Dsrl:
+    case IrOpKind::Dsra:
+    case IrOpKind::Dsll32:
+    case IrOpKind::Dsrl32:
+    case IrOpKind::Dsra32:
+        out[n++] = op.rt;
+        out[n++] = op.rd;
+        break;
+    case IrOpKind::Lui:
+        out[n++] = op.rt;
+        break;
+    case IrOpKind::Addiu:
+    case IrOpKind::Andi:
+    case IrOpKind::Ori:
+    case IrOpKind::Xori:
+    case IrOpKind::Slti:
+    case IrOpKind::Sltiu:
+    case IrOpKind::Daddiu:
+    case IrOpKind::Beq:
+    case IrOpKind::Bne:
+    case IrOpKind::Beql:
+    case IrOpKind::Bnel:
+    case IrOpKind::Lb:
+    case IrOpKind::Lbu:
+    case IrOpKind::Lh:
+    case IrOpKind::Lhu:
+    case IrOpKind::Lw:
+    case IrOpKind::Lwu:
+    case IrOpKind::Ld:
+    case IrOpKind::Sb:
+    case IrOpKind::Sh:
+    case IrOpKind::Sw:
+    case IrOpKind::Sd:
+    case IrOpKind::Mult:
+    case IrOpKind::Multu:
+    case IrOpKind::Div:
+    case IrOpKind::Divu:
+    case IrOpKind::Dmult:
+    case IrOpKind::Dmultu:
+    case IrOpKind::Ddiv:
+    case IrOpKind::Ddivu:
+        out[n++] = op.rs;
+        out[n++] = op.rt;
+        break;
+    case IrOpKind::Jr:
+    case IrOpKind::Jalr:
+    case IrOpKind::Blez:
+    case IrOpKind::Bgtz:
+    case IrOpKind::Bltz:
+    case IrOpKind::Bgez:
+    case IrOpKind::Blezl:
+    case IrOpKind::Bgtzl:
+    case IrOpKind::Bltzl:
+    case IrOpKind::Bgezl:
+    case IrOpKind::Bltzal:
+    case IrOpKind::Bgezal:
+    case IrOpKind::Mthi:
+    case IrOpKind::Mtlo:
+        out[n++] = op.rs;
+        break;
+    case IrOpKind::Mfhi:
+    case IrOpKind::Mflo:
+    case IrOpKind::LoadConst:
+        out[n++] = op.rd;
+        break;
+    case IrOpKind::Lwc1:
+    case IrOpKind::Ldc1:
+    case IrOpKind::Swc1:
+    case IrOpKind::Sdc1:
+        out[n++] = op.rs;
+        break;
+    case IrOpKind::Mfc1:
+    case IrOpKind::Mtc1:
+    case IrOpKind::Dmfc1:
+    case IrOpKind::Dmtc1:
+        out[n++] = op.rt;
+        break;
+    default:
+        break;
+    }
+    return n;
+}
+
 class BlockEmitter : public CodeGenerator {
   public:
     explicit BlockEmitter(uint8_t *buf, size_t size)
         : CodeGenerator(size, buf) {
         auto &cpu = g_cpu();
-        gpr_base_ = reinterpret_cast<uintptr_t>(cpu.gpr_data());
-        lo_ptr_ = reinterpret_cast<uintptr_t>(cpu.lo_ptr());
-        hi_ptr_ = reinterpret_cast<uintptr_t>(cpu.hi_ptr());
-        delay_slot_ptr_ = reinterpret_cast<uintptr_t>(cpu.delay_slot_ptr());
-        prev_delay_slot_ptr_ =
-            reinterpret_cast<uintptr_t>(cpu.prev_delay_slot_ptr());
-        prev_pc_ptr_ = reinterpret_cast<uintptr_t>(cpu.prev_pc_ptr());
-        pc_ptr_ = reinterpret_cast<uintptr_t>(cpu.pc_ptr());
-        next_pc_ptr_ = reinterpret_cast<uintptr_t>(cpu.next_pc_ptr());
+        // rbp points 128 bytes into the GPR file so every GPR is a disp8
+        // operand; the other Cpu fields live in the same object.
+        base_ = reinterpret_cast<uintptr_t>(cpu.gpr_data()) + 128;
+        lo_off_ = cpu_offset(cpu.lo_ptr());
+        hi_off_ = cpu_offset(cpu.hi_ptr());
+        delay_slot_off_ = cpu_offset(cpu.delay_slot_ptr());
+        prev_delay_slot_off_ = cpu_offset(cpu.prev_delay_slot_ptr());
+        prev_pc_off_ = cpu_offset(cpu.prev_pc_ptr());
+        pc_off_ = cpu_offset(cpu.pc_ptr());
+        next_pc_off_ = cpu_offset(cpu.next_pc_ptr());
         aborted_ptr_ =
             reinterpret_cast<uintptr_t>(&exec_state_ptr()->aborted);
         annul_ptr_ =
             reinterpret_cast<uintptr_t>(&exec_state_ptr()->annul_delay_slot);
+        link_break_ptr_ =
+            reinterpret_cast<uintptr_t>(&exec_state_ptr()->link_break);
+        exec_ptr_ = reinterpret_cast<uintptr_t>(exec_state_ptr());
+        status_off_ = cpu_offset(&cpu.cop0.reg.status);
+        entry_hi_off_ = cpu_offset(&cpu.cop0.reg.entry_hi);
+        fcr31_off_ = cpu_offset(&cpu.cop1.fcr31);
+        fgr_off_ = cpu_offset(cpu.cop1.fgr.data());
+        cop0_status_t cu1{}, fr{};
+        cu1.cu1 = 1;
+        fr.fr = 1;
+        cu1_mask_ = cu1.raw;
+        fr_mask_ = fr.raw;
+        fcr31_t cmp{};
+        cmp.compare = 1;
+        compare_mask_ = cmp.raw;
         rdram_base_ =
             reinterpret_cast<uintptr_t>(g_memory().get_rdram().data());
+        if (Fastmem::enabled())
+            fastmem_base_ = reinterpret_cast<uintptr_t>(Fastmem::base());
+        rsp_pending_ptr_ =
+            reinterpret_cast<uintptr_t>(g_rsp().task_pending_flag());
         soft_tlb_load_ =
             reinterpret_cast<uintptr_t>(Mmu::soft_tlb_load_table());
         soft_tlb_store_ =
             reinterpret_cast<uintptr_t>(Mmu::soft_tlb_store_table());
     }
 
-    BlockFn emit(const IrBlock &block) {
+    BlockFn emit(const IrBlock &block, CompiledBlock &out) {
         const size_t n = block.ops.size();
         Xbyak::Label exit_label;
+        out_ = &out;
+        fr_ = block.fr;
 
-        // prologue: keep cycles in ebx (callee-saved).
-        // On entry RSP is 8-mod-16; after two pushes still 8-mod-16.
+        pick_cached_regs(block);
+
+        // prologue: cycles in ebx, Cpu base in rbp, cached GPRs in r12..r15
+        // (all callee-saved). On entry RSP is 8-mod-16; an even number of
+        // pushes keeps it there, an odd one needs 8 more bytes of padding.
         // ABI requires 16-byte alignment before CALL (Win64 also needs shadow).
         push(rbx);
-        push(r12);
-        sub(rsp, kAbiStackAdjust);
+        push(rbp);
+        for (int i = 0; i < num_cached_; i++)
+            push(kHostRegs[i]);
+        const size_t stack_adjust =
+            kAbiStackAdjust + ((num_cached_ & 1) ? 8 : 0);
+        sub(rsp, stack_adjust);
+        mov(rbp, base_);
+        reload_cached();
         xor_(ebx, ebx); // cycles_done
 
+        Xbyak::Label seam_out;
+        size_t next_seam = 0;
+        bool cop1_checked = false;
         for (size_t i = 0; i < n; i++) {
+            const IrOpKind kind = block.ops[i].kind;
+            if (next_seam < block.seams.size() &&
+                block.seams[next_seam].op == i) {
+                emit_seam(block.seams[next_seam].vaddr, exit_label, seam_out);
+                ++next_seam;
+            }
+            // Before the PC advance, so a failed check leaves the op to the
+            // interpreter exactly as if the block had ended here.
+            if (is_native_cop1(kind) && !cop1_checked) {
+                emit_cop1_guard(exit_label);
+                cop1_checked = true;
+            }
+
             emit_advance_pc();
 
             emit_op(block.ops[i], exit_label);
@@ -149,103 +362,292 @@ class BlockEmitter : public CodeGenerator {
             inc(ebx);
 
             // Memory / FPU helpers can set aborted (TLB, CU1, etc.).
-            if (is_mem_op(block.ops[i].kind) ||
-                block.ops[i].kind == IrOpKind::Fpu ||
-                block.ops[i].kind == IrOpKind::Bc1 ||
-                block.ops[i].kind == IrOpKind::Bc1l) {
-                mov(rax, aborted_ptr_);
-                cmp(byte[rax], 0);
+            if (is_mem_op(kind) || kind == IrOpKind::Fpu) {
+                cmp_flag(aborted_ptr_);
                 jne(exit_label, T_NEAR);
             }
+            // Status may have changed under the native COP1 assumptions.
+            if (kind == IrOpKind::Mtc0 || kind == IrOpKind::Dmtc0)
+                cop1_checked = false;
 
             // Branch-likely may annul the delay slot that follows in this block.
             if (is_branch_likely(block.ops[i].kind) && i + 1 < n) {
-                mov(rax, annul_ptr_);
-                cmp(byte[rax], 0);
+                cmp_flag(annul_ptr_);
                 jne(exit_label, T_NEAR);
             }
         }
 
         L(exit_label);
+        // Every exit shares this path, so store anything written anywhere in
+        // the block; host registers always hold the current guest value.
+        for (int i = 0; i < num_cached_; i++) {
+            if (written_ & (1u << i))
+                mov(qword[rbp + gpr_disp(cached_[i])], kHostRegs[i]);
+        }
         // add_count(cycles) — compare-edge logic stays in C++.
         mov(JIT_ARG1d, ebx);
         mov(rax, reinterpret_cast<uintptr_t>(&add_count));
         call(rax);
 
+        // Native linking: a clean exit onto a static successor jumps on
+        // while the budget lasts; anything else returns to the dispatcher.
+        Xbyak::Label ret_label;
+        Xbyak::Label leave[MAX_BLOCK_EXITS];
+        const int num_exits = block.num_successors;
+        if (num_exits > 0) {
+            mov(rax, exec_ptr_);
+            cmp(byte[rax + offsetof(ExecState, aborted)], 0);
+            jne(ret_label, T_NEAR);
+            cmp(byte[rax + offsetof(ExecState, link_break)], 0);
+            jne(ret_label, T_NEAR);
+            cmp(byte[rbp + delay_slot_off_], 0);
+            jne(ret_label, T_NEAR);
+            for (int k = 0; k < num_exits; k++) {
+                cmp(qword[rbp + pc_off_],
+                    static_cast<int32_t>(block.successors[k].vaddr));
+                je(leave[k], T_NEAR);
+            }
+        }
+
+        L(ret_label);
         mov(eax, ebx); // return cycles
-        add(rsp, kAbiStackAdjust);
-        pop(r12);
-        pop(rbx);
+        emit_epilogue(stack_adjust);
         ret();
 
+        if (!block.seams.empty()) {
+            // Stopped at a seam after add_count: same as the exit path
+            // without counting again.
+            L(seam_out);
+            for (int i = 0; i < num_cached_; i++) {
+                if (written_ & (1u << i))
+                    mov(qword[rbp + gpr_disp(cached_[i])], kHostRegs[i]);
+            }
+            jmp(ret_label, T_NEAR);
+        }
+
+        for (int k = 0; k < num_exits; k++) {
+            BlockExit &exit = out.exits[k];
+            Xbyak::Label unlinked;
+            L(leave[k]);
+            // Exit profile for trace formation; rax stays the ExecState.
+            mov_rcx_record(reinterpret_cast<uint8_t *>(&exit.hits) -
+                           reinterpret_cast<uint8_t *>(&out));
+            inc(dword[rcx]);
+            sub(dword[rax + offsetof(ExecState, link_budget)], ebx);
+            jle(ret_label, T_NEAR);
+            add(dword[rax + offsetof(ExecState, linked_cycles)], ebx);
+            inc(dword[rax + offsetof(ExecState, links_taken)]);
+            mov(byte[rax + offsetof(ExecState, annul_delay_slot)], 0);
+            emit_epilogue(stack_adjust);
+            // Patch site: rel32 JMP, retargeted by CodeCache::link/unlink.
+            exit.target = block.successors[k].paddr;
+            exit.jmp = const_cast<uint8_t *>(getCurr());
+            jmp(unlinked, T_NEAR);
+            L(unlinked);
+            exit.unlinked = const_cast<uint8_t *>(getCurr());
+            // Cycles are already in linked_cycles; tell the dispatcher which
+            // exit to patch once it finds the successor.
+            mov_rcx_record(reinterpret_cast<uint8_t *>(&exit) -
+                           reinterpret_cast<uint8_t *>(&out));
+            mov(qword[rax + offsetof(ExecState, link_exit)], rcx);
+            xor_(eax, eax);
+            ret();
+        }
+
         ready();
         return getCode<BlockFn>();
     }
 
+    const std::vector<RecordRef> &record_refs() const { return record_refs_; }
+    const std::vector<FaultSite> &fault_sites() const { return fault_sites_; }
+
   private:
-    uintptr_t gpr_base_{};
-    uintptr_t lo_ptr_{};
-    uintptr_t hi_ptr_{};
-    uintptr_t delay_slot_ptr_{};
-    uintptr_t prev_delay_slot_ptr_{};
-    uintptr_t prev_pc_ptr_{};
-    uintptr_t pc_ptr_{};
-    uintptr_t next_pc_ptr_{};
+    static inline const Reg64 kHostRegs[kCachedRegs] = {r12, r13, r14, r15};
+
+    uintptr_t base_{};
+    int32_t lo_off_{};
+    int32_t hi_off_{};
+    int32_t delay_slot_off_{};
+    int32_t prev_delay_slot_off_{};
+    int32_t prev_pc_off_{};
+    int32_t pc_off_{};
+    int32_t next_pc_off_{};
     uintptr_t aborted_ptr_{};
     uintptr_t annul_ptr_{};
+    uintptr_t link_break_ptr_{};
+    uintptr_t exec_ptr_{};
+    int32_t status_off_{};
+    int32_t entry_hi_off_{};
+    int32_t fcr31_off_{};
+    int32_t fgr_off_{};
+    uint32_t cu1_mask_{};
+    uint32_t fr_mask_{};
+    uint32_t compare_mask_{};
+    bool fr_{false}; // Status.FR the block was translated under
+    CompiledBlock *out_{nullptr};
+    std::vector<RecordRef> record_refs_;
+    std::vector<FaultSite> fault_sites_;
     uintptr_t rdram_base_{};
+    uintptr_t fastmem_base_{}; // 0: fastmem off
+    uintptr_t rsp_pending_ptr_{};
     uintptr_t soft_tlb_load_{};
     uintptr_t soft_tlb_store_{};
 
-    void call_fn(const void *fn) {
+    // Guest GPR held by kHostRegs[i]; bit i of dirty_ / written_.
+    uint8_t cached_[kCachedRegs]{};
+    int num_cached_{0};
+    uint32_t dirty_{0};   // newer than memory at this point of emission
+    uint32_t written_{0}; // stored by any op in the block
+
+    int32_t cpu_offset(const void *p) const {
+        return static_cast<int32_t>(
+            static_cast<intptr_t>(reinterpret_cast<uintptr_t>(p) - base_));
+    }
+
+    static int32_t gpr_disp(uint8_t reg) { return reg * 8 - 128; }
+
+    // Top kCachedRegs GPRs by inline use count. A single use is not worth
+    // the entry load (and maybe the exit store).
+    void pick_cached_regs(const IrBlock &block) {
+        int uses[32]{};
+        for (const auto &op : block.ops) {
+            uint8_t regs[3];
+            const int n = inline_gprs(op, regs);
+            for (int i = 0; i < n; i++)
+                uses[regs[i] & 31]++;
+        }
+        uses[0] = 0;
+        num_cached_ = 0;
+        while (num_cached_ < kCachedRegs) {
+            int best = 0;
+            for (int r = 1; r < 32; r++) {
+                if (uses[r] > uses[best])
+                    best = r;
+            }
+            if (uses[best] < 2)
+                break;
+            cached_[num_cached_++] = static_cast<uint8_t>(best);
+            uses[best] = 0;
+        }
+        dirty_ = written_ = 0;
+    }
+
+    int cached_index(uint8_t reg) const {
+        for (int i = 0; i < num_cached_; i++) {
+            if (cached_[i] == reg)
+                return i;
+        }
+        return -1;
+    }
+
+    void flush_dirty() {
+        for (int i = 0; i < num_cached_; i++) {
+            if (dirty_ & (1u << i))
+                mov(qword[rbp + gpr_disp(cached_[i])], kHostRegs[i]);
+        }
+    }
+
+    void reload_cached() {
+        for (int i = 0; i < num_cached_; i++)
+            mov(kHostRegs[i], qword[rbp + gpr_disp(cached_[i])]);
+    }
+
+    void cmp_flag(uintptr_t flag) {
+        const auto d = static_cast<int64_t>(flag - base_);
+        if (d == static_cast<int32_t>(d)) {
+            cmp(byte[rbp + static_cast<int32_t>(d)], 0);
+        } else {
+            mov(rax, flag);
+            cmp(byte[rax], 0);
+        }
+    }
+
+    void set_flag(uintptr_t flag) {
+        const auto d = static_cast<int64_t>(flag - base_);
+        if (d == static_cast<int32_t>(d)) {
+            mov(byte[rbp + static_cast<int32_t>(d)], 1);
+        } else {
+            mov(rax, flag);
+            mov(byte[rax], 1);
+        }
+    }
+
+    void emit_epilogue(size_t stack_adjust) {
+        add(rsp, stack_adjust);
+        for (int i = num_cached_ - 1; i >= 0; i--)
+            pop(kHostRegs[i]);
+        pop(rbp);
+        pop(rbx);
+    }
+
+    // Helpers read and write guest GPRs in memory: spill dirty cached
+    // registers before the call and reload all of them after. Slow paths
+    // that rejoin an inline fast path keep the dirty set, since the fast
+    // path did not spill.
+    void call_fn(const void *fn, bool side_path = false) {
+        flush_dirty();
         mov(rax, reinterpret_cast<uintptr_t>(fn));
         call(rax);
+        reload_cached();
+        if (!side_path)
+            dirty_ = 0;
+    }
+
+    // Helpers that can reach MMIO, COP0 or the scheduler also end a native
+    // link chain, so the dispatcher re-checks events and interrupts.
+    void call_sys_fn(const void *fn, bool side_path = false) {
+        set_flag(link_break_ptr_);
+        call_fn(fn, side_path);
     }
 
     // Inline Cpu::advance_pc_no_fetch().
     void emit_advance_pc() {
         // prev_delay_slot = delay_slot; delay_slot = false;
-        mov(rax, delay_slot_ptr_);
-        movzx(ecx, byte[rax]);
-        mov(rdx, prev_delay_slot_ptr_);
-        mov(byte[rdx], cl);
-        mov(byte[rax], 0);
+        movzx(ecx, byte[rbp + delay_slot_off_]);
+        mov(byte[rbp + prev_delay_slot_off_], cl);
+        mov(byte[rbp + delay_slot_off_], 0);
 
         // prev_pc = pc; pc = next_pc; next_pc += 4;
-        mov(rax, pc_ptr_);
-        mov(rcx, qword[rax]);
-        mov(rdx, prev_pc_ptr_);
-        mov(qword[rdx], rcx);
-        mov(rdx, next_pc_ptr_);
-        mov(rcx, qword[rdx]);
-        mov(qword[rax], rcx);
-        add(qword[rdx], 4);
+        mov(rax, qword[rbp + pc_off_]);
+        mov(qword[rbp + prev_pc_off_], rax);
+        mov(rcx, qword[rbp + next_pc_off_]);
+        mov(qword[rbp + pc_off_], rcx);
+        add(qword[rbp + next_pc_off_], 4);
     }
 
-    void gpr_to_rax(uint8_t reg) {
+    void load_gpr(const Reg64 &dst, uint8_t reg) {
         if (reg == 0) {
-            xor_(eax, eax);
+            xor_(dst.cvt32(), dst.cvt32());
             return;
         }
-        mov(rax, gpr_base_ + static_cast<uintptr_t>(reg) * 8);
-        mov(rax, qword[rax]);
+        const int i = cached_index(reg);
+        if (i >= 0)
+            mov(dst, kHostRegs[i]);
+        else
+            mov(dst, qword[rbp + gpr_disp(reg)]);
     }
 
+    void gpr_to_rax(uint8_t reg) { load_gpr(rax, reg); }
+
     void rax_to_gpr(uint8_t reg) {
         if (reg == 0)
             return;
-        // value in rax
-        mov(rdx, gpr_base_ + static_cast<uintptr_t>(reg) * 8);
-        mov(qword[rdx], rax);
+        const int i = cached_index(reg);
+        if (i >= 0) {
+            mov(kHostRegs[i], rax);
+            dirty_ |= 1u << i;
+            written_ |= 1u << i;
+        } else {
+            mov(qword[rbp + gpr_disp(reg)], rax);
+        }
     }
 
     void emit_alu_rr_32(IrOpKind kind, const IrOp &op) {
-        // rs -> r12, rt -> rax; 32-bit arithmetic then sign-extend
-        gpr_to_rax(op.rs);
-        mov(r12, rax);
+        // rs -> r11, rt -> rax; 32-bit arithmetic then sign-extend
+        load_gpr(r11, op.rs);
         gpr_to_rax(op.rt);
         mov(ecx, eax);  // rt
-        mov(eax, r12d); // rs
+        mov(eax, r11d); // rs
 
         switch (kind) {
         case IrOpKind::Add:
@@ -264,21 +666,20 @@ class BlockEmitter : public CodeGenerator {
     }
 
     void emit_alu_rr_64_logic(IrOpKind kind, const IrOp &op) {
-        gpr_to_rax(op.rs);
-        mov(r12, rax);
+        load_gpr(r11, op.rs);
         gpr_to_rax(op.rt);
         switch (kind) {
         case IrOpKind::And:
-            and_(rax, r12);
+            and_(rax, r11);
             break;
         case IrOpKind::Or:
-            or_(rax, r12);
+            or_(rax, r11);
             break;
         case IrOpKind::Xor:
-            xor_(rax, r12);
+            xor_(rax, r11);
             break;
         case IrOpKind::Nor:
-            or_(rax, r12);
+            or_(rax, r11);
             not_(rax);
             break;
         default:
@@ -288,10 +689,9 @@ class BlockEmitter : public CodeGenerator {
     }
 
     void emit_slt(IrOpKind kind, const IrOp &op) {
-        gpr_to_rax(op.rs);
-        mov(r12, rax);
+        load_gpr(r11, op.rs);
         gpr_to_rax(op.rt);
-        cmp(r12, rax);
+        cmp(r11, rax);
         if (kind == IrOpKind::Slt)
             setl(al);
         else
@@ -345,9 +745,11 @@ class BlockEmitter : public CodeGenerator {
     }
 
     void emit_shift_v(IrOpKind kind, const IrOp &op) {
+        const bool dword = kind == IrOpKind::Dsllv ||
+                           kind == IrOpKind::Dsrlv || kind == IrOpKind::Dsrav;
         gpr_to_rax(op.rs);
         mov(ecx, eax); // shift amount
-        and_(ecx, 31);
+        and_(ecx, dword ? 63 : 31);
         gpr_to_rax(op.rt);
         switch (kind) {
         case IrOpKind::Sllv:
@@ -362,12 +764,135 @@ class BlockEmitter : public CodeGenerator {
             sar(eax, cl);
             cdqe();
             break;
+        case IrOpKind::Dsllv:
+            shl(rax, cl);
+            break;
+        case IrOpKind::Dsrlv:
+            shr(rax, cl);
+            break;
+        case IrOpKind::Dsrav:
+            sar(rax, cl);
+            break;
         default:
             break;
         }
         rax_to_gpr(op.rd);
     }
 
+    // MULT/MULTU leave each 32-bit half of the product sign-extended in
+    // LO/HI; DMULT/DMULTU the full 128-bit product.
+    void emit_mult(const IrOp &op) {
+        gpr_to_rax(op.rs);
+        load_gpr(rcx, op.rt);
+        switch (op.kind) {
+        case IrOpKind::Mult:
+            movsxd(rax, eax);
+            movsxd(rcx, ecx);
+            imul(rax, rcx);
+            break;
+        case IrOpKind::Multu:
+            mov(eax, eax);
+            mov(ecx, ecx);
+            imul(rax, rcx);
+            break;
+        case IrOpKind::Dmult:
+            imul(rcx); // rdx:rax
+            break;
+        default:
+            mul(rcx);
+            break;
+        }
+        if (op.kind == IrOpKind::Mult || op.kind == IrOpKind::Multu) {
+            movsxd(rcx, eax);
+            mov(qword[rbp + lo_off_], rcx);
+            shr(rax, 32);
+            cdqe();
+            mov(qword[rbp + hi_off_], rax);
+        } else {
+            mov(qword[rbp + lo_off_], rax);
+            mov(qword[rbp + hi_off_], rdx);
+        }
+    }
+
+    // Zero divisors give the interpreter's LO/HI; DDIV hands those and
+    // INT64_MIN / -1 to do_ddiv.
+    void emit_div(const IrOp &op) {
+        Xbyak::Label special, done;
+        gpr_to_rax(op.rs);
+        load_gpr(rcx, op.rt);
+        switch (op.kind) {
+        case IrOpKind::Div:
+            // 64-bit idiv, so INT32_MIN / -1 cannot fault.
+            movsxd(rax, eax);
+            movsxd(rcx, ecx);
+            test(rcx, rcx);
+            jz(special, T_NEAR);
+            cqo();
+            idiv(rcx);
+            cdqe();
+            movsxd(rdx, edx);
+            break;
+        case IrOpKind::Divu:
+            test(ecx, ecx);
+            jz(special, T_NEAR);
+            xor_(edx, edx);
+            div(ecx);
+            cdqe();
+            movsxd(rdx, edx);
+            break;
+        case IrOpKind::Ddiv: {
+            Xbyak::Label divide;
+            test(rcx, rcx);
+            jz(special, T_NEAR);
+            cmp(rcx, -1);
+            jne(divide);
+            mov(r11, 0x8000000000000000ULL);
+            cmp(rax, r11);
+            je(special, T_NEAR);
+            L(divide);
+            cqo();
+            idiv(rcx);
+            break;
+        }
+        default:
+            test(rcx, rcx);
+            jz(special, T_NEAR);
+            xor_(edx, edx);
+            div(rcx);
+            break;
+        }
+        mov(qword[rbp + lo_off_], rax);
+        mov(qword[rbp + hi_off_], rdx);
+        jmp(done, T_NEAR);
+
+        L(special);
+        switch (op.kind) {
+        case IrOpKind::Div:
+            // HI = dividend, LO = dividend < 0 ? 1 : -1
+            mov(qword[rbp + hi_off_], rax);
+            sar(rax, 63);
+            add(rax, rax);
+            not_(rax);
+            mov(qword[rbp + lo_off_], rax);
+            break;
+        case IrOpKind::Divu:
+            movsxd(rax, eax);
+            mov(qword[rbp + hi_off_], rax);
+            mov(qword[rbp + lo_off_], -1);
+            break;
+        case IrOpKind::Ddiv:
+            mov(JIT_ARG1d, op.rs);
+            mov(JIT_ARG2d, op.rt);
+            call_fn(reinterpret_cast<const void *>(&do_ddiv), true);
+            break;
+        default:
+            mov(qword[rbp + hi_off_], rax);
+            mov(qword[rbp + lo_off_], -1);
+            break;
+        }
+        L(done);
+    }
+
     void emit_imm(IrOpKind kind, const IrOp &op) {
         const int16_t simm = static_cast<int16_t>(op.imm);
         const uint16_t zimm = op.imm;
@@ -424,26 +949,266 @@ class BlockEmitter : public CodeGenerator {
     }
 
     // Inline Cpu::branch_addr64 for a PC-relative offset (non-likely).
-    // Condition is already in JIT_ARG1d (0/1). Uses pc/next_pc/delay_slot ptrs.
+    // Condition is already in JIT_ARG1d (0/1). Uses rbp-relative pc/next_pc/delay_slot.
     void emit_branch_offset_inline(int16_t off) {
         Xbyak::Label not_taken, done;
         // delay_slot = true
-        mov(rax, delay_slot_ptr_);
-        mov(byte[rax], 1);
+        mov(byte[rbp + delay_slot_off_], 1);
         test(JIT_ARG1d, JIT_ARG1d);
         jz(not_taken, T_NEAR);
         // next_pc = pc + (int64_t)off * 4
-        mov(rax, pc_ptr_);
-        mov(rcx, qword[rax]);
+        mov(rcx, qword[rbp + pc_off_]);
         add(rcx, static_cast<int64_t>(off) * 4);
-        mov(rax, next_pc_ptr_);
-        mov(qword[rax], rcx);
+        mov(qword[rbp + next_pc_off_], rcx);
         jmp(done, T_NEAR);
         L(not_taken);
         // not taken: next_pc already points at fall-through
         L(done);
     }
 
+    // FGR operands under the block's Status.FR, as Cop1::get_fgr_*: the
+    // S/D/W arithmetic and doubleword forms use the even register when FR=0,
+    // word moves / LWC1 / SWC1 map odd registers to its upper half.
+    int32_t fgr_disp(uint8_t reg) const {
+        if (!fr_)
+            reg &= ~1;
+        return fgr_off_ + reg * 8;
+    }
+
+    int32_t fgr_word_disp(uint8_t reg) const {
+        if (fr_ || !(reg & 1))
+            return fgr_off_ + reg * 8;
+        return fgr_off_ + (reg & ~1) * 8 + 4;
+    }
+
+    // Trace seam: carry on into the next block only where the exit path
+    // would have taken a native link into it (see the leave[] stubs), so a
+    // trace keeps the timing of its blocks run separately.
+    void emit_seam(uint32_t vaddr, Xbyak::Label &exit_label,
+                   Xbyak::Label &seam_out) {
+        cmp(qword[rbp + pc_off_], static_cast<int32_t>(vaddr));
+        jne(exit_label, T_NEAR); // side exit
+        mov(JIT_ARG1d, ebx);
+        mov(rax, reinterpret_cast<uintptr_t>(&add_count));
+        call(rax);
+        mov(rax, exec_ptr_);
+        cmp(byte[rax + offsetof(ExecState, aborted)], 0);
+        jne(seam_out, T_NEAR);
+        cmp(byte[rax + offsetof(ExecState, link_break)], 0);
+        jne(seam_out, T_NEAR);
+        cmp(byte[rbp + delay_slot_off_], 0);
+        jne(seam_out, T_NEAR);
+        sub(dword[rax + offsetof(ExecState, link_budget)], ebx);
+        jle(seam_out, T_NEAR);
+        add(dword[rax + offsetof(ExecState, linked_cycles)], ebx);
+        inc(dword[rax + offsetof(ExecState, links_taken)]);
+        mov(byte[rax + offsetof(ExecState, annul_delay_slot)], 0);
+        xor_(ebx, ebx);
+    }
+
+    // MOV RCX, imm64 of a field `addend` bytes into this block's record,
+    // always in the 10-byte form so place_block() can retarget it.
+    void mov_rcx_record(ptrdiff_t addend) {
+        db(0x48);
+        db(0xB9);
+        record_refs_.push_back({static_cast<uint32_t>(getSize()),
+                                static_cast<uint32_t>(addend)});
+        dq(reinterpret_cast<uintptr_t>(out_) + static_cast<uintptr_t>(addend));
+    }
+
+    // One CU1/FR check covers every native COP1 op up to the next Status
+    // write. On mismatch the block stops before the op and the dispatcher
+    // interprets it (raising Coprocessor Unusable, or with the new FR).
+    void emit_cop1_guard(Xbyak::Label &exit_label) {
+        Xbyak::Label ok;
+        mov(eax, dword[rbp + status_off_]);
+        and_(eax, cu1_mask_ | fr_mask_);
+        cmp(eax, cu1_mask_ | (fr_ ? fr_mask_ : 0u));
+        je(ok, T_NEAR);
+        mov(rax, exec_ptr_);
+        mov(byte[rax + offsetof(ExecState, link_break)], 1);
+        mov_rcx_record(0);
+        mov(qword[rax + offsetof(ExecState, bail_block)], rcx);
+        jmp(exit_label, T_NEAR);
+        L(ok);
+    }
+
+    void emit_bc1(const IrOp &op) {
+        const int16_t off = static_cast<int16_t>(op.imm);
+        test(dword[rbp + fcr31_off_], compare_mask_);
+        setnz(al);
+        movzx(JIT_ARG1d, al);
+        if (!(op.rt & 1)) // BC1F / BC1FL
+            xor_(JIT_ARG1d, 1);
+        if (op.kind == IrOpKind::Bc1l) {
+            mov(JIT_ARG2d, off);
+            call_fn(reinterpret_cast<const void *>(&do_branch_likely_offset));
+        } else if (off == -1) {
+            mov(JIT_ARG2d, off);
+            call_fn(reinterpret_cast<const void *>(&do_branch_offset));
+        } else {
+            emit_branch_offset_inline(off);
+        }
+    }
+
+    void emit_cop1_move(const IrOp &op) {
+        switch (op.kind) {
+        case IrOpKind::Mfc1:
+            movsxd(rax, dword[rbp + fgr_word_disp(op.rd)]);
+            rax_to_gpr(op.rt);
+            break;
+        case IrOpKind::Mtc1:
+            gpr_to_rax(op.rt);
+            mov(dword[rbp + fgr_word_disp(op.rd)], eax);
+            break;
+        case IrOpKind::Dmfc1:
+            mov(rax, qword[rbp + fgr_disp(op.rd)]);
+            rax_to_gpr(op.rt);
+            break;
+        case IrOpKind::Dmtc1:
+            gpr_to_rax(op.rt);
+            mov(qword[rbp + fgr_disp(op.rd)], rax);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Mirrors FpuImpl::op_cop1_arith. Like the interpreter this runs under
+    // the host's default MXCSR and leaves FCR31 cause/flag bits untouched;
+    // ABS/NEG/MOV are bit operations, as the compiled C++ is.
+    void emit_cop1_arith(const IrOp &op) {
+        const uint8_t fmt = op.sa;
+        const uint8_t funct = static_cast<uint8_t>(op.imm);
+        const int32_t fs = fgr_disp(op.rs);
+        const int32_t ft = fgr_disp(op.rt);
+        const int32_t fd = fgr_disp(op.rd);
+
+        if (fmt == COP1_FMT_W) {
+            xorps(xmm0, xmm0); // no false dependency for cvtsi2s*
+            if (funct == COP1_FUNCT_CVT_S) {
+                cvtsi2ss(xmm0, dword[rbp + fs]);
+                movss(dword[rbp + fd], xmm0);
+            } else {
+                cvtsi2sd(xmm0, dword[rbp + fs]);
+                movsd(qword[rbp + fd], xmm0);
+            }
+            return;
+        }
+
+        const bool dbl = fmt == COP1_FMT_D;
+        const auto load = [&](const Xmm &x, int32_t d) {
+            if (dbl)
+                movsd(x, qword[rbp + d]);
+            else
+                movss(x, dword[rbp + d]);
+        };
+        const auto store_fd = [&]() {
+            if (dbl)
+                movsd(qword[rbp + fd], xmm0);
+            else
+                movss(dword[rbp + fd], xmm0);
+        };
+
+        if ((funct & 0b110000) == COP1_FUNCT_C_F) {
+            const uint8_t cond = funct & 0b111;
+            load(xmm0, fs);
+            load(xmm1, ft);
+            if (dbl)
+                ucomisd(xmm0, xmm1);
+            else
+                ucomiss(xmm0, xmm1);
+            setp(cl); // unordered
+            setb(al); // less (or unordered)
+            setz(dl); // equal (or unordered)
+            movzx(ecx, cl);
+            movzx(eax, al);
+            movzx(edx, dl);
+            mov(r11d, ecx);
+            xor_(r11d, 1);
+            and_(eax, r11d);
+            and_(edx, r11d);
+            xor_(r11d, r11d);
+            if (cond & 0x4)
+                or_(r11d, eax);
+            if (cond & 0x2)
+                or_(r11d, edx);
+            if (cond & 0x1)
+                or_(r11d, ecx);
+            neg(r11d);
+            and_(r11d, compare_mask_);
+            mov(eax, dword[rbp + fcr31_off_]);
+            and_(eax, ~compare_mask_);
+            or_(eax, r11d);
+            mov(dword[rbp + fcr31_off_], eax);
+            return;
+        }
+
+        switch (funct) {
+        case COP1_FUNCT_ADD:
+        case COP1_FUNCT_SUB:
+        case COP1_FUNCT_MUL:
+        case COP1_FUNCT_DIV:
+            load(xmm0, fs);
+            load(xmm1, ft);
+            if (funct == COP1_FUNCT_ADD)
+                dbl ? addsd(xmm0, xmm1) : addss(xmm0, xmm1);
+            else if (funct == COP1_FUNCT_SUB)
+                dbl ? subsd(xmm0, xmm1) : subss(xmm0, xmm1);
+            else if (funct == COP1_FUNCT_MUL)
+                dbl ? mulsd(xmm0, xmm1) : mulss(xmm0, xmm1);
+            else
+                dbl ? divsd(xmm0, xmm1) : divss(xmm0, xmm1);
+            store_fd();
+            break;
+        case COP1_FUNCT_SQRT:
+            load(xmm1, fs);
+            dbl ? sqrtsd(xmm0, xmm1) : sqrtss(xmm0, xmm1);
+            store_fd();
+            break;
+        case COP1_FUNCT_ABS:
+        case COP1_FUNCT_MOV:
+        case COP1_FUNCT_NEG:
+            if (dbl) {
+                mov(rax, qword[rbp + fs]);
+                if (funct == COP1_FUNCT_ABS)
+                    btr(rax, 63);
+                else if (funct == COP1_FUNCT_NEG)
+                    btc(rax, 63);
+                mov(qword[rbp + fd], rax);
+            } else {
+                mov(eax, dword[rbp + fs]);
+                if (funct == COP1_FUNCT_ABS)
+                    and_(eax, 0x7FFFFFFFu);
+                else if (funct == COP1_FUNCT_NEG)
+                    xor_(eax, 0x80000000u);
+                mov(dword[rbp + fd], eax);
+            }
+            break;
+        case COP1_FUNCT_ROUND_W:
+            // cvt*2si rounds to nearest-even like std::nearbyint; both give
+            // 0x80000000 for NaN / out of range.
+            dbl ? cvtsd2si(eax, qword[rbp + fs]) : cvtss2si(eax, dword[rbp + fs]);
+            mov(dword[rbp + fd], eax);
+            break;
+        case COP1_FUNCT_TRUNC_W:
+            dbl ? cvttsd2si(eax, qword[rbp + fs])
+                : cvttss2si(eax, dword[rbp + fs]);
+            mov(dword[rbp + fd], eax);
+            break;
+        case COP1_FUNCT_CVT_S: // from D
+            cvtsd2ss(xmm0, qword[rbp + fs]);
+            movss(dword[rbp + fd], xmm0);
+            break;
+        case COP1_FUNCT_CVT_D: // from S
+            cvtss2sd(xmm0, dword[rbp + fs]);
+            movsd(qword[rbp + fd], xmm0);
+            break;
+        default:
+            break;
+        }
+    }
+
     void emit_branch(const IrOp &op) {
         const int16_t off = static_cast<int16_t>(op.imm);
         switch (op.kind) {
@@ -454,10 +1219,9 @@ class BlockEmitter : public CodeGenerator {
             call_fn(reinterpret_cast<const void *>(&do_branch_addr));
             break;
         case IrOpKind::Jalr:
-            gpr_to_rax(op.rs);
-            mov(r12, rax);
+            load_gpr(r11, op.rs);
             mov(JIT_ARG1d, 1);
-            mov(JIT_ARG2q, r12);
+            mov(JIT_ARG2q, r11);
             call_fn(reinterpret_cast<const void *>(&do_branch_addr));
             mov(JIT_ARG1d, op.rd);
             call_fn(reinterpret_cast<const void *>(&do_link));
@@ -474,10 +1238,9 @@ class BlockEmitter : public CodeGenerator {
         case IrOpKind::Beql:
         case IrOpKind::Bne:
         case IrOpKind::Bnel: {
-            gpr_to_rax(op.rs);
-            mov(r12, rax);
+            load_gpr(r11, op.rs);
             gpr_to_rax(op.rt);
-            cmp(r12, rax);
+            cmp(r11, rax);
             setz(al);
             movzx(JIT_ARG1d, al);
             if (op.kind == IrOpKind::Bne || op.kind == IrOpKind::Bnel)
@@ -552,7 +1315,7 @@ class BlockEmitter : public CodeGenerator {
         }
     }
 
-    void emit_mem_helper(const IrOp &op) {
+    void emit_mem_helper(const IrOp &op, bool side_path = false) {
         mov(JIT_ARG1d, op.rt);
         mov(JIT_ARG2d, op.rs);
         mov(JIT_ARG3d, static_cast<int16_t>(op.imm));
@@ -603,15 +1366,39 @@ class BlockEmitter : public CodeGenerator {
         case IrOpKind::Swr:
             fn = reinterpret_cast<const void *>(&do_swr);
             break;
+        case IrOpKind::Ldl:
+            fn = reinterpret_cast<const void *>(&do_ldl);
+            break;
+        case IrOpKind::Ldr:
+            fn = reinterpret_cast<const void *>(&do_ldr);
+            break;
+        case IrOpKind::Sdl:
+            fn = reinterpret_cast<const void *>(&do_sdl);
+            break;
+        case IrOpKind::Sdr:
+            fn = reinterpret_cast<const void *>(&do_sdr);
+            break;
+        case IrOpKind::Ll:
+            fn = reinterpret_cast<const void *>(&do_ll);
+            break;
+        case IrOpKind::Lld:
+            fn = reinterpret_cast<const void *>(&do_lld);
+            break;
+        case IrOpKind::Sc:
+            fn = reinterpret_cast<const void *>(&do_sc);
+            break;
+        case IrOpKind::Scd:
+            fn = reinterpret_cast<const void *>(&do_scd);
+            break;
         default:
             break;
         }
         if (fn)
-            call_fn(fn);
+            call_sys_fn(fn, side_path);
     }
 
     // Emit RDRAM load/store given paddr in eax and rdram base already in rdx.
-    // Clobbers rax/rcx/r12 as needed. Does not jump.
+    // Clobbers rax/rcx/r11 as needed. Does not jump.
     void emit_rdram_access(const IrOp &op) {
         switch (op.kind) {
         case IrOpKind::Lb:
@@ -644,52 +1431,92 @@ class BlockEmitter : public CodeGenerator {
             rax_to_gpr(op.rt);
             break;
         case IrOpKind::Ld: {
-            mov(r12d, dword[rdx + rax]);
+            mov(r11d, dword[rdx + rax]);
             mov(ecx, dword[rdx + rax + 4]);
-            shl(r12, 32);
+            shl(r11, 32);
             mov(eax, ecx);
-            or_(rax, r12);
+            or_(rax, r11);
             rax_to_gpr(op.rt);
             break;
         }
         case IrOpKind::Sb: {
-            mov(r12d, eax);
+            mov(r11d, eax);
             gpr_to_rax(op.rt);
             mov(ecx, eax);
-            mov(eax, r12d);
+            mov(eax, r11d);
             xor_(eax, 3);
             mov(byte[rdx + rax], cl);
             break;
         }
         case IrOpKind::Sh: {
-            mov(r12d, eax);
+            mov(r11d, eax);
             gpr_to_rax(op.rt);
             mov(ecx, eax);
-            mov(eax, r12d);
+            mov(eax, r11d);
             xor_(eax, 2);
             mov(word[rdx + rax], cx);
             break;
         }
         case IrOpKind::Sw: {
-            mov(r12d, eax);
+            mov(r11d, eax);
             gpr_to_rax(op.rt);
-            mov(dword[rdx + r12], eax);
+            mov(dword[rdx + r11], eax);
             break;
         }
         case IrOpKind::Sd: {
-            mov(r12d, eax);
+            mov(r11d, eax);
             gpr_to_rax(op.rt);
             mov(ecx, eax);
             shr(rax, 32);
-            mov(dword[rdx + r12], eax);
-            mov(dword[rdx + r12 + 4], ecx);
+            mov(dword[rdx + r11], eax);
+            mov(dword[rdx + r11 + 4], ecx);
             break;
         }
+        case IrOpKind::Lwc1:
+            mov(eax, dword[rdx + rax]);
+            mov(dword[rbp + fgr_word_disp(op.rt)], eax);
+            break;
+        case IrOpKind::Ldc1:
+            mov(r11d, dword[rdx + rax]);
+            mov(ecx, dword[rdx + rax + 4]);
+            shl(r11, 32);
+            mov(eax, ecx);
+            or_(rax, r11);
+            mov(qword[rbp + fgr_disp(op.rt)], rax);
+            break;
+        case IrOpKind::Swc1:
+            mov(ecx, dword[rbp + fgr_word_disp(op.rt)]);
+            mov(dword[rdx + rax], ecx);
+            break;
+        case IrOpKind::Sdc1:
+            mov(r11d, eax);
+            mov(rax, qword[rbp + fgr_disp(op.rt)]);
+            mov(ecx, eax);
+            shr(rax, 32);
+            mov(dword[rdx + r11], eax);
+            mov(dword[rdx + r11 + 4], ecx);
+            break;
         default:
             break;
         }
     }
 
+    // Fastmem: the same access through the arena with no range check. A
+    // fault (MMIO, unmapped, or a store to a code page) is rerouted to the
+    // slow path that bind_fault_sites() records.
+    void emit_fastmem_access(const IrOp &op) {
+        const auto begin = static_cast<uint32_t>(getSize());
+        mov(rdx, fastmem_base_);
+        emit_rdram_access(op);
+        fault_sites_.push_back({begin, static_cast<uint32_t>(getSize()), 0});
+    }
+
+    // Fault sites emitted since `first` resume here.
+    void bind_fault_sites(size_t first) {
+        for (size_t i = first; i < fault_sites_.size(); i++)
+            fault_sites_[i].slow = static_cast<uint32_t>(getSize());
+    }
+
     bool is_store_op(IrOpKind k) const {
         switch (k) {
         case IrOpKind::Sb:
@@ -698,6 +1525,33 @@ class BlockEmitter : public CodeGenerator {
         case IrOpKind::Sd:
         case IrOpKind::Swl:
         case IrOpKind::Swr:
+        case IrOpKind::Sdl:
+        case IrOpKind::Sdr:
+        case IrOpKind::Sc:
+        case IrOpKind::Scd:
+        case IrOpKind::Swc1:
+        case IrOpKind::Sdc1:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Unaligned and load-linked/store-conditional accesses.
+    static bool is_helper_mem(IrOpKind k) {
+        switch (k) {
+        case IrOpKind::Lwl:
+        case IrOpKind::Lwr:
+        case IrOpKind::Swl:
+        case IrOpKind::Swr:
+        case IrOpKind::Ldl:
+        case IrOpKind::Ldr:
+        case IrOpKind::Sdl:
+        case IrOpKind::Sdr:
+        case IrOpKind::Ll:
+        case IrOpKind::Lld:
+        case IrOpKind::Sc:
+        case IrOpKind::Scd:
             return true;
         default:
             return false;
@@ -706,18 +1560,40 @@ class BlockEmitter : public CodeGenerator {
 
     // KSEG0/KSEG1 + RDRAM, then soft-TLB + RDRAM; else C++ helper.
     void emit_mem(const IrOp &op) {
-        if (op.kind == IrOpKind::Lwl || op.kind == IrOpKind::Lwr ||
-            op.kind == IrOpKind::Swl || op.kind == IrOpKind::Swr) {
+        if (is_helper_mem(op.kind)) {
             emit_mem_helper(op);
             return;
         }
 
+        const size_t first_site = fault_sites_.size();
+        Xbyak::Label slow, done;
+        // A deferred RSP task may own the page; the helpers sync it first.
+        cmp_flag(rsp_pending_ptr_);
+        jne(slow, T_NEAR);
+        if (op.const_paddr) {
+            // Address proven by the optimizer to be KSEG0/KSEG1 RDRAM.
+            // With fastmem still a fault site: the page may hold code.
+            mov(eax, op.paddr);
+            if (fastmem_base_) {
+                emit_fastmem_access(op);
+            } else {
+                mov(rdx, rdram_base_);
+                emit_rdram_access(op);
+            }
+            jmp(done, T_NEAR);
+            L(slow);
+            bind_fault_sites(first_site);
+            emit_mem_slow(op);
+            L(done);
+            return;
+        }
+
         const int16_t simm = static_cast<int16_t>(op.imm);
         const uint32_t access_size = mem_access_size(op.kind);
         const uint32_t max_paddr = RDRAM_SIZE - access_size;
         const bool is_store = is_store_op(op.kind);
 
-        Xbyak::Label slow, done, seg_ok, try_soft;
+        Xbyak::Label seg_ok, try_soft;
 
         // vaddr32 in ecx
         gpr_to_rax(op.rs);
@@ -735,10 +1611,14 @@ class BlockEmitter : public CodeGenerator {
 
         mov(eax, ecx);
         and_(eax, 0x1FFFFFFFu);
-        cmp(eax, max_paddr);
-        ja(slow, T_NEAR);
-        mov(rdx, rdram_base_);
-        emit_rdram_access(op);
+        if (fastmem_base_) {
+            emit_fastmem_access(op);
+        } else {
+            cmp(eax, max_paddr);
+            ja(slow, T_NEAR);
+            mov(rdx, rdram_base_);
+            emit_rdram_access(op);
+        }
         jmp(done, T_NEAR);
 
         // Soft TLB: same 4 KiB page, cached RDRAM mapping
@@ -750,27 +1630,44 @@ class BlockEmitter : public CodeGenerator {
 
         mov(eax, ecx);
         shr(eax, 12); // vpn
-        mov(r12d, eax);
+        movzx(r11d, byte[rbp + entry_hi_off_]); // EntryHi.ASID
+        shl(r11d, Mmu::SOFT_TLB_ASID_SHIFT);
+        or_(r11d, eax); // tag
         and_(eax, Mmu::SOFT_TLB_MASK);
         mov(rdx, is_store ? soft_tlb_store_ : soft_tlb_load_);
-        // entry is 8 bytes: vpn, pa_page
-        cmp(dword[rdx + rax * 8], r12d);
+        // entry is 8 bytes: tag, pa_page
+        cmp(dword[rdx + rax * 8], r11d);
         jne(slow, T_NEAR);
         mov(eax, dword[rdx + rax * 8 + 4]); // pa_page
         mov(edx, ecx);
         and_(edx, 0xFFFu);
         or_(eax, edx); // paddr
-        cmp(eax, max_paddr);
-        ja(slow, T_NEAR);
-        mov(rdx, rdram_base_);
-        emit_rdram_access(op);
+        if (fastmem_base_) {
+            emit_fastmem_access(op);
+        } else {
+            cmp(eax, max_paddr);
+            ja(slow, T_NEAR);
+            mov(rdx, rdram_base_);
+            emit_rdram_access(op);
+        }
         jmp(done, T_NEAR);
 
         L(slow);
-        emit_mem_helper(op);
+        bind_fault_sites(first_site);
+        emit_mem_slow(op);
         L(done);
     }
 
+    void emit_mem_slow(const IrOp &op) {
+        if (is_native_cop1(op.kind)) {
+            // The interpreter op re-checks CU1 and raises TLB exceptions.
+            mov(JIT_ARG1d, op.target);
+            call_sys_fn(reinterpret_cast<const void *>(&do_fpu), true);
+        } else {
+            emit_mem_helper(op, true);
+        }
+    }
+
     void emit_op(const IrOp &op, Xbyak::Label & /*exit_label*/) {
         switch (op.kind) {
         case IrOpKind::Nop:
@@ -792,19 +1689,17 @@ class BlockEmitter : public CodeGenerator {
             emit_slt(op.kind, op);
             break;
         case IrOpKind::Daddu: {
-            gpr_to_rax(op.rs);
-            mov(r12, rax);
+            load_gpr(r11, op.rs);
             gpr_to_rax(op.rt);
-            add(rax, r12);
+            add(rax, r11);
             rax_to_gpr(op.rd);
             break;
         }
         case IrOpKind::Dsubu: {
-            gpr_to_rax(op.rs);
-            mov(r12, rax);
+            load_gpr(r11, op.rs);
             gpr_to_rax(op.rt);
             mov(rcx, rax);
-            mov(rax, r12);
+            mov(rax, r11);
             sub(rax, rcx);
             rax_to_gpr(op.rd);
             break;
@@ -823,6 +1718,9 @@ class BlockEmitter : public CodeGenerator {
         case IrOpKind::Sllv:
         case IrOpKind::Srlv:
         case IrOpKind::Srav:
+        case IrOpKind::Dsllv:
+        case IrOpKind::Dsrlv:
+        case IrOpKind::Dsrav:
             emit_shift_v(op.kind, op);
             break;
         case IrOpKind::Addiu:
@@ -857,13 +1755,25 @@ class BlockEmitter : public CodeGenerator {
             break;
         case IrOpKind::Bc1:
         case IrOpKind::Bc1l:
-            mov(JIT_ARG1d, op.target);
-            call_fn(reinterpret_cast<const void *>(&do_bc1));
+            emit_bc1(op);
+            break;
+        case IrOpKind::Mfc1:
+        case IrOpKind::Mtc1:
+        case IrOpKind::Dmfc1:
+        case IrOpKind::Dmtc1:
+            emit_cop1_move(op);
+            break;
+        case IrOpKind::Cop1Arith:
+            emit_cop1_arith(op);
             break;
         case IrOpKind::Fpu:
             mov(JIT_ARG1d, op.target);
             call_fn(reinterpret_cast<const void *>(&do_fpu));
             break;
+        case IrOpKind::LoadConst:
+            mov(rax, static_cast<int64_t>(static_cast<int32_t>(op.target)));
+            rax_to_gpr(op.rd);
+            break;
         case IrOpKind::Lb:
         case IrOpKind::Lbu:
         case IrOpKind::Lh:
@@ -879,67 +1789,69 @@ class BlockEmitter : public CodeGenerator {
         case IrOpKind::Sd:
         case IrOpKind::Swl:
         case IrOpKind::Swr:
+        case IrOpKind::Ldl:
+        case IrOpKind::Ldr:
+        case IrOpKind::Ll:
+        case IrOpKind::Lld:
+        case IrOpKind::Sdl:
+        case IrOpKind::Sdr:
+        case IrOpKind::Sc:
+        case IrOpKind::Scd:
+        case IrOpKind::Lwc1:
+        case IrOpKind::Ldc1:
+        case IrOpKind::Swc1:
+        case IrOpKind::Sdc1:
             emit_mem(op);
             break;
         case IrOpKind::Mfhi:
-            mov(rax, hi_ptr_);
-            mov(rax, qword[rax]);
+            mov(rax, qword[rbp + hi_off_]);
             rax_to_gpr(op.rd);
             break;
         case IrOpKind::Mflo:
-            mov(rax, lo_ptr_);
-            mov(rax, qword[rax]);
+            mov(rax, qword[rbp + lo_off_]);
             rax_to_gpr(op.rd);
             break;
         case IrOpKind::Mthi:
             gpr_to_rax(op.rs);
-            mov(rdx, hi_ptr_);
-            mov(qword[rdx], rax);
+            mov(qword[rbp + hi_off_], rax);
             break;
         case IrOpKind::Mtlo:
             gpr_to_rax(op.rs);
-            mov(rdx, lo_ptr_);
-            mov(qword[rdx], rax);
+            mov(qword[rbp + lo_off_], rax);
             break;
         case IrOpKind::Mult:
-            mov(JIT_ARG1d, op.rs);
-            mov(JIT_ARG2d, op.rt);
-            call_fn(reinterpret_cast<const void *>(&do_mult));
-            break;
         case IrOpKind::Multu:
-            mov(JIT_ARG1d, op.rs);
-            mov(JIT_ARG2d, op.rt);
-            call_fn(reinterpret_cast<const void *>(&do_multu));
+        case IrOpKind::Dmult:
+        case IrOpKind::Dmultu:
+            emit_mult(op);
             break;
         case IrOpKind::Div:
-            mov(JIT_ARG1d, op.rs);
-            mov(JIT_ARG2d, op.rt);
-            call_fn(reinterpret_cast<const void *>(&do_div));
-            break;
         case IrOpKind::Divu:
-            mov(JIT_ARG1d, op.rs);
-            mov(JIT_ARG2d, op.rt);
-            call_fn(reinterpret_cast<const void *>(&do_divu));
+        case IrOpKind::Ddiv:
+        case IrOpKind::Ddivu:
+            emit_div(op);
             break;
         case IrOpKind::Mfc0:
             mov(JIT_ARG1d, op.rt);
             mov(JIT_ARG2d, op.rd);
-            call_fn(reinterpret_cast<const void *>(&do_mfc0));
+            call_sys_fn(reinterpret_cast<const void *>(&do_mfc0));
             break;
         case IrOpKind::Mtc0:
             mov(JIT_ARG1d, op.rt);
             mov(JIT_ARG2d, op.rd);
-            call_fn(reinterpret_cast<const void *>(&do_mtc0));
+            call_sys_fn(reinterpret_cast<const void *>(&do_mtc0));
             break;
         case IrOpKind::Dmfc0:
             mov(JIT_ARG1d, op.rt);
             mov(JIT_ARG2d, op.rd);
-            call_fn(reinterpret_cast<const void *>(&do_dmfc0));
+            call_sys_fn(reinterpret_cast<const void *>(&do_dmfc0));
             break;
         case IrOpKind::Dmtc0:
             mov(JIT_ARG1d, op.rt);
             mov(JIT_ARG2d, op.rd);
-            call_fn(reinterpret_cast<const void *>(&do_dmtc0));
+            call_sys_fn(reinterpret_cast<const void *>(&do_dmtc0));
+            break;
+        case IrOpKind::Count:
             break;
         }
     }
@@ -947,17 +1859,54 @@ class BlockEmitter : public CodeGenerator {
 
 } // namespace
 
-BlockFn emit_block(const IrBlock &block, CodeCache &cache) {
+BlockFn emit_block(const IrBlock &block, CodeCache &cache,
+                   CompiledBlock &out) {
     // Inlined KSEG0/RDRAM mem paths need more room than helper-call emit.
-    constexpr size_t kBufSize = 32 * 1024;
+    constexpr size_t kBufSize = CodeCache::MAX_BLOCK_CODE;
     uint8_t *buf = cache.alloc_exec(kBufSize);
     BlockEmitter emitter(buf, kBufSize);
-    BlockFn fn = emitter.emit(block);
+    BlockFn fn = emitter.emit(block, out);
     // Reclaim unused tail of this bump allocation for the next block.
     cache.shrink_last_alloc(kBufSize, emitter.getSize());
+    cache.add_fault_sites(buf, emitter.fault_sites());
     return fn;
 }
 
+bool emit_block_detached(const IrBlock &block, DetachedBlock &out) {
+    out.code.resize(CodeCache::MAX_BLOCK_CODE);
+    BlockEmitter emitter(out.code.data(), out.code.size());
+    emitter.emit(block, out.record);
+    out.code.resize(emitter.getSize());
+    out.record_refs = emitter.record_refs();
+    out.fault_sites = emitter.fault_sites();
+    return !out.code.empty();
+}
+
+BlockFn place_block(const DetachedBlock &block, CodeCache &cache,
+                    CompiledBlock &out) {
+    const uint8_t *code = block.code.data();
+    uint8_t *dst = cache.alloc_exec(block.code.size());
+    std::memcpy(dst, code, block.code.size());
+    // Everything outside the block is addressed absolutely and jumps inside
+    // it are relative; only pointers into the record need fixing up.
+    for (const RecordRef &ref : block.record_refs) {
+        const uintptr_t p = reinterpret_cast<uintptr_t>(&out) + ref.addend;
+        std::memcpy(dst + ref.at, &p, sizeof(p));
+    }
+    for (int k = 0; k < MAX_BLOCK_EXITS; k++) {
+        const BlockExit &from = block.record.exits[k];
+        if (!from.jmp)
+            continue;
+        BlockExit &exit = out.exits[k];
+        exit.target = from.target;
+        exit.jmp = dst + (from.jmp - code);
+        exit.unlinked = dst + (from.unlinked - code);
+        exit.linked = nullptr;
+    }
+    cache.add_fault_sites(dst, block.fault_sites);
+    return reinterpret_cast<BlockFn>(dst);
+}
+
 } // namespace Jit
 } // namespace Cpu
 } // namespace N64
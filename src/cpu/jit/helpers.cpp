@@ -1,16 +1,20 @@
 #include "cpu/jit/helpers.h"
 #include "cpu/cpu.h"
 #include "cpu/instruction.h"
+#include "cpu/jit/invalidate_hook.h"
 #include "cpu/jit/jit.h"
 #include "memory/bus.h"
+#include "memory/fastmem.h"
 #include "memory/memory.h"
 #include "memory/memory_map.h"
 #include "mmu/mmu.h"
 #include "mmu/soft_tlb.h"
 #include "mmu/tlb.h"
 #include "n64_system/interrupt.h"
+#include "rcp/rsp.h"
 #include "rdp/rdp_core.h"
 #include "utils/byte_array.h"
+#include "utils/log.h"
 #include <optional>
 #include <span>
 
@@ -26,6 +30,12 @@ uint8_t *rdram_data() { return g_memory().get_rdram().data(); }
 
 void note_rdram_store(uint32_t paddr, uint32_t length) {
     // JIT RDRAM stores bypass Memory::write_paddr; still invalidate SMC pages.
+    // Fastmem also tracks decode-cache pages, so both caches see the write.
+    if (Fastmem::enabled()) {
+        if (Fastmem::may_hold_code(paddr))
+            maybe_invalidate_code(paddr, length);
+        return;
+    }
     if (g_dynarec().page_has_code(paddr))
         g_dynarec().invalidate_range(paddr, length);
 }
@@ -55,7 +65,14 @@ bool block_entry_checks() {
     return false;
 }
 
-void add_count(int n) { g_cpu().add_count(static_cast<uint32_t>(n)); }
+void add_count(int n) {
+    auto &cause = g_cpu().cop0.reg.cause;
+    const bool ip7 = cause.ip7;
+    g_cpu().add_count(static_cast<uint32_t>(n));
+    // A fresh timer edge may need servicing before the next linked block.
+    if (!ip7 && cause.ip7)
+        g_exec.link_break = true;
+}
 
 void do_branch_addr(bool cond, uint64_t target) {
     Cpu::branch_addr64(g_cpu(), cond, target);
@@ -110,43 +127,19 @@ void set_lo(uint64_t v) { g_cpu().lo = v; }
 
 uint64_t get_pc() { return g_cpu().get_pc64(); }
 
-void do_mult(uint8_t rs, uint8_t rt) {
-    const int32_t s = static_cast<int32_t>(g_cpu().gpr.read(rs));
-    const int32_t t = static_cast<int32_t>(g_cpu().gpr.read(rt));
-    const int64_t res = static_cast<int64_t>(s) * static_cast<int64_t>(t);
-    g_cpu().lo = static_cast<int64_t>(static_cast<int32_t>(res));
-    g_cpu().hi = static_cast<int64_t>(static_cast<int32_t>(res >> 32));
-}
-
-void do_multu(uint8_t rs, uint8_t rt) {
-    const uint64_t s = g_cpu().gpr.read(rs) & 0xFFFFFFFFu;
-    const uint64_t t = g_cpu().gpr.read(rt) & 0xFFFFFFFFu;
-    const uint64_t res = s * t;
-    g_cpu().lo = static_cast<int64_t>(static_cast<int32_t>(res));
-    g_cpu().hi = static_cast<int64_t>(static_cast<int32_t>(res >> 32));
-}
-
-void do_div(uint8_t rs, uint8_t rt) {
-    const int64_t dividend = static_cast<int32_t>(g_cpu().gpr.read(rs));
-    const int64_t divisor = static_cast<int32_t>(g_cpu().gpr.read(rt));
+void do_ddiv(uint8_t rs, uint8_t rt) {
+    const int64_t dividend = static_cast<int64_t>(g_cpu().gpr.read(rs));
+    const int64_t divisor = static_cast<int64_t>(g_cpu().gpr.read(rt));
+    // Same results as CpuImpl::op_ddiv.
     if (divisor == 0) {
-        g_cpu().hi = dividend;
-        g_cpu().lo = dividend >= 0 ? static_cast<int64_t>(-1) : static_cast<int64_t>(1);
+        g_cpu().lo = dividend >= 0 ? ~uint64_t{0} : 1;
+        g_cpu().hi = static_cast<uint64_t>(dividend);
+    } else if (divisor == -1 && dividend == INT64_MIN) {
+        g_cpu().lo = static_cast<uint64_t>(dividend);
+        g_cpu().hi = 0;
     } else {
-        g_cpu().lo = static_cast<int32_t>(dividend / divisor);
-        g_cpu().hi = static_cast<int32_t>(dividend % divisor);
-    }
-}
-
-void do_divu(uint8_t rs, uint8_t rt) {
-    const uint32_t dividend = static_cast<uint32_t>(g_cpu().gpr.read(rs));
-    const uint32_t divisor = static_cast<uint32_t>(g_cpu().gpr.read(rt));
-    if (divisor == 0) {
-        g_cpu().hi = static_cast<int32_t>(dividend);
-        g_cpu().lo = static_cast<int64_t>(-1);
-    } else {
-        g_cpu().lo = static_cast<int32_t>(dividend / divisor);
-        g_cpu().hi = static_cast<int32_t>(dividend % divisor);
+        g_cpu().lo = dividend / divisor;
+        g_cpu().hi = dividend % divisor;
     }
 }
 
@@ -162,6 +155,7 @@ void do_load(uint8_t rt, uint8_t base, int16_t offset, uint32_t access_size,
         const uint32_t p = cached.value();
         if (paddr_in_rdram(p, access_size)) {
             Rdp::check_framebuffers(p, access_size);
+            g_rsp().sync_rdram(p);
             write_val(cpu, rt, read_rdram(p));
             return;
         }
@@ -172,6 +166,7 @@ void do_load(uint8_t rt, uint8_t base, int16_t offset, uint32_t access_size,
         if (paddr_in_rdram(p, access_size)) {
             Mmu::soft_tlb_note_load(va32, p);
             Rdp::check_framebuffers(p, access_size);
+            g_rsp().sync_rdram(p);
             write_val(cpu, rt, read_rdram(p));
         } else {
             write_val(cpu, rt, read_bus(p));
@@ -194,6 +189,7 @@ void do_store(uint8_t rt, uint8_t base, int16_t offset, uint32_t access_size,
         const uint32_t p = cached.value();
         if (paddr_in_rdram(p, access_size)) {
             Rdp::on_rdram_write(p, access_size);
+            g_rsp().sync_rdram_write();
             store_rdram(p, v);
             return;
         }
@@ -205,6 +201,7 @@ void do_store(uint8_t rt, uint8_t base, int16_t offset, uint32_t access_size,
         if (paddr_in_rdram(p, access_size)) {
             Mmu::soft_tlb_note_store(va32, p);
             Rdp::on_rdram_write(p, access_size);
+            g_rsp().sync_rdram_write();
             store_rdram(p, v);
         } else {
             store_bus(p, v);
@@ -480,6 +477,157 @@ void do_swr(uint8_t rt, uint8_t base, int16_t offset) {
     }
 }
 
+// LDL/LDR/SDL/SDR and LL/SC are rare enough to go straight through the bus,
+// exactly like the interpreter.
+void do_ldl(uint8_t rt, uint8_t base, int16_t offset) {
+    auto &cpu = g_cpu();
+    const uint64_t vaddr = cpu.gpr.read(base) + offset;
+    std::optional<uint32_t> paddr =
+        Mmu::resolve_vaddr(static_cast<uint32_t>(vaddr));
+    if (paddr.has_value()) {
+        const uint32_t shift = 8 * static_cast<uint32_t>(vaddr & 7);
+        const uint64_t mask = ~0ULL << shift;
+        const uint64_t data = Memory::read_paddr64(paddr.value() & ~7u);
+        const uint64_t old = cpu.gpr.read(rt);
+        cpu.gpr.write(rt, (old & ~mask) | (data << shift));
+    } else {
+        cpu.handle_exception(
+            g_tlb().get_tlb_exception_code(Mmu::BusAccess::LOAD), 0, true);
+        exec_state().aborted = true;
+    }
+}
+
+void do_ldr(uint8_t rt, uint8_t base, int16_t offset) {
+    auto &cpu = g_cpu();
+    const uint64_t vaddr = cpu.gpr.read(base) + offset;
+    std::optional<uint32_t> paddr =
+        Mmu::resolve_vaddr(static_cast<uint32_t>(vaddr));
+    if (paddr.has_value()) {
+        const uint32_t shift = 8 * static_cast<uint32_t>((vaddr ^ 7) & 7);
+        const uint64_t mask = ~0ULL >> shift;
+        const uint64_t data = Memory::read_paddr64(paddr.value() & ~7u);
+        const uint64_t old = cpu.gpr.read(rt);
+        cpu.gpr.write(rt, (old & ~mask) | (data >> shift));
+    } else {
+        cpu.handle_exception(
+            g_tlb().get_tlb_exception_code(Mmu::BusAccess::LOAD), 0, true);
+        exec_state().aborted = true;
+    }
+}
+
+void do_sdl(uint8_t rt, uint8_t base, int16_t offset) {
+    auto &cpu = g_cpu();
+    const uint64_t vaddr = cpu.gpr.read(base) + offset;
+    std::optional<uint32_t> paddr = Mmu::resolve_vaddr(
+        static_cast<uint32_t>(vaddr), Mmu::BusAccess::STORE);
+    if (paddr.has_value()) {
+        const uint32_t shift = 8 * static_cast<uint32_t>(vaddr & 7);
+        const uint64_t mask = ~0ULL >> shift;
+        const uint32_t aligned = paddr.value() & ~7u;
+        const uint64_t data = Memory::read_paddr64(aligned);
+        const uint64_t reg = cpu.gpr.read(rt);
+        Memory::write_paddr64(aligned, (data & ~mask) | (reg >> shift));
+    } else {
+        cpu.handle_exception(
+            g_tlb().get_tlb_exception_code(Mmu::BusAccess::STORE), 0, true);
+        exec_state().aborted = true;
+    }
+}
+
+void do_sdr(uint8_t rt, uint8_t base, int16_t offset) {
+    auto &cpu = g_cpu();
+    const uint64_t vaddr = cpu.gpr.read(base) + offset;
+    std::optional<uint32_t> paddr = Mmu::resolve_vaddr(
+        static_cast<uint32_t>(vaddr), Mmu::BusAccess::STORE);
+    if (paddr.has_value()) {
+        const uint32_t shift = 8 * static_cast<uint32_t>((vaddr ^ 7) & 7);
+        const uint64_t mask = ~0ULL << shift;
+        const uint32_t aligned = paddr.value() & ~7u;
+        const uint64_t data = Memory::read_paddr64(aligned);
+        const uint64_t reg = cpu.gpr.read(rt);
+        Memory::write_paddr64(aligned, (data & ~mask) | (reg << shift));
+    } else {
+        cpu.handle_exception(
+            g_tlb().get_tlb_exception_code(Mmu::BusAccess::STORE), 0, true);
+        exec_state().aborted = true;
+    }
+}
+
+void do_ll(uint8_t rt, uint8_t base, int16_t offset) {
+    auto &cpu = g_cpu();
+    const uint64_t vaddr = cpu.gpr.read(base) + offset;
+    std::optional<uint32_t> paddr =
+        Mmu::resolve_vaddr(static_cast<uint32_t>(vaddr));
+    if (paddr.has_value()) {
+        const int32_t word =
+            static_cast<int32_t>(Memory::read_paddr32(paddr.value()));
+        cpu.gpr.write(rt, static_cast<int64_t>(word));
+        cpu.cop0.reg.lladdr = paddr.value() >> 4;
+        cpu.cop0.llbit = 1;
+    } else {
+        cpu.handle_exception(
+            g_tlb().get_tlb_exception_code(Mmu::BusAccess::LOAD), 0, true);
+        exec_state().aborted = true;
+    }
+}
+
+void do_lld(uint8_t rt, uint8_t base, int16_t offset) {
+    auto &cpu = g_cpu();
+    const uint64_t vaddr = cpu.gpr.read(base) + offset;
+    std::optional<uint32_t> paddr =
+        Mmu::resolve_vaddr(static_cast<uint32_t>(vaddr));
+    if (paddr.has_value()) {
+        cpu.gpr.write(rt, Memory::read_paddr64(paddr.value()));
+        cpu.cop0.reg.lladdr = paddr.value() >> 4;
+        cpu.cop0.llbit = 1;
+    } else {
+        cpu.handle_exception(
+            g_tlb().get_tlb_exception_code(Mmu::BusAccess::LOAD), 0, true);
+        exec_state().aborted = true;
+    }
+}
+
+void do_sc(uint8_t rt, uint8_t base, int16_t offset) {
+    auto &cpu = g_cpu();
+    if (!cpu.cop0.llbit) {
+        cpu.gpr.write(rt, 0);
+        return;
+    }
+    cpu.cop0.llbit = false;
+    const uint64_t vaddr = cpu.gpr.read(base) + offset;
+    std::optional<uint32_t> paddr = Mmu::resolve_vaddr(
+        static_cast<uint32_t>(vaddr), Mmu::BusAccess::STORE);
+    if (paddr.has_value()) {
+        Memory::write_paddr32(paddr.value(),
+                              static_cast<uint32_t>(cpu.gpr.read(rt)));
+        cpu.gpr.write(rt, 1);
+    } else {
+        cpu.handle_exception(
+            g_tlb().get_tlb_exception_code(Mmu::BusAccess::STORE), 0, true);
+        exec_state().aborted = true;
+    }
+}
+
+void do_scd(uint8_t rt, uint8_t base, int16_t offset) {
+    auto &cpu = g_cpu();
+    if (!cpu.cop0.llbit) {
+        cpu.gpr.write(rt, 0);
+        return;
+    }
+    cpu.cop0.llbit = false;
+    const uint64_t vaddr = cpu.gpr.read(base) + offset;
+    std::optional<uint32_t> paddr = Mmu::resolve_vaddr(
+        static_cast<uint32_t>(vaddr), Mmu::BusAccess::STORE);
+    if (paddr.has_value()) {
+        Memory::write_paddr64(paddr.value(), cpu.gpr.read(rt));
+        cpu.gpr.write(rt, 1);
+    } else {
+        cpu.handle_exception(
+            g_tlb().get_tlb_exception_code(Mmu::BusAccess::STORE), 0, true);
+        exec_state().aborted = true;
+    }
+}
+
 void do_mfc0(uint8_t rt, uint8_t rd) {
     // Match interpreter: 32-bit read, sign-extended.
     const uint32_t val =
@@ -509,25 +657,6 @@ void do_fpu(uint32_t raw) {
         exec_state().aborted = true;
 }
 
-void do_bc1(uint32_t raw) {
-    instruction_t inst{};
-    inst.raw = raw;
-    auto &cpu = g_cpu();
-    // Keep JIT annul in sync with branch_likely_offset16 (Bc1l only).
-    if (inst.r_type.rs == COP_BC) {
-        const uint8_t ndtf = static_cast<uint8_t>(inst.i_type.rt);
-        if (ndtf == COP1_BC_FL || ndtf == COP1_BC_TL) {
-            const bool cmp = cpu.cop1.fcr31.compare != 0;
-            const bool taken = (ndtf == COP1_BC_TL) ? cmp : !cmp;
-            exec_state().annul_delay_slot = !taken;
-        }
-    }
-    const bool exl_before = cpu.cop0.reg.status.exl != 0;
-    cpu.execute_instruction(inst);
-    if (!exl_before && cpu.cop0.reg.status.exl != 0)
-        exec_state().aborted = true;
-}
-
 } // namespace Jit
 } // namespace Cpu
 } // namespace N64
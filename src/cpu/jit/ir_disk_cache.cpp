@@ -0,0 +1,195 @@
+#include "cpu/jit/ir_disk_cache.h"
+#include "utils/log.h"
+#include "utils/state_io.h"
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace N64 {
+namespace Cpu {
+namespace Jit {
+
+namespace {
+
+constexpr uint32_t CACHE_MAGIC = Utils::state_tag("K64J");
+constexpr uint32_t CACHE_VERSION = 2;
+// IrOp is stored raw; a layout or opcode-list change must miss, not
+// misdecode, so both are part of the header.
+constexpr uint32_t OP_SIZE = sizeof(IrOp);
+constexpr uint32_t OP_KINDS = static_cast<uint32_t>(IrOpKind::Count);
+// Guard against a corrupt count turning into a huge allocation.
+constexpr uint32_t MAX_OPS = 4096;
+
+// A bool is stored as one byte; anything but 0 or 1 is corruption, not a
+// value to load into a bool.
+void read_bool(Utils::StateReader &r, bool &v) {
+    uint8_t b = 0;
+    r.pod(b);
+    if (b > 1)
+        r.fail();
+    v = b != 0;
+}
+
+} // namespace
+
+void IrDiskCache::open(const std::string &path, uint32_t crc1,
+                       uint32_t crc2) {
+    close();
+    path_ = path;
+    crc1_ = crc1;
+    crc2_ = crc2;
+}
+
+void IrDiskCache::close() {
+    save();
+    path_.clear();
+    entries_.clear();
+    loaded_ = false;
+    dirty_ = false;
+}
+
+const IrDiskCache::Entry *IrDiskCache::find(uint32_t paddr) {
+    if (!enabled())
+        return nullptr;
+    if (!loaded_)
+        load();
+    const auto it = entries_.find(paddr);
+    return it == entries_.end() ? nullptr : &it->second;
+}
+
+void IrDiskCache::store(const IrBlock &ir, uint64_t checksum) {
+    if (!enabled() || ir.ops.empty() || ir.ops.size() > MAX_OPS)
+        return;
+    if (!loaded_)
+        load();
+    entries_[ir.paddr] = Entry{ir, checksum};
+    dirty_ = true;
+}
+
+void IrDiskCache::load() {
+    loaded_ = true;
+    std::ifstream file(path_, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+        return;
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                                    std::istreambuf_iterator<char>());
+    Utils::StateReader r(data);
+    uint32_t magic = 0, version = 0, crc1 = 0, crc2 = 0;
+    uint32_t op_size = 0, op_kinds = 0, count = 0;
+    r.pod(magic);
+    r.pod(version);
+    r.pod(crc1);
+    r.pod(crc2);
+    r.pod(op_size);
+    r.pod(op_kinds);
+    r.pod(count);
+    if (!r.ok() || magic != CACHE_MAGIC || version != CACHE_VERSION ||
+        crc1 != crc1_ || crc2 != crc2_ || op_size != OP_SIZE ||
+        op_kinds != OP_KINDS) {
+        Utils::debug("JIT disk cache: ignoring stale {}", path_);
+        return;
+    }
+
+    std::unordered_map<uint32_t, Entry> loaded;
+    loaded.reserve(count);
+    for (uint32_t i = 0; i < count && r.ok(); ++i) {
+        Entry e;
+        uint32_t ops = 0;
+        r.pod(e.ir.paddr);
+        r.pod(e.ir.vaddr);
+        read_bool(r, e.ir.fr);
+        read_bool(r, e.ir.ends_with_branch);
+        r.pod(e.ir.num_successors);
+        if (!r.ok() || e.ir.num_successors > 2) {
+            r.fail();
+            break;
+        }
+        for (uint8_t k = 0; k < e.ir.num_successors; k++)
+            r.pod(e.ir.successors[k]);
+        r.pod(e.checksum);
+        r.pod(ops);
+        if (!r.ok() || ops == 0 || ops > MAX_OPS) {
+            r.fail();
+            break;
+        }
+        // Check the enum and bool bytes before they become an IrOp.
+        std::vector<uint8_t> raw(ops * sizeof(IrOp));
+        r.bytes(raw.data(), raw.size());
+        for (uint32_t k = 0; k < ops && r.ok(); ++k) {
+            const uint8_t *p = raw.data() + k * sizeof(IrOp);
+            if (p[offsetof(IrOp, kind)] >= OP_KINDS ||
+                p[offsetof(IrOp, const_paddr)] > 1)
+                r.fail();
+        }
+        if (!r.ok())
+            break;
+        e.ir.ops.resize(ops);
+        std::memcpy(e.ir.ops.data(), raw.data(), raw.size());
+        if (r.ok())
+            loaded.emplace(e.ir.paddr, std::move(e));
+    }
+    if (!r.ok() || r.remaining() != 0) {
+        Utils::warn("JIT disk cache: {} is corrupt, ignoring it", path_);
+        return;
+    }
+    entries_ = std::move(loaded);
+    Utils::debug("JIT disk cache: {} blocks from {}", entries_.size(), path_);
+}
+
+bool IrDiskCache::save() {
+    if (!enabled() || !dirty_)
+        return true;
+    dirty_ = false;
+
+    std::vector<uint8_t> data;
+    Utils::StateWriter w(data);
+    w.pod(CACHE_MAGIC);
+    w.pod(CACHE_VERSION);
+    w.pod(crc1_);
+    w.pod(crc2_);
+    w.pod(OP_SIZE);
+    w.pod(OP_KINDS);
+    w.pod(static_cast<uint32_t>(entries_.size()));
+    for (const auto &[paddr, e] : entries_) {
+        w.pod(e.ir.paddr);
+        w.pod(e.ir.vaddr);
+        w.pod(e.ir.fr);
+        w.pod(e.ir.ends_with_branch);
+        w.pod(e.ir.num_successors);
+        for (uint8_t k = 0; k < e.ir.num_successors; k++)
+            w.pod(e.ir.successors[k]);
+        w.pod(e.checksum);
+        w.pod(static_cast<uint32_t>(e.ir.ops.size()));
+        w.bytes(e.ir.ops.data(), e.ir.ops.size() * sizeof(IrOp));
+    }
+
+    // Write a sibling file and rename it over the old one, so a crash
+    // mid-write never leaves a truncated cache behind.
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::create_directories(fs::path(path_).parent_path(), ec);
+    const std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream file(tmp,
+                           std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(data.data()),
+                   static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            Utils::warn("Could not write JIT disk cache: {}", tmp);
+            return false;
+        }
+    }
+    fs::rename(tmp, path_, ec);
+    if (ec) {
+        Utils::warn("Could not write JIT disk cache: {}", path_);
+        return false;
+    }
+    Utils::debug("JIT disk cache: {} blocks to {}", entries_.size(), path_);
+    return true;
+}
+
+} // namespace Jit
+} // namespace Cpu
+} // namespace N64
@@ -0,0 +1,512 @@
+#include "cpu/jit/ir_opt.h"
+#include "memory/memory_map.h"
+#include <cstddef>
+
+namespace N64 {
+namespace Cpu {
+namespace Jit {
+
+namespace {
+
+constexpr int NO_REG = -1;
+
+inline uint64_t sext32(uint32_t v) {
+    return static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(v)));
+}
+
+inline uint64_t simm64(uint16_t imm) {
+    return static_cast<uint64_t>(
+        static_cast<int64_t>(static_cast<int16_t>(imm)));
+}
+
+bool is_rtype_alu(IrOpKind k) {
+    switch (k) {
+    case IrOpKind::Add:
+    case IrOpKind::Addu:
+    case IrOpKind::Sub:
+    case IrOpKind::Subu:
+    case IrOpKind::And:
+    case IrOpKind::Or:
+    case IrOpKind::Xor:
+    case IrOpKind::Nor:
+    case IrOpKind::Slt:
+    case IrOpKind::Sltu:
+    case IrOpKind::Daddu:
+    case IrOpKind::Dsubu:
+    case IrOpKind::Sllv:
+    case IrOpKind::Srlv:
+    case IrOpKind::Srav:
+    case IrOpKind::Dsllv:
+    case IrOpKind::Dsrlv:
+    case IrOpKind::Dsrav:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool is_shift_sa(IrOpKind k) {
+    switch (k) {
+    case IrOpKind::Sll:
+    case IrOpKind::Srl:
+    case IrOpKind::Sra:
+    case IrOpKind::Dsll:
+    case IrOpKind::Dsrl:
+    case IrOpKind::Dsra:
+    case IrOpKind::Dsll32:
+    case IrOpKind::Dsrl32:
+    case IrOpKind::Dsra32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool is_imm_alu(IrOpKind k) {
+    switch (k) {
+    case IrOpKind::Addiu:
+    case IrOpKind::Andi:
+    case IrOpKind::Ori:
+    case IrOpKind::Xori:
+    case IrOpKind::Lui:
+    case IrOpKind::Slti:
+    case IrOpKind::Sltiu:
+    case IrOpKind::Daddiu:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Register-only ALU op: result depends on GPR inputs alone, no side effects.
+bool is_pure(IrOpKind k) {
+    return is_rtype_alu(k) || is_shift_sa(k) || is_imm_alu(k) ||
+           k == IrOpKind::LoadConst;
+}
+
+bool is_load(IrOpKind k) {
+    switch (k) {
+    case IrOpKind::Lb:
+    case IrOpKind::Lbu:
+    case IrOpKind::Lh:
+    case IrOpKind::Lhu:
+    case IrOpKind::Lw:
+    case IrOpKind::Lwu:
+    case IrOpKind::Ld:
+    case IrOpKind::Lwl:
+    case IrOpKind::Lwr:
+    case IrOpKind::Ldl:
+    case IrOpKind::Ldr:
+    case IrOpKind::Ll:
+    case IrOpKind::Lld:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool is_mem(IrOpKind k) {
+    switch (k) {
+    case IrOpKind::Sb:
+    case IrOpKind::Sh:
+    case IrOpKind::Sw:
+    case IrOpKind::Sd:
+    case IrOpKind::Swl:
+    case IrOpKind::Swr:
+    case IrOpKind::Sdl:
+    case IrOpKind::Sdr:
+    case IrOpKind::Sc:
+    case IrOpKind::Scd:
+    case IrOpKind::Lwc1:
+    case IrOpKind::Ldc1:
+    case IrOpKind::Swc1:
+    case IrOpKind::Sdc1:
+        return true;
+    default:
+        return is_load(k);
+    }
+}
+
+uint32_t access_size(IrOpKind k) {
+    switch (k) {
+    case IrOpKind::Lb:
+    case IrOpKind::Lbu:
+    case IrOpKind::Sb:
+        return 1;
+    case IrOpKind::Lh:
+    case IrOpKind::Lhu:
+    case IrOpKind::Sh:
+        return 2;
+    case IrOpKind::Ld:
+    case IrOpKind::Sd:
+    case IrOpKind::Ldc1:
+    case IrOpKind::Sdc1:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+// The emitter always routes these through the C++ helper.
+bool is_helper_mem(IrOpKind k) {
+    switch (k) {
+    case IrOpKind::Lwl:
+    case IrOpKind::Lwr:
+    case IrOpKind::Swl:
+    case IrOpKind::Swr:
+    case IrOpKind::Ldl:
+    case IrOpKind::Ldr:
+    case IrOpKind::Sdl:
+    case IrOpKind::Sdr:
+    case IrOpKind::Ll:
+    case IrOpKind::Lld:
+    case IrOpKind::Sc:
+    case IrOpKind::Scd:
+        return true;
+    default:
+        return false;
+    }
+}
+
+int pure_dest(const IrOp &op) {
+    return (is_rtype_alu(op.kind) || is_shift_sa(op.kind) ||
+            op.kind == IrOpKind::LoadConst)
+               ? op.rd
+               : op.rt;
+}
+
+// GPR written by `op` (NO_REG if none). Fpu is conservatively assumed to
+// write its rt field (MFC1/CFC1 through the helper).
+int gpr_def(const IrOp &op) {
+    if (is_pure(op.kind))
+        return pure_dest(op);
+    if (is_load(op.kind))
+        return op.rt;
+    switch (op.kind) {
+    case IrOpKind::Mfhi:
+    case IrOpKind::Mflo:
+    case IrOpKind::Jalr:
+        return op.rd;
+    case IrOpKind::Jal:
+    case IrOpKind::Bgezal:
+    case IrOpKind::Bltzal:
+        return 31;
+    case IrOpKind::Mfc0:
+    case IrOpKind::Dmfc0:
+    case IrOpKind::Mfc1:
+    case IrOpKind::Dmfc1:
+    case IrOpKind::Sc:
+    case IrOpKind::Scd:
+        return op.rt;
+    case IrOpKind::Fpu:
+        return (op.target >> 16) & 31;
+    default:
+        return NO_REG;
+    }
+}
+
+// Mirrors the emitter's lowering; `a` = rs value, `b` = rt value.
+uint64_t eval(const IrOp &op, uint64_t a, uint64_t b) {
+    const uint32_t a32 = static_cast<uint32_t>(a);
+    const uint32_t b32 = static_cast<uint32_t>(b);
+    const uint64_t zimm = op.imm;
+    switch (op.kind) {
+    case IrOpKind::Add:
+    case IrOpKind::Addu:
+        return sext32(a32 + b32);
+    case IrOpKind::Sub:
+    case IrOpKind::Subu:
+        return sext32(a32 - b32);
+    case IrOpKind::And:
+        return a & b;
+    case IrOpKind::Or:
+        return a | b;
+    case IrOpKind::Xor:
+        return a ^ b;
+    case IrOpKind::Nor:
+        return ~(a | b);
+    case IrOpKind::Slt:
+        return static_cast<int64_t>(a) < static_cast<int64_t>(b) ? 1 : 0;
+    case IrOpKind::Sltu:
+        return a < b ? 1 : 0;
+    case IrOpKind::Daddu:
+        return a + b;
+    case IrOpKind::Dsubu:
+        return a - b;
+    case IrOpKind::Sll:
+        return sext32(b32 << op.sa);
+    case IrOpKind::Srl:
+        return sext32(b32 >> op.sa);
+    case IrOpKind::Sra:
+        return sext32(
+            static_cast<uint32_t>(static_cast<int32_t>(b32) >> op.sa));
+    case IrOpKind::Sllv:
+        return sext32(b32 << (a32 & 31));
+    case IrOpKind::Srlv:
+        return sext32(b32 >> (a32 & 31));
+    case IrOpKind::Srav:
+        return sext32(
+            static_cast<uint32_t>(static_cast<int32_t>(b32) >> (a32 & 31)));
+    case IrOpKind::Dsll:
+        return b << op.sa;
+    case IrOpKind::Dsrl:
+        return b >> op.sa;
+    case IrOpKind::Dsra:
+        return static_cast<uint64_t>(static_cast<int64_t>(b) >> op.sa);
+    case IrOpKind::Dsll32:
+        return b << (op.sa + 32);
+    case IrOpKind::Dsrl32:
+        return b >> (op.sa + 32);
+    case IrOpKind::Dsra32:
+        return static_cast<uint64_t>(static_cast<int64_t>(b) >> (op.sa + 32));
+    case IrOpKind::Dsllv:
+        return b << (a & 63);
+    case IrOpKind::Dsrlv:
+        return b >> (a & 63);
+    case IrOpKind::Dsrav:
+        return static_cast<uint64_t>(static_cast<int64_t>(b) >> (a & 63));
+    case IrOpKind::Addiu:
+        return sext32(a32 + static_cast<uint32_t>(simm64(op.imm)));
+    case IrOpKind::Daddiu:
+        return a + simm64(op.imm);
+    case IrOpKind::Andi:
+        return a & zimm;
+    case IrOpKind::Ori:
+        return a | zimm;
+    case IrOpKind::Xori:
+        return a ^ zimm;
+    case IrOpKind::Lui:
+        return sext32(static_cast<uint32_t>(op.imm) << 16);
+    case IrOpKind::Slti:
+        return static_cast<int64_t>(a) < static_cast<int64_t>(simm64(op.imm))
+                   ? 1
+                   : 0;
+    case IrOpKind::Sltiu:
+        return a < simm64(op.imm) ? 1 : 0;
+    case IrOpKind::LoadConst:
+        return sext32(op.target);
+    default:
+        return 0;
+    }
+}
+
+// Source register of a pure op that only moves a value (rd = rs | $zero,
+// rt = rs + 0, ...), or NO_REG.
+int copy_source(const IrOp &op) {
+    switch (op.kind) {
+    case IrOpKind::Or:
+    case IrOpKind::Xor:
+    case IrOpKind::Daddu:
+        if (op.rt == 0)
+            return op.rs;
+        if (op.rs == 0)
+            return op.rt;
+        return NO_REG;
+    case IrOpKind::Dsubu:
+        return op.rt == 0 ? op.rs : NO_REG;
+    case IrOpKind::Ori:
+    case IrOpKind::Xori:
+    case IrOpKind::Daddiu:
+        return op.imm == 0 ? op.rs : NO_REG;
+    case IrOpKind::Dsll:
+    case IrOpKind::Dsrl:
+    case IrOpKind::Dsra:
+        return op.sa == 0 ? op.rt : NO_REG;
+    default:
+        return NO_REG;
+    }
+}
+
+bool reads_rs(const IrOp &op) {
+    return is_rtype_alu(op.kind) ||
+           (is_imm_alu(op.kind) && op.kind != IrOpKind::Lui);
+}
+
+bool reads_rt(const IrOp &op) {
+    return is_rtype_alu(op.kind) || is_shift_sa(op.kind);
+}
+
+void fold_r0_writes(IrBlock &block, IrOptStats *stats) {
+    for (auto &op : block.ops) {
+        const bool pure_or_hilo = is_pure(op.kind) ||
+                                  op.kind == IrOpKind::Mfhi ||
+                                  op.kind == IrOpKind::Mflo;
+        if (pure_or_hilo && gpr_def(op) == 0) {
+            op = IrOp{};
+            if (stats)
+                ++stats->r0_folded;
+        }
+    }
+}
+
+void propagate(IrBlock &block, IrOptStats *stats) {
+    bool known[32]{};
+    uint64_t value[32]{};
+    int copy_of[32];
+    for (int r = 0; r < 32; r++)
+        copy_of[r] = NO_REG;
+    known[0] = true;
+
+    const auto rename = [&](uint8_t &reg) {
+        if (reg != 0 && !known[reg] && copy_of[reg] != NO_REG) {
+            reg = static_cast<uint8_t>(copy_of[reg]);
+            if (stats)
+                ++stats->copies;
+        }
+    };
+    const auto kill = [&](int reg) {
+        if (reg <= 0)
+            return;
+        known[reg] = false;
+        copy_of[reg] = NO_REG;
+        for (int r = 1; r < 32; r++) {
+            if (copy_of[r] == reg)
+                copy_of[r] = NO_REG;
+        }
+    };
+
+    for (auto &op : block.ops) {
+        if (is_pure(op.kind)) {
+            if (reads_rs(op))
+                rename(op.rs);
+            if (reads_rt(op))
+                rename(op.rt);
+            const bool inputs_known = (!reads_rs(op) || known[op.rs]) &&
+                                      (!reads_rt(op) || known[op.rt]);
+            const int src = inputs_known ? NO_REG : copy_source(op);
+            const int dst = pure_dest(op);
+            const uint64_t v =
+                inputs_known ? eval(op, value[op.rs], value[op.rt]) : 0;
+            kill(dst);
+            if (inputs_known) {
+                known[dst] = true;
+                value[dst] = v;
+                const bool fits = sext32(static_cast<uint32_t>(v)) == v;
+                if (fits && op.kind != IrOpKind::LoadConst &&
+                    op.kind != IrOpKind::Lui) {
+                    IrOp c{};
+                    c.kind = IrOpKind::LoadConst;
+                    c.rd = static_cast<uint8_t>(dst);
+                    c.target = static_cast<uint32_t>(v);
+                    op = c;
+                    if (stats)
+                        ++stats->consts_folded;
+                }
+            } else if (src != NO_REG && src != dst) {
+                copy_of[dst] = src;
+            }
+            continue;
+        }
+
+        if (is_mem(op.kind)) {
+            rename(op.rs);
+            if (known[op.rs] && !is_helper_mem(op.kind)) {
+                const uint32_t vaddr = static_cast<uint32_t>(value[op.rs]) +
+                                       static_cast<uint32_t>(simm64(op.imm));
+                const uint32_t seg = vaddr >> 29;
+                const uint32_t paddr = vaddr & 0x1FFFFFFFu;
+                if ((seg == 4 || seg == 5) &&
+                    paddr <= RDRAM_SIZE - access_size(op.kind)) {
+                    op.const_paddr = true;
+                    op.paddr = paddr;
+                    if (stats)
+                        ++stats->const_addrs;
+                }
+            }
+        }
+        kill(gpr_def(op));
+    }
+}
+
+// Ops that neither read nor write anything but GPRs and HI/LO; everything
+// else (memory, branches, COP0/COP1, helpers) may exit the block and so
+// sees every GPR as live.
+bool is_local(IrOpKind k) {
+    switch (k) {
+    case IrOpKind::Nop:
+    case IrOpKind::Mfhi:
+    case IrOpKind::Mflo:
+    case IrOpKind::Mthi:
+    case IrOpKind::Mtlo:
+    case IrOpKind::Mult:
+    case IrOpKind::Multu:
+    case IrOpKind::Div:
+    case IrOpKind::Divu:
+    case IrOpKind::Dmult:
+    case IrOpKind::Dmultu:
+    case IrOpKind::Ddiv:
+    case IrOpKind::Ddivu:
+        return true;
+    default:
+        return is_pure(k);
+    }
+}
+
+void eliminate_dead_writes(IrBlock &block, IrOptStats *stats) {
+    constexpr uint32_t ALL = 0xFFFFFFFFu;
+    uint32_t live = ALL; // successors may read anything
+    // A trace can leave at any seam, so everything is live across one.
+    size_t seam = block.seams.size();
+    for (size_t i = block.ops.size(); i-- > 0;) {
+        if (seam > 0 && block.seams[seam - 1].op > i) {
+            live = ALL;
+            --seam;
+        }
+        IrOp &op = block.ops[i];
+        if (!is_local(op.kind)) {
+            live = ALL;
+            continue;
+        }
+        if (op.kind == IrOpKind::Nop)
+            continue;
+        const int dst = gpr_def(op);
+        if (dst != NO_REG) {
+            const uint32_t bit = 1u << dst;
+            if (!(live & bit)) {
+                op = IrOp{};
+                if (stats)
+                    ++stats->dead_writes;
+                continue;
+            }
+            live &= ~bit;
+        }
+        switch (op.kind) {
+        case IrOpKind::Mthi:
+        case IrOpKind::Mtlo:
+            live |= 1u << op.rs;
+            break;
+        case IrOpKind::Mult:
+        case IrOpKind::Multu:
+        case IrOpKind::Div:
+        case IrOpKind::Divu:
+        case IrOpKind::Dmult:
+        case IrOpKind::Dmultu:
+        case IrOpKind::Ddiv:
+        case IrOpKind::Ddivu:
+            live |= (1u << op.rs) | (1u << op.rt);
+            break;
+        default:
+            if (reads_rs(op))
+                live |= 1u << op.rs;
+            if (reads_rt(op))
+                live |= 1u << op.rt;
+            break;
+        }
+    }
+}
+
+} // namespace
+
+void optimize_block(IrBlock &block, IrOptStats *stats) {
+    if (stats) {
+        ++stats->blocks;
+        stats->ops += block.ops.size();
+    }
+    fold_r0_writes(block, stats);
+    propagate(block, stats);
+    eliminate_dead_writes(block, stats);
+}
+
+} // namespace Jit
+} // namespace Cpu
+} // namespace N64
@@ -4,14 +4,22 @@
 #include "cpu/idle_skip.h"
 #include "cpu/jit/helpers.h"
 #include "cpu/jit/invalidate_hook.h"
+#include "memory/bus.h"
+#include "memory/fastmem.h"
+#include "memory/memory.h"
 #include "memory/memory_map.h"
 #include "mmu/mmu.h"
+#include "mmu/soft_tlb.h"
 #include "n64_system/interrupt.h"
 #include "n64_system/machine_advance.h"
 #include "n64_system/scheduler.h"
 #include "utils/log.h"
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstdlib>
+#include <cstring>
+#include <memory>
 
 namespace N64 {
 namespace Cpu {
@@ -23,6 +31,13 @@ namespace {
 // half-line (~6000), so CPU?RSP and PI/AI waits cannot starve.
 constexpr int kAdvanceEveryCycles = 1024;
 
+// Clean exits a block takes before the dispatcher first tries to make it
+// a trace head; doubled after each attempt that forms nothing.
+constexpr uint32_t kTraceHot = 256;
+
+// Upper bounds (us) of the compile-stall histogram; the last bucket is open.
+constexpr std::array<double, 5> kStallBucketsUs{10, 50, 100, 500, 1000};
+
 struct JitProf {
     bool enabled = false;
     bool times = false; // per-call chrono; expensive at ~10M blocks/s
@@ -40,11 +55,22 @@ struct JitProf {
     uint64_t cache_hits = 0;
     uint64_t cache_misses = 0;
     uint64_t tlb_slow = 0;
-    uint64_t invalidates = 0;
+    uint64_t invalidates = 0; // blocks dropped by guest writes
+    uint64_t revalidated = 0; // dropped blocks revived by checksum
+    uint64_t disk_hits = 0;   // builds that reused IR from the disk cache
+    uint64_t disk_stores = 0; // translations added to the disk cache
+    uint64_t tier_cold = 0;      // cold blocks run on the interpreter
+    uint64_t tier_queued = 0;    // hot blocks sent to the compile thread
+    uint64_t tier_published = 0; // background compiles added to the cache
+    uint64_t tier_dropped = 0;   // cancelled, failed or stale compiles
+    uint64_t traces = 0;         // traces formed
     uint64_t advances = 0;
     uint64_t idle_warps = 0;
     uint64_t idle_cycles = 0;
     uint64_t chain_links = 0;
+    uint64_t links_patched = 0;
+    IrOptStats opt;
+    std::array<uint64_t, kStallBucketsUs.size() + 1> compile_stalls{};
 };
 
 JitProf &prof() {
@@ -65,18 +91,92 @@ using clock = std::chrono::steady_clock;
 inline double ms_since(clock::time_point t0) {
     return std::chrono::duration<double, std::milli>(clock::now() - t0).count();
 }
+
+// FNV-1a over the guest words [paddr, end). Only RDRAM is ever written, so
+// blocks elsewhere are never dropped and need no checksum.
+uint64_t code_checksum(uint32_t paddr, uint32_t end) {
+    if (end > RDRAM_SIZE)
+        return 0;
+    const uint8_t *rdram = g_memory().get_rdram().data();
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (uint32_t a = paddr; a < end; a += 4) {
+        uint32_t w;
+        std::memcpy(&w, rdram + a, sizeof(w));
+        h = (h ^ w) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+void note_compile_stall(JitProf &p, double ms) {
+    size_t bucket = 0;
+    while (bucket < kStallBucketsUs.size() &&
+           ms * 1000.0 >= kStallBucketsUs[bucket])
+        ++bucket;
+    ++p.compile_stalls[bucket];
+}
+
+uint32_t exit_hits(const CompiledBlock &block) {
+    uint32_t n = 0;
+    for (const BlockExit &e : block.exits)
+        n += e.hits;
+    return n;
+}
+
+// Adds `s` to the first `n` of `list` unless a successor with the same
+// vaddr is there; false if the list is full.
+bool add_unique(IrSuccessor *list, uint8_t &n, const IrSuccessor &s) {
+    for (uint8_t i = 0; i < n; i++) {
+        if (list[i].vaddr == s.vaddr)
+            return true;
+    }
+    if (n >= MAX_SUCCESSORS)
+        return false;
+    list[n++] = s;
+    return true;
+}
+
+// Everything jit_profile_dump reports per interval.
+void reset_counters(JitProf &p) {
+    p.native_ms = p.fallback_ms = p.compile_ms = p.advance_ms = p.dispatch_ms =
+        0;
+    p.native_calls = p.native_cycles = 0;
+    p.fallback_calls = p.fallback_cycles = 0;
+    p.compiles = p.cache_hits = p.cache_misses = 0;
+    p.tlb_slow = p.invalidates = p.revalidated = p.advances = 0;
+    p.idle_warps = p.idle_cycles = 0;
+    p.chain_links = p.links_patched = 0;
+    p.opt = {};
+    g_dynarec().reset_cache_counters();
+    p.compile_stalls.fill(0);
+    p.disk_hits = p.disk_stores = 0;
+    p.tier_cold = p.tier_queued = p.tier_published = p.tier_dropped = 0;
+    p.traces = 0;
+}
+
+void add_opt_stats(IrOptStats &to, const IrOptStats &from) {
+    to.blocks += from.blocks;
+    to.ops += from.ops;
+    to.r0_folded += from.r0_folded;
+    to.consts_folded += from.consts_folded;
+    to.copies += from.copies;
+    to.dead_writes += from.dead_writes;
+    to.const_addrs += from.const_addrs;
+}
 } // namespace
 
-void jit_profile_note_invalidate() {
+void jit_profile_note_invalidate(uint32_t blocks) {
     auto &p = prof();
     if (p.enabled)
-        ++p.invalidates;
+        p.invalidates += blocks;
 }
 
 void jit_profile_dump() {
     auto &p = prof();
     if (!p.enabled)
         return;
+    // Counted inline by linked exits.
+    const uint32_t links = exec_state().links_taken;
+    exec_state().links_taken = 0;
     const double avg_cyc =
         p.native_calls ? double(p.native_cycles) / double(p.native_calls) : 0.0;
     if (p.times) {
@@ -87,34 +187,67 @@ void jit_profile_dump() {
             "jit profile (1s): native={:.2f}ms({:.0f}%) fallback={:.2f}ms({:.0f}%) "
             "compile={:.2f}ms({:.0f}%) advance={:.2f}ms({:.0f}%) "
             "dispatch={:.2f}ms({:.0f}%) | calls native={} fb={} compile={} "
-            "cache hit/miss={}/{} tlb_slow={} inval={} adv={} idle={}/{}c "
-            "chain={} | "
+            "cache hit/miss={}/{} tlb_slow={} inval={} reval={} adv={} "
+            "idle={}/{}c chain={} link={}/{}patched | "
             "cyc native={} fb={} avg_blk={:.1f}",
             p.native_ms, p.native_ms * inv, p.fallback_ms, p.fallback_ms * inv,
             p.compile_ms, p.compile_ms * inv, p.advance_ms, p.advance_ms * inv,
             p.dispatch_ms, p.dispatch_ms * inv, p.native_calls, p.fallback_calls,
             p.compiles, p.cache_hits, p.cache_misses, p.tlb_slow, p.invalidates,
-            p.advances, p.idle_warps, p.idle_cycles, p.chain_links,
-            p.native_cycles, p.fallback_cycles, avg_cyc);
+            p.revalidated, p.advances, p.idle_warps, p.idle_cycles,
+            p.chain_links, links, p.links_patched, p.native_cycles,
+            p.fallback_cycles, avg_cyc);
     } else {
         Utils::info(
             "jit profile (1s): calls native={} fb={} compile={} "
-            "cache hit/miss={}/{} tlb_slow={} inval={} adv={} idle={}/{}c "
-            "chain={} | "
+            "cache hit/miss={}/{} tlb_slow={} inval={} reval={} adv={} "
+            "idle={}/{}c chain={} link={}/{}patched | "
             "cyc native={} fb={} avg_blk={:.1f}",
             p.native_calls, p.fallback_calls, p.compiles, p.cache_hits,
-            p.cache_misses, p.tlb_slow, p.invalidates, p.advances, p.idle_warps,
-            p.idle_cycles, p.chain_links, p.native_cycles, p.fallback_cycles,
-            avg_cyc);
+            p.cache_misses, p.tlb_slow, p.invalidates, p.revalidated,
+            p.advances, p.idle_warps, p.idle_cycles, p.chain_links, links,
+            p.links_patched, p.native_cycles, p.fallback_cycles, avg_cyc);
     }
-    p.native_ms = p.fallback_ms = p.compile_ms = p.advance_ms = p.dispatch_ms =
-        0;
-    p.native_calls = p.native_cycles = 0;
-    p.fallback_calls = p.fallback_cycles = 0;
-    p.compiles = p.cache_hits = p.cache_misses = 0;
-    p.tlb_slow = p.invalidates = p.advances = 0;
-    p.idle_warps = p.idle_cycles = 0;
-    p.chain_links = 0;
+    if (p.opt.blocks) {
+        const auto &o = p.opt;
+        Utils::info("jit opt (1s): blocks={} ops={} r0={} const={} copy={} "
+                    "dead={} const_addr={}",
+                    o.blocks, o.ops, o.r0_folded, o.consts_folded, o.copies,
+                    o.dead_writes, o.const_addrs);
+    }
+    const auto c = g_dynarec().cache_stats();
+    const auto &h = p.compile_stalls;
+    Utils::info("jit cache (1s): blocks={} slabs={} code={}/{}KiB "
+                "evicted slabs={} blocks={} | compile us <10={} <50={} "
+                "<100={} <500={} <1000={} >=1000={} | disk hit/store={}/{} "
+                "| tier cold={} queued={} published={} dropped={} | "
+                "traces={} fastmem_patched={}",
+                c.blocks, c.slabs, c.used_bytes >> 10, c.slab_bytes >> 10,
+                c.evicted_slabs, c.evicted_blocks, h[0], h[1], h[2], h[3], h[4],
+                h[5], p.disk_hits, p.disk_stores, p.tier_cold, p.tier_queued,
+                p.tier_published, p.tier_dropped, p.traces, c.fault_patches);
+    reset_counters(p);
+}
+
+void jit_profile_enable() {
+    auto &p = prof();
+    p.enabled = true;
+}
+
+JitProfileTotals jit_profile_take() {
+    auto &p = prof();
+    JitProfileTotals t;
+    t.compile_ms = p.compile_ms;
+    t.compiles = p.compiles;
+    t.traces = p.traces;
+    t.native_calls = p.native_calls;
+    t.native_cycles = p.native_cycles;
+    t.fallback_calls = p.fallback_calls;
+    t.fallback_cycles = p.fallback_cycles;
+    t.code_bytes = g_dynarec().cache_stats().used_bytes;
+    exec_state().links_taken = 0;
+    reset_counters(p);
+    return t;
 }
 
 Dynarec Dynarec::instance_{};
@@ -124,20 +257,28 @@ Dynarec &Dynarec::get_instance() { return instance_; }
 void Dynarec::reset() {
     cache_.clear();
     CachedInterp::clear();
+    // In-flight jobs finish on their own and are dropped when collected.
+    for (auto &[paddr, job] : queued_)
+        job->cancelled.store(true, std::memory_order_relaxed);
+    queued_.clear();
+    heat_.clear();
     set_code_invalidate_hook([](uint32_t paddr, uint32_t length) {
         g_dynarec().invalidate_range(paddr, length);
         CachedInterp::invalidate_range(paddr, length);
     });
+    Fastmem::set_fault_fixup(
+        [](uintptr_t pc) { return g_dynarec().cache_.patch_fault_site(pc); });
 }
 
 void Dynarec::invalidate_page(uint32_t paddr) {
+    cancel_queued(paddr & ~0xFFFu, 0x1000);
     if (!cache_.page_has_code(paddr))
         return;
-    jit_profile_note_invalidate();
-    cache_.invalidate_page(paddr);
+    jit_profile_note_invalidate(cache_.invalidate_page(paddr));
 }
 
 void Dynarec::invalidate_range(uint32_t paddr, uint32_t length) {
+    cancel_queued(paddr, length);
     // Cheap reject: single-page data writes (framebuffer) dominate.
     if (length <= 8 && !cache_.page_has_code(paddr))
         return;
@@ -157,8 +298,17 @@ void Dynarec::invalidate_range(uint32_t paddr, uint32_t length) {
         if (!any)
             return;
     }
-    jit_profile_note_invalidate();
-    cache_.invalidate_range(paddr, length);
+    jit_profile_note_invalidate(cache_.invalidate_range(paddr, length));
+}
+
+void Dynarec::cancel_queued(uint32_t paddr, uint32_t length) {
+    if (queued_.empty())
+        return;
+    const uint64_t end = uint64_t{paddr} + length;
+    for (auto &[start, job] : queued_) {
+        if (start < end && paddr < start + 4u * job->words.size())
+            job->cancelled.store(true, std::memory_order_relaxed);
+    }
 }
 
 void invalidate_code_page(uint32_t paddr) {
@@ -188,44 +338,333 @@ int Dynarec::run_interpreter_fallback() {
     return got;
 }
 
+// TLB-mapped PC missing from the soft TLB. Code in RDRAM is noted there,
+// so the next dispatch to the page skips the TLB probe.
+static std::optional<uint32_t> resolve_mapped_pc(uint32_t pc32) {
+    auto paddr = Mmu::resolve_vaddr_slow(pc32);
+    if (paddr.has_value() && *paddr <= RDRAM_SIZE - 4)
+        Mmu::soft_tlb_note_load(pc32, *paddr);
+    return paddr;
+}
+
 static bool should_interpret_paddr(uint32_t paddr) {
     // IPL3 / boot code in SP DMEM is sensitive; keep it on the interpreter
     // until the dynarec is proven correct there.
     return PHYS_SPDMEM_BASE <= paddr && paddr <= PHYS_SPDMEM_END;
 }
 
-CompiledBlock *Dynarec::compile(uint32_t vaddr, uint32_t paddr) {
-    auto &p = prof();
-    if (!p.enabled) {
-        IrBlock ir;
+CompiledBlock *Dynarec::build(uint32_t vaddr, uint32_t paddr,
+                              IrOptStats *stats) {
+    IrBlock ir;
+    uint64_t checksum = 0;
+    if (!load_disk_ir(vaddr, paddr, ir, checksum)) {
         if (!translate_block(vaddr, paddr, ir))
             return nullptr;
-        BlockFn fn = emit_block(ir, cache_);
-        cache_.insert(paddr, fn, static_cast<uint16_t>(ir.ops.size()));
-        return cache_.lookup(paddr);
+        const uint32_t end = paddr + 4u * static_cast<uint32_t>(ir.ops.size());
+        checksum = code_checksum(paddr, end);
+        // Only RDRAM code has a checksum to validate a later load against.
+        if (disk_cache_.enabled() && end <= RDRAM_SIZE) {
+            disk_cache_.store(ir, checksum);
+            if (prof().enabled)
+                ++prof().disk_stores;
+        }
     }
-    CompiledBlock *block = nullptr;
-    if (p.times) {
-        const auto t0 = clock::now();
-        IrBlock ir;
-        if (!translate_block(vaddr, paddr, ir))
-            return nullptr;
-        BlockFn fn = emit_block(ir, cache_);
-        cache_.insert(paddr, fn, static_cast<uint16_t>(ir.ops.size()));
-        block = cache_.lookup(paddr);
-        p.compile_ms += ms_since(t0);
-    } else {
-        IrBlock ir;
-        if (!translate_block(vaddr, paddr, ir))
-            return nullptr;
-        BlockFn fn = emit_block(ir, cache_);
-        cache_.insert(paddr, fn, static_cast<uint16_t>(ir.ops.size()));
-        block = cache_.lookup(paddr);
+    if (optimize_)
+        optimize_block(ir, stats);
+    CompiledBlock *nb = cache_.new_block(paddr);
+    nb->vaddr = vaddr;
+    nb->fr = ir.fr;
+    nb->checksum = checksum;
+    nb->trace_at = kTraceHot;
+    BlockFn fn = emit_block(ir, cache_, *nb);
+    cache_.insert(nb, fn, static_cast<uint16_t>(ir.ops.size()));
+    return cache_.lookup(paddr);
+}
+
+bool Dynarec::load_disk_ir(uint32_t vaddr, uint32_t paddr, IrBlock &out,
+                           uint64_t &checksum) {
+    const IrDiskCache::Entry *e = disk_cache_.find(paddr);
+    if (!e)
+        return false;
+    const uint32_t end =
+        paddr + 4u * static_cast<uint32_t>(e->ir.ops.size());
+    if (end > RDRAM_SIZE || e->ir.vaddr != vaddr ||
+        e->ir.fr != (g_cpu().cop0.reg.status.fr != 0) ||
+        e->checksum != code_checksum(paddr, end))
+        return false;
+    out = e->ir;
+    checksum = e->checksum;
+    if (prof().enabled)
+        ++prof().disk_hits;
+    return true;
+}
+
+CompiledBlock *Dynarec::revalidate(uint32_t vaddr, uint32_t paddr) {
+    CompiledBlock *b = cache_.find_stale(paddr);
+    if (!b || b->end > RDRAM_SIZE || b->vaddr != vaddr ||
+        b->fr != (g_cpu().cop0.reg.status.fr != 0) ||
+        b->checksum != code_checksum(b->begin, b->end))
+        return nullptr;
+    cache_.revive(b);
+    return b;
+}
+
+CompiledBlock *Dynarec::compile(uint32_t vaddr, uint32_t paddr) {
+    auto &p = prof();
+    if (CompiledBlock *b = revalidate(vaddr, paddr)) {
+        if (p.enabled)
+            ++p.revalidated;
+        return b;
     }
+    // Tiered: RDRAM code waits on the interpreter until the compile thread
+    // has it; elsewhere there is no snapshot to hand over, so compile now.
+    if (tier_threshold_ && paddr < RDRAM_SIZE) {
+        note_cold(vaddr, paddr);
+        return nullptr;
+    }
+    if (!p.enabled)
+        return build(vaddr, paddr, nullptr);
+    // Compiles are rare next to block calls, so they are always timed: the
+    // histogram shows the stalls (slab eviction included) a frame can hit.
+    const auto t0 = clock::now();
+    CompiledBlock *block = build(vaddr, paddr, &p.opt);
+    const double ms = ms_since(t0);
+    p.compile_ms += ms;
+    if (!block)
+        return nullptr;
     ++p.compiles;
+    note_compile_stall(p, ms);
     return block;
 }
 
+bool Dynarec::retranslate(const CompiledBlock &block, IrBlock &out) {
+    return translate_block(block.vaddr, block.paddr, out) &&
+           out.ops.size() == block.num_insts && out.fr == block.fr &&
+           code_checksum(block.paddr, block.end) == block.checksum;
+}
+
+CompiledBlock *Dynarec::form_trace(CompiledBlock *head) {
+    head->trace_at = head->trace_at > UINT32_MAX / 2 ? UINT32_MAX
+                                                     : head->trace_at * 2;
+    // Only RDRAM code has the checksum a dropped trace is revived by.
+    const bool fr = g_cpu().cop0.reg.status.fr != 0;
+    if (head->end > RDRAM_SIZE || head->fr != fr)
+        return head;
+    IrBlock trace;
+    if (!retranslate(*head, trace))
+        return head;
+
+    const auto t0 = clock::now();
+    uint32_t begin = head->begin;
+    uint32_t end = head->end;
+    // Successors of the last block joined, and the ways out of the earlier
+    // ones other than into the next.
+    IrSuccessor last[MAX_SUCCESSORS];
+    uint8_t num_last = trace.num_successors;
+    std::copy_n(trace.successors, num_last, last);
+    IrSuccessor side[MAX_SUCCESSORS];
+    uint8_t num_side = 0;
+    uint32_t joined[MAX_TRACE_BLOCKS] = {head->paddr};
+    int num_joined = 1;
+    const CompiledBlock *cur = head;
+    while (num_joined < MAX_TRACE_BLOCKS) {
+        // Follow an exit only if it takes at least 3/4 of the traffic.
+        const uint32_t total = exit_hits(*cur);
+        int k = 0;
+        while (k < num_last && uint64_t{cur->exits[k].hits} * 4 <
+                                   uint64_t{total} * 3)
+            ++k;
+        if (total == 0 || k == num_last)
+            break;
+        const CompiledBlock *next = cache_.lookup(last[k].paddr);
+        if (!next || next->is_trace || next->vaddr != last[k].vaddr ||
+            next->fr != fr || next->end > RDRAM_SIZE ||
+            std::find(joined, joined + num_joined, next->paddr) !=
+                joined + num_joined)
+            break;
+        // Keep the invalidation range of the trace within a page or so.
+        const uint32_t lo = std::min(begin, next->begin);
+        const uint32_t hi = std::max(end, next->end);
+        if (hi - lo > 0x1000 ||
+            trace.ops.size() + next->num_insts >
+                static_cast<size_t>(MAX_TRACE_INSNS))
+            break;
+        IrSuccessor exits[MAX_SUCCESSORS];
+        uint8_t num_exits = num_side;
+        std::copy_n(side, num_side, exits);
+        bool fits = true;
+        for (uint8_t i = 0; i < num_last && fits; i++) {
+            if (i != k)
+                fits = add_unique(exits, num_exits, last[i]);
+        }
+        IrBlock part;
+        if (!fits || !retranslate(*next, part))
+            break;
+        // Everything the trace can still leave to must have an exit.
+        uint8_t num_all = num_exits;
+        IrSuccessor all[MAX_SUCCESSORS];
+        std::copy_n(exits, num_exits, all);
+        for (uint8_t i = 0; i < part.num_successors && fits; i++)
+            fits = add_unique(all, num_all, part.successors[i]);
+        if (!fits)
+            break;
+
+        trace.seams.push_back(
+            IrSeam{static_cast<uint16_t>(trace.ops.size()), last[k].vaddr});
+        trace.ops.insert(trace.ops.end(), part.ops.begin(), part.ops.end());
+        trace.ends_with_branch = part.ends_with_branch;
+        std::copy_n(exits, num_exits, side);
+        num_side = num_exits;
+        std::copy_n(part.successors, part.num_successors, last);
+        num_last = part.num_successors;
+        joined[num_joined++] = next->paddr;
+        begin = lo;
+        end = hi;
+        cur = next;
+    }
+    if (trace.seams.empty())
+        return head;
+    trace.num_successors = num_side;
+    std::copy_n(side, num_side, trace.successors);
+    for (uint8_t i = 0; i < num_last; i++)
+        add_unique(trace.successors, trace.num_successors, last[i]);
+
+    auto &p = prof();
+    if (optimize_)
+        optimize_block(trace, p.enabled ? &p.opt : nullptr);
+    const uint32_t paddr = head->paddr;
+    const uint32_t vaddr = head->vaddr;
+    cache_.drop(head);
+    CompiledBlock *nb = cache_.new_block(paddr);
+    nb->vaddr = vaddr;
+    nb->fr = fr;
+    nb->checksum = code_checksum(begin, end);
+    nb->is_trace = true;
+    BlockFn fn = emit_block(trace, cache_, *nb);
+    cache_.insert_trace(nb, fn, static_cast<uint16_t>(trace.ops.size()),
+                        begin, end);
+    if (p.enabled) {
+        const double ms = ms_since(t0);
+        p.compile_ms += ms;
+        note_compile_stall(p, ms);
+        ++p.traces;
+    }
+    return nb;
+}
+
+void Dynarec::note_cold(uint32_t vaddr, uint32_t paddr) {
+    if (queued_.contains(paddr))
+        return;
+    if (++heat_[paddr] < tier_threshold_)
+        return;
+    // A dropped job or block has to warm up again.
+    heat_.erase(paddr);
+    auto job = std::make_unique<CompileJob>();
+    job->vaddr = vaddr;
+    job->paddr = paddr;
+    job->fr = g_cpu().cop0.reg.status.fr != 0;
+    job->optimize = optimize_;
+    // Enough words for any block translate_block() can form here: the rest
+    // of the page plus a delay slot.
+    const uint32_t to_page_end = (0x1000u - (paddr & 0xFFFu)) / 4;
+    const uint32_t words = std::min<uint32_t>(
+        {to_page_end + 1, MAX_BLOCK_INSNS, (RDRAM_SIZE - paddr) / 4});
+    job->words.resize(words);
+    for (uint32_t i = 0; i < words; i++)
+        job->words[i] = Memory::read_paddr32(paddr + 4 * i);
+    uint64_t checksum = 0;
+    job->have_ir = load_disk_ir(vaddr, paddr, job->ir, checksum);
+    queued_[paddr] = job.get();
+    worker_.submit(std::move(job));
+    if (prof().enabled)
+        ++prof().tier_queued;
+}
+
+bool Dynarec::publish_one(CompileJob &job) {
+    if (job.cancelled.load(std::memory_order_relaxed) || !job.ok)
+        return false;
+    const uint32_t n = static_cast<uint32_t>(job.ir.ops.size());
+    // Guest writes cancel jobs, but only the words the block ended up
+    // using are checked here, against what the interpreter sees now.
+    for (uint32_t i = 0; i < n; i++) {
+        if (Memory::read_paddr32(job.paddr + 4 * i) != job.words[i])
+            return false;
+    }
+    const uint32_t end = job.paddr + 4 * n;
+    const uint64_t checksum = code_checksum(job.paddr, end);
+    if (!job.have_ir && disk_cache_.enabled()) {
+        disk_cache_.store(job.translated, checksum);
+        if (prof().enabled)
+            ++prof().disk_stores;
+    }
+    CompiledBlock *nb = cache_.new_block(job.paddr);
+    nb->vaddr = job.vaddr;
+    nb->fr = job.fr;
+    nb->checksum = checksum;
+    nb->trace_at = kTraceHot;
+    BlockFn fn = place_block(job.block, cache_, *nb);
+    cache_.insert(nb, fn, static_cast<uint16_t>(n));
+    return true;
+}
+
+void Dynarec::publish_compiled() {
+    if (!worker_.has_finished())
+        return;
+    auto &p = prof();
+    for (auto &job : worker_.take_finished()) {
+        const auto it = queued_.find(job->paddr);
+        if (it == queued_.end() || it->second != job.get())
+            continue; // queued before a reset
+        queued_.erase(it);
+        // Revalidated while in flight.
+        if (cache_.lookup(job->paddr))
+            continue;
+        const auto t0 = p.enabled ? clock::now() : clock::time_point{};
+        const bool ok = publish_one(*job);
+        if (!p.enabled)
+            continue;
+        if (ok) {
+            const double ms = ms_since(t0);
+            p.compile_ms += ms;
+            ++p.compiles;
+            ++p.tier_published;
+            note_compile_stall(p, ms);
+            add_opt_stats(p.opt, job->opt);
+        } else {
+            ++p.tier_dropped;
+        }
+    }
+}
+
+int Dynarec::run_cold() {
+    // Same extent as a translated block: straight-line code through one
+    // branch and its delay slot, stopping early on an exception (any PC
+    // that is not the next word) or at the page end.
+    auto &cpu = g_cpu();
+    const uint32_t start = static_cast<uint32_t>(cpu.get_pc64());
+    int n = 0;
+    bool branched = false;
+    for (;;) {
+        CachedInterp::step_one();
+        ++n;
+        if (cpu.delay_slot) {
+            branched = true;
+            continue;
+        }
+        const uint32_t pc = static_cast<uint32_t>(cpu.get_pc64());
+        if (branched || n >= MAX_BLOCK_INSNS ||
+            pc != start + 4u * static_cast<uint32_t>(n) || !(pc & 0xFFFu))
+            break;
+    }
+    auto &p = prof();
+    if (p.enabled) {
+        ++p.tier_cold;
+        ++p.fallback_calls;
+        p.fallback_cycles += static_cast<uint64_t>(n) * CPU_CYCLES_PER_INST;
+    }
+    return n * static_cast<int>(CPU_CYCLES_PER_INST);
+}
+
 int Dynarec::run(int budget) {
     if (budget < 1)
         budget = 1;
@@ -280,6 +719,19 @@ int Dynarec::run(int budget) {
         apply_idle_if_pending();
     };
 
+    // Cycles linked blocks may run before the dispatcher has to look again:
+    // end of budget, next event, or the next batched machine advance.
+    const auto link_budget = [&]() -> int32_t {
+        if (!linking_)
+            return 0;
+        int64_t left = std::min<int64_t>(budget - total,
+                                         kAdvanceEveryCycles - pending);
+        const uint64_t until = g_scheduler().cycles_until_next_event();
+        if (until != UINT64_MAX)
+            left = std::min<int64_t>(left, static_cast<int64_t>(until) - pending);
+        return static_cast<int32_t>(std::max<int64_t>(left, 0));
+    };
+
     idle_skip_begin_slice(budget);
 
     // Soft-chain within the half-line budget. Batch RSP + scheduler every
@@ -336,8 +788,10 @@ int Dynarec::run(int budget) {
         uint32_t paddr;
         if (auto direct = Mmu::try_direct_map(pc32)) {
             paddr = *direct;
+        } else if (auto mapped = Mmu::soft_tlb_lookup(pc32, 4, false)) {
+            paddr = *mapped;
         } else {
-            auto resolved = Mmu::resolve_vaddr_slow(pc32);
+            auto resolved = resolve_mapped_pc(pc32);
             if (!resolved.has_value()) {
                 credit(run_interpreter_fallback());
                 continue;
@@ -365,17 +819,27 @@ int Dynarec::run(int budget) {
         }
 
         CompiledBlock *block = cache_.lookup(paddr);
+        if (!block && !queued_.empty()) {
+            publish_compiled();
+            block = cache_.lookup(paddr);
+        }
         if (!block) {
             if (prof_on)
                 ++p.cache_misses;
             block = compile(pc32, paddr);
             if (!block) {
-                credit(run_interpreter_fallback());
+                credit(tier_threshold_ ? run_cold()
+                                       : run_interpreter_fallback());
                 continue;
             }
         } else if (prof_on) {
             ++p.cache_hits;
         }
+        if (tracing_ && !block->is_trace &&
+            exit_hits(*block) >= block->trace_at)
+            block = form_trace(block);
+        if (cache_.link_pending(block) && prof_on)
+            ++p.links_patched;
 
         // Intentionally allow a block to run slightly past `until` / slice.
         // Clamping to interpreter or returning to the outer loop here was the
@@ -386,29 +850,44 @@ int Dynarec::run(int budget) {
 
         // Block linking: re-enter compiled code for the next PC without the
         // full outer dispatcher (scheduler/TLB/compile) when possible.
+        // Natively linked exits skip even this loop within link_budget().
         for (;;) {
             exec->aborted = false;
             exec->annul_delay_slot = false;
-            int got;
+            exec->link_break = false;
+            exec->link_budget = link_budget();
+            exec->linked_cycles = 0;
+            exec->link_exit = nullptr;
+            exec->bail_block = nullptr;
+            int taken;
+            if (prof_times) {
+                const auto t0 = clock::now();
+                taken = block->fn() + exec->linked_cycles;
+                p.native_ms += ms_since(t0);
+            } else {
+                taken = block->fn() + exec->linked_cycles;
+            }
+            // A bail may legitimately stop before the first op.
+            const int got = (taken > 0 || exec->bail_block) ? taken : 1;
             if (prof_on) {
-                if (prof_times) {
-                    const auto t0 = clock::now();
-                    const int taken = block->fn();
-                    p.native_ms += ms_since(t0);
-                    got = taken > 0 ? taken : 1;
-                } else {
-                    const int taken = block->fn();
-                    got = taken > 0 ? taken : 1;
-                }
                 ++p.native_calls;
                 p.native_cycles += static_cast<uint64_t>(got);
-            } else {
-                const int taken = block->fn();
-                got = taken > 0 ? taken : 1;
             }
+            if (exec->link_exit)
+                cache_.set_pending_exit(exec->link_exit);
 
             const int total_before = total;
             credit(got);
+            if (exec->bail_block) {
+                // COP1 guard: either CU1 is off (the interpreter raises the
+                // exception; keep the block for when the OS enables it) or
+                // Status.FR changed since compile, which needs a recompile.
+                if (cpu.cop0.reg.status.cu1)
+                    cache_.drop(exec->bail_block);
+                exec->bail_block = nullptr;
+                credit(run_interpreter_fallback());
+                break;
+            }
             if (exec->aborted) {
                 flush_pending();
                 break; // leave chain + outer; final flush below
@@ -439,8 +918,10 @@ int Dynarec::run(int budget) {
             uint32_t next_paddr;
             if (auto direct = Mmu::try_direct_map(next_pc)) {
                 next_paddr = *direct;
+            } else if (auto mapped = Mmu::soft_tlb_lookup(next_pc, 4, false)) {
+                next_paddr = *mapped;
             } else {
-                auto resolved = Mmu::resolve_vaddr_slow(next_pc);
+                auto resolved = resolve_mapped_pc(next_pc);
                 if (!resolved.has_value())
                     break;
                 if (prof_on)
@@ -453,9 +934,15 @@ int Dynarec::run(int budget) {
             CompiledBlock *next = cache_.lookup(next_paddr);
             if (!next)
                 break;
+            if (tracing_ && !next->is_trace &&
+                exit_hits(*next) >= next->trace_at)
+                next = form_trace(next);
+            const bool patched = cache_.link_pending(next);
             if (prof_on) {
                 ++p.cache_hits;
                 ++p.chain_links;
+                if (patched)
+                    ++p.links_patched;
             }
             block = next;
         }
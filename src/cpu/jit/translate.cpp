@@ -1,8 +1,10 @@
 #include "cpu/jit/jit.h"
+#include "cpu/cpu.h"
 #include "cpu/instruction.h"
 #include "memory/bus.h"
 #include "mmu/mmu.h"
 #include <optional>
+#include <span>
 
 namespace N64 {
 namespace Cpu {
@@ -95,6 +97,15 @@ bool try_special(instruction_t inst, IrOp &op) {
     case SPECIAL_FUNCT_DSRA32:
         op.kind = IrOpKind::Dsra32;
         return true;
+    case SPECIAL_FUNCT_DSLLV:
+        op.kind = IrOpKind::Dsllv;
+        return true;
+    case SPECIAL_FUNCT_DSRLV:
+        op.kind = IrOpKind::Dsrlv;
+        return true;
+    case SPECIAL_FUNCT_DSRAV:
+        op.kind = IrOpKind::Dsrav;
+        return true;
     case SPECIAL_FUNCT_JR:
         op.kind = IrOpKind::Jr;
         return true;
@@ -125,6 +136,18 @@ bool try_special(instruction_t inst, IrOp &op) {
     case SPECIAL_FUNCT_DIVU:
         op.kind = IrOpKind::Divu;
         return true;
+    case SPECIAL_FUNCT_DMULT:
+        op.kind = IrOpKind::Dmult;
+        return true;
+    case SPECIAL_FUNCT_DMULTU:
+        op.kind = IrOpKind::Dmultu;
+        return true;
+    case SPECIAL_FUNCT_DDIV:
+        op.kind = IrOpKind::Ddiv;
+        return true;
+    case SPECIAL_FUNCT_DDIVU:
+        op.kind = IrOpKind::Ddivu;
+        return true;
     case SPECIAL_FUNCT_SYNC:
         op.kind = IrOpKind::Nop;
         return true;
@@ -184,6 +207,76 @@ bool try_cop0(instruction_t inst, IrOp &op) {
     }
 }
 
+// Arithmetic the emitter lowers to SSE with the interpreter's results. CVT.W
+// (FCR31 rounding mode), CEIL/FLOOR and the L format stay on do_fpu.
+bool is_native_cop1_arith(uint8_t fmt, uint8_t funct) {
+    if (fmt == COP1_FMT_W)
+        return funct == COP1_FUNCT_CVT_S || funct == COP1_FUNCT_CVT_D;
+    if (fmt != COP1_FMT_S && fmt != COP1_FMT_D)
+        return false;
+    if ((funct & 0b110000) == COP1_FUNCT_C_F)
+        return true;
+    switch (funct) {
+    case COP1_FUNCT_ADD:
+    case COP1_FUNCT_SUB:
+    case COP1_FUNCT_MUL:
+    case COP1_FUNCT_DIV:
+    case COP1_FUNCT_SQRT:
+    case COP1_FUNCT_ABS:
+    case COP1_FUNCT_MOV:
+    case COP1_FUNCT_NEG:
+    case COP1_FUNCT_ROUND_W:
+    case COP1_FUNCT_TRUNC_W:
+        return true;
+    case COP1_FUNCT_CVT_S:
+        return fmt == COP1_FMT_D;
+    case COP1_FUNCT_CVT_D:
+        return fmt == COP1_FMT_S;
+    default:
+        return false;
+    }
+}
+
+void try_cop1(instruction_t inst, IrOp &op) {
+    const uint8_t sub = static_cast<uint8_t>(inst.cop_r_like.sub);
+    op.target = inst.raw;
+    switch (sub) {
+    case COP_BC: {
+        const uint8_t ndtf = static_cast<uint8_t>(inst.i_type.rt);
+        op.kind = (ndtf == COP1_BC_FL || ndtf == COP1_BC_TL) ? IrOpKind::Bc1l
+                                                             : IrOpKind::Bc1;
+        op.rt = ndtf;
+        op.imm = static_cast<uint16_t>(inst.i_type.imm);
+        return;
+    }
+    case COP_MFC:
+    case COP_MTC:
+    case COP_DMFC:
+    case COP_DMTC:
+        op.kind = sub == COP_MFC    ? IrOpKind::Mfc1
+                  : sub == COP_MTC  ? IrOpKind::Mtc1
+                  : sub == COP_DMFC ? IrOpKind::Dmfc1
+                                    : IrOpKind::Dmtc1;
+        op.rt = static_cast<uint8_t>(inst.cop_r_like.rt);
+        op.rd = static_cast<uint8_t>(inst.cop_r_like.rd);
+        return;
+    default:
+        break;
+    }
+    const uint8_t fmt = static_cast<uint8_t>(inst.fr_type.fmt);
+    const uint8_t funct = static_cast<uint8_t>(inst.fr_type.funct);
+    if (!is_native_cop1_arith(fmt, funct)) {
+        op.kind = IrOpKind::Fpu; // CFC1/CTC1 and the rest
+        return;
+    }
+    op.kind = IrOpKind::Cop1Arith;
+    op.sa = fmt;
+    op.imm = funct;
+    op.rd = static_cast<uint8_t>(inst.fr_type.fd);
+    op.rs = static_cast<uint8_t>(inst.fr_type.fs);
+    op.rt = static_cast<uint8_t>(inst.fr_type.ft);
+}
+
 bool decode_one(uint32_t raw, IrOp &op) {
     instruction_t inst{};
     inst.raw = raw;
@@ -285,6 +378,18 @@ bool decode_one(uint32_t raw, IrOp &op) {
     case OPCODE_LWR:
         op.kind = IrOpKind::Lwr;
         break;
+    case OPCODE_LDL:
+        op.kind = IrOpKind::Ldl;
+        break;
+    case OPCODE_LDR:
+        op.kind = IrOpKind::Ldr;
+        break;
+    case OPCODE_LL:
+        op.kind = IrOpKind::Ll;
+        break;
+    case OPCODE_LLD:
+        op.kind = IrOpKind::Lld;
+        break;
     case OPCODE_SB:
         op.kind = IrOpKind::Sb;
         break;
@@ -303,25 +408,37 @@ bool decode_one(uint32_t raw, IrOp &op) {
     case OPCODE_SWR:
         op.kind = IrOpKind::Swr;
         break;
+    case OPCODE_SDL:
+        op.kind = IrOpKind::Sdl;
+        break;
+    case OPCODE_SDR:
+        op.kind = IrOpKind::Sdr;
+        break;
+    case OPCODE_SC:
+        op.kind = IrOpKind::Sc;
+        break;
+    case OPCODE_SCD:
+        op.kind = IrOpKind::Scd;
+        break;
     case OPCODE_LWC1:
+        op.kind = IrOpKind::Lwc1;
+        op.target = raw;
+        break;
     case OPCODE_LDC1:
+        op.kind = IrOpKind::Ldc1;
+        op.target = raw;
+        break;
     case OPCODE_SWC1:
-    case OPCODE_SDC1:
-        op.kind = IrOpKind::Fpu;
+        op.kind = IrOpKind::Swc1;
         op.target = raw;
-        return true;
-    case OPCODE_CP1: {
-        if (inst.r_type.rs == COP_BC) {
-            const uint8_t ndtf = static_cast<uint8_t>(inst.i_type.rt);
-            op.kind = (ndtf == COP1_BC_FL || ndtf == COP1_BC_TL)
-                          ? IrOpKind::Bc1l
-                          : IrOpKind::Bc1;
-        } else {
-            op.kind = IrOpKind::Fpu;
-        }
+        break;
+    case OPCODE_SDC1:
+        op.kind = IrOpKind::Sdc1;
         op.target = raw;
+        break;
+    case OPCODE_CP1:
+        try_cop1(inst, op);
         return true;
-    }
     case OPCODE_CACHE:
         op.kind = IrOpKind::Nop;
         op.rs = static_cast<uint8_t>(inst.i_type.rs);
@@ -365,12 +482,56 @@ bool is_branch(IrOpKind k) {
     }
 }
 
-} // namespace
+void add_successor(IrBlock &out, uint32_t vaddr, uint32_t branch_vaddr) {
+    // Self-loops stay on the dispatcher, which owns idle-loop skipping.
+    if (vaddr == branch_vaddr)
+        return;
+    const auto paddr = Mmu::try_direct_map(vaddr);
+    if (!paddr.has_value())
+        return;
+    for (uint8_t i = 0; i < out.num_successors; i++) {
+        if (out.successors[i].vaddr == vaddr)
+            return;
+    }
+    out.successors[out.num_successors++] = IrSuccessor{vaddr, *paddr};
+}
 
-bool translate_block(uint32_t vaddr, uint32_t paddr, IrBlock &out) {
+// Only direct branches with their delay slot in the block have successors
+// fixed at translation time; JR/JALR targets are left to the dispatcher.
+void find_successors(IrBlock &out) {
+    const size_t n = out.ops.size();
+    if (n < 2 || is_branch(out.ops[n - 1].kind) ||
+        !is_branch(out.ops[n - 2].kind))
+        return;
+    const IrOp &br = out.ops[n - 2];
+    const uint32_t br_v = out.vaddr + static_cast<uint32_t>(n - 2) * 4;
+    const uint32_t ds_v = br_v + 4;
+    switch (br.kind) {
+    case IrOpKind::Jr:
+    case IrOpKind::Jalr:
+        return;
+    case IrOpKind::J:
+    case IrOpKind::Jal:
+        add_successor(out, (ds_v & 0xF0000000u) | (br.target << 2), br_v);
+        return;
+    default: {
+        const int32_t off = static_cast<int16_t>(br.imm) * 4;
+        add_successor(out, ds_v + static_cast<uint32_t>(off), br_v);
+        add_successor(out, ds_v + 4, br_v);
+        return;
+    }
+    }
+}
+
+// `fetch(paddr)` yields the guest word there, or nullopt to end the block
+// as if the word were unsupported.
+template <typename Fetch>
+bool translate_words(uint32_t vaddr, uint32_t paddr, bool fr, Fetch fetch,
+                     IrBlock &out) {
     out = {};
     out.vaddr = vaddr;
     out.paddr = paddr;
+    out.fr = fr;
 
     uint32_t cur_v = vaddr;
     uint32_t cur_p = paddr;
@@ -381,9 +542,9 @@ bool translate_block(uint32_t vaddr, uint32_t paddr, IrBlock &out) {
         if ((cur_p & ~0xFFFu) != start_page && !out.ends_with_branch)
             break;
 
-        const uint32_t raw = Memory::read_paddr32(cur_p);
+        const std::optional<uint32_t> raw = fetch(cur_p);
         IrOp op{};
-        if (!decode_one(raw, op)) {
+        if (!raw || !decode_one(*raw, op)) {
             // Unsupported: if nothing translated yet, fail; else end block.
             if (out.ops.empty())
                 return false;
@@ -401,13 +562,14 @@ bool translate_block(uint32_t vaddr, uint32_t paddr, IrBlock &out) {
             // delay slot (was the main soft-chain slowdown).
             if (static_cast<int>(out.ops.size()) >= MAX_BLOCK_INSNS)
                 break;
-            const uint32_t ds_raw = Memory::read_paddr32(cur_p);
+            const std::optional<uint32_t> ds_raw = fetch(cur_p);
             IrOp ds{};
-            if (!decode_one(ds_raw, ds)) {
+            if (!ds_raw || !decode_one(*ds_raw, ds)) {
                 out.ops.pop_back();
                 return !out.ops.empty();
             }
             out.ops.push_back(ds);
+            find_successors(out);
             break;
         }
     }
@@ -415,6 +577,30 @@ bool translate_block(uint32_t vaddr, uint32_t paddr, IrBlock &out) {
     return !out.ops.empty();
 }
 
+} // namespace
+
+bool translate_block(uint32_t vaddr, uint32_t paddr, IrBlock &out) {
+    return translate_words(
+        vaddr, paddr, g_cpu().cop0.reg.status.fr != 0,
+        [](uint32_t p) -> std::optional<uint32_t> {
+            return Memory::read_paddr32(p);
+        },
+        out);
+}
+
+bool translate_block(uint32_t vaddr, uint32_t paddr, bool fr,
+                     std::span<const uint32_t> words, IrBlock &out) {
+    return translate_words(
+        vaddr, paddr, fr,
+        [paddr, words](uint32_t p) -> std::optional<uint32_t> {
+            const uint32_t i = (p - paddr) / 4;
+            if (i >= words.size())
+                return std::nullopt;
+            return words[i];
+        },
+        out);
+}
+
 } // namespace Jit
 } // namespace Cpu
 } // namespace N64
@@ -677,6 +677,7 @@ void Debugger::cmd_mi() const {
 
 void Debugger::cmd_rsp() const {
     auto &rsp = g_rsp();
+    rsp.sync();
     const uint32_t status = rsp.read_paddr32(Rsp::PADDR_SP_STATUS);
     const uint32_t pc = rsp.read_paddr32(Rsp::PADDR_SP_PC);
     dbg_out("SP STATUS={:#010x} PC={:#05x} halt={} broke={} iob={}", status, pc,
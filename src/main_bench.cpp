@@ -0,0 +1,463 @@
+#include "memory/memory.h"
+#include "mmio/controller_input.h"
+#include "n64_system/config.h"
+#include "n64_system/n64_system.h"
+#include "n64_system/scheduler.h"
+#include "rcp/rsp.h"
+#include "rdp/rdp_core.h"
+#include "ui/config_cli.h"
+#include "utils/log.h"
+#include "utils/work_profile.h"
+#if defined(N64_JIT_X64)
+#include "cpu/jit/jit.h"
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+constexpr std::string_view USAGE =
+    "Usage: kamo64-bench [options] [ROM.z64...]\n"
+    "Runs each ROM headless and unpaced for a fixed number of VI fields per\n"
+    "variant and prints a JSON report. Without ROMs, runs the built-in corpus.\n"
+    "Options:\n"
+    "--fields=N\tVI fields per run (default 600)\n"
+    "--cycles=N\talso stop after N guest cycles\n"
+    "--variant=NAME\tbackend to run; repeatable (default jit and interp).\n"
+    "\tNAME is interp or jit, optionally joined with +rsp-jit, "
+    "+rsp-lazy,\n"
+    "\t+rsp-threaded, +audio-hle, +fastmem, +no-simd, +no-opt, +no-link,\n"
+    "\t+no-trace\n"
+    "--input=FILE\tcontroller 1 script: lines of `FIELD BUTTONS [X Y]`\n"
+    "\t(BUTTONS = byte1 << 8 | byte2 in hex; `#` starts a comment)\n"
+    "--out=FILE\twrite the report to FILE (default stdout, shared with the "
+    "log)\n"
+    "--min-fps=X\texit 1 if any run is below X fields/s\n"
+    "Other kamo64-core options (--play-movie=FILE, --soft-rdp, --jit-tier=N,\n"
+    "--log-level=...) apply to every variant.\n";
+
+namespace {
+using N64::N64System::Config;
+using N64::N64System::CpuBackend;
+
+struct InputEvent {
+    uint64_t field;
+    N64::Mmio::N64ControllerState state;
+};
+
+struct Variant {
+    std::string name;
+    Config config;
+};
+
+struct RunResult {
+    std::string rom;
+    std::string variant;
+    uint64_t fields = 0;
+    uint64_t guest_cycles = 0;
+    double wall_ms = 0;
+    N64::WorkProfile::Totals work;
+#if defined(N64_JIT_X64)
+    N64::Cpu::Jit::JitProfileTotals jit;
+#endif
+    uint64_t rss_kib = 0;
+    uint64_t peak_rss_kib = 0;
+};
+
+uint64_t g_fields = 0;
+const std::vector<InputEvent> *g_script = nullptr;
+size_t g_script_pos = 0;
+
+// Script entries take effect once `field` fields have been presented.
+void apply_input(uint64_t field) {
+    while (g_script_pos < g_script->size() &&
+           (*g_script)[g_script_pos].field <= field) {
+        N64::Input::set_controller_state(0, (*g_script)[g_script_pos].state);
+        ++g_script_pos;
+    }
+}
+
+void on_field(N64::Mmio::VI::VI &) {
+    ++g_fields;
+    apply_input(g_fields);
+}
+
+bool parse_input(const std::string &path, std::vector<InputEvent> &out) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Error: cannot open input script `" << path << "`"
+                  << std::endl;
+        return false;
+    }
+    std::string line;
+    for (int n = 1; std::getline(in, line); n++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream ss(line);
+        uint64_t field;
+        if (!(ss >> field))
+            continue; // blank or comment
+        unsigned buttons = 0;
+        int x = 0, y = 0;
+        if (!(ss >> std::hex >> buttons >> std::dec) || buttons > 0xFFFF ||
+            (ss >> x && !(ss >> y)) || x < -128 || x > 127 || y < -128 ||
+            y > 127) {
+            std::cerr << "Error: " << path << ":" << n
+                      << ": expected `FIELD BUTTONS [X Y]`" << std::endl;
+            return false;
+        }
+        InputEvent e{field, {}};
+        e.state.byte1 = static_cast<uint8_t>(buttons >> 8);
+        e.state.byte2 = static_cast<uint8_t>(buttons);
+        e.state.joy_x = static_cast<int8_t>(x);
+        e.state.joy_y = static_cast<int8_t>(y);
+        out.push_back(e);
+    }
+    std::stable_sort(out.begin(), out.end(),
+                     [](const InputEvent &a, const InputEvent &b) {
+                         return a.field < b.field;
+                     });
+    return true;
+}
+
+bool make_variant(std::string_view name, const Config &base, Variant &out) {
+    out.name = std::string(name);
+    out.config = base;
+    Config &c = out.config;
+    size_t pos = 0;
+    for (bool first = true; pos <= name.size(); first = false) {
+        const size_t plus = std::min(name.find('+', pos), name.size());
+        const std::string_view tok = name.substr(pos, plus - pos);
+        pos = plus + 1;
+        if (first && tok == "interp") {
+            c.cpu_backend = CpuBackend::Interpreter;
+        } else if (first && tok == "jit") {
+#if defined(N64_JIT_X64)
+            c.cpu_backend = CpuBackend::Jit;
+#else
+            std::cerr << "Error: this build has no CPU dynarec" << std::endl;
+            return false;
+#endif
+        } else if (!first && tok == "rsp-jit") {
+            c.rsp_jit = true;
+        } else if (!first && tok == "rsp-lazy") {
+            c.rsp_lazy = true;
+        } else if (!first && tok == "rsp-threaded") {
+            c.rsp_threaded = true;
+        } else if (!first && tok == "audio-hle") {
+            c.audio_hle = true;
+        } else if (!first && tok == "fastmem") {
+            c.fastmem = true;
+        } else if (!first && tok == "no-simd") {
+            c.rsp_simd = false;
+        } else if (!first && tok == "no-opt") {
+            c.jit_opt = false;
+        } else if (!first && tok == "no-link") {
+            c.jit_link = false;
+        } else if (!first && tok == "no-trace") {
+            c.jit_trace = false;
+        } else {
+            std::cerr << "Error: unknown variant `" << name << "`"
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parse_u64(std::string_view arg, uint64_t &out) {
+    const std::string s(arg.substr(arg.find('=') + 1));
+    char *end = nullptr;
+    out = std::strtoull(s.c_str(), &end, 0);
+    if (end == s.c_str() || *end != '\0' || out == 0) {
+        std::cerr << "Error: invalid value in `" << arg << "`" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> corpus_roms() {
+    std::vector<std::string> roms;
+    std::error_code ec;
+    for (const auto &e : std::filesystem::recursive_directory_iterator(
+             N64_BENCH_CORPUS_DIR, ec)) {
+        if (e.is_regular_file() && e.path().extension() == ".z64")
+            roms.push_back(e.path().string());
+    }
+    std::sort(roms.begin(), roms.end());
+    return roms;
+}
+
+// VmRSS / VmHWM in KiB; zero where /proc is missing.
+void read_memory(uint64_t &rss, uint64_t &peak) {
+    rss = peak = 0;
+    std::ifstream in("/proc/self/status");
+    std::string key;
+    uint64_t kib;
+    while (in >> key) {
+        if (key == "VmRSS:" && in >> kib)
+            rss = kib;
+        else if (key == "VmHWM:" && in >> kib)
+            peak = kib;
+        in.ignore(256, '\n');
+    }
+}
+
+// Starts a new VmHWM window so each run reports its own peak (Linux).
+void reset_peak_memory() {
+    std::ofstream clear("/proc/self/clear_refs");
+    if (clear)
+        clear << "5";
+}
+
+RunResult run_one(const std::string &rom, const Variant &v, uint64_t fields,
+                  uint64_t max_cycles,
+                  const std::vector<InputEvent> &script) {
+    Config config = v.config;
+    config.rom_filepath = rom;
+
+    reset_peak_memory();
+    N64::N64System::set_up(config);
+    N64::Input::set_controller_state(0, {});
+    g_fields = 0;
+    g_script = &script;
+    g_script_pos = 0;
+    apply_input(0);
+    // Drop whatever set_up counted; only stepping is measured.
+    N64::WorkProfile::take_and_reset();
+#if defined(N64_JIT_X64)
+    N64::Cpu::Jit::jit_profile_take();
+#endif
+
+    const uint64_t cycle0 = N64::g_scheduler().get_current_time();
+    const auto t0 = std::chrono::steady_clock::now();
+    while (g_fields < fields &&
+           (max_cycles == 0 ||
+            N64::g_scheduler().get_current_time() - cycle0 < max_cycles))
+        N64::N64System::step(config);
+    const auto t1 = std::chrono::steady_clock::now();
+
+    RunResult r;
+    r.rom = rom;
+    r.variant = v.name;
+    r.fields = g_fields;
+    r.guest_cycles = N64::g_scheduler().get_current_time() - cycle0;
+    r.wall_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    r.work = N64::WorkProfile::take_and_reset();
+#if defined(N64_JIT_X64)
+    r.jit = N64::Cpu::Jit::jit_profile_take();
+#endif
+    read_memory(r.rss_kib, r.peak_rss_kib);
+    return r;
+}
+
+std::string json_string(std::string_view s) {
+    std::string out = "\"";
+    for (const char c : s) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if (static_cast<unsigned char>(c) < 0x20)
+            out += fmt::format("\\u{:04x}", static_cast<int>(c));
+        else
+            out += c;
+    }
+    return out + "\"";
+}
+
+double fields_per_s(const RunResult &r) {
+    return r.wall_ms > 0 ? 1000.0 * double(r.fields) / r.wall_ms : 0.0;
+}
+
+std::string to_json(const std::vector<RunResult> &runs, uint64_t fields) {
+    using N64::WorkProfile::Bucket;
+    using N64::WorkProfile::events_of;
+    using N64::WorkProfile::ms_of;
+    std::string out = fmt::format(
+        "{{\n  \"build\": {{\"rsp_simd\": {}, \"cpu_jit\": {}}},\n"
+        "  \"fields\": {},\n  \"runs\": [",
+        N64_RSP_SIMD ? "true" : "false",
+#if defined(N64_JIT_X64)
+        "true",
+#else
+        "false",
+#endif
+        fields);
+    for (size_t i = 0; i < runs.size(); i++) {
+        const RunResult &r = runs[i];
+        const auto &w = r.work;
+        const double secs = r.wall_ms / 1000.0;
+        const double rsp = ms_of(w, Bucket::RspTask);
+        // The CPU slice includes RSP tasks run on the CPU thread; soft RDP
+        // time is nested under whichever of the two wrote DPC_END.
+        const double cpu = std::max(ms_of(w, Bucket::CpuSlice) - rsp, 0.0);
+        const uint64_t vu_ops = events_of(w, Bucket::VuCompute);
+        double jit_ms = 0;
+        std::string jit = "null";
+#if defined(N64_JIT_X64)
+        jit_ms = r.jit.compile_ms;
+        jit = fmt::format(
+            "{{\"compiles\": {}, \"traces\": {}, \"native_calls\": {}, "
+            "\"fallback_calls\": {}, \"code_bytes\": {}}}",
+            r.jit.compiles, r.jit.traces, r.jit.native_calls,
+            r.jit.fallback_calls, r.jit.code_bytes);
+#endif
+        out += fmt::format(
+            "{}\n    {{\"rom\": {}, \"variant\": {}, \"fields\": {}, "
+            "\"guest_cycles\": {}, \"wall_ms\": {:.3f}, "
+            "\"fields_per_s\": {:.3f}, \"guest_cycles_per_s\": {:.0f},\n"
+            "     \"ms\": {{\"cpu\": {:.3f}, \"rsp\": {:.3f}, "
+            "\"soft_rdp\": {:.3f}, \"present\": {:.3f}, "
+            "\"jit_compile\": {:.3f}, \"fb_check\": {:.3f}, "
+            "\"fb_flush\": {:.3f}}},\n"
+            "     \"rsp\": {{\"tasks\": {}, \"insns\": {}, \"vu_ops\": {}, "
+            "\"vu_share\": {:.4f}}},\n"
+            "     \"jit\": {},\n"
+            "     \"memory\": {{\"rss_kib\": {}, \"peak_rss_kib\": {}}}}}",
+            i ? "," : "", json_string(r.rom), json_string(r.variant),
+            r.fields, r.guest_cycles, r.wall_ms, fields_per_s(r),
+            secs > 0 ? double(r.guest_cycles) / secs : 0.0, cpu, rsp,
+            ms_of(w, Bucket::SoftRdp), ms_of(w, Bucket::Present), jit_ms,
+            ms_of(w, Bucket::FbCheck), ms_of(w, Bucket::FbFlush),
+            events_of(w, Bucket::RspTask), w.rsp_insns, vu_ops,
+            w.rsp_insns ? double(vu_ops) / double(w.rsp_insns) : 0.0, jit,
+            r.rss_kib, r.peak_rss_kib);
+    }
+    return out + "\n  ]\n}\n";
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Config base{};
+    base.log_level = Utils::LogLevel::WARN;
+    uint64_t fields = 600;
+    uint64_t max_cycles = 0;
+    double min_fps = 0;
+    std::string input_path;
+    std::string out_path;
+    std::vector<std::string> variant_names;
+    std::vector<std::string> roms;
+
+    // Bench options and ROMs here; the rest goes to apply_command_line.
+    std::vector<char *> passthrough{argv[0]};
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+        if (arg.starts_with("--fields=")) {
+            if (!parse_u64(arg, fields))
+                return -1;
+        } else if (arg.starts_with("--cycles=")) {
+            if (!parse_u64(arg, max_cycles))
+                return -1;
+        } else if (arg.starts_with("--variant=")) {
+            variant_names.emplace_back(arg.substr(arg.find('=') + 1));
+        } else if (arg.starts_with("--input=")) {
+            input_path = std::string(arg.substr(arg.find('=') + 1));
+        } else if (arg.starts_with("--out=")) {
+            out_path = std::string(arg.substr(arg.find('=') + 1));
+        } else if (arg.starts_with("--min-fps=")) {
+            min_fps = std::atof(std::string(arg.substr(10)).c_str());
+        } else if (!arg.empty() && !arg.starts_with('-')) {
+            roms.emplace_back(arg);
+        } else {
+            passthrough.push_back(argv[i]);
+            if (arg == "--log" && i + 1 < argc)
+                passthrough.push_back(argv[++i]);
+        }
+    }
+
+    Utils::init_logger();
+    if (!N64::Ui::apply_command_line(
+            base, static_cast<int>(passthrough.size()), passthrough.data())) {
+        std::cout << USAGE << std::endl;
+        return -1;
+    }
+    if (!base.log_filepath.empty())
+        Utils::set_log_file(base.log_filepath);
+    Utils::set_log_level(base.log_level);
+    base.headless = true;
+    base.speed = 0.0;
+    if (base.test_mode || base.debug || !base.dump_frames_dir.empty()) {
+        std::cerr << "Error: --test, --debug and --dump-frames do not apply "
+                     "to kamo64-bench"
+                  << std::endl;
+        return -1;
+    }
+
+    if (variant_names.empty()) {
+#if defined(N64_JIT_X64)
+        variant_names = {"jit", "interp"};
+#else
+        variant_names = {"interp"};
+#endif
+    }
+    std::vector<Variant> variants(variant_names.size());
+    for (size_t i = 0; i < variant_names.size(); i++) {
+        if (!make_variant(variant_names[i], base, variants[i]))
+            return -1;
+    }
+
+    std::vector<InputEvent> script;
+    if (!input_path.empty() && !parse_input(input_path, script))
+        return -1;
+
+    if (roms.empty())
+        roms = corpus_roms();
+    if (roms.empty()) {
+        std::cerr << "Error: no ROMs given and none under "
+                  << N64_BENCH_CORPUS_DIR << std::endl;
+        return -1;
+    }
+    for (const std::string &rom : roms) {
+        if (!std::filesystem::is_regular_file(rom)) {
+            std::cerr << "Error: ROM `" << rom << "` not found" << std::endl;
+            return -1;
+        }
+    }
+
+    if (N64::WorkProfile::enabled())
+        Utils::warn("N64_PROFILE_FRAME resets the bench counters every second");
+    N64::WorkProfile::set_enabled(true);
+#if defined(N64_JIT_X64)
+    N64::Cpu::Jit::jit_profile_enable();
+#endif
+    // Keep real saves out of the measurement.
+    N64::g_memory().set_data_dir(
+        (std::filesystem::temp_directory_path() / "kamo64-bench").string());
+    if (base.soft_rdp)
+        N64::Rdp::init_software(N64::g_memory().get_rdram().data());
+    N64::N64System::set_field_present(&on_field);
+    N64::N64System::set_present_stats_fn(nullptr);
+
+    std::vector<RunResult> runs;
+    bool slow = false;
+    for (const std::string &rom : roms) {
+        for (const Variant &v : variants) {
+            runs.push_back(run_one(rom, v, fields, max_cycles, script));
+            const RunResult &r = runs.back();
+            Utils::info("bench: {} [{}] {} fields in {:.0f}ms ({:.1f}/s)",
+                        r.rom, r.variant, r.fields, r.wall_ms,
+                        fields_per_s(r));
+            if (min_fps > 0 && fields_per_s(r) < min_fps) {
+                Utils::critical("bench: {} [{}] below --min-fps={}", r.rom,
+                                r.variant, min_fps);
+                slow = true;
+            }
+        }
+    }
+
+    const std::string report = to_json(runs, fields);
+    if (out_path.empty()) {
+        std::cout << report;
+    } else {
+        std::ofstream out(out_path);
+        if (!(out << report)) {
+            std::cerr << "Error: cannot write `" << out_path << "`"
+                      << std::endl;
+            return -1;
+        }
+    }
+    return slow ? 1 : 0;
+}
@@ -13,10 +13,48 @@ constexpr std::string_view USAGE =
     "info)\n"
     "--jit\tuse CPU dynarec (x86-64, default)\n"
     "--no-jit\tdisable CPU dynarec (use interpreter)\n"
+    "--no-jit-link\treturn to the dispatcher after every compiled block\n"
+    "--no-jit-opt\temit dynarec IR without optimization passes\n"
+    "--jit-cache-mb=N\tdynarec code budget before old code is evicted "
+    "(default 32)\n"
+    "--jit-cache-blocks=N\tdynarec block budget (default 8192)\n"
+    "--jit-tier=N\tinterpret cold code; compile blocks in the background "
+    "after N entries (default 0: compile on first use)\n"
+    "--no-jit-trace\tdo not join hot dynarec blocks into traces\n"
+    "--jit-disk-cache[=DIR]\treuse dynarec translations across runs "
+    "(default DIR: <app data>/jitcache)\n"
+    "--fastmem\taccess RDRAM through a reserved host address range\n"
+    "--no-fastmem\tcheck every guest access on the bus (default)\n"
     "--upscale=[1|2|4|8]\tParallel-RDP resolution multiplier (default 4)\n"
+    "--speed=[unlimited|N.x]\trun at N times real time, or unpaced "
+    "(default 1x; --test and --fields default to unlimited)\n"
+    "--rsp-lazy\tdefer RSP tasks until the CPU observes them\n"
+    "--no-rsp-lazy\trun RSP tasks as soon as they start (default)\n"
+    "--rsp-jit\trecompile RSP microcode to x86-64\n"
+    "--no-rsp-jit\tinterpret RSP microcode (default)\n"
+    "--no-rsp-simd\tuse the scalar RSP vector unit even in SIMD builds\n"
+    "--rsp-threaded\trun RSP tasks on a worker thread next to the CPU\n"
+    "--rsp-threaded-check\tsame, replaying each worker run to verify it\n"
+    "--no-rsp-threaded\trun RSP tasks on the CPU thread (default)\n"
+    "--audio-hle\trun standard audio ucode tasks natively\n"
+    "--audio-hle-compare\tsame, but keep LLE and report where HLE differs "
+    "(--test and --fields runs then fail)\n"
+    "--no-audio-hle\trun audio tasks on the emulated RSP (default)\n"
+    "--record-movie=FILE\trecord every controller read to FILE\n"
+    "--movie-state=STATE\tstart the recording from a save state file\n"
+    "--play-movie=FILE\treplay controller reads from FILE\n"
+    "--load-state=FILE\tstart from a save state file\n"
     "--frame-interp\tenable frame interpolation (default: optical flow)\n"
     "--no-frame-interp\tdisable frame interpolation (default)\n"
     "--headless\tno window / no Vulkan present\n"
+    "--fields=N\theadless: stop after N VI fields and log a hash of RDRAM "
+    "and SP memory\n"
+    "--save-state=FILE\twith --fields: write a save state file on stopping\n"
+    "--soft-rdp\theadless: rasterize RDP commands on the CPU\n"
+    "--dump-frames=DIR\theadless: write each VI field to DIR as PPM "
+    "(implies --soft-rdp)\n"
+    "--input-script=FILE\theadless: drive controller 1 from FILE, one "
+    "`FIELD BUTTONS [X Y]` line per change (BUTTONS in hex)\n"
     "--test\trun n64-tests (implies --headless)\n"
     "--debug\tenable interactive debugger\n"
     "--break=ADDR\tbreak when PC hits ADDR (implies --debug)\n"
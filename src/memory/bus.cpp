@@ -2,6 +2,7 @@
 #include "cpu/cpu.h"
 #include "cpu/jit/invalidate_hook.h"
 #include "debugger/debugger.h"
+#include "memory/fastmem.h"
 #include "memory/memory.h"
 #include "memory/memory_map.h"
 #include "mmio/ai.h"
@@ -122,8 +123,11 @@ template <typename Wire> Wire read_paddr(uint32_t paddr) {
 
     if (paddr <= PHYS_RDRAM_MEM_END) {
         Rdp::check_framebuffers(paddr, static_cast<uint32_t>(sizeof(Wire)));
+        g_rsp().sync_rdram(paddr);
         return Utils::read_from_byte_array<Wire>(g_memory().get_rdram(), paddr);
     }
+    // Any device access can observe (or feed) a deferred RSP task.
+    g_rsp().sync();
 
     switch (phys_map()[paddr >> 16]) {
     case PhysMap::SpMem:
@@ -330,23 +334,24 @@ template <typename Wire> void write_paddr(uint32_t paddr, Wire value) {
 
     if (paddr <= PHYS_RDRAM_MEM_END) {
         Rdp::on_rdram_write(paddr, static_cast<uint32_t>(sizeof(Wire)));
+        g_rsp().sync_rdram_write();
         if constexpr (wire8) {
             Utils::write_to_byte_array8(g_memory().get_rdram(), paddr, value);
-            maybe_invalidate_code(paddr, 1);
         } else if constexpr (wire16) {
             Utils::write_to_byte_array16(g_memory().get_rdram(), paddr, value);
-            maybe_invalidate_code(paddr, 2);
         } else if constexpr (wire32) {
             Utils::write_to_byte_array32(g_memory().get_rdram(), paddr, value);
-            maybe_invalidate_code(paddr, 4);
         } else if constexpr (wire64) {
             Utils::write_to_byte_array64(g_memory().get_rdram(), paddr, value);
-            maybe_invalidate_code(paddr, 8);
         } else {
             static_assert(always_false<Wire>);
         }
+        // With fastmem, pages without code are known and skip the probe.
+        if (Fastmem::may_hold_code(paddr))
+            maybe_invalidate_code(paddr, static_cast<uint32_t>(sizeof(Wire)));
         return;
     }
+    g_rsp().sync();
 
     switch (phys_map()[paddr >> 16]) {
     case PhysMap::SpMem:
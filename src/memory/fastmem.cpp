@@ -0,0 +1,233 @@
+#include "memory/fastmem.h"
+#include "memory/memory_map.h"
+#include "utils/log.h"
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#if !defined(_WIN32)
+#include <csignal>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+#if !defined(_WIN32) && defined(__x86_64__) &&                                 \
+    (defined(__linux__) || defined(__APPLE__))
+#define N64_FASTMEM_HOST 1
+#else
+#define N64_FASTMEM_HOST 0
+#endif
+
+namespace N64 {
+namespace Fastmem {
+
+namespace {
+
+constexpr uint32_t PAGE_SHIFT = 12;
+constexpr uint32_t PAGE_SIZE = 1u << PAGE_SHIFT;
+constexpr uint32_t RDRAM_PAGES = RDRAM_SIZE >> PAGE_SHIFT;
+// 4 GiB of paddr space plus slack for an 8-byte access at 0xFFFFFFFF.
+constexpr size_t ARENA_SIZE = (size_t{1} << 32) + 0x10000;
+
+struct FastmemState {
+    int rdram_fd = -1;
+    size_t rdram_size = 0;
+    uint8_t *arena = nullptr;
+    bool enabled = false;
+    std::array<uint8_t, RDRAM_PAGES> owners{};
+};
+
+FastmemState &fastmem() {
+    static FastmemState s;
+    return s;
+}
+
+// Read by the signal handler, so kept outside FastmemState.
+std::atomic<uintptr_t> g_arena{0};
+std::atomic<FaultFixup> g_fixup{nullptr};
+
+#if N64_FASTMEM_HOST
+
+struct sigaction g_old_segv;
+struct sigaction g_old_bus;
+
+uintptr_t &fault_pc(void *ctx) {
+    auto *uc = static_cast<ucontext_t *>(ctx);
+#if defined(__APPLE__)
+    return reinterpret_cast<uintptr_t &>(uc->uc_mcontext->__ss.__rip);
+#else
+    return reinterpret_cast<uintptr_t &>(uc->uc_mcontext.gregs[REG_RIP]);
+#endif
+}
+
+void on_fault(int sig, siginfo_t *info, void *ctx) {
+    const auto addr = reinterpret_cast<uintptr_t>(info->si_addr);
+    const uintptr_t arena = g_arena.load(std::memory_order_relaxed);
+    const FaultFixup fixup = g_fixup.load(std::memory_order_relaxed);
+    if (arena != 0 && fixup && addr - arena < ARENA_SIZE) {
+        uintptr_t &pc = fault_pc(ctx);
+        if (const uintptr_t resume = fixup(pc)) {
+            pc = resume;
+            return;
+        }
+    }
+    // Not a fastmem access: hand it to whoever was installed before us.
+    const struct sigaction &old = sig == SIGBUS ? g_old_bus : g_old_segv;
+    if (old.sa_flags & SA_SIGINFO) {
+        old.sa_sigaction(sig, info, ctx);
+    } else if (old.sa_handler == SIG_DFL || old.sa_handler == SIG_IGN) {
+        // Returning re-runs the access, which now takes the default action.
+        sigaction(sig, &old, nullptr);
+    } else {
+        old.sa_handler(sig);
+    }
+}
+
+bool install_handler() {
+    struct sigaction sa {};
+    sa.sa_sigaction = &on_fault;
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&sa.sa_mask);
+    return sigaction(SIGSEGV, &sa, &g_old_segv) == 0 &&
+           sigaction(SIGBUS, &sa, &g_old_bus) == 0;
+}
+
+int create_shared_fd(size_t size) {
+#if defined(__linux__)
+    const int fd = memfd_create("kamo64-rdram", MFD_CLOEXEC);
+#else
+    char name[64];
+    std::snprintf(name, sizeof(name), "/kamo64-rdram-%d",
+                  static_cast<int>(getpid()));
+    const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0)
+        shm_unlink(name);
+#endif
+    if (fd < 0)
+        return -1;
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool reserve_arena() {
+    auto &s = fastmem();
+    if (s.rdram_fd < 0) {
+        Utils::warn("Fastmem: RDRAM is not in shared memory");
+        return false;
+    }
+    if (sysconf(_SC_PAGESIZE) != static_cast<long>(PAGE_SIZE)) {
+        Utils::warn("Fastmem: needs 4 KiB host pages");
+        return false;
+    }
+    void *arena = mmap(nullptr, ARENA_SIZE, PROT_NONE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (arena == MAP_FAILED) {
+        Utils::warn("Fastmem: could not reserve the guest address space");
+        return false;
+    }
+    void *view = mmap(arena, s.rdram_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_FIXED, s.rdram_fd, 0);
+    if (view == MAP_FAILED || !install_handler()) {
+        Utils::warn("Fastmem: could not map RDRAM into the arena");
+        munmap(arena, ARENA_SIZE);
+        return false;
+    }
+    s.arena = static_cast<uint8_t *>(arena);
+    g_arena.store(reinterpret_cast<uintptr_t>(arena));
+    return true;
+}
+
+void protect_page(uint32_t page, bool read_only) {
+    mprotect(fastmem().arena + (size_t{page} << PAGE_SHIFT), PAGE_SIZE,
+             read_only ? PROT_READ : PROT_READ | PROT_WRITE);
+}
+
+#else
+
+bool reserve_arena() {
+    Utils::warn("Fastmem: not supported on this host");
+    return false;
+}
+
+void protect_page(uint32_t, bool) {}
+
+#endif
+
+} // namespace
+
+uint8_t *alloc_rdram(size_t size) {
+    auto &s = fastmem();
+    s.rdram_size = size;
+#if N64_FASTMEM_HOST
+    s.rdram_fd = create_shared_fd(size);
+    if (s.rdram_fd >= 0) {
+        void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         s.rdram_fd, 0);
+        if (mem != MAP_FAILED)
+            return static_cast<uint8_t *>(mem);
+        close(s.rdram_fd);
+        s.rdram_fd = -1;
+    }
+#endif
+    return static_cast<uint8_t *>(std::calloc(size, 1));
+}
+
+bool set_enabled(bool on) {
+    auto &s = fastmem();
+    if (!on) {
+        if (s.enabled)
+            clear_code_pages(static_cast<CodeOwner>(CODE_JIT | CODE_DECODE));
+        s.enabled = false;
+        return true;
+    }
+    if (!s.enabled) {
+        if (!s.arena && !reserve_arena())
+            return false;
+        s.enabled = true;
+        Utils::debug("Fastmem: guest address space at {}",
+                     static_cast<void *>(s.arena));
+    }
+    return true;
+}
+
+bool enabled() { return fastmem().enabled; }
+
+uint8_t *base() { return fastmem().arena; }
+
+void set_code_page(uint32_t paddr, CodeOwner owner, bool on) {
+    auto &s = fastmem();
+    const uint32_t page = paddr >> PAGE_SHIFT;
+    if (!s.enabled || page >= RDRAM_PAGES)
+        return;
+    const uint8_t was = s.owners[page];
+    const uint8_t now = on ? was | owner : was & ~owner;
+    s.owners[page] = now;
+    if ((was != 0) != (now != 0))
+        protect_page(page, now != 0);
+}
+
+void clear_code_pages(CodeOwner owner) {
+    auto &s = fastmem();
+    for (uint32_t page = 0; page < RDRAM_PAGES; page++) {
+        if (s.owners[page] & owner)
+            set_code_page(page << PAGE_SHIFT, owner, false);
+    }
+}
+
+bool may_hold_code(uint32_t paddr) {
+    const auto &s = fastmem();
+    if (!s.enabled)
+        return true;
+    const uint32_t page = paddr >> PAGE_SHIFT;
+    return page >= RDRAM_PAGES || s.owners[page] != 0;
+}
+
+void set_fault_fixup(FaultFixup fixup) { g_fixup.store(fixup); }
+
+} // namespace Fastmem
+} // namespace N64
@@ -1,7 +1,11 @@
 ﻿#include "memory/memory.h"
+#include "cpu/jit/invalidate_hook.h"
+#include "memory/fastmem.h"
 #include "memory/memory_map.h"
+#include "rdp/rdp_core.h"
 #include "utils/log.h"
 #include <algorithm>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 
@@ -12,6 +16,8 @@ namespace {
 
 namespace fs = std::filesystem;
 
+constexpr uint32_t STATE_PAGE_SIZE = 0x1000;
+
 // Make a ROM header title safe as a single path component.
 std::string sanitize_game_folder_name(std::string name) {
     for (char &c : name) {
@@ -34,13 +40,71 @@ std::string sanitize_game_folder_name(std::string name) {
 
 } // namespace
 
-Memory::Memory() : rdram({}), sram({}) { rdram.assign(RDRAM_SIZE, 0); }
+Memory::Memory()
+    : rdram(Fastmem::alloc_rdram(RDRAM_SIZE), RDRAM_SIZE), sram({}) {}
 
 void Memory::reset() {
     Utils::debug("Resetting Memory (RDRAM)");
     ri.reset();
 }
 
+void Memory::save_state(Utils::StateWriter &w) const {
+    ri.save_state(w);
+    w.bytes(rdram.data(), rdram.size());
+    w.pod(static_cast<uint32_t>(sram.size()));
+    w.bytes(sram.data(), sram.size());
+}
+
+void Memory::load_state(Utils::StateReader &r) {
+    ri.load_state(r);
+    const auto src = r.view(rdram.size());
+    uint32_t sram_size = 0;
+    r.pod(sram_size);
+    if (sram_size != sram.size())
+        r.fail();
+    r.bytes(sram.data(), sram.size());
+    if (!r.ok())
+        return;
+
+    // Let the RDP finish writing into RDRAM before it is replaced.
+    Rdp::check_framebuffers(0, RDRAM_SIZE);
+
+    // Copy page-wise, skipping identical pages, and report each changed run
+    // once so JIT / decode caches only drop what actually changed.
+    uint32_t run_start = 0;
+    uint32_t run_len = 0;
+    const auto flush_run = [&] {
+        if (run_len == 0)
+            return;
+        maybe_invalidate_code(run_start, run_len);
+        Rdp::on_rdram_write(run_start, run_len);
+        run_len = 0;
+    };
+    for (uint32_t a = 0; a < RDRAM_SIZE; a += STATE_PAGE_SIZE) {
+        if (std::memcmp(rdram.data() + a, src.data() + a, STATE_PAGE_SIZE) ==
+            0) {
+            flush_run();
+            continue;
+        }
+        std::memcpy(rdram.data() + a, src.data() + a, STATE_PAGE_SIZE);
+        if (run_len == 0)
+            run_start = a;
+        run_len += STATE_PAGE_SIZE;
+    }
+    flush_run();
+}
+
+void Memory::check_state(Utils::StateReader &r) const {
+    RI scratch;
+    scratch.load_state(r);
+    r.view(rdram.size());
+    uint32_t sram_size = 0;
+    r.pod(sram_size);
+    if (sram_size != sram.size())
+        r.fail();
+    r.view(sram.size());
+}
+
 void Memory::set_data_dir(const std::string &dir) {
     data_dir = dir.empty() ? "." : dir;
 }
@@ -113,7 +177,7 @@ void Memory::persist_sram() {
 
 Memory &Memory::get_instance() { return instance; }
 
-std::vector<uint8_t> &Memory::get_rdram() { return rdram; }
+const std::span<uint8_t> &Memory::get_rdram() { return rdram; }
 
 std::vector<uint8_t> &Memory::get_sram() { return sram; }
 
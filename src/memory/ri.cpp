@@ -60,5 +60,21 @@ void RI::write_paddr32(uint32_t paddr, uint32_t value) {
     }
 }
 
+void RI::save_state(Utils::StateWriter &w) const {
+    w.pod(reg_mode);
+    w.pod(reg_config);
+    w.pod(reg_current_load);
+    w.pod(reg_select);
+    w.pod(reg_refresh);
+}
+
+void RI::load_state(Utils::StateReader &r) {
+    r.pod(reg_mode);
+    r.pod(reg_config);
+    r.pod(reg_current_load);
+    r.pod(reg_select);
+    r.pod(reg_refresh);
+}
+
 } // namespace Memory
 } // namespace N64
@@ -168,6 +168,10 @@ uint32_t Rom::get_cic_seed() const {
     return CIC_SEEDS[static_cast<uint32_t>(cic)];
 }
 
+uint32_t Rom::get_crc1() const { return read_offset32(0x10); }
+
+uint32_t Rom::get_crc2() const { return read_offset32(0x14); }
+
 std::vector<uint8_t> &Rom::get_raw_data() { return rom; }
 
 std::string Rom::get_image_name() const {
@@ -106,9 +106,8 @@ void AI::start_next_dma() {
     g_mi().get_reg_intr().ai = 1;
     N64System::check_interrupt();
 
-    g_scheduler().set_timer(
-        dma_duration_cycles,
-        N64System::Event{&AIScheduler::on_dma_complete});
+    g_scheduler().set_timer(dma_duration_cycles,
+                            N64System::EventKind::AiDmaComplete);
 
     // Host output after MMIO side effects (may block briefly for audio sync).
     push_dma_audio(dma_addr[0], dma_length[0]);
@@ -232,6 +231,33 @@ AI &AI::get_instance() { return instance; }
 
 AI AI::instance{};
 
+void AI::save_state(Utils::StateWriter &w) const {
+    w.pod(dma_addr);
+    w.pod(dma_length);
+    w.pod(fifo_count);
+    w.pod(next_dram_addr);
+    w.pod(dma_enable);
+    w.pod(dacrate);
+    w.pod(bitrate);
+    w.pod(delayed_carry);
+    w.pod(dma_start_time);
+    w.pod(dma_duration_cycles);
+}
+
+void AI::load_state(Utils::StateReader &r) {
+    r.pod(dma_addr);
+    r.pod(dma_length);
+    r.pod(fifo_count);
+    r.pod(next_dram_addr);
+    r.pod(dma_enable);
+    r.pod(dacrate);
+    r.pod(bitrate);
+    r.pod(delayed_carry);
+    r.pod(dma_start_time);
+    r.pod(dma_duration_cycles);
+    Audio::set_frequency_from_dacrate(dacrate);
+}
+
 } // namespace AI
 } // namespace Mmio
 
@@ -9,9 +9,11 @@ namespace {
 std::mutex g_mu;
 std::array<Mmio::N64ControllerState, kMaxControllers> g_states{};
 HostPollFn g_host_poll = nullptr;
+PifReadHookFn g_pif_read_hook = nullptr;
 } // namespace
 
 void set_host_poll(HostPollFn fn) { g_host_poll = fn; }
+void set_pif_read_hook(PifReadHookFn fn) { g_pif_read_hook = fn; }
 
 void poll_host() {
     if (g_host_poll)
@@ -32,5 +34,11 @@ Mmio::N64ControllerState get_controller_state(int channel) {
     return g_states[static_cast<size_t>(channel)];
 }
 
+Mmio::N64ControllerState read_for_pif(int channel) {
+    poll_host();
+    const Mmio::N64ControllerState live = get_controller_state(channel);
+    return g_pif_read_hook ? g_pif_read_hook(channel, live) : live;
+}
+
 } // namespace Input
 } // namespace N64
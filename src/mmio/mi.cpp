@@ -107,6 +107,20 @@ void MI::write_paddr32(uint32_t paddr, uint32_t value) {
 
 MI MI::instance{};
 
+void MI::save_state(Utils::StateWriter &w) const {
+    w.pod(reg_mode);
+    w.pod(reg_version);
+    w.pod(reg_intr);
+    w.pod(reg_intr_mask);
+}
+
+void MI::load_state(Utils::StateReader &r) {
+    r.pod(reg_mode);
+    r.pod(reg_version);
+    r.pod(reg_intr);
+    r.pod(reg_intr_mask);
+}
+
 } // namespace MI
 } // namespace Mmio
 
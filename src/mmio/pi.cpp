@@ -6,8 +6,9 @@
 #include "n64_system/interrupt.h"
 #include "n64_system/scheduler.h"
 #include "rdp/rdp_core.h"
-#include "utils/byte_array.h"
+#include "utils/dma_copy.h"
 #include "utils/log.h"
+#include <algorithm>
 
 namespace N64 {
 namespace Mmio {
@@ -141,23 +142,22 @@ void PI::dma_write() {
 
     if (!sram.empty() && PHYS_SRAM_BASE <= cart_addr &&
         cart_addr < PHYS_ROM_BASE) {
-        const uint32_t sram_mask = static_cast<uint32_t>(sram.size() - 1);
-        for (uint32_t i = 0; i < length; i++) {
-            const uint32_t sram_offs =
-                ((cart_addr - PHYS_SRAM_BASE) + i) & sram_mask;
-            // SRAM is logical N64 byte order; RDRAM is host-endian (addr^3).
-            Utils::write_to_byte_array8(rdram, (dram_addr + i) & RDRAM_SIZE_MASK,
-                                       sram[sram_offs]);
-        }
+        Utils::dma_copy_wrapped(rdram, dram_addr, Utils::DmaLayout::HostWords,
+                                sram, cart_addr - PHYS_SRAM_BASE,
+                                Utils::DmaLayout::BigEndian, length);
         Utils::debug("DMA Write: SRAM {:#010x} -> dram {:#010x} (len = {:#010x})",
                      cart_addr, dram_addr, length);
     } else if (0x1000'0000 <= cart_addr && cart_addr <= 0xFFFF'FFFF) {
         const uint32_t cart_offset = cart_addr - 0x1000'0000;
-        for (uint32_t i = 0; i < length; i++) {
-            Utils::write_to_byte_array8(
-                rdram, (dram_addr + i) & RDRAM_SIZE_MASK,
-                g_memory().rom.read_offset8(cart_offset + i));
-        }
+        // Reads past the end of the ROM space return zero rather than
+        // mirroring the start of the cartridge.
+        const uint32_t in_rom =
+            std::min(length, Memory::ROM_SIZE - cart_offset);
+        Utils::dma_copy_wrapped(rdram, dram_addr, Utils::DmaLayout::HostWords,
+                                g_memory().rom.get_raw_data(), cart_offset,
+                                Utils::DmaLayout::HostWords, in_rom);
+        for (uint32_t i = in_rom; i < length; i++)
+            rdram[(dram_addr + i) & RDRAM_SIZE_MASK] = 0;
 
         Utils::debug("DMA Write: cart offset {:#010x} -> dram offset {:#010x} "
                      "(len = {:#010x})",
@@ -175,9 +175,8 @@ void PI::dma_write() {
     reg_status |= PiStatusFlags::DMA_BUSY;
     reg_dram_addr = dram_addr + length;
     reg_cart_addr = cart_addr + length;
-    g_scheduler().set_timer(
-        length / 8,
-        N64System::Event{&PIScheduler::on_dma_write_completed});
+    g_scheduler().set_timer(length / 8,
+                            N64System::EventKind::PiDmaWriteComplete);
 }
 
 void PIScheduler::on_dma_write_completed() {
@@ -207,13 +206,10 @@ void PI::dma_read() {
     // RDRAM -> cartridge (typically SRAM)
     if (PHYS_SRAM_BASE <= cart_addr && cart_addr < PHYS_ROM_BASE) {
         if (!sram.empty()) {
-            const uint32_t sram_mask = static_cast<uint32_t>(sram.size() - 1);
-            for (uint32_t i = 0; i < length; i++) {
-                const uint32_t sram_offs =
-                    ((cart_addr - PHYS_SRAM_BASE) + i) & sram_mask;
-                sram[sram_offs] = Utils::read_from_byte_array8(
-                    rdram, (dram_addr + i) & RDRAM_SIZE_MASK);
-            }
+            Utils::dma_copy_wrapped(sram, cart_addr - PHYS_SRAM_BASE,
+                                    Utils::DmaLayout::BigEndian, rdram,
+                                    dram_addr, Utils::DmaLayout::HostWords,
+                                    length);
             Utils::debug(
                 "DMA Read: dram {:#010x} -> SRAM {:#010x} (len = {:#010x})",
                 dram_addr, cart_addr, length);
@@ -233,7 +229,7 @@ void PI::dma_read() {
     reg_dram_addr = dram_addr + length;
     reg_cart_addr = cart_addr + length;
     g_scheduler().set_timer(length / 8,
-                            N64System::Event{&PIScheduler::on_dma_read_completed});
+                            N64System::EventKind::PiDmaReadComplete);
 }
 
 void PIScheduler::on_dma_read_completed() {
@@ -246,6 +242,38 @@ void PIScheduler::on_dma_read_completed() {
 
 PI PI::instance{};
 
+void PI::save_state(Utils::StateWriter &w) const {
+    w.pod(reg_dram_addr);
+    w.pod(reg_cart_addr);
+    w.pod(reg_rd_len);
+    w.pod(reg_wr_len);
+    w.pod(reg_status);
+    w.pod(reg_bsd_dom1_lat);
+    w.pod(reg_bsd_dom1_pwd);
+    w.pod(reg_bsd_dom1_pgs);
+    w.pod(reg_bsd_dom1_rls);
+    w.pod(reg_bsd_dom2_lat);
+    w.pod(reg_bsd_dom2_pwd);
+    w.pod(reg_bsd_dom2_pgs);
+    w.pod(reg_bsd_dom2_rls);
+}
+
+void PI::load_state(Utils::StateReader &r) {
+    r.pod(reg_dram_addr);
+    r.pod(reg_cart_addr);
+    r.pod(reg_rd_len);
+    r.pod(reg_wr_len);
+    r.pod(reg_status);
+    r.pod(reg_bsd_dom1_lat);
+    r.pod(reg_bsd_dom1_pwd);
+    r.pod(reg_bsd_dom1_pgs);
+    r.pod(reg_bsd_dom1_rls);
+    r.pod(reg_bsd_dom2_lat);
+    r.pod(reg_bsd_dom2_pwd);
+    r.pod(reg_bsd_dom2_pgs);
+    r.pod(reg_bsd_dom2_rls);
+}
+
 } // namespace PI
 } // namespace Mmio
 
@@ -439,7 +439,7 @@ void Pif::process_controller_command(int channel, uint8_t *cmd) {
             cmd[6] = 0;
         } break;
         case JoyBusControllerType::N64_CONTROLLER: {
-            const N64ControllerState s = poll_n64_controller();
+            const N64ControllerState s = poll_n64_controller(channel);
             cmd[3] = s.byte1;
             cmd[4] = s.byte2;
             cmd[5] = s.joy_x;
@@ -514,12 +514,10 @@ void Pif::process_controller_command(int channel, uint8_t *cmd) {
     }
 }
 
-N64ControllerState Pif::poll_n64_controller() const {
+N64ControllerState Pif::poll_n64_controller(int channel) const {
     // Refresh host input at Joybus read time so we are not stuck with the
     // previous VI field's snapshot (noticeable lag even without frame interp).
-    Input::poll_host();
-    // TODO: Support multiple controllers (channel).
-    const N64ControllerState ret = Input::get_controller_state(0);
+    const N64ControllerState ret = Input::read_for_pif(channel);
     Utils::debug("byte1 {:#10b}", ret.byte1);
     Utils::debug("byte2 {:#10b}", ret.byte2);
     Utils::debug("joy_x {:#10b}", ret.joy_x);
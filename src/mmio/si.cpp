@@ -1,9 +1,11 @@
 #include "mmio/si.h"
+#include "cpu/jit/invalidate_hook.h"
 #include "memory/memory.h"
+#include "memory/memory_map.h"
 #include "mmio/mi.h"
 #include "n64_system/interrupt.h"
 #include "rdp/rdp_core.h"
-#include "utils/byte_array.h"
+#include "utils/dma_copy.h"
 #include "utils/log.h"
 
 namespace N64 {
@@ -27,9 +29,11 @@ void SI::dma_from_pif_to_dram() {
     dma_busy = true;
     pif.control_write();
     Rdp::on_rdram_write(reg_dram_addr, 64);
-    for (int i = 0; i < 64; i++)
-        Utils::write_to_byte_array8(g_memory().get_rdram(), reg_dram_addr + i,
-                                   pif.ram[i]);
+    // PIF RAM is big-endian; RDRAM is host-endian.
+    Utils::dma_copy_wrapped(g_memory().get_rdram(), reg_dram_addr,
+                            Utils::DmaLayout::HostWords, pif.ram, 0,
+                            Utils::DmaLayout::BigEndian, 64);
+    maybe_invalidate_code(reg_dram_addr & RDRAM_SIZE_MASK, 64);
     // TODO: should use scheduler?
     dma_busy = false;
     Utils::debug("SI: DMA complete");
@@ -44,11 +48,9 @@ void SI::dma_from_dram_to_pif() {
                  reg_dram_addr);
     dma_busy = true;
     Rdp::check_framebuffers(reg_dram_addr, 64);
-    for (int i = 0; i < 64; i++) {
-        // Utils::debug("i = {}", i);
-        pif.ram[i] = Utils::read_from_byte_array8(g_memory().get_rdram(),
-                                                 reg_dram_addr + i);
-    }
+    Utils::dma_copy_wrapped(pif.ram, 0, Utils::DmaLayout::BigEndian,
+                            g_memory().get_rdram(), reg_dram_addr,
+                            Utils::DmaLayout::HostWords, 64);
     pif.control_write();
     // TODO: should use scheduler?
     dma_busy = false;
@@ -108,6 +110,22 @@ void SI::write_paddr32(uint32_t paddr, uint32_t value) {
 
 SI SI::instance{};
 
+void SI::save_state(Utils::StateWriter &w) const {
+    w.pod(reg_dram_addr);
+    w.pod(reg_pif_addr);
+    w.pod(reg_status);
+    w.pod(dma_busy);
+    w.pod(pif.ram);
+}
+
+void SI::load_state(Utils::StateReader &r) {
+    r.pod(reg_dram_addr);
+    r.pod(reg_pif_addr);
+    r.pod(reg_status);
+    r.pod(dma_busy);
+    r.pod(pif.ram);
+}
+
 } // namespace SI
 } // namespace Mmio
 
@@ -176,6 +176,44 @@ int VI::get_num_fields() const {
 
 VI VI::instance{};
 
+void VI::save_state(Utils::StateWriter &w) const {
+    w.pod(reg_status);
+    w.pod(reg_origin);
+    w.pod(reg_width);
+    w.pod(reg_intr);
+    w.pod(reg_current);
+    w.pod(reg_burst);
+    w.pod(reg_vsync);
+    w.pod(reg_hsync);
+    w.pod(reg_hsync_leap);
+    w.pod(reg_h_video);
+    w.pod(reg_v_video);
+    w.pod(reg_v_burst);
+    w.pod(reg_x_scale);
+    w.pod(reg_y_scale);
+    w.pod(num_half_lines);
+    w.pod(cycles_per_half_line);
+}
+
+void VI::load_state(Utils::StateReader &r) {
+    r.pod(reg_status);
+    r.pod(reg_origin);
+    r.pod(reg_width);
+    r.pod(reg_intr);
+    r.pod(reg_current);
+    r.pod(reg_burst);
+    r.pod(reg_vsync);
+    r.pod(reg_hsync);
+    r.pod(reg_hsync_leap);
+    r.pod(reg_h_video);
+    r.pod(reg_v_video);
+    r.pod(reg_v_burst);
+    r.pod(reg_x_scale);
+    r.pod(reg_y_scale);
+    r.pod(num_half_lines);
+    r.pod(cycles_per_half_line);
+}
+
 } // namespace VI
 } // namespace Mmio
 
@@ -21,22 +21,39 @@ SoftTlbEntry *soft_tlb_store_table() { return g_store.data(); }
 
 void soft_tlb_invalidate() {
     for (auto &e : g_load)
-        e.vpn = 0xFFFFFFFFu;
+        e.tag = 0xFFFFFFFFu;
     for (auto &e : g_store)
-        e.vpn = 0xFFFFFFFFu;
+        e.tag = 0xFFFFFFFFu;
+}
+
+void soft_tlb_invalidate_range(uint32_t vaddr, uint64_t length) {
+    if (length == 0)
+        return;
+    const uint64_t first = vaddr >> 12;
+    const uint64_t last = (uint64_t{vaddr} + length - 1) >> 12;
+    // Large pages cover every slot anyway.
+    if (last - first >= SOFT_TLB_SIZE) {
+        soft_tlb_invalidate();
+        return;
+    }
+    for (uint64_t vpn = first; vpn <= last; vpn++) {
+        for (SoftTlbEntry *table : {g_load.data(), g_store.data()}) {
+            SoftTlbEntry &e = table[vpn & SOFT_TLB_MASK];
+            if ((e.tag & SOFT_TLB_VPN_MASK) == (vpn & SOFT_TLB_VPN_MASK))
+                e.tag = 0xFFFFFFFFu;
+        }
+    }
 }
 
 void soft_tlb_note_load(uint32_t vaddr, uint32_t paddr) {
-    const uint32_t vpn = vaddr >> 12;
-    SoftTlbEntry &e = g_load[vpn & SOFT_TLB_MASK];
-    e.vpn = vpn;
+    SoftTlbEntry &e = g_load[(vaddr >> 12) & SOFT_TLB_MASK];
+    e.tag = soft_tlb_tag(vaddr);
     e.pa_page = paddr & ~0xFFFu;
 }
 
 void soft_tlb_note_store(uint32_t vaddr, uint32_t paddr) {
-    const uint32_t vpn = vaddr >> 12;
-    SoftTlbEntry &e = g_store[vpn & SOFT_TLB_MASK];
-    e.vpn = vpn;
+    SoftTlbEntry &e = g_store[(vaddr >> 12) & SOFT_TLB_MASK];
+    e.tag = soft_tlb_tag(vaddr);
     e.pa_page = paddr & ~0xFFFu;
 }
 
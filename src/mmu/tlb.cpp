@@ -1,10 +1,26 @@
 #include "mmu/tlb.h"
 #include "mmu/soft_tlb.h"
 #include "utils/log.h"
+#include <bit>
 
 namespace N64 {
 namespace Mmu {
 
+namespace {
+// PageMask of each size class TLB::write_entry() produces.
+constexpr uint32_t size_mask(int size) {
+    return ((1u << (2 * size)) - 1) << 13;
+}
+
+int size_class(uint32_t page_mask) {
+    for (int size = 0; size < 7; size++) {
+        if (page_mask == size_mask(size))
+            return size;
+    }
+    return -1;
+}
+} // namespace
+
 TLB::TLB() {
     for (int i = 0; i < 32; i++) {
         entries[i] = TLBEntry();
@@ -16,9 +32,78 @@ void TLB::reset() {
     for (int i = 0; i < 32; i++) {
         entries[i] = TLBEntry();
     }
+    rebuild_index();
+    soft_tlb_invalidate();
+}
+
+void TLB::save_state(Utils::StateWriter &w) const {
+    w.pod(entries);
+    w.pod(error);
+}
+
+void TLB::load_state(Utils::StateReader &r) {
+    r.pod(entries);
+    r.pod(error);
+    rebuild_index();
     soft_tlb_invalidate();
 }
 
+uint32_t TLB::vpn_bucket(uint64_t vpn, int size) {
+    // Fold in the region bits so KUSEG and KSEG3 pages do not collide.
+    uint64_t h = (vpn >> (13 + 2 * size)) ^ (vpn >> 40);
+    h ^= h >> 6;
+    return static_cast<uint32_t>(h) & (VPN_BUCKETS - 1);
+}
+
+void TLB::index_add(int index) {
+    const TLBEntry &entry = entries[index];
+    const uint32_t bit = 1u << index;
+    const int size = size_class(entry.page_mask);
+    if (size < 0) {
+        odd_masks |= bit;
+        return;
+    }
+    const uint64_t vpn = calculate_vpn(entry.entry_hi.raw, entry.page_mask);
+    by_vpn[size][vpn_bucket(vpn, size)] |= bit;
+    by_size[size] |= bit;
+}
+
+void TLB::index_remove(int index) {
+    const uint32_t bit = 1u << index;
+    odd_masks &= ~bit;
+    for (int size = 0; size < PAGE_SIZES; size++) {
+        if (!(by_size[size] & bit))
+            continue;
+        by_size[size] &= ~bit;
+        for (uint32_t &bucket : by_vpn[size])
+            bucket &= ~bit;
+    }
+}
+
+void TLB::rebuild_index() {
+    for (auto &buckets : by_vpn) {
+        for (uint32_t &bucket : buckets)
+            bucket = 0;
+    }
+    for (uint32_t &size : by_size)
+        size = 0;
+    odd_masks = 0;
+    for (int i = 0; i < 32; i++) {
+        if (entries[i].valid())
+            index_add(i);
+    }
+}
+
+void TLB::invalidate_soft_tlb(const TLBEntry &entry) {
+    if (!entry.valid())
+        return;
+    // An even/odd pair of pages; the soft TLB only holds 32-bit VAs.
+    const uint64_t pair = (uint64_t{entry.page_mask | 0x1FFFu}) + 1;
+    const uint32_t base = static_cast<uint32_t>(entry.entry_hi.raw) &
+                          ~static_cast<uint32_t>(pair - 1);
+    soft_tlb_invalidate_range(base, pair);
+}
+
 uint64_t TLB::sign_extend_vaddr32(uint32_t vaddr) {
     return static_cast<uint64_t>(static_cast<int32_t>(vaddr));
 }
@@ -108,6 +193,9 @@ void TLB::write_entry(bool random) {
                  cop0.entry_lo0.global && cop0.entry_lo1.global);
 
     TLBEntry &entry = entries[index];
+    invalidate_soft_tlb(entry);
+    if (entry.valid())
+        index_remove(index);
     entry.is_valid = true;
     entry.page_mask = page_mask;
     entry.entry_hi.raw = cop0.entry_hi.raw;
@@ -116,7 +204,9 @@ void TLB::write_entry(bool random) {
     entry.entry_lo0.raw = cop0.entry_lo0.raw & 0x03FFFFFE;
     entry.entry_lo1.raw = cop0.entry_lo1.raw & 0x03FFFFFE;
     entry.global = cop0.entry_lo0.global && cop0.entry_lo1.global;
-    soft_tlb_invalidate();
+    index_add(index);
+    // The new mapping may shadow pages another entry had cached.
+    invalidate_soft_tlb(entry);
 }
 
 void TLB::read_entry() {
@@ -143,11 +233,18 @@ void TLB::probe_index() {
 }
 
 std::optional<int> TLB::lookup_tlb_entry_index(uint64_t vaddr) {
-    // R4300's TLB is fully associative.
-    for (int i = 0; i < 32; i++) {
+    // R4300's TLB is fully associative: check every entry the index says
+    // could match, lowest first as a full scan would.
+    uint32_t candidates = odd_masks;
+    for (int size = 0; size < PAGE_SIZES; size++) {
+        if (by_size[size]) {
+            const uint64_t vpn = calculate_vpn(vaddr, size_mask(size));
+            candidates |= by_vpn[size][vpn_bucket(vpn, size)];
+        }
+    }
+    for (; candidates; candidates &= candidates - 1) {
+        const int i = std::countr_zero(candidates);
         const TLBEntry &entry = entries[i];
-        if (!entry.valid())
-            continue;
 
         uint64_t vaddr_vpn = calculate_vpn(vaddr, entry.page_mask);
         uint64_t entry_vpn =
@@ -1,11 +1,15 @@
 #include "cpu/cpu.h"
 #include "mmio/mi.h"
+#include "rcp/rsp.h"
 
 namespace N64 {
 namespace N64System {
 
 // Called when each interface updates its interrupt register?
 void check_interrupt() {
+    // Interrupt state changed: a deferred RSP task may have to run now so
+    // its SP/DP interrupts arrive where eager mode would raise them.
+    g_rsp().sync_if_interruptible();
 
     if (g_mi().get_reg_intr().raw & g_mi().get_reg_intr_mask().raw) {
         g_cpu().cop0.reg.cause.ip2 = 1;
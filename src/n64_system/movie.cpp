@@ -0,0 +1,230 @@
+#include "n64_system/movie.h"
+#include "memory/memory.h"
+#include "mmio/controller_input.h"
+#include "n64_system/save_state.h"
+#include "utils/log.h"
+#include "utils/state_io.h"
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace N64 {
+namespace Movie {
+
+namespace {
+
+constexpr uint32_t MOVIE_MAGIC = Utils::state_tag("K64M");
+
+enum class Start : uint32_t {
+    PowerOn = 0,
+    Snapshot = 1,
+};
+
+// One Joybus controller read; the file body is these back to back.
+struct Record {
+    uint32_t field;
+    uint16_t read; // index among this channel's reads in `field`
+    uint8_t channel;
+    uint8_t pad;
+    Mmio::N64ControllerState state;
+};
+static_assert(sizeof(Record) == 12);
+
+enum class Mode { Off, Record, Play };
+
+constexpr size_t CHANNELS = Input::kMaxControllers;
+
+struct MovieState {
+    Mode mode = Mode::Off;
+    uint64_t field = 0;
+    std::array<uint16_t, CHANNELS> reads{};
+    std::ofstream out;
+    std::array<std::vector<Record>, CHANNELS> records;
+    std::array<size_t, CHANNELS> cursor{};
+    std::array<Mmio::N64ControllerState, CHANNELS> last{};
+    bool desync_warned = false;
+    bool end_logged = false;
+};
+
+MovieState &movie() {
+    static MovieState m;
+    return m;
+}
+
+Mmio::N64ControllerState record_read(int channel,
+                                     const Mmio::N64ControllerState &live) {
+    auto &m = movie();
+    const Record r{static_cast<uint32_t>(m.field), m.reads[channel]++,
+                   static_cast<uint8_t>(channel), 0, live};
+    m.out.write(reinterpret_cast<const char *>(&r), sizeof(r));
+    return live;
+}
+
+Mmio::N64ControllerState play_read(int channel,
+                                   const Mmio::N64ControllerState &) {
+    auto &m = movie();
+    const uint16_t read = m.reads[channel]++;
+    const auto &list = m.records[channel];
+    size_t &i = m.cursor[channel];
+    bool in_sync = true;
+    // Reads the recording had but this run skipped.
+    while (i < list.size() &&
+           (list[i].field < m.field ||
+            (list[i].field == m.field && list[i].read < read))) {
+        ++i;
+        in_sync = false;
+    }
+    if (i < list.size() && list[i].field == m.field && list[i].read == read)
+        m.last[channel] = list[i++].state;
+    else if (i < list.size())
+        in_sync = false; // a read the recording never saw: hold the last
+    else
+        m.last[channel] = {};
+    if (!in_sync && !m.desync_warned) {
+        m.desync_warned = true;
+        Utils::warn("Movie: desync at field {} (channel {}, read {})",
+                    m.field, channel, read);
+    }
+    return m.last[channel];
+}
+
+void write_header(std::vector<uint8_t> &out, Start start,
+                  const std::vector<uint8_t> &snapshot) {
+    Utils::StateWriter w(out);
+    const auto &rom = g_memory().rom;
+    w.pod(MOVIE_MAGIC);
+    w.pod(MOVIE_VERSION);
+    w.pod(rom.get_crc1());
+    w.pod(rom.get_crc2());
+    w.pod(start);
+    w.pod(static_cast<uint32_t>(snapshot.size()));
+    w.bytes(snapshot.data(), snapshot.size());
+}
+
+} // namespace
+
+bool start_recording(const std::string &path, const std::string &state_path) {
+    stop();
+    std::vector<uint8_t> snapshot;
+    if (!state_path.empty()) {
+        if (!N64System::load_state_file(state_path))
+            return false;
+        N64System::save_state(snapshot);
+    }
+    std::vector<uint8_t> header;
+    write_header(header, snapshot.empty() ? Start::PowerOn : Start::Snapshot,
+                 snapshot);
+
+    auto &m = movie();
+    m.out.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    m.out.write(reinterpret_cast<const char *>(header.data()),
+                static_cast<std::streamsize>(header.size()));
+    if (!m.out) {
+        Utils::warn("Could not write movie: {}", path);
+        m = {};
+        return false;
+    }
+    m.mode = Mode::Record;
+    Input::set_pif_read_hook(&record_read);
+    Utils::info("Recording movie: {}", path);
+    return true;
+}
+
+bool start_playback(const std::string &path) {
+    stop();
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        Utils::warn("No movie: {}", path);
+        return false;
+    }
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                                    std::istreambuf_iterator<char>());
+    Utils::StateReader r(data);
+    uint32_t magic = 0, version = 0, crc1 = 0, crc2 = 0, snapshot_size = 0;
+    Start start = Start::PowerOn;
+    r.pod(magic);
+    r.pod(version);
+    r.pod(crc1);
+    r.pod(crc2);
+    r.pod(start);
+    r.pod(snapshot_size);
+    const auto snapshot = r.view(snapshot_size);
+    if (!r.ok() || magic != MOVIE_MAGIC) {
+        Utils::warn("Movie: not a Kamo64 movie: {}", path);
+        return false;
+    }
+    if (version != MOVIE_VERSION) {
+        Utils::warn("Movie: version {} (expected {})", version,
+                    MOVIE_VERSION);
+        return false;
+    }
+    const auto &rom = g_memory().rom;
+    if (crc1 != rom.get_crc1() || crc2 != rom.get_crc2()) {
+        Utils::warn("Movie: ROM mismatch (CRC {:08x}/{:08x})", crc1, crc2);
+        return false;
+    }
+    if (start == Start::Snapshot && !N64System::load_state(snapshot))
+        return false;
+
+    auto &m = movie();
+    // A trailing partial record is what a killed recording leaves behind.
+    const size_t count = r.remaining() / sizeof(Record);
+    for (size_t n = 0; n < count; n++) {
+        Record rec;
+        r.pod(rec);
+        if (rec.channel >= CHANNELS) {
+            Utils::warn("Movie: bad channel {} in record {}", rec.channel, n);
+            m = {};
+            return false;
+        }
+        m.records[rec.channel].push_back(rec);
+    }
+    m.mode = Mode::Play;
+    Input::set_pif_read_hook(&play_read);
+    Utils::info("Playing movie: {} ({} reads)", path, count);
+    return true;
+}
+
+void stop() {
+    auto &m = movie();
+    if (m.mode == Mode::Off)
+        return;
+    Input::set_pif_read_hook(nullptr);
+    m = {};
+}
+
+bool recording() { return movie().mode == Mode::Record; }
+
+bool playing() { return movie().mode == Mode::Play; }
+
+bool finished() {
+    const auto &m = movie();
+    if (m.mode != Mode::Play)
+        return false;
+    for (size_t c = 0; c < CHANNELS; c++) {
+        if (m.cursor[c] < m.records[c].size())
+            return false;
+    }
+    return true;
+}
+
+void on_field() {
+    auto &m = movie();
+    if (m.mode == Mode::Off)
+        return;
+    ++m.field;
+    m.reads.fill(0);
+    if (m.mode == Mode::Record) {
+        m.out.flush();
+    } else if (!m.end_logged && finished()) {
+        m.end_logged = true;
+        Utils::info("Movie: playback ended at field {}", m.field);
+    }
+}
+
+uint64_t field() { return movie().field; }
+
+} // namespace Movie
+} // namespace N64
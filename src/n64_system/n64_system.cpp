@@ -6,6 +6,7 @@
 #endif
 #include "debugger/debugger.h"
 #include "memory/bus.h"
+#include "memory/fastmem.h"
 #include "memory/memory.h"
 #include "mmio/ai.h"
 #include "mmio/mi.h"
@@ -15,7 +16,10 @@
 #include "mmu/tlb.h"
 #include "n64_system/config.h"
 #include "n64_system/interrupt.h"
+#include "n64_system/movie.h"
+#include "n64_system/save_state.h"
 #include "n64_system/scheduler.h"
+#include "rcp/audio_hle.h"
 #include "rcp/dpc.h"
 #include "rcp/rsp.h"
 #include "rcp/vu_profile.h"
@@ -24,23 +28,40 @@
 #include <algorithm>
 #include <chrono>
 #include <cstdlib>
+#include <filesystem>
+#include <span>
 #include <thread>
 
 namespace N64 {
 namespace N64System {
 
 namespace {
-void pace_field_realtime() {
+bool g_fast_forward = false;
+
+// `speed` scales the field period; <= 0 disables pacing entirely.
+void pace_field_realtime(double speed) {
     using clock = std::chrono::steady_clock;
     static clock::time_point deadline{};
     static bool have_deadline = false;
-    constexpr auto kField =
+    static double last_speed = 1.0;
+
+    Audio::set_speed(speed);
+    if (speed <= 0.0) {
+        // Re-seed on return to paced mode instead of bursting to catch up.
+        have_deadline = false;
+        return;
+    }
+    if (speed != last_speed) {
+        last_speed = speed;
+        have_deadline = false;
+    }
+    const auto field =
         std::chrono::duration_cast<clock::duration>(
-            std::chrono::duration<double>(1.0 / 60.0));
+            std::chrono::duration<double>(1.0 / (60.0 * speed)));
 
     const auto now = clock::now();
     if (!have_deadline) {
-        deadline = now + kField;
+        deadline = now + field;
         have_deadline = true;
         return;
     }
@@ -57,10 +78,10 @@ void pace_field_realtime() {
                     clock::now() - wait_t0)
                     .count()));
     }
-    auto next = deadline + kField;
+    auto next = deadline + field;
     const auto t = clock::now();
     while (next <= t)
-        next += kField;
+        next += field;
     deadline = next;
 }
 } // namespace
@@ -73,6 +94,30 @@ PresentStatsFn g_present_stats = nullptr;
 void set_field_present(FieldPresentFn fn) { g_field_present = fn; }
 void set_present_stats_fn(PresentStatsFn fn) { g_present_stats = fn; }
 
+void set_fast_forward(bool on) { g_fast_forward = on; }
+bool fast_forward() { return g_fast_forward; }
+
+#if defined(N64_JIT_X64)
+static void open_jit_disk_cache(const Config &config) {
+    auto &dynarec = N64::Cpu::Jit::g_dynarec();
+    if (!config.jit_disk_cache) {
+        dynarec.open_disk_cache({}, 0, 0);
+        return;
+    }
+    const auto &rom = N64::g_memory().rom;
+    const std::string dir =
+        config.jit_disk_cache_dir.empty()
+            ? (std::filesystem::path(N64::g_memory().get_data_dir()) /
+               "jitcache")
+                  .string()
+            : config.jit_disk_cache_dir;
+    const std::string file =
+        fmt::format("{:08x}{:08x}.jit", rom.get_crc1(), rom.get_crc2());
+    dynarec.open_disk_cache((std::filesystem::path(dir) / file).string(),
+                            rom.get_crc1(), rom.get_crc2());
+}
+#endif
+
 static void reset_all(Config &config) {
     N64::g_scheduler().init();
 
@@ -80,15 +125,30 @@ static void reset_all(Config &config) {
     N64::g_memory().load_rom(config.rom_filepath);
     N64::g_tlb().reset();
     N64::g_cpu().reset();
+    // Before the code caches reset, so they start tracking code pages.
+    if (!N64::Fastmem::set_enabled(config.fastmem))
+        config.fastmem = false;
 #if defined(N64_JIT_X64)
-    if (config.cpu_backend == CpuBackend::Jit)
+    if (config.cpu_backend == CpuBackend::Jit) {
         N64::Cpu::Jit::g_dynarec().reset();
-    else
+        N64::Cpu::Jit::g_dynarec().set_linking(config.jit_link);
+        N64::Cpu::Jit::g_dynarec().set_optimize(config.jit_opt);
+        N64::Cpu::Jit::g_dynarec().set_cache_limits(
+            size_t{config.jit_cache_mb} << 20, config.jit_cache_blocks);
+        N64::Cpu::Jit::g_dynarec().set_tiering(config.jit_tier);
+        N64::Cpu::Jit::g_dynarec().set_tracing(config.jit_trace);
+        open_jit_disk_cache(config);
+    } else
         N64::Cpu::CachedInterp::reset();
 #else
     N64::Cpu::CachedInterp::reset();
 #endif
     N64::g_rsp().reset();
+    N64::g_rsp().set_lazy(config.rsp_lazy);
+    N64::g_rsp().set_jit(config.rsp_jit);
+    N64::Rsp::set_vu_simd(config.rsp_simd);
+    N64::g_rsp().set_threaded(config.rsp_threaded, config.rsp_threaded_check);
+    N64::Rsp::set_audio_hle(config.audio_hle, config.audio_hle_compare);
     N64::g_dpc().reset();
     N64::g_pi().reset();
     N64::g_si().reset();
@@ -115,19 +175,63 @@ void set_up(Config &config) {
         Utils::debug("Executing PIF ROM");
         N64::g_si().pif.execute_rom_hle();
     }
+
+    if (!config.start_state.empty() && !load_state_file(config.start_state)) {
+        Utils::critical("Cannot load start state");
+        exit(-1);
+    }
+
+    // A run that asked for a movie is only reproducible with it.
+    Movie::stop();
+    bool movie_ok = true;
+    if (!config.movie_play.empty())
+        movie_ok = Movie::start_playback(config.movie_play);
+    else if (!config.movie_record.empty())
+        movie_ok =
+            Movie::start_recording(config.movie_record, config.movie_state);
+    if (!movie_ok) {
+        Utils::critical("Cannot start movie");
+        exit(-1);
+    }
+}
+
+uint64_t state_hash() {
+    g_rsp().sync();
+    uint64_t h = 0xcbf29ce484222325ull;
+    const auto mix = [&h](std::span<const uint8_t> bytes) {
+        for (const uint8_t b : bytes) {
+            h ^= b;
+            h *= 0x100000001b3ull;
+        }
+    };
+    mix(g_memory().get_rdram());
+    mix(g_rsp().get_sp_dmem());
+    mix(g_rsp().get_sp_imem());
+    return h;
+}
+
+static void save_jit_disk_cache() {
+#if defined(N64_JIT_X64)
+    N64::Cpu::Jit::g_dynarec().save_disk_cache();
+#endif
 }
 
 void shutdown() {
     Utils::info("Stopping N64 system");
+    Movie::stop();
     N64::g_memory().persist_sram();
+    save_jit_disk_cache();
 }
 
 static void cpu_step_callback(Config &config) {
     if (config.test_mode) {
         if (N64::g_cpu().gpr.read(30) != 0) {
-            Utils::info("Test finished");
+            Utils::info("Test finished at cycle {}",
+                        N64::g_scheduler().get_current_time());
             Utils::core_dump();
-            if ((int64_t)N64::g_cpu().gpr.read(30) == -1) {
+            save_jit_disk_cache();
+            const bool hle_ok = N64::Rsp::audio_hle_compare_passed();
+            if ((int64_t)N64::g_cpu().gpr.read(30) == -1 && hle_ok) {
                 Utils::info("Test passed");
                 exit(0);
             } else {
@@ -157,14 +261,14 @@ void step(Config &config) {
     }();
     static uint64_t prof_fields = 0;
     static double prof_emu_ms = 0.0;
-    static double prof_cpu_ms = 0.0;
-    static double prof_rdp_ms = 0.0;
     static double prof_audio_ms = 0.0;
     static auto prof_last_log = std::chrono::steady_clock::now();
+    // Timing also runs without the log when a harness enables WorkProfile.
+    const bool timing = WorkProfile::enabled();
 
     for (int field = 0; field < g_vi().get_num_fields(); field++) {
-        const auto field_t0 = profile_frame ? std::chrono::steady_clock::now()
-                                            : std::chrono::steady_clock::time_point{};
+        const auto field_t0 = timing ? std::chrono::steady_clock::now()
+                                     : std::chrono::steady_clock::time_point{};
         for (int line = 0; line < g_vi().get_num_half_lines(); line++) {
             g_vi().set_reg_current(line * 2 + field);
             if ((g_vi().get_reg_current() & 0x3FE) == g_vi().get_reg_intr()) {
@@ -189,7 +293,7 @@ void step(Config &config) {
                 int taken = 1;
                 if (dbg_on)
                     dbg.on_step();
-                const auto cpu_t0 = profile_frame
+                const auto cpu_t0 = timing
                                        ? std::chrono::steady_clock::now()
                                        : std::chrono::steady_clock::time_point{};
                 if (use_jit) {
@@ -207,7 +311,7 @@ void step(Config &config) {
                     if (taken < 1)
                         taken = 1;
                 }
-                if (profile_frame) {
+                if (timing) {
                     cpu_ms += std::chrono::duration<double, std::milli>(
                                   std::chrono::steady_clock::now() - cpu_t0)
                                   .count();
@@ -218,28 +322,32 @@ void step(Config &config) {
 
                 remaining -= taken;
             }
-            if (profile_frame)
-                prof_cpu_ms += cpu_ms;
+            if (timing)
+                WorkProfile::add_ms(WorkProfile::Bucket::CpuSlice, cpu_ms);
         }
         if ((g_vi().get_reg_current() & 0x3FE) == g_vi().get_reg_intr()) {
             g_mi().get_reg_intr().vi = 1;
             N64System::check_interrupt();
         }
-        const auto rdp_t0 = profile_frame ? std::chrono::steady_clock::now()
-                                          : std::chrono::steady_clock::time_point{};
+        const auto rdp_t0 = timing ? std::chrono::steady_clock::now()
+                                   : std::chrono::steady_clock::time_point{};
+        Movie::on_field();
         if (g_field_present)
             g_field_present(g_vi());
-        const auto rdp_t1 = profile_frame ? std::chrono::steady_clock::now()
-                                          : std::chrono::steady_clock::time_point{};
-        pace_field_realtime();
+        const auto rdp_t1 = timing ? std::chrono::steady_clock::now()
+                                   : std::chrono::steady_clock::time_point{};
+        pace_field_realtime(g_fast_forward ? 0.0 : config.speed);
+        if (timing) {
+            WorkProfile::add_ms(
+                WorkProfile::Bucket::Present,
+                std::chrono::duration<double, std::milli>(rdp_t1 - rdp_t0)
+                    .count());
+        }
         if (profile_frame) {
             const auto t1 = std::chrono::steady_clock::now();
             prof_emu_ms +=
                 std::chrono::duration<double, std::milli>(rdp_t0 - field_t0)
                     .count();
-            prof_rdp_ms +=
-                std::chrono::duration<double, std::milli>(rdp_t1 - rdp_t0)
-                    .count();
             prof_audio_ms += Audio::take_sync_wait_ms();
             ++prof_fields;
             if (std::chrono::duration<double>(t1 - prof_last_log).count() >=
@@ -247,9 +355,12 @@ void step(Config &config) {
                 const double inv = prof_fields ? 1.0 / prof_fields : 0.0;
                 const double emu = prof_emu_ms * inv;
                 const double pace = prof_audio_ms * inv;
-                const double cpu_wall = std::max(prof_cpu_ms * inv, 0.0);
-                const double rdp = prof_rdp_ms * inv;
                 const WorkProfile::Totals wp = WorkProfile::take_and_reset();
+                const double cpu_wall = std::max(
+                    WorkProfile::ms_of(wp, WorkProfile::Bucket::CpuSlice) * inv,
+                    0.0);
+                const double rdp =
+                    WorkProfile::ms_of(wp, WorkProfile::Bucket::Present) * inv;
                 const double rsp = WorkProfile::ms_of(wp, WorkProfile::Bucket::RspTask) * inv;
                 const double fb_scan =
                     WorkProfile::ms_of(wp, WorkProfile::Bucket::FbCheck) * inv;
@@ -299,8 +410,6 @@ void step(Config &config) {
 #endif
                 prof_fields = 0;
                 prof_emu_ms = 0.0;
-                prof_cpu_ms = 0.0;
-                prof_rdp_ms = 0.0;
                 prof_audio_ms = 0.0;
                 prof_last_log = t1;
             }
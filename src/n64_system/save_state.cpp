@@ -0,0 +1,229 @@
+#include "n64_system/save_state.h"
+#include "cpu/cpu.h"
+#include "memory/memory.h"
+#include "mmio/ai.h"
+#include "mmio/mi.h"
+#include "mmio/pi.h"
+#include "mmio/si.h"
+#include "mmio/vi.h"
+#include "mmu/tlb.h"
+#include "n64_system/interrupt.h"
+#include "n64_system/scheduler.h"
+#include "rcp/audio_hle.h"
+#include "rcp/dpc.h"
+#include "rcp/rsp.h"
+#include "utils/log.h"
+#include "utils/state_io.h"
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <type_traits>
+
+namespace N64 {
+namespace N64System {
+
+namespace {
+
+constexpr uint32_t STATE_MAGIC = Utils::state_tag("K64S");
+
+// Payload size of a fixed-layout section in this build, taken from a
+// scratch instance so the live machine is neither read nor synced.
+template <typename T> size_t fixed_size() {
+    static const size_t size = [] {
+        const auto scratch = std::make_unique<T>();
+        std::vector<uint8_t> out;
+        Utils::StateWriter w(out);
+        scratch->save_state(w);
+        return out.size();
+    }();
+    return size;
+}
+
+template <typename T> void check_fixed(Utils::StateReader &r) {
+    r.view(fixed_size<std::remove_cvref_t<T>>());
+}
+
+struct Section {
+    uint32_t tag;
+    void (*save)(Utils::StateWriter &w);
+    void (*load)(Utils::StateReader &r);
+    // Consumes the payload exactly as `load` would and fails where it
+    // would, without touching the machine.
+    void (*check)(Utils::StateReader &r);
+};
+
+// Memory goes last: its loader reports changed RDRAM pages to the code
+// caches, which must see the restored CPU/TLB state.
+const Section SECTIONS[] = {
+    {Utils::state_tag("CPU "), [](auto &w) { g_cpu().save_state(w); },
+     [](auto &r) { g_cpu().load_state(r); },
+     [](auto &r) { check_fixed<decltype(g_cpu())>(r); }},
+    {Utils::state_tag("TLB "), [](auto &w) { g_tlb().save_state(w); },
+     [](auto &r) { g_tlb().load_state(r); },
+     [](auto &r) { check_fixed<decltype(g_tlb())>(r); }},
+    {Utils::state_tag("RSP "), [](auto &w) { g_rsp().save_state(w); },
+     [](auto &r) { g_rsp().load_state(r); },
+     [](auto &r) { check_fixed<decltype(g_rsp())>(r); }},
+    {Utils::state_tag("DPC "), [](auto &w) { g_dpc().save_state(w); },
+     [](auto &r) { g_dpc().load_state(r); },
+     [](auto &r) { Rdp::Dpc::check_state(r); }},
+    {Utils::state_tag("PI  "), [](auto &w) { g_pi().save_state(w); },
+     [](auto &r) { g_pi().load_state(r); },
+     [](auto &r) { check_fixed<decltype(g_pi())>(r); }},
+    {Utils::state_tag("SI  "), [](auto &w) { g_si().save_state(w); },
+     [](auto &r) { g_si().load_state(r); },
+     [](auto &r) { check_fixed<decltype(g_si())>(r); }},
+    {Utils::state_tag("AI  "), [](auto &w) { g_ai().save_state(w); },
+     [](auto &r) { g_ai().load_state(r); },
+     [](auto &r) { check_fixed<decltype(g_ai())>(r); }},
+    {Utils::state_tag("VI  "), [](auto &w) { g_vi().save_state(w); },
+     [](auto &r) { g_vi().load_state(r); },
+     [](auto &r) { check_fixed<decltype(g_vi())>(r); }},
+    {Utils::state_tag("MI  "), [](auto &w) { g_mi().save_state(w); },
+     [](auto &r) { g_mi().load_state(r); },
+     [](auto &r) { check_fixed<decltype(g_mi())>(r); }},
+    {Utils::state_tag("SCHD"), [](auto &w) { g_scheduler().save_state(w); },
+     [](auto &r) { g_scheduler().load_state(r); },
+     [](auto &r) { Scheduler::check_state(r); }},
+    {Utils::state_tag("MEM "), [](auto &w) { g_memory().save_state(w); },
+     [](auto &r) { g_memory().load_state(r); },
+     [](auto &r) { g_memory().check_state(r); }},
+};
+
+void write_header(Utils::StateWriter &w) {
+    auto &rom = g_memory().rom;
+    w.pod(STATE_MAGIC);
+    w.pod(SAVE_STATE_VERSION);
+    w.pod(rom.get_crc1());
+    w.pod(rom.get_crc2());
+}
+
+bool check_header(Utils::StateReader &r) {
+    uint32_t magic = 0, version = 0, crc1 = 0, crc2 = 0;
+    r.pod(magic);
+    r.pod(version);
+    r.pod(crc1);
+    r.pod(crc2);
+    if (!r.ok() || magic != STATE_MAGIC) {
+        Utils::warn("Save state: not a Kamo64 snapshot");
+        return false;
+    }
+    if (version != SAVE_STATE_VERSION) {
+        Utils::warn("Save state: version {} (expected {})", version,
+                    SAVE_STATE_VERSION);
+        return false;
+    }
+    auto &rom = g_memory().rom;
+    if (crc1 != rom.get_crc1() || crc2 != rom.get_crc2()) {
+        Utils::warn("Save state: ROM mismatch (CRC {:08x}/{:08x})", crc1,
+                    crc2);
+        return false;
+    }
+    return true;
+}
+
+// Header, every section tag/size and every section's contents as its
+// loader reads them, without applying anything.
+bool check_framing(std::span<const uint8_t> in) {
+    Utils::StateReader r(in);
+    if (!check_header(r))
+        return false;
+    for (const auto &s : SECTIONS) {
+        const size_t end = r.enter_section(s.tag);
+        if (!r.ok()) {
+            Utils::warn("Save state: missing or truncated section");
+            return false;
+        }
+        s.check(r);
+        r.leave_section(end);
+        if (!r.ok()) {
+            Utils::warn("Save state: section {:08x} does not match this "
+                        "build",
+                        s.tag);
+            return false;
+        }
+    }
+    return r.remaining() == 0;
+}
+
+} // namespace
+
+void save_state(std::vector<uint8_t> &out) {
+    // Snapshots never hold a deferred RSP task.
+    g_rsp().sync();
+    out.clear();
+    Utils::StateWriter w(out);
+    write_header(w);
+    for (const auto &s : SECTIONS) {
+        const size_t at = w.begin_section(s.tag);
+        s.save(w);
+        w.end_section(at);
+    }
+}
+
+bool load_state(std::span<const uint8_t> in) {
+    if (!check_framing(in))
+        return false;
+    // A deferred RSP task belongs to the machine being replaced, and so do
+    // audio HLE save areas and a pending comparison.
+    g_rsp().abandon_task();
+    Rsp::audio_hle_reset();
+
+    const auto t0 = std::chrono::steady_clock::now();
+    Utils::StateReader r(in);
+    check_header(r);
+    for (const auto &s : SECTIONS) {
+        const size_t end = r.enter_section(s.tag);
+        s.load(r);
+        r.leave_section(end);
+        if (!r.ok()) {
+            // check_framing read every section the same way; a loader and
+            // its check have drifted apart.
+            Utils::critical("Save state: section {:08x} failed after its "
+                            "check passed",
+                            s.tag);
+            return false;
+        }
+    }
+    check_interrupt();
+    Utils::debug("Save state loaded in {:.3f} ms",
+                 std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - t0)
+                     .count());
+    return true;
+}
+
+bool save_state_file(const std::string &path) {
+    std::vector<uint8_t> data;
+    save_state(data);
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        Utils::warn("Could not write save state: {}", path);
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(data.data()),
+               static_cast<std::streamsize>(data.size()));
+    if (!file) {
+        Utils::warn("Could not write save state: {}", path);
+        return false;
+    }
+    Utils::info("Saved state: {}", path);
+    return true;
+}
+
+bool load_state_file(const std::string &path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        Utils::warn("No save state: {}", path);
+        return false;
+    }
+    const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                                    std::istreambuf_iterator<char>());
+    if (!load_state(data))
+        return false;
+    Utils::info("Loaded state: {}", path);
+    return true;
+}
+
+} // namespace N64System
+} // namespace N64
@@ -1,71 +1,99 @@
 ﻿#include "n64_system/scheduler.h"
+#include "mmio/ai.h"
+#include "mmio/pi.h"
+#include "rcp/rsp.h"
 #include "utils/log.h"
+#include "utils/state_io.h"
 #include <cstdint>
 
 namespace N64 {
 namespace N64System {
 
+namespace {
+void perform(EventKind kind) {
+    switch (kind) {
+    case EventKind::AiDmaComplete:
+        Mmio::AI::AIScheduler::on_dma_complete();
+        break;
+    case EventKind::PiDmaWriteComplete:
+        Mmio::PI::PIScheduler::on_dma_write_completed();
+        break;
+    case EventKind::PiDmaReadComplete:
+        Mmio::PI::PIScheduler::on_dma_read_completed();
+        break;
+    case EventKind::SpTask:
+        g_rsp().on_sp_event();
+        break;
+    default:
+        Utils::abort("Unknown scheduler event {}", static_cast<int>(kind));
+    }
+}
+
+// Dispatch order: earlier first, then lower kind.
+bool before(uint64_t at_a, EventKind a, uint64_t at_b, EventKind b) {
+    if (at_a != at_b)
+        return at_a < at_b;
+    return a < b;
+}
+} // namespace
+
 void Scheduler::init() {
     current_time = 0;
-    event_queue = {};
-    for (auto &e : named_) {
-        e.enabled = false;
-        e.at = 0;
-        e.cb = {};
+    num_pending_ = 0;
+    update_next();
+}
+
+void Scheduler::insert(uint64_t at, EventKind kind) {
+    if (num_pending_ == MAX_PENDING)
+        Utils::abort("Scheduler: more than {} pending events", MAX_PENDING);
+    size_t i = num_pending_;
+    while (i > 0 && before(pending_[i - 1].at, pending_[i - 1].kind, at, kind)) {
+        pending_[i] = pending_[i - 1];
+        --i;
     }
+    pending_[i] = {at, kind};
+    ++num_pending_;
+    update_next();
 }
 
-void Scheduler::set_timer(uint64_t cycles, Event event) {
-    event_queue.push({current_time + cycles, std::move(event)});
+void Scheduler::remove_kind(EventKind kind) {
+    size_t out = 0;
+    for (size_t i = 0; i < num_pending_; ++i) {
+        if (pending_[i].kind != kind)
+            pending_[out++] = pending_[i];
+    }
+    num_pending_ = out;
+    update_next();
 }
 
-void Scheduler::schedule_named(NamedEventId id, uint64_t cycles,
-                               std::function<void()> cb) {
-    auto &e = named_[static_cast<int>(id)];
-    e.enabled = true;
-    e.at = current_time + cycles;
-    e.cb = std::move(cb);
+void Scheduler::set_timer(uint64_t cycles, EventKind kind) {
+    insert(current_time + cycles, kind);
 }
 
-void Scheduler::cancel_named(NamedEventId id) {
-    auto &e = named_[static_cast<int>(id)];
-    e.enabled = false;
-    e.at = 0;
-    e.cb = {};
+void Scheduler::schedule(EventKind kind, uint64_t cycles) {
+    schedule_at(kind, current_time + cycles);
 }
 
-bool Scheduler::dispatch_one_due() {
-    uint64_t best_named = UINT64_MAX;
-    int best_id = -1;
-    for (int i = 0; i < static_cast<int>(NamedEventId::Count); ++i) {
-        if (named_[i].enabled && named_[i].at < best_named) {
-            best_named = named_[i].at;
-            best_id = i;
-        }
-    }
+void Scheduler::schedule_at(EventKind kind, uint64_t at) {
+    remove_kind(kind);
+    insert(at, kind);
+}
 
-    const bool have_q = !event_queue.empty();
-    const uint64_t q_at = have_q ? event_queue.top().first : UINT64_MAX;
+void Scheduler::cancel(EventKind kind) { remove_kind(kind); }
 
-    if (have_q && q_at <= best_named) {
-        if (q_at > current_time)
-            return false;
-        scheduled_event_t e = event_queue.top();
-        event_queue.pop();
-        e.second.perform();
-        return true;
-    }
-    if (best_id >= 0) {
-        if (best_named > current_time)
-            return false;
-        auto cb = std::move(named_[best_id].cb);
-        named_[best_id].enabled = false;
-        named_[best_id].cb = {};
-        if (cb)
-            cb();
+bool Scheduler::dispatch_one_due() {
+    if (next_at_ > current_time)
+        return false;
+    // A deferred RSP task logically started before this event; catch it up
+    // first, then pick again (its completion may now be the earliest).
+    if (g_rsp().task_pending()) {
+        g_rsp().sync_before(next_at_);
         return true;
     }
-    return false;
+    const EventKind kind = pending_[--num_pending_].kind;
+    update_next();
+    perform(kind);
+    return true;
 }
 
 void Scheduler::tick(uint64_t cycles) {
@@ -74,24 +102,57 @@ void Scheduler::tick(uint64_t cycles) {
         Utils::unimplemented("current_time is reaching max");
     }
 
+    g_rsp().poll_worker();
     while (dispatch_one_due()) {
     }
 }
 
-uint64_t Scheduler::cycles_until_next_event() const {
-    uint64_t next = UINT64_MAX;
-    if (!event_queue.empty()) {
-        const uint64_t at = event_queue.top().first;
-        next = at <= current_time ? 0 : at - current_time;
+void Scheduler::save_state(Utils::StateWriter &w) const {
+    w.pod(current_time);
+    // Stored in dispatch order.
+    w.pod(static_cast<uint32_t>(num_pending_));
+    for (size_t i = num_pending_; i-- > 0;) {
+        w.pod(pending_[i].at);
+        w.pod(pending_[i].kind);
+    }
+}
+
+void Scheduler::load_state(Utils::StateReader &r) {
+    r.pod(current_time);
+    num_pending_ = 0;
+    uint32_t n = 0;
+    r.pod(n);
+    if (n > MAX_PENDING)
+        r.fail();
+    for (uint32_t i = 0; i < n && r.ok(); ++i) {
+        uint64_t at = 0;
+        EventKind kind{};
+        r.pod(at);
+        r.pod(kind);
+        if (static_cast<uint8_t>(kind) >=
+            static_cast<uint8_t>(EventKind::Count)) {
+            r.fail();
+            break;
+        }
+        insert(at, kind);
     }
-    for (const auto &e : named_) {
-        if (!e.enabled)
-            continue;
-        const uint64_t rem = e.at <= current_time ? 0 : e.at - current_time;
-        if (rem < next)
-            next = rem;
+    update_next();
+}
+
+void Scheduler::check_state(Utils::StateReader &r) {
+    r.view(sizeof(current_time));
+    uint32_t n = 0;
+    r.pod(n);
+    if (n > MAX_PENDING)
+        r.fail();
+    for (uint32_t i = 0; i < n && r.ok(); ++i) {
+        EventKind kind{};
+        r.view(sizeof(uint64_t));
+        r.pod(kind);
+        if (static_cast<uint8_t>(kind) >=
+            static_cast<uint8_t>(EventKind::Count))
+            r.fail();
     }
-    return next;
 }
 
 Scheduler Scheduler::instance{};
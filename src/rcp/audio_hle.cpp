@@ -0,0 +1,720 @@
+#include "rcp/audio_hle.h"
+#include "cpu/jit/invalidate_hook.h"
+#include "memory/memory.h"
+#include "memory/memory_map.h"
+#include "rdp/rdp_core.h"
+#include "utils/byte_array.h"
+#include "utils/log.h"
+#include "utils/work_profile.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <unordered_map>
+#include <vector>
+
+namespace N64 {
+namespace Rsp {
+
+namespace {
+
+// The sample buffer below keeps int16 samples in host order.
+static_assert(std::endian::native == std::endian::little);
+
+// OSTask fields (DMEM 0xFC0).
+constexpr uint32_t TASK_TYPE = 0xFC0;
+constexpr uint32_t TASK_FLAGS = 0xFC4;
+constexpr uint32_t TASK_UCODE = 0xFD0;
+constexpr uint32_t TASK_UCODE_SIZE = 0xFD4;
+constexpr uint32_t TASK_UCODE_DATA = 0xFD8;
+constexpr uint32_t TASK_UCODE_DATA_SIZE = 0xFDC;
+constexpr uint32_t TASK_DATA_PTR = 0xFF0;
+constexpr uint32_t TASK_DATA_SIZE = 0xFF4;
+
+constexpr uint32_t M_AUDTASK = 2;
+constexpr uint32_t OS_TASK_YIELDED = 0x0001;
+
+// ABI1 flag bits.
+constexpr uint8_t A_INIT = 0x01;
+constexpr uint8_t A_LOOP = 0x02;
+constexpr uint8_t A_LEFT = 0x02;
+constexpr uint8_t A_VOL = 0x04;
+constexpr uint8_t A_AUX = 0x08;
+
+// ABI1 commands; POLEF (14) and anything past SETLOOP stay LLE.
+enum Acmd : uint8_t {
+    SPNOOP = 0,
+    ADPCM,
+    CLEARBUFF,
+    ENVMIXER,
+    LOADBUFF,
+    RESAMPLE,
+    SAVEBUFF,
+    SEGMENT,
+    SETBUFF,
+    SETVOL,
+    DMEMMOVE,
+    LOADADPCM,
+    MIXER,
+    INTERLEAVE,
+    POLEF,
+    SETLOOP,
+};
+
+// Buffer offsets in command lists are relative to this DMEM address.
+constexpr uint32_t DMEM_BASE = 0x5C0;
+// DMEM offsets wrap at 4 KiB. A run starting near the end spills past it
+// instead of wrapping, so the buffer is twice that (plus a group of 8
+// samples of slack) and run lengths are capped at 4 KiB.
+constexpr uint32_t BUF_BYTES = 0x1000;
+constexpr uint32_t N_SEGMENTS = 16;
+
+// Rough RSP cost, for when the task's completion reaches the CPU.
+constexpr uint32_t TASK_CYCLES = 1000;
+constexpr uint32_t COMMAND_CYCLES = 100;
+
+struct Ucode {
+    bool hle{false};
+    // 64 rows of 4 taps, indexed by the top 6 bits of the pitch fraction.
+    std::array<int16_t, 64 * 4> resample_lut{};
+};
+
+// Written by the task, and what compare mode needs to undo or check.
+struct Write {
+    uint32_t address;
+    std::vector<uint16_t> data;
+};
+
+struct State {
+    bool on{false};
+    bool compare{false};
+    std::unordered_map<uint64_t, Ucode> ucodes;
+    const Ucode *ucode{nullptr};
+
+    alignas(64) std::array<int16_t, BUF_BYTES + 8> buffer{}; // 2x bytes
+
+    std::array<uint32_t, N_SEGMENTS> segments{};
+    uint16_t in{0}, out{0}, count{0};
+    uint16_t dry_right{0}, wet_left{0}, wet_right{0};
+    int16_t dry{0}, wet{0};
+    std::array<int16_t, 2> vol{}, target{};
+    std::array<int32_t, 2> rate{};
+    uint32_t loop{0};
+    std::array<int16_t, 16 * 8> adpcm_table{};
+    uint32_t cycles{0};
+
+    // Compare mode.
+    bool recording{false};
+    std::vector<Write> undo;
+    std::vector<Write> output;
+    bool pending{false};
+    // Save areas as this engine left them. LLE rewrites them in its own
+    // layout, so HLE resumes from these instead.
+    std::unordered_map<uint32_t, std::vector<uint16_t>> blobs;
+    uint64_t compared{0};
+    uint64_t mismatched{0};
+};
+
+State &state() {
+    static State s;
+    return s;
+}
+
+const std::span<uint8_t> &rdram() { return g_memory().get_rdram(); }
+
+uint32_t rdram_u32(uint32_t address) {
+    return Utils::read_from_byte_array32(rdram(),
+                                         address & RDRAM_SIZE_MASK & ~3u);
+}
+
+uint16_t rdram_u16(uint32_t address) {
+    return Utils::read_from_byte_array16(rdram(),
+                                         address & RDRAM_SIZE_MASK & ~1u);
+}
+
+uint32_t dmem_u32(std::span<const uint8_t> dmem, uint32_t offset) {
+    return Utils::read_from_byte_array32_be(dmem, offset);
+}
+
+// Halfword runs between RDRAM and host-order arrays. Each host word of
+// RDRAM holds two big-endian-ordered halfwords, high one first.
+void rdram_load(uint16_t *dst, uint32_t address, uint32_t halfwords) {
+    address &= RDRAM_SIZE_MASK & ~1u;
+    halfwords = std::min(halfwords, (RDRAM_SIZE - address) / 2);
+    Rdp::check_framebuffers(address, halfwords * 2);
+    for (uint32_t i = 0; i < halfwords; i++)
+        dst[i] = rdram_u16(address + i * 2);
+}
+
+void rdram_store(uint32_t address, const uint16_t *src, uint32_t halfwords) {
+    auto &s = state();
+    address &= RDRAM_SIZE_MASK & ~1u;
+    halfwords = std::min(halfwords, (RDRAM_SIZE - address) / 2);
+    if (halfwords == 0)
+        return;
+    if (s.recording) {
+        Write w{address, std::vector<uint16_t>(halfwords)};
+        rdram_load(w.data.data(), address, halfwords);
+        s.undo.push_back(std::move(w));
+    }
+    Rdp::on_rdram_write(address, halfwords * 2);
+    auto &ram = rdram();
+    for (uint32_t i = 0; i < halfwords; i++)
+        Utils::write_to_byte_array16(ram, address + i * 2, src[i]);
+    maybe_invalidate_code(address, halfwords * 2);
+}
+
+// Per-voice save areas (ADPCM history, resampler and envelope state).
+void load_blob(uint16_t *dst, uint32_t address, uint32_t halfwords) {
+    auto &s = state();
+    if (s.compare) {
+        const auto it = s.blobs.find(address);
+        if (it != s.blobs.end() && it->second.size() == halfwords) {
+            std::copy(it->second.begin(), it->second.end(), dst);
+            return;
+        }
+    }
+    rdram_load(dst, address, halfwords);
+}
+
+void store_blob(uint32_t address, const uint16_t *src, uint32_t halfwords) {
+    auto &s = state();
+    rdram_store(address, src, halfwords);
+    if (s.compare)
+        s.blobs[address].assign(src, src + halfwords);
+}
+
+uint32_t align(uint32_t x, uint32_t to) { return (x + to - 1) & ~(to - 1); }
+
+int16_t clamp16(int32_t x) {
+    return static_cast<int16_t>(std::clamp(x, -32768, 32767));
+}
+
+// Buffer access by DMEM byte offset.
+int16_t *samples(uint32_t offset) {
+    return state().buffer.data() + ((offset & (BUF_BYTES - 1)) >> 1);
+}
+
+uint8_t &buffer_u8(uint32_t offset) {
+    auto *bytes = reinterpret_cast<uint8_t *>(state().buffer.data());
+    return bytes[(offset & (BUF_BYTES - 1)) ^ 1];
+}
+
+uint32_t cap(uint32_t bytes) { return std::min(bytes, BUF_BYTES); }
+
+uint32_t address_of(uint32_t so) {
+    const uint32_t segment = (so >> 24) & 0x3F;
+    const uint32_t offset = so & 0xFFFFFF;
+    if (segment >= N_SEGMENTS)
+        return offset;
+    return (state().segments[segment] + offset) & RDRAM_SIZE_MASK;
+}
+
+uint64_t fnv1a(uint64_t h, uint32_t address, uint32_t bytes) {
+    for (uint32_t i = 0; i < bytes; i += 4) {
+        h ^= rdram_u32(address + i);
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
+
+// --- Kernels -------------------------------------------------------------
+// Plain contiguous loops over host-order samples, which the compiler
+// vectorizes; the history-dependent ones (ADPCM, resample) stay scalar.
+
+void mix(int16_t *dst, const int16_t *src, uint32_t n, int16_t gain) {
+    for (uint32_t i = 0; i < n; i++)
+        dst[i] = clamp16(dst[i] + ((src[i] * gain) >> 15));
+}
+
+void interleave(int16_t *dst, const int16_t *left, const int16_t *right,
+                uint32_t n) {
+    std::array<int16_t, BUF_BYTES / 2> l, r;
+    std::copy(left, left + n, l.begin());
+    std::copy(right, right + n, r.begin());
+    for (uint32_t i = 0; i < n; i++) {
+        dst[2 * i] = l[i];
+        dst[2 * i + 1] = r[i];
+    }
+}
+
+// Sum of x[j] * y[n - 1 - j] for j < n.
+int32_t rdot(uint32_t n, const int16_t *x, const int16_t *y) {
+    int32_t accu = 0;
+    for (uint32_t j = 0; j < n; j++)
+        accu += x[j] * y[n - 1 - j];
+    return accu;
+}
+
+void adpcm_residuals(int16_t *dst, const int16_t *src, const int16_t *book,
+                     int16_t l1, int16_t l2) {
+    const int16_t *book1 = book;
+    const int16_t *book2 = book + 8;
+    for (uint32_t i = 0; i < 8; i++) {
+        int32_t accu = src[i] << 11;
+        accu += book1[i] * l1 + book2[i] * l2 + rdot(i, book2, src);
+        dst[i] = clamp16(accu >> 11);
+    }
+}
+
+void adpcm(bool init, bool loop, uint16_t dmemo, uint16_t dmemi,
+           uint32_t count, uint32_t loop_address, uint32_t state_address) {
+    auto &s = state();
+    std::array<int16_t, 16> last{};
+    if (!init) {
+        auto *dst = reinterpret_cast<uint16_t *>(last.data());
+        if (loop)
+            rdram_load(dst, loop_address, 16);
+        else
+            load_blob(dst, state_address, 16);
+    }
+    std::copy(last.begin(), last.end(), samples(dmemo));
+    dmemo += 32;
+
+    for (; count != 0; count -= 32) {
+        const uint8_t code = buffer_u8(dmemi++);
+        const uint32_t scale = code >> 4;
+        const int16_t *book = s.adpcm_table.data() + ((code & 0xF) << 4);
+        const uint32_t rshift = scale < 12 ? 12 - scale : 0;
+        std::array<int16_t, 16> frame;
+        for (uint32_t i = 0; i < 8; i++) {
+            const uint8_t byte = buffer_u8(dmemi++);
+            frame[2 * i] = static_cast<int16_t>(
+                static_cast<int16_t>((byte & 0xF0) << 8) >> rshift);
+            frame[2 * i + 1] = static_cast<int16_t>(
+                static_cast<int16_t>((byte & 0x0F) << 12) >> rshift);
+        }
+        adpcm_residuals(last.data(), frame.data(), book, last[14], last[15]);
+        adpcm_residuals(last.data() + 8, frame.data() + 8, book, last[6],
+                        last[7]);
+        std::copy(last.begin(), last.end(), samples(dmemo));
+        dmemo += 32;
+    }
+    store_blob(state_address, reinterpret_cast<const uint16_t *>(last.data()),
+               16);
+}
+
+void resample(bool init, uint16_t dmemo, uint16_t dmemi, uint32_t count,
+              uint32_t pitch, uint32_t state_address) {
+    const auto &lut = state().ucode->resample_lut;
+    int16_t *buf = state().buffer.data();
+    constexpr uint32_t MASK = BUF_BYTES / 2 - 1;
+    uint32_t ipos = (dmemi >> 1) - 4;
+    uint32_t opos = dmemo >> 1;
+    uint32_t accu = 0;
+
+    std::array<uint16_t, 5> saved{};
+    if (!init)
+        load_blob(saved.data(), state_address, 5);
+    for (uint32_t k = 0; k < 4; k++)
+        buf[(ipos + k) & MASK] = static_cast<int16_t>(saved[k]);
+    accu = saved[4];
+
+    for (uint32_t n = count >> 1; n != 0; n--) {
+        const int16_t *taps = lut.data() + ((accu & 0xFC00) >> 8);
+        int32_t sum = 0;
+        for (uint32_t k = 0; k < 4; k++)
+            sum += (buf[(ipos + k) & MASK] * taps[k]) >> 15;
+        buf[opos++ & MASK] = clamp16(sum);
+        accu += pitch;
+        ipos += accu >> 16;
+        accu &= 0xFFFF;
+    }
+
+    for (uint32_t k = 0; k < 4; k++)
+        saved[k] = static_cast<uint16_t>(buf[(ipos + k) & MASK]);
+    saved[4] = static_cast<uint16_t>(accu);
+    store_blob(state_address, saved.data(), 5);
+}
+
+struct Ramp {
+    int32_t value;
+    int32_t target;
+    int32_t step;
+
+    int16_t next() {
+        value += step;
+        const bool reached = step <= 0 ? value <= target : value >= target;
+        if (reached) {
+            value = target;
+            step = 0;
+        }
+        return static_cast<int16_t>(value >> 16);
+    }
+};
+
+// Volume ramps approach their target exponentially, 8 samples per step.
+void envmixer(bool init, bool aux, uint32_t state_address) {
+    auto &s = state();
+    const uint32_t outputs = aux ? 4 : 2;
+    int16_t *in = samples(s.in);
+    int16_t *dst[4] = {samples(s.out), samples(s.dry_right),
+                       samples(s.wet_left), samples(s.wet_right)};
+    int16_t dry = s.dry;
+    int16_t wet = s.wet;
+    std::array<Ramp, 2> ramp;
+    std::array<int32_t, 2> rate, seq;
+
+    // Save area: wet, dry, then target, rate, seq and value for each side
+    // as high/low halfword pairs.
+    std::array<uint16_t, 18> saved{};
+    const auto word = [&](uint32_t i) {
+        return static_cast<int32_t>((saved[i] << 16) | saved[i + 1]);
+    };
+    if (init) {
+        for (uint32_t c = 0; c < 2; c++) {
+            ramp[c].value = s.vol[c] * 65536;
+            ramp[c].target = s.target[c] * 65536;
+            rate[c] = s.rate[c];
+            seq[c] = static_cast<int32_t>(static_cast<int64_t>(s.vol[c]) *
+                                          s.rate[c]);
+        }
+    } else {
+        load_blob(saved.data(), state_address, 18);
+        wet = static_cast<int16_t>(saved[0]);
+        dry = static_cast<int16_t>(saved[1]);
+        for (uint32_t c = 0; c < 2; c++) {
+            ramp[c].target = word(2 + c * 2);
+            rate[c] = word(6 + c * 2);
+            seq[c] = word(10 + c * 2);
+            ramp[c].value = word(14 + c * 2);
+        }
+    }
+    for (auto &r : ramp)
+        r.step = r.target - r.value;
+
+    const uint32_t n = cap(s.count) >> 1;
+    for (uint32_t base = 0; base < n; base += 8) {
+        for (uint32_t c = 0; c < 2; c++) {
+            if (ramp[c].step == 0)
+                continue;
+            seq[c] = static_cast<int32_t>(
+                (static_cast<int64_t>(seq[c]) * rate[c]) >> 16);
+            ramp[c].step = (seq[c] - ramp[c].value) >> 3;
+        }
+        std::array<std::array<int16_t, 8>, 4> gains;
+        for (uint32_t x = 0; x < 8; x++) {
+            const int16_t l = ramp[0].next();
+            const int16_t r = ramp[1].next();
+            gains[0][x] = clamp16((l * dry + 0x4000) >> 15);
+            gains[1][x] = clamp16((r * dry + 0x4000) >> 15);
+            gains[2][x] = clamp16((l * wet + 0x4000) >> 15);
+            gains[3][x] = clamp16((r * wet + 0x4000) >> 15);
+        }
+        for (uint32_t o = 0; o < outputs; o++) {
+            int16_t *d = dst[o] + base;
+            const int16_t *src = in + base;
+            for (uint32_t x = 0; x < 8; x++)
+                d[x] = clamp16(d[x] + ((src[x] * gains[o][x]) >> 15));
+        }
+    }
+
+    const auto put = [&](uint32_t i, int32_t v) {
+        saved[i] = static_cast<uint16_t>(static_cast<uint32_t>(v) >> 16);
+        saved[i + 1] = static_cast<uint16_t>(v);
+    };
+    saved[0] = static_cast<uint16_t>(wet);
+    saved[1] = static_cast<uint16_t>(dry);
+    for (uint32_t c = 0; c < 2; c++) {
+        put(2 + c * 2, ramp[c].target);
+        put(6 + c * 2, rate[c]);
+        put(10 + c * 2, seq[c]);
+        put(14 + c * 2, ramp[c].value);
+    }
+    store_blob(state_address, saved.data(), 18);
+}
+
+// --- Command list -------------------------------------------------------
+
+void run_command(uint32_t w1, uint32_t w2) {
+    auto &s = state();
+    const uint8_t flags = static_cast<uint8_t>(w1 >> 16);
+    s.cycles += COMMAND_CYCLES;
+    switch (static_cast<Acmd>((w1 >> 24) & 0x7F)) {
+    case SPNOOP:
+        break;
+    case ADPCM:
+        s.cycles += s.count;
+        adpcm(flags & A_INIT, flags & A_LOOP, s.out, s.in,
+              cap(align(s.count, 32)), s.loop, address_of(w2));
+        break;
+    case CLEARBUFF: {
+        const uint32_t bytes = cap(align(w2 & 0xFFFF, 16));
+        std::fill_n(samples(DMEM_BASE + (w1 & 0xFFFF)), bytes >> 1, 0);
+        break;
+    }
+    case ENVMIXER:
+        s.cycles += s.count;
+        envmixer(flags & A_INIT, flags & A_AUX, address_of(w2));
+        break;
+    case LOADBUFF:
+        if (s.count != 0)
+            rdram_load(reinterpret_cast<uint16_t *>(samples(s.in & ~3u)),
+                       address_of(w2) & ~7u, cap(align(s.count, 8)) >> 1);
+        break;
+    case RESAMPLE:
+        s.cycles += s.count;
+        resample(flags & A_INIT, s.out, s.in, cap(align(s.count, 16)),
+                 (w1 & 0xFFFF) << 1, address_of(w2));
+        break;
+    case SAVEBUFF:
+        if (s.count != 0) {
+            const uint32_t address = address_of(w2) & ~7u;
+            const auto *src =
+                reinterpret_cast<const uint16_t *>(samples(s.out & ~3u));
+            const uint32_t halfwords = cap(align(s.count, 8)) >> 1;
+            rdram_store(address, src, halfwords);
+            if (s.recording)
+                s.output.push_back({address, {src, src + halfwords}});
+        }
+        break;
+    case SEGMENT:
+        if (((w2 >> 24) & 0x3F) < N_SEGMENTS)
+            s.segments[(w2 >> 24) & 0x3F] = w2 & 0xFFFFFF;
+        break;
+    case SETBUFF: {
+        const auto dmem = static_cast<uint16_t>(DMEM_BASE + (w1 & 0xFFFF));
+        const auto dmemo = static_cast<uint16_t>(DMEM_BASE + (w2 >> 16));
+        const auto count = static_cast<uint16_t>(w2);
+        if (flags & A_AUX) {
+            s.dry_right = dmem;
+            s.wet_left = dmemo;
+            s.wet_right = static_cast<uint16_t>(DMEM_BASE + count);
+        } else {
+            s.in = dmem;
+            s.out = dmemo;
+            s.count = count;
+        }
+        break;
+    }
+    case SETVOL: {
+        const auto vol = static_cast<int16_t>(w1);
+        if (flags & A_VOL) {
+            if (flags & A_LEFT) {
+                s.vol[0] = vol;
+                s.dry = static_cast<int16_t>(w2 >> 16);
+                s.wet = static_cast<int16_t>(w2);
+            } else {
+                s.vol[1] = vol;
+            }
+        } else {
+            const uint32_t side = (flags & A_LEFT) ? 0 : 1;
+            s.target[side] = vol;
+            s.rate[side] = static_cast<int32_t>(w2);
+        }
+        break;
+    }
+    case DMEMMOVE: {
+        uint32_t from = DMEM_BASE + (w1 & 0xFFFF);
+        uint32_t to = DMEM_BASE + (w2 >> 16);
+        // Byte by byte, front to back, as overlapping moves rely on.
+        for (uint32_t n = cap(align(w2 & 0xFFFF, 16)); n != 0; n--)
+            buffer_u8(to++) = buffer_u8(from++);
+        break;
+    }
+    case LOADADPCM: {
+        const uint32_t halfwords = std::min<uint32_t>(
+            align(w1 & 0xFFFF, 8) >> 1, static_cast<uint32_t>(
+                                              s.adpcm_table.size()));
+        rdram_load(reinterpret_cast<uint16_t *>(s.adpcm_table.data()),
+                   address_of(w2), halfwords);
+        break;
+    }
+    case MIXER:
+        if (s.count != 0) {
+            s.cycles += s.count;
+            mix(samples(DMEM_BASE + (w2 & 0xFFFF)),
+                samples(DMEM_BASE + (w2 >> 16)), cap(align(s.count, 32)) >> 1,
+                static_cast<int16_t>(w1));
+        }
+        break;
+    case INTERLEAVE:
+        if (s.count != 0) {
+            s.cycles += s.count;
+            // The output is twice the input.
+            interleave(samples(s.out), samples(DMEM_BASE + (w2 >> 16)),
+                       samples(DMEM_BASE + (w2 & 0xFFFF)),
+                       std::min(align(s.count, 16), BUF_BYTES / 2) >> 1);
+        }
+        break;
+    case SETLOOP:
+        s.loop = address_of(w2);
+        break;
+    default:
+        break; // rejected by supported()
+    }
+}
+
+bool supported(uint32_t list, uint32_t commands) {
+    for (uint32_t i = 0; i < commands; i++) {
+        const uint32_t id = (rdram_u32(list + i * 8) >> 24) & 0x7F;
+        if (id == POLEF || id > SETLOOP)
+            return false;
+    }
+    return true;
+}
+
+// Finds the resample filter in the ucode's data segment: 64 rows of 4
+// taps, each row summing to about 1.0 (Q15), weight moving from the second
+// tap to the third as the fraction grows.
+bool find_resample_lut(uint32_t data, uint32_t size, Ucode &u) {
+    constexpr uint32_t TABLE_BYTES = 64 * 4 * 2;
+    for (uint32_t at = 0; at + TABLE_BYTES <= size; at += 8) {
+        std::array<int16_t, 64 * 4> t;
+        rdram_load(reinterpret_cast<uint16_t *>(t.data()), data + at,
+                   64 * 4);
+        bool ok = t[1] > t[2] && t[4 * 63 + 2] > t[4 * 63 + 1];
+        for (uint32_t row = 0; ok && row < 64; row++) {
+            const int16_t *r = t.data() + row * 4;
+            const int32_t sum = r[0] + r[1] + r[2] + r[3];
+            ok = sum > 0x7E00 && sum < 0x8200;
+        }
+        if (ok) {
+            u.resample_lut = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Standard ABI1 and the GoldenEye / Blast Corps revisions of it, which
+// share its command set, told apart by words of their data segment.
+bool is_abi1(uint32_t data) {
+    if (rdram_u32(data) != 1 || rdram_u32(data + 0x30) != 0xF0000F00)
+        return false;
+    const uint32_t v = rdram_u32(data + 0x28);
+    return v == 0x1E24138C || v == 0x1DC8138C || v == 0x1E3C1390;
+}
+
+Ucode &identify(std::span<const uint8_t> dmem) {
+    auto &s = state();
+    const uint32_t text = dmem_u32(dmem, TASK_UCODE);
+    const uint32_t text_size =
+        std::min<uint32_t>(dmem_u32(dmem, TASK_UCODE_SIZE), 0x1000);
+    const uint32_t data = dmem_u32(dmem, TASK_UCODE_DATA);
+    const uint32_t data_size =
+        std::min<uint32_t>(dmem_u32(dmem, TASK_UCODE_DATA_SIZE), 0x1000);
+    uint64_t h = 0xCBF29CE484222325ull;
+    h = fnv1a(h, text, text_size);
+    h = fnv1a(h, data, data_size);
+    const auto [it, added] = s.ucodes.try_emplace(h);
+    Ucode &u = it->second;
+    if (!added)
+        return u;
+    if (!is_abi1(data)) {
+        Utils::info("Audio HLE: unknown audio ucode {:016x}, using LLE", h);
+        return u;
+    }
+    u.hle = find_resample_lut(data, data_size, u);
+    if (u.hle)
+        Utils::info("Audio HLE: ABI1 ucode {:016x}", h);
+    else
+        Utils::warn("Audio HLE: no resample table in ucode {:016x}, using "
+                    "LLE",
+                    h);
+    return u;
+}
+
+void undo_writes() {
+    auto &s = state();
+    s.recording = false;
+    for (auto it = s.undo.rbegin(); it != s.undo.rend(); ++it)
+        rdram_store(it->address, it->data.data(),
+                    static_cast<uint32_t>(it->data.size()));
+    s.undo.clear();
+}
+
+} // namespace
+
+void set_audio_hle(bool on, bool compare) {
+    audio_hle_reset();
+    state().on = on || compare;
+    state().compare = compare;
+}
+
+bool audio_hle() { return state().on; }
+
+uint32_t audio_hle_task(std::span<const uint8_t> dmem) {
+    auto &s = state();
+    if (!s.on || dmem_u32(dmem, TASK_TYPE) != M_AUDTASK ||
+        (dmem_u32(dmem, TASK_FLAGS) & OS_TASK_YIELDED))
+        return 0;
+    WorkProfile::Scoped timer(WorkProfile::Bucket::RspTask);
+    Ucode &u = identify(dmem);
+    if (!u.hle)
+        return 0;
+    const uint32_t list = dmem_u32(dmem, TASK_DATA_PTR) & RDRAM_SIZE_MASK;
+    const uint32_t commands =
+        std::min<uint32_t>(dmem_u32(dmem, TASK_DATA_SIZE), 0x10000) / 8;
+    if (!supported(list, commands)) {
+        // Its save areas would then be in a mix of layouts; keep it LLE.
+        Utils::warn("Audio HLE: unsupported command in list, using LLE from "
+                    "now on");
+        u.hle = false;
+        return 0;
+    }
+
+    s.ucode = &u;
+    s.segments.fill(0);
+    s.cycles = TASK_CYCLES;
+    s.recording = s.compare;
+    s.output.clear();
+    for (uint32_t i = 0; i < commands; i++)
+        run_command(rdram_u32(list + i * 8), rdram_u32(list + i * 8 + 4));
+    if (!s.compare)
+        return s.cycles;
+    undo_writes();
+    s.pending = true;
+    return 0;
+}
+
+void audio_hle_check() {
+    auto &s = state();
+    if (!s.pending)
+        return;
+    s.pending = false;
+    ++s.compared;
+    uint32_t bad = 0;
+    uint32_t first = 0;
+    uint16_t want = 0, got = 0;
+    for (const auto &w : s.output) {
+        for (uint32_t i = 0; i < w.data.size(); i++) {
+            const uint16_t v = rdram_u16(w.address + i * 2);
+            if (v == w.data[i])
+                continue;
+            if (bad++ == 0) {
+                first = w.address + i * 2;
+                want = v;
+                got = w.data[i];
+            }
+        }
+    }
+    if (bad == 0)
+        return;
+    if (++s.mismatched <= 16)
+        Utils::warn("Audio HLE: {} samples differ from LLE (first at "
+                    "{:#08x}: LLE {:04x}, HLE {:04x}; {}/{} tasks)",
+                    bad, first, want, got, s.mismatched, s.compared);
+}
+
+bool audio_hle_compare_passed() {
+    const auto &s = state();
+    if (!s.compare)
+        return true;
+    Utils::info("Audio HLE compare: {}/{} tasks differ from LLE",
+                s.mismatched, s.compared);
+    return s.mismatched == 0;
+}
+
+void audio_hle_reset() {
+    auto &s = state();
+    s.ucodes.clear();
+    s.ucode = nullptr;
+    s.recording = false;
+    s.undo.clear();
+    s.output.clear();
+    s.pending = false;
+    s.blobs.clear();
+}
+
+} // namespace Rsp
+} // namespace N64
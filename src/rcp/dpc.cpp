@@ -39,6 +39,47 @@ void Dpc::reset() {
     g_dpc_leftover_words = 0;
 }
 
+void Dpc::save_state(Utils::StateWriter &w) const {
+    w.pod(start);
+    w.pod(end);
+    w.pod(current);
+    w.pod(status);
+    w.pod(clock);
+    w.pod(tmem);
+    w.pod(g_dpc_leftover_words);
+    w.bytes(g_dpc_cmd_buf,
+            static_cast<size_t>(g_dpc_leftover_words) * sizeof(uint32_t));
+}
+
+void Dpc::load_state(Utils::StateReader &r) {
+    r.pod(start);
+    r.pod(end);
+    r.pod(current);
+    r.pod(status);
+    r.pod(clock);
+    r.pod(tmem);
+    int leftover = 0;
+    r.pod(leftover);
+    if (leftover < 0 || leftover > static_cast<int>(RDP_COMMAND_BUFFER_SIZE)) {
+        r.fail();
+        return;
+    }
+    r.bytes(g_dpc_cmd_buf, static_cast<size_t>(leftover) * sizeof(uint32_t));
+    g_dpc_leftover_words = r.ok() ? leftover : 0;
+}
+
+void Dpc::check_state(Utils::StateReader &r) {
+    r.view(sizeof(start) + sizeof(end) + sizeof(current) + sizeof(status) +
+           sizeof(clock) + sizeof(tmem));
+    int leftover = 0;
+    r.pod(leftover);
+    if (leftover < 0 || leftover > static_cast<int>(RDP_COMMAND_BUFFER_SIZE)) {
+        r.fail();
+        return;
+    }
+    r.view(static_cast<size_t>(leftover) * sizeof(uint32_t));
+}
+
 uint32_t Dpc::read_paddr32(uint32_t paddr) const {
     switch (paddr) {
     case PADDR_DPC_START:
@@ -1,4 +1,5 @@
 #include "rcp/rsp.h"
+#include "cpu/cpu.h"
 #include "cpu/jit/invalidate_hook.h"
 #include "debugger/debugger.h"
 #include "memory/memory.h"
@@ -6,12 +7,19 @@
 #include "mmio/mi.h"
 #include "n64_system/interrupt.h"
 #include "n64_system/scheduler.h"
+#include "rcp/audio_hle.h"
 #include "rcp/dpc.h"
+#if N64_RSP_JIT
+#include "rcp/rsp_jit.h"
+#endif
 #include "rcp/vu_profile.h"
 #include "rdp/rdp_core.h"
 #include "utils/byte_array.h"
+#include "utils/dma_copy.h"
 #include "utils/log.h"
 #include "utils/work_profile.h"
+#include <algorithm>
+#include <optional>
 
 namespace N64 {
 namespace Rsp {
@@ -56,6 +64,9 @@ inline int16_t imm_se(uint32_t i) { return static_cast<int16_t>(i & 0xFFFF); }
 inline uint16_t imm_ze(uint32_t i) { return static_cast<uint16_t>(i & 0xFFFF); }
 inline uint32_t target(uint32_t i) { return (i & 0x03FFFFFF) << 2; }
 
+// Instruction cap per task slice (guards against a runaway microcode loop).
+constexpr uint32_t kMaxSliceInsns = 10'000'000u;
+
 Rsp::ImemFn special_table[64] = {};
 Rsp::ImemFn primary_table[64] = {};
 bool decode_tables_ready = false;
@@ -135,6 +146,23 @@ void Rsp::refresh_imem_word(uint16_t addr) {
 void Rsp::rebuild_imem_cache() {
     for (uint16_t a = 0; a < SP_IMEM_SIZE; a += 4)
         refresh_imem_word(a);
+#if N64_RSP_JIT
+    g_rsp_jit().note_imem_written();
+#endif
+}
+
+void Rsp::invalidate_imem_cache() {
+    for (uint32_t i = 0; i < SP_IMEM_WORDS; ++i)
+        imem_insns_[i] = ImemInsn{&Rsp::op_undecoded, i};
+#if N64_RSP_JIT
+    g_rsp_jit().note_imem_written();
+#endif
+}
+
+void Rsp::op_undecoded(Rsp &r, uint32_t word_index) {
+    r.refresh_imem_word(static_cast<uint16_t>(word_index << 2));
+    const ImemInsn &insn = r.imem_insns_[word_index];
+    insn.fn(r, insn.opcode);
 }
 
 void Rsp::note_imem_written(uint16_t offset, uint32_t length) {
@@ -142,10 +170,14 @@ void Rsp::note_imem_written(uint16_t offset, uint32_t length) {
         return;
     for (uint32_t i = 0; i < length; i += 4)
         refresh_imem_word(static_cast<uint16_t>((offset + i) & 0xFFF));
+#if N64_RSP_JIT
+    g_rsp_jit().note_imem_written();
+#endif
 }
 
 void Rsp::reset() {
     Utils::debug("Resetting RSP");
+    abandon_task();
     set_pc(0);
     delay_slot_ = false;
     status_reg.raw = 0;
@@ -173,12 +205,86 @@ void Rsp::reset() {
     divin_loaded_ = false;
     sync_point_ = false;
     broken_ = false;
+    hle_task_ = false;
     task_halted_ = false;
     running_task_ = false;
     run_after_dma_ = false;
     last_status_signals_ = 0;
     last_dpc_busy_ = 0;
     task_cycle_counter_ = 0;
+    task_pending_ = false;
+    task_start_ = 0;
+    dma_pages_.reset();
+    audio_hle_reset();
+}
+
+void Rsp::save_state(Utils::StateWriter &w) const {
+    w.pod(sp_dmem);
+    w.pod(sp_imem);
+    w.pod(pc);
+    w.pod(next_pc);
+    w.pod(delay_slot_);
+    w.pod(status_reg);
+    w.pod(mem_addr);
+    w.pod(dram_addr);
+    w.pod(shadow_mem_addr);
+    w.pod(shadow_dram_addr);
+    w.pod(dma);
+    w.pod(semaphore_held);
+    w.pod(sync_point_);
+    w.pod(broken_);
+    w.pod(hle_task_);
+    w.pod(task_halted_);
+    w.pod(running_task_);
+    w.pod(run_after_dma_);
+    w.pod(last_status_signals_);
+    w.pod(last_dpc_busy_);
+    w.pod(task_cycle_counter_);
+    w.pod(gpr_);
+    w.pod(vpr_);
+    w.pod(acc_);
+    w.pod(vcc_);
+    w.pod(vco_);
+    w.pod(vce_);
+    w.pod(divin_);
+    w.pod(divout_);
+    w.pod(divin_loaded_);
+}
+
+void Rsp::load_state(Utils::StateReader &r) {
+    r.pod(sp_dmem);
+    r.pod(sp_imem);
+    r.pod(pc);
+    r.pod(next_pc);
+    r.pod(delay_slot_);
+    r.pod(status_reg);
+    r.pod(mem_addr);
+    r.pod(dram_addr);
+    r.pod(shadow_mem_addr);
+    r.pod(shadow_dram_addr);
+    r.pod(dma);
+    r.pod(semaphore_held);
+    r.pod(sync_point_);
+    r.pod(broken_);
+    r.pod(hle_task_);
+    r.pod(task_halted_);
+    r.pod(running_task_);
+    r.pod(run_after_dma_);
+    r.pod(last_status_signals_);
+    r.pod(last_dpc_busy_);
+    r.pod(task_cycle_counter_);
+    r.pod(gpr_);
+    r.pod(vpr_);
+    r.pod(acc_);
+    r.pod(vcc_);
+    r.pod(vco_);
+    r.pod(vce_);
+    r.pod(divin_);
+    r.pod(divout_);
+    r.pod(divin_loaded_);
+    // Snapshots are taken after sync(), so nothing is ever pending in one.
+    task_pending_ = false;
+    invalidate_imem_cache();
 }
 
 void Rsp::set_pc(uint16_t value) {
@@ -187,6 +293,26 @@ void Rsp::set_pc(uint16_t value) {
     delay_slot_ = false;
 }
 
+void Rsp::set_jit(bool on) {
+#if N64_RSP_JIT
+    if (on && !g_rsp_jit().supported()) {
+        Utils::warn("RSP JIT needs SSSE3/SSE4.1; using the interpreter");
+        on = false;
+    }
+#else
+    if (on)
+        Utils::warn("RSP JIT not built for this host; using the interpreter");
+    on = false;
+#endif
+    jit_ = on;
+}
+
+void Rsp::set_threaded(bool on, bool check) {
+    abandon_task();
+    threaded_ = on || check;
+    thread_check_ = check;
+}
+
 void Rsp::branch(uint16_t target_pc) { next_pc = target_pc & 0xffc; }
 
 void Rsp::take_break() {
@@ -195,42 +321,212 @@ void Rsp::take_break() {
 }
 
 uint64_t Rsp::run_until_sync() {
+    begin_run();
+    run_insns(false);
+    return finish_run();
+}
+
+void Rsp::begin_run() {
     broken_ = false;
     task_cycle_counter_ = 0;
     running_task_ = true;
     sync_point_ = false;
+    slice_insns_ = 0;
+    slice_begun_ = true;
+}
 
-    constexpr uint32_t kMaxInsns = 10'000'000u;
-    uint32_t ran = 0;
-    while (!sync_point_ && !broken_ && !task_halted_ && ran < kMaxInsns) {
-        if (status_reg.halt)
-            break;
+bool Rsp::slice_done() const {
+    return sync_point_ || broken_ || task_halted_ || status_reg.halt ||
+           slice_insns_ >= kMaxSliceInsns;
+}
+
+// Runs the current slice until it ends (true) or, with `private_only`, until
+// the next instruction is a COP0 access (false).
+bool Rsp::run_insns(bool private_only) {
+    while (!slice_done()) {
+        if (private_only &&
+            op(Utils::read_from_byte_array32(sp_imem, pc & 0xFFC)) == OPC_COP0)
+            return false;
+#if N64_RSP_JIT
+        // Blocks never start in a delay slot and never cross the cap.
+        if (jit_ && !status_reg.single_step && next_pc == ((pc + 4) & 0xffc) &&
+            kMaxSliceInsns - slice_insns_ >= RspJit::MAX_BLOCK_INSNS) {
+            const RspJit::Block &block = g_rsp_jit().lookup(*this, pc);
+            if (block.fn) {
+                const uint32_t n = block.fn();
+                slice_insns_ += n;
+                task_cycle_counter_ += n;
+                slice_vu_ops_ += block.vu_ops_upto[n];
+                continue;
+            }
+        }
+#endif
         step();
-        ++ran;
+        ++slice_insns_;
         ++task_cycle_counter_;
     }
+    return true;
+}
+
+uint64_t Rsp::finish_run() {
     running_task_ = false;
-    WorkProfile::add_rsp_insns(ran);
-    if (ran >= kMaxInsns)
+    slice_begun_ = false;
+    flush_profile();
+    if (slice_insns_ >= kMaxSliceInsns)
         Utils::warn("RSP run_until_sync hit instruction cap");
-    return (task_cycle_counter_ * 3) / 2;
+    return task_elapsed();
+}
+
+// The worker's tallies reach the shared profiles only here, on the CPU
+// thread, once the slice is no longer running anywhere.
+void Rsp::flush_profile() {
+    WorkProfile::add_rsp_insns(slice_insns_);
+    WorkProfile::add_vu_ops(slice_vu_ops_);
+    slice_vu_ops_ = 0;
+    vu_profile_merge(vu_counts_);
+}
+
+// Runs whatever is left of the current slice on this thread.
+uint64_t Rsp::finish_slice() {
+    if (worker_pending_)
+        collect_worker();
+    if (!slice_begun_)
+        begin_run();
+    run_insns(false);
+    return finish_run();
+}
+
+void Rsp::launch_worker() {
+    if (thread_check_) {
+        check_snapshot_.clear();
+        Utils::StateWriter w(check_snapshot_);
+        save_state(w);
+        check_insns_ = slice_insns_;
+    }
+    worker_pending_ = true;
+    worker_.start([this] { slice_ended_ = run_insns(true); });
+}
+
+void Rsp::collect_worker() {
+    worker_.wait();
+    worker_pending_ = false;
+    if (thread_check_)
+        verify_worker_run();
+}
+
+// The worker stopped in front of a COP0 access (or at the end of the slice,
+// which is then left for the next observation point).
+void Rsp::service_worker() {
+    collect_worker();
+    if (slice_ended_)
+        return;
+    // As in run_deferred(): an interrupt raised here must not re-enter.
+    task_pending_ = false;
+    step();
+    ++slice_insns_;
+    ++task_cycle_counter_;
+    task_pending_ = true;
+    if (!slice_done())
+        launch_worker();
+}
+
+void Rsp::verify_worker_run() {
+    std::vector<uint8_t> worker_state;
+    {
+        Utils::StateWriter w(worker_state);
+        save_state(w);
+    }
+    const uint32_t worker_insns = slice_insns_;
+    const bool pending = task_pending_;
+    // The replay must not count the same instructions twice.
+    const uint64_t worker_vu_ops = slice_vu_ops_;
+    const VuProfileCounts worker_counts = vu_counts_;
+    {
+        Utils::StateReader r(check_snapshot_);
+        load_state(r);
+    }
+    task_pending_ = pending;
+    slice_insns_ = check_insns_;
+    slice_ended_ = run_insns(true);
+    slice_vu_ops_ = worker_vu_ops;
+    vu_counts_ = worker_counts;
+
+    std::vector<uint8_t> replay_state;
+    Utils::StateWriter w(replay_state);
+    save_state(w);
+    if (replay_state != worker_state || slice_insns_ != worker_insns)
+        Utils::abort("RSP worker diverged from its replay (pc {:#05x})", pc);
+}
+
+void Rsp::abandon_task() {
+    worker_.wait();
+    worker_pending_ = false;
+    slice_begun_ = false;
+    task_pending_ = false;
+    running_task_ = false;
 }
 
 void Rsp::do_task() {
-    WorkProfile::Scoped timer(WorkProfile::Bucket::RspTask);
+    const uint64_t now = N64::g_scheduler().get_current_time();
+    if (const uint32_t cycles = audio_hle_task(sp_dmem)) {
+        // The results are already in RDRAM; TASKDONE and the break follow
+        // in end_task_slice() at the task's estimated end.
+        hle_task_ = true;
+        N64::g_scheduler().schedule_at(N64System::EventKind::SpTask,
+                                       now + (uint64_t{cycles} * 3) / 2);
+        return;
+    }
+    if (lazy_ || threaded_)
+        note_task_pages();
+    start_task(now);
+}
+
+namespace {
+// Would an SP/DP interrupt raised right now be taken by the CPU?
+bool cpu_takes_rcp_interrupt() {
+    const auto &mask = g_mi().get_reg_intr_mask();
+    if (!mask.sp && !mask.dp)
+        return false;
+    const auto &status = g_cpu().cop0.reg.status;
+    return status.ie && !status.exl && !status.erl && (status.im & 0x04);
+}
+} // namespace
+
+bool Rsp::begin_task_slice() {
     sync_point_ = false;
     last_status_signals_ = 0;
     last_dpc_busy_ = 0;
     if (status_reg.dma_busy) {
         run_after_dma_ = true;
+        return false;
+    }
+    return true;
+}
+
+void Rsp::start_task(uint64_t start) {
+    if (!begin_task_slice())
         return;
+    task_pending_ = true;
+    task_start_ = start;
+    // Interrupts raised mid-task must reach the CPU at the same point as in
+    // eager mode, so only defer while the CPU can't take them.
+    if ((!lazy_ && !threaded_) || cpu_takes_rcp_interrupt()) {
+        run_deferred(N64::g_scheduler().get_current_time());
+    } else if (threaded_) {
+        begin_run();
+        launch_worker();
     }
-    const uint64_t timer_cycles = run_until_sync();
-    N64::g_scheduler().schedule_named(
-        N64System::NamedEventId::Sp, timer_cycles, [] { g_rsp().on_sp_event(); });
 }
 
-void Rsp::on_sp_event() {
+bool Rsp::end_task_slice() {
+    if (hle_task_) {
+        // Finish as the ucode would: TASKDONE (signal 2), then break.
+        hle_task_ = false;
+        status_reg.signal_2 = 1;
+        broken_ = true;
+    }
+    if (broken_ || task_halted_)
+        audio_hle_check();
     if (broken_) {
         status_reg.halt = 1;
         status_reg.broke = 1;
@@ -238,16 +534,48 @@ void Rsp::on_sp_event() {
             g_mi().get_reg_intr().sp = 1;
             N64System::check_interrupt();
         }
-        return;
+        return false;
     }
     if (task_halted_) {
         status_reg.halt = 1;
         task_halted_ = false;
-        return;
+        return false;
     }
-    if (status_reg.halt)
-        return;
-    do_task();
+    return !status_reg.halt;
+}
+
+void Rsp::on_sp_event() {
+    if (end_task_slice())
+        start_task(N64::g_scheduler().get_current_time());
+}
+
+// Runs the pending task slice by slice. A slice whose completion falls
+// before `limit` was never observed, so its completion is applied right
+// away; the first one at or after `limit` goes to the scheduler at its
+// eager-mode time.
+void Rsp::run_deferred(uint64_t limit) {
+    WorkProfile::Scoped timer(WorkProfile::Bucket::RspTask);
+    while (task_pending_) {
+        task_pending_ = false;
+        const uint64_t done = task_start_ + finish_slice();
+        if (done >= limit) {
+            N64::g_scheduler().schedule_at(N64System::EventKind::SpTask, done);
+            return;
+        }
+        if (!end_task_slice() || !begin_task_slice())
+            return;
+        task_pending_ = true;
+        task_start_ = done;
+    }
+}
+
+void Rsp::run_deferred_now() {
+    run_deferred(N64::g_scheduler().get_current_time());
+}
+
+void Rsp::sync_if_interruptible() {
+    if (task_pending_ && cpu_takes_rcp_interrupt())
+        run_deferred_now();
 }
 
 uint8_t Rsp::dmem_load8(uint32_t addr) const { return sp_dmem[addr & 0xFFF]; }
@@ -596,6 +924,12 @@ void Rsp::write_cp0(int reg, uint32_t value) {
 }
 
 void Rsp::execute_cop0(uint32_t inst) {
+    // COP0 is the task's only way out to the rest of the machine, so it
+    // runs at the task's time whichever thread or mode runs the task.
+    std::optional<N64System::Scheduler::TimeShift> at_task_time;
+    if (running_task_)
+        at_task_time.emplace(N64::g_scheduler(),
+                             task_start_ + task_elapsed());
     const uint8_t sub = rs(inst);
     if (sub == 0x00) { // MFC0
         set_gpr(rt(inst), read_cp0(rd(inst)));
@@ -613,7 +947,7 @@ void Rsp::execute_cop2(uint32_t inst) {
         return;
     }
     const uint8_t sub = rs(inst);
-    vu_profile_cop2_move(sub);
+    vu_profile_cop2_move(vu_counts_, sub);
     const uint8_t vd = rd(inst);
     const uint8_t vt = rt(inst);
     const uint8_t element = sa(inst) >> 1; // rough; MFC2/MTC2 use element
@@ -750,6 +1084,72 @@ void Rsp::write_paddr32(uint32_t paddr, uint32_t value) {
     }
 }
 
+void Rsp::note_dma_pages(uint32_t dram_address, uint32_t length) {
+    if (length == 0)
+        return;
+    const uint32_t first = dram_address >> 12;
+    const uint32_t last = (dram_address + length - 1) >> 12;
+    for (uint32_t p = first; p <= last; ++p)
+        dma_pages_.set(p % dma_pages_.size());
+}
+
+// A deferred task may write a page no DMA has touched yet, and the CPU
+// must not get to it first. Before a task starts, mark the buffers its
+// OSTask header (DMEM 0xFC0) names. Graphics FIFO ucodes keep an end
+// pointer in output_buff_size; a size is below the start and is skipped.
+void Rsp::note_task_pages() {
+    const auto ptr = [this](uint32_t offset) {
+        return dmem_load32(offset) & 0x1FFF'FFFF;
+    };
+    const auto note = [this](uint32_t start, uint32_t length) {
+        if (start < RDRAM_SIZE)
+            note_dma_pages(start, std::min(length, RDRAM_SIZE - start));
+    };
+    note(ptr(0xFD0), dmem_load32(0xFD4)); // ucode
+    note(ptr(0xFD8), dmem_load32(0xFDC)); // ucode_data
+    note(ptr(0xFE0), dmem_load32(0xFE4)); // dram_stack
+    note(ptr(0xFF0), dmem_load32(0xFF4)); // data_ptr
+    note(ptr(0xFF8), dmem_load32(0xFFC)); // yield_data_ptr
+    const uint32_t output = ptr(0xFE8);
+    const uint32_t output_end = ptr(0xFEC);
+    if (output < output_end)
+        note(output, output_end - output);
+}
+
+namespace {
+// IMEM matches the RDRAM host-endian layout; DMEM is big-endian.
+Utils::DmaLayout sp_layout(bool imem) {
+    return imem ? Utils::DmaLayout::HostWords : Utils::DmaLayout::BigEndian;
+}
+
+// One row of an SP DMA. Rows are 8-byte aligned: the SP side wraps at its
+// 4 KiB end, and RDRAM past its end reads as zero and drops writes.
+void copy_dma_row(std::span<uint8_t> sp, Utils::DmaLayout layout,
+                  std::span<uint8_t> rdram, uint32_t mem_address,
+                  uint32_t dram_address, uint32_t length, bool to_sp) {
+    while (length > 0) {
+        mem_address &= 0xFFF;
+        const uint32_t chunk = std::min(length, SP_DMEM_SIZE - mem_address);
+        const uint32_t in_rdram =
+            dram_address < RDRAM_SIZE
+                ? std::min(chunk, RDRAM_SIZE - dram_address)
+                : 0;
+        if (to_sp) {
+            Utils::dma_copy(sp, mem_address, layout, rdram, dram_address,
+                            Utils::DmaLayout::HostWords, in_rdram);
+            std::fill_n(sp.begin() + mem_address + in_rdram, chunk - in_rdram,
+                        uint8_t{0});
+        } else {
+            Utils::dma_copy(rdram, dram_address, Utils::DmaLayout::HostWords,
+                            sp, mem_address, layout, in_rdram);
+        }
+        mem_address += chunk;
+        dram_address += chunk;
+        length -= chunk;
+    }
+}
+} // namespace
+
 void Rsp::dma_read() {
     uint32_t length = (dma.length + 1 + 7) & ~7u;
     uint32_t dram_address = shadow_dram_addr.address & RSP_DRAM_ADDR_MASK;
@@ -762,20 +1162,13 @@ void Rsp::dma_read() {
         dma.count == 0 ? length
                        : (dma.count + 1) * length + dma.count * dma.skip;
     Rdp::check_framebuffers(dram_address, check_len);
+    note_dma_pages(dram_address, check_len);
 
     for (uint32_t i = 0; i < dma.count + 1; i++) {
-        const uint32_t row_mem = mem_address;
-        for (uint32_t j = 0; j < length; j++) {
-            uint16_t addr = (mem_address + j) & 0xFFF;
-            // IMEM matches RDRAM host-endian layout; DMEM is big-endian so
-            uint16_t index =
-                to_imem ? addr
-                        : static_cast<uint16_t>(Utils::byte_address(addr));
-            uint32_t dram_i = dram_address + j;
-            mem[index] = (dram_i < RDRAM_SIZE) ? rdram[dram_i] : 0;
-        }
+        copy_dma_row(mem, sp_layout(to_imem), rdram, mem_address, dram_address,
+                     length, true);
         if (to_imem)
-            note_imem_written(static_cast<uint16_t>(row_mem), length);
+            note_imem_written(static_cast<uint16_t>(mem_address), length);
         uint32_t skip = (i == dma.count) ? 0 : dma.skip;
         dram_address = (dram_address + length + skip) & RSP_DRAM_ADDR_MASK;
         mem_address = (mem_address + length) & RSP_MEM_ADDR_MASK;
@@ -799,17 +1192,11 @@ void Rsp::dma_write() {
         dma.count == 0 ? length
                        : (dma.count + 1) * length + dma.count * dma.skip;
     Rdp::on_rdram_write(dram_address, check_len);
+    note_dma_pages(dram_address, check_len);
 
     for (uint32_t i = 0; i < dma.count + 1; i++) {
-        for (uint32_t j = 0; j < length; j++) {
-            uint16_t addr = (mem_address + j) & 0xFFF;
-            uint16_t index =
-                from_imem ? addr
-                          : static_cast<uint16_t>(Utils::byte_address(addr));
-            uint32_t dram_i = dram_address + j;
-            if (dram_i < RDRAM_SIZE)
-                rdram[dram_i] = mem[index];
-        }
+        copy_dma_row(mem, sp_layout(from_imem), rdram, mem_address,
+                     dram_address, length, false);
         uint32_t skip = (i == dma.count) ? 0 : dma.skip;
         dram_address = (dram_address + length + skip) & RSP_DRAM_ADDR_MASK;
         mem_address = (mem_address + length) & RSP_MEM_ADDR_MASK;
@@ -830,7 +1217,8 @@ void Rsp::status_reg_write(uint32_t value) {
     if (write.clear_halt && !write.set_halt)
         status_reg.halt = 0;
     if (!write.clear_halt && write.set_halt) {
-        N64::g_scheduler().cancel_named(N64System::NamedEventId::Sp);
+        N64::g_scheduler().cancel(N64System::EventKind::SpTask);
+        hle_task_ = false;
         status_reg.halt = 1;
     }
     if (write.clear_broke)
@@ -0,0 +1,1258 @@
+#include "rcp/rsp_jit.h"
+#include "utils/byte_array.h"
+#include "utils/log.h"
+#include <xbyak/xbyak.h>
+#include <xbyak/xbyak_util.h>
+#include <algorithm>
+#include <cstring>
+
+namespace N64 {
+namespace Rsp {
+
+namespace {
+
+using namespace Xbyak;
+using namespace Xbyak::util;
+
+#ifdef _WIN32
+// Microsoft x64: RCX, RDX + 32-byte shadow; XMM6-15 are callee-saved.
+constexpr size_t kAbiStackAdjust = 0x28;
+constexpr size_t kXmmSaveBytes = 10 * 16;
+#define JIT_ARG1q rcx
+#define JIT_ARG2d edx
+#else
+constexpr size_t kAbiStackAdjust = 8;
+constexpr size_t kXmmSaveBytes = 0;
+#define JIT_ARG1q rdi
+#define JIT_ARG2d esi
+#endif
+
+constexpr size_t kCodeBytes = 4 * 1024 * 1024;
+// Worst case for one block; the arena is flushed when less is left.
+constexpr size_t kMaxBlockBytes = 64 * 1024;
+
+constexpr uint8_t OPC_SPECIAL = 0x00;
+constexpr uint8_t OPC_REGIMM = 0x01;
+constexpr uint8_t OPC_J = 0x02;
+constexpr uint8_t OPC_JAL = 0x03;
+constexpr uint8_t OPC_BEQ = 0x04;
+constexpr uint8_t OPC_BNE = 0x05;
+constexpr uint8_t OPC_BLEZ = 0x06;
+constexpr uint8_t OPC_BGTZ = 0x07;
+constexpr uint8_t OPC_ADDI = 0x08;
+constexpr uint8_t OPC_ADDIU = 0x09;
+constexpr uint8_t OPC_SLTI = 0x0A;
+constexpr uint8_t OPC_SLTIU = 0x0B;
+constexpr uint8_t OPC_ANDI = 0x0C;
+constexpr uint8_t OPC_ORI = 0x0D;
+constexpr uint8_t OPC_XORI = 0x0E;
+constexpr uint8_t OPC_LUI = 0x0F;
+constexpr uint8_t OPC_COP0 = 0x10;
+constexpr uint8_t OPC_COP2 = 0x12;
+constexpr uint8_t OPC_LB = 0x20;
+constexpr uint8_t OPC_LH = 0x21;
+constexpr uint8_t OPC_LW = 0x23;
+constexpr uint8_t OPC_LBU = 0x24;
+constexpr uint8_t OPC_LHU = 0x25;
+constexpr uint8_t OPC_SB = 0x28;
+constexpr uint8_t OPC_SH = 0x29;
+constexpr uint8_t OPC_SW = 0x2B;
+constexpr uint8_t OPC_LWC2 = 0x32;
+constexpr uint8_t OPC_SWC2 = 0x3A;
+
+constexpr uint8_t FN_JR = 0x08;
+constexpr uint8_t FN_JALR = 0x09;
+constexpr uint8_t FN_BREAK = 0x0D;
+
+constexpr uint8_t VU_LQV = 0x04;
+
+inline uint8_t op(uint32_t i) { return static_cast<uint8_t>((i >> 26) & 0x3F); }
+inline uint8_t rs(uint32_t i) { return static_cast<uint8_t>((i >> 21) & 0x1F); }
+inline uint8_t rt(uint32_t i) { return static_cast<uint8_t>((i >> 16) & 0x1F); }
+inline uint8_t rd(uint32_t i) { return static_cast<uint8_t>((i >> 11) & 0x1F); }
+inline uint8_t sa(uint32_t i) { return static_cast<uint8_t>((i >> 6) & 0x1F); }
+inline uint8_t funct(uint32_t i) { return static_cast<uint8_t>(i & 0x3F); }
+inline int16_t imm_se(uint32_t i) { return static_cast<int16_t>(i & 0xFFFF); }
+inline uint16_t imm_ze(uint32_t i) { return static_cast<uint16_t>(i & 0xFFFF); }
+
+bool is_regimm_branch(uint32_t inst) {
+    switch (rt(inst)) {
+    case 0x00: // BLTZ
+    case 0x01: // BGEZ
+    case 0x10: // BLTZAL
+    case 0x11: // BGEZAL
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool is_control(uint32_t inst) {
+    switch (op(inst)) {
+    case OPC_SPECIAL:
+        return funct(inst) == FN_JR || funct(inst) == FN_JALR;
+    case OPC_REGIMM:
+        return is_regimm_branch(inst);
+    case OPC_J:
+    case OPC_JAL:
+    case OPC_BEQ:
+    case OPC_BNE:
+    case OPC_BLEZ:
+    case OPC_BGTZ:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Ops the interpreter treats as reserved (they log the PC) end a block.
+bool is_compilable(uint32_t inst) {
+    switch (op(inst)) {
+    case OPC_SPECIAL:
+        switch (funct(inst)) {
+        case 0x00: case 0x02: case 0x03: case 0x04: case 0x06: case 0x07:
+        case FN_JR: case FN_JALR: case FN_BREAK:
+        case 0x20: case 0x21: case 0x22: case 0x23: case 0x24: case 0x25:
+        case 0x26: case 0x27: case 0x2A: case 0x2B:
+            return true;
+        default:
+            return false;
+        }
+    case OPC_REGIMM:
+        return is_regimm_branch(inst);
+    case OPC_J: case OPC_JAL: case OPC_BEQ: case OPC_BNE: case OPC_BLEZ:
+    case OPC_BGTZ: case OPC_ADDI: case OPC_ADDIU: case OPC_SLTI:
+    case OPC_SLTIU: case OPC_ANDI: case OPC_ORI: case OPC_XORI: case OPC_LUI:
+    case OPC_COP0: case OPC_COP2: case OPC_LB: case OPC_LH: case OPC_LW:
+    case OPC_LBU: case OPC_LHU: case OPC_SB: case OPC_SH: case OPC_SW:
+    case OPC_LWC2: case OPC_SWC2:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool is_vu_compute(uint32_t inst) {
+    return op(inst) == OPC_COP2 && (inst & (1u << 25)) != 0;
+}
+
+bool is_native_vu(uint32_t inst) {
+    if (!is_vu_compute(inst))
+        return false;
+    switch (funct(inst)) {
+    case 0x00: // VMULF
+    case 0x01: // VMULU
+    case 0x04: // VMUDL
+    case 0x05: // VMUDM
+    case 0x06: // VMUDN
+    case 0x07: // VMUDH
+    case 0x08: // VMACF
+    case 0x09: // VMACU
+    case 0x0C: // VMADL
+    case 0x0D: // VMADM
+    case 0x0E: // VMADN
+    case 0x0F: // VMADH
+    case 0x10: // VADD
+    case 0x11: // VSUB
+    case 0x1D: // VSAR
+    case 0x27: // VMRG
+    case 0x28: // VAND
+    case 0x29: // VNAND
+    case 0x2A: // VOR
+    case 0x2B: // VNOR
+    case 0x2C: // VXOR
+    case 0x2D: // VNXOR
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Lane sources per element field; same table as broadcast_vt().
+constexpr int broadcast_lane(int element, int dest_lane) {
+    if (element < 2)
+        return dest_lane;
+    if (element < 4)
+        return (dest_lane & ~1) | (element & 1);
+    if (element < 8)
+        return (dest_lane & ~3) | (element & 3);
+    return element & 7;
+}
+
+struct ElementShuffles {
+    alignas(16) uint8_t ctrl[16][16];
+};
+
+constexpr ElementShuffles make_element_shuffles() {
+    ElementShuffles t{};
+    for (int e = 0; e < 16; e++) {
+        for (int d = 0; d < 8; d++) {
+            const int s = broadcast_lane(e, d);
+            t.ctrl[e][2 * d] = static_cast<uint8_t>(2 * s);
+            t.ctrl[e][2 * d + 1] = static_cast<uint8_t>(2 * s + 1);
+        }
+    }
+    return t;
+}
+
+constexpr ElementShuffles kElementShuffle = make_element_shuffles();
+alignas(16) constexpr uint16_t kLaneBits[8] = {0x01, 0x02, 0x04, 0x08,
+                                               0x10, 0x20, 0x40, 0x80};
+alignas(16) constexpr uint16_t kSign16[8] = {0x8000, 0x8000, 0x8000, 0x8000,
+                                             0x8000, 0x8000, 0x8000, 0x8000};
+// DMEM is big-endian; VuReg lanes are host uint16.
+alignas(16) constexpr uint8_t kSwap16[16] = {1, 0, 3,  2,  5,  4,  7,  6,
+                                             9, 8, 11, 10, 13, 12, 15, 14};
+
+uint64_t hash_imem(const std::array<uint8_t, SP_IMEM_SIZE> &imem) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < SP_IMEM_SIZE; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, imem.data() + i, sizeof(w));
+        h = (h ^ w) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+} // namespace
+
+class RspEmitter : public Xbyak::CodeGenerator {
+  public:
+    RspEmitter(const Rsp &rsp, const bool *imem_dirty)
+        : CodeGenerator(kCodeBytes), imem_dirty_(imem_dirty) {
+        const auto off = [&](const void *p) {
+            return static_cast<int32_t>(reinterpret_cast<uintptr_t>(p) -
+                                        reinterpret_cast<uintptr_t>(&rsp));
+        };
+        base_ = reinterpret_cast<uintptr_t>(&rsp);
+        gpr_off_ = off(rsp.gpr_.data());
+        vpr_off_ = off(rsp.vpr_.data());
+        acc_off_[0] = off(&rsp.acc_.l);
+        acc_off_[1] = off(&rsp.acc_.m);
+        acc_off_[2] = off(&rsp.acc_.h);
+        vcc_off_ = off(&rsp.vcc_);
+        vco_off_ = off(&rsp.vco_);
+        dmem_off_ = off(rsp.sp_dmem.data());
+        pc_off_ = off(&rsp.pc);
+        next_pc_off_ = off(&rsp.next_pc);
+        delay_slot_off_ = off(&rsp.delay_slot_);
+        sync_point_off_ = off(&rsp.sync_point_);
+        broken_off_ = off(&rsp.broken_);
+        task_halted_off_ = off(&rsp.task_halted_);
+        status_off_ = off(&rsp.status_reg);
+        sp_status_t stop{};
+        stop.halt = 1;
+        stop.single_step = 1;
+        stop_mask_ = stop.raw;
+    }
+
+    bool has_room() const { return getSize() + kMaxBlockBytes <= kCodeBytes; }
+
+    RspJit::BlockFn emit(const std::vector<uint32_t> &insts, uint16_t pc,
+                         RspJit::Block &out) {
+        const size_t n = insts.size();
+        auto *entry = const_cast<uint8_t *>(getCurr());
+        for (auto &s : slots_)
+            s = Slot{};
+
+        push(rbp);
+        push(r12);
+        sub(rsp, kAbiStackAdjust + kXmmSaveBytes);
+#ifdef _WIN32
+        for (int i = 0; i < kVecSlots; i++)
+            movdqu(xword[rsp + 0x20 + i * 16], kSlotRegs[i]);
+#endif
+        mov(rbp, base_);
+
+        Label exit_label;
+        std::vector<std::pair<Label, size_t>> stops;
+        stops.reserve(n);
+        const bool ends_in_branch = n >= 2 && is_control(insts[n - 2]);
+        uint8_t vu_ops = 0;
+        out.vu_ops_upto[0] = 0;
+
+        for (size_t i = 0; i < n; i++) {
+            const uint32_t inst = insts[i];
+            const uint16_t addr = static_cast<uint16_t>((pc + 4 * i) & 0xFFC);
+            const bool flags = emit_op(inst, addr);
+            if (is_native_vu(inst))
+                ++vu_ops;
+            out.vu_ops_upto[i + 1] = vu_ops;
+            // COP0 / BREAK may stop the task (the interpreter checks the same
+            // flags after every instruction) or start a DMA into IMEM.
+            if (flags && i + 1 < n) {
+                stops.emplace_back(Label{}, i);
+                mov(al, byte[rbp + sync_point_off_]);
+                or_(al, byte[rbp + broken_off_]);
+                or_(al, byte[rbp + task_halted_off_]);
+                mov(rdx, reinterpret_cast<uintptr_t>(imem_dirty_));
+                or_(al, byte[rdx]);
+                jnz(stops.back().first, T_NEAR);
+                test(dword[rbp + status_off_], stop_mask_);
+                jnz(stops.back().first, T_NEAR);
+            }
+        }
+
+        write_back_all();
+        if (ends_in_branch) {
+            mov(word[rbp + pc_off_], r12w);
+            lea(eax, ptr[r12 + 4]);
+            and_(eax, 0xFFC);
+            mov(word[rbp + next_pc_off_], ax);
+        } else {
+            const uint16_t last = static_cast<uint16_t>((pc + 4 * (n - 1)) & 0xFFC);
+            mov(word[rbp + pc_off_], static_cast<uint16_t>((last + 4) & 0xFFC));
+            mov(word[rbp + next_pc_off_],
+                static_cast<uint16_t>((last + 8) & 0xFFC));
+        }
+        mov(byte[rbp + delay_slot_off_], 0);
+        mov(eax, static_cast<uint32_t>(n));
+
+        L(exit_label);
+#ifdef _WIN32
+        for (int i = 0; i < kVecSlots; i++)
+            movdqu(kSlotRegs[i], xword[rsp + 0x20 + i * 16]);
+#endif
+        add(rsp, kAbiStackAdjust + kXmmSaveBytes);
+        pop(r12);
+        pop(rbp);
+        ret();
+
+        // Early stops follow a helper call, so no vector register is cached.
+        for (auto &[label, i] : stops) {
+            const uint16_t addr = static_cast<uint16_t>((pc + 4 * i) & 0xFFC);
+            L(label);
+            mov(word[rbp + pc_off_], static_cast<uint16_t>((addr + 4) & 0xFFC));
+            mov(word[rbp + next_pc_off_],
+                static_cast<uint16_t>((addr + 8) & 0xFFC));
+            mov(byte[rbp + delay_slot_off_], 0);
+            mov(eax, static_cast<uint32_t>(i + 1));
+            jmp(exit_label, T_NEAR);
+        }
+
+        out.num_insns = static_cast<uint8_t>(n);
+        return reinterpret_cast<RspJit::BlockFn>(entry);
+    }
+
+  private:
+    // XMM6-15 cache VU registers and the accumulator slices for the whole
+    // block; XMM0-5 are scratch. Every helper call writes the cache back.
+    static constexpr int kVecSlots = 10;
+    static inline const Xmm kSlotRegs[kVecSlots] = {
+        Xmm(6),  Xmm(7),  Xmm(8),  Xmm(9),  Xmm(10),
+        Xmm(11), Xmm(12), Xmm(13), Xmm(14), Xmm(15)};
+    static constexpr int ACC_L = 32;
+    static constexpr int ACC_M = 33;
+    static constexpr int ACC_H = 34;
+
+    struct Slot {
+        int reg{-1};
+        bool dirty{false};
+        uint32_t stamp{0};
+    };
+
+    const bool *imem_dirty_;
+    uintptr_t base_{};
+    int32_t gpr_off_{};
+    int32_t vpr_off_{};
+    int32_t acc_off_[3]{};
+    int32_t vcc_off_{};
+    int32_t vco_off_{};
+    int32_t dmem_off_{};
+    int32_t pc_off_{};
+    int32_t next_pc_off_{};
+    int32_t delay_slot_off_{};
+    int32_t sync_point_off_{};
+    int32_t broken_off_{};
+    int32_t task_halted_off_{};
+    int32_t status_off_{};
+    uint32_t stop_mask_{};
+    std::array<Slot, kVecSlots> slots_{};
+    uint32_t stamp_{0};
+
+    int32_t vec_disp(int r) const {
+        return r < 32 ? vpr_off_ + r * 16 : acc_off_[r - ACC_L];
+    }
+
+    void spill(int i) {
+        if (slots_[i].reg >= 0 && slots_[i].dirty) {
+            movdqu(xword[rbp + vec_disp(slots_[i].reg)], kSlotRegs[i]);
+            slots_[i].dirty = false;
+        }
+    }
+
+    int slot_of(int r, bool load) {
+        for (int i = 0; i < kVecSlots; i++) {
+            if (slots_[i].reg == r) {
+                slots_[i].stamp = ++stamp_;
+                return i;
+            }
+        }
+        int pick = -1;
+        for (int i = 0; i < kVecSlots && pick < 0; i++) {
+            if (slots_[i].reg < 0)
+                pick = i;
+        }
+        if (pick < 0) {
+            pick = 0;
+            for (int i = 1; i < kVecSlots; i++) {
+                if (slots_[i].stamp < slots_[pick].stamp)
+                    pick = i;
+            }
+            spill(pick);
+        }
+        slots_[pick] = Slot{r, false, ++stamp_};
+        if (load)
+            movdqu(kSlotRegs[pick], xword[rbp + vec_disp(r)]);
+        return pick;
+    }
+
+    const Xmm &use(int r) { return kSlotRegs[slot_of(r, true)]; }
+    // Read-modify-write (accumulator slices).
+    const Xmm &modify(int r) {
+        const int i = slot_of(r, true);
+        slots_[i].dirty = true;
+        return kSlotRegs[i];
+    }
+    // Fully overwritten; no load.
+    const Xmm &def(int r) {
+        const int i = slot_of(r, false);
+        slots_[i].dirty = true;
+        return kSlotRegs[i];
+    }
+
+    void write_back_all() {
+        for (int i = 0; i < kVecSlots; i++)
+            spill(i);
+    }
+
+    void forget_all() {
+        write_back_all();
+        for (auto &s : slots_)
+            s = Slot{};
+    }
+
+    // After a helper on a cold path: the cache must match the hot path.
+    void reload_all() {
+        for (int i = 0; i < kVecSlots; i++) {
+            if (slots_[i].reg >= 0)
+                movdqu(kSlotRegs[i], xword[rbp + vec_disp(slots_[i].reg)]);
+        }
+    }
+
+    void call_helper(const void *fn, uint32_t inst) {
+        mov(JIT_ARG1q, rbp);
+        mov(JIT_ARG2d, inst);
+        mov(rax, reinterpret_cast<uintptr_t>(fn));
+        call(rax);
+    }
+
+    // Unconditional interpreter op.
+    void emit_interp(Rsp::ImemFn fn, uint32_t inst) {
+        forget_all();
+        call_helper(reinterpret_cast<const void *>(fn), inst);
+    }
+
+    void load_gpr(const Reg32 &r, int n) {
+        if (n == 0)
+            xor_(r, r);
+        else
+            mov(r, dword[rbp + gpr_off_ + n * 4]);
+    }
+
+    void store_gpr(int n, const Reg32 &r) {
+        if (n != 0)
+            mov(dword[rbp + gpr_off_ + n * 4], r);
+    }
+
+    void store_gpr_imm(int n, uint32_t v) {
+        if (n != 0)
+            mov(dword[rbp + gpr_off_ + n * 4], v);
+    }
+
+    // eax = (gpr[base] + offset) & 0xFFF
+    void dmem_addr(int base, int32_t offset) {
+        load_gpr(eax, base);
+        if (offset != 0)
+            add(eax, offset);
+        and_(eax, 0xFFF);
+    }
+
+    // Returns true if the op may have stopped the task (flags to check).
+    bool emit_op(uint32_t inst, uint16_t addr) {
+        const uint16_t link = static_cast<uint16_t>((addr + 8) & 0xFFC);
+        const uint16_t branch_target =
+            static_cast<uint16_t>((addr + 4 + (imm_se(inst) << 2)) & 0xFFC);
+
+        switch (op(inst)) {
+        case OPC_SPECIAL:
+            return emit_special(inst, link);
+        case OPC_REGIMM: {
+            load_gpr(eax, rs(inst));
+            if (rt(inst) & 0x10)
+                store_gpr_imm(31, link);
+            mov(r12d, link);
+            mov(edx, branch_target);
+            cmp(eax, 0);
+            if (rt(inst) & 1)
+                cmovge(r12d, edx);
+            else
+                cmovl(r12d, edx);
+            return false;
+        }
+        case OPC_J:
+        case OPC_JAL:
+            if (op(inst) == OPC_JAL)
+                store_gpr_imm(31, link);
+            mov(r12d, ((inst & 0x03FFFFFF) << 2) & 0xFFC);
+            return false;
+        case OPC_BEQ:
+        case OPC_BNE:
+        case OPC_BLEZ:
+        case OPC_BGTZ:
+            load_gpr(eax, rs(inst));
+            mov(r12d, link);
+            mov(edx, branch_target);
+            if (op(inst) == OPC_BEQ || op(inst) == OPC_BNE) {
+                load_gpr(ecx, rt(inst));
+                cmp(eax, ecx);
+            } else {
+                cmp(eax, 0);
+            }
+            switch (op(inst)) {
+            case OPC_BEQ:
+                cmove(r12d, edx);
+                break;
+            case OPC_BNE:
+                cmovne(r12d, edx);
+                break;
+            case OPC_BLEZ:
+                cmovle(r12d, edx);
+                break;
+            default:
+                cmovg(r12d, edx);
+                break;
+            }
+            return false;
+        case OPC_ADDI:
+        case OPC_ADDIU:
+            if (rt(inst) == 0)
+                return false;
+            load_gpr(eax, rs(inst));
+            add(eax, imm_se(inst));
+            store_gpr(rt(inst), eax);
+            return false;
+        case OPC_SLTI:
+        case OPC_SLTIU:
+            if (rt(inst) == 0)
+                return false;
+            load_gpr(eax, rs(inst));
+            cmp(eax, imm_se(inst));
+            if (op(inst) == OPC_SLTI)
+                setl(cl);
+            else
+                setb(cl);
+            movzx(ecx, cl);
+            store_gpr(rt(inst), ecx);
+            return false;
+        case OPC_ANDI:
+        case OPC_ORI:
+        case OPC_XORI:
+            if (rt(inst) == 0)
+                return false;
+            load_gpr(eax, rs(inst));
+            if (op(inst) == OPC_ANDI)
+                and_(eax, imm_ze(inst));
+            else if (op(inst) == OPC_ORI)
+                or_(eax, imm_ze(inst));
+            else
+                xor_(eax, imm_ze(inst));
+            store_gpr(rt(inst), eax);
+            return false;
+        case OPC_LUI:
+            store_gpr_imm(rt(inst), static_cast<uint32_t>(imm_ze(inst)) << 16);
+            return false;
+        case OPC_COP0:
+            emit_interp(&Rsp::op_cop0, inst);
+            return true;
+        case OPC_COP2:
+            if (is_native_vu(inst))
+                emit_vu(inst);
+            else
+                emit_interp(&Rsp::op_cop2, inst);
+            return false;
+        case OPC_LB:
+        case OPC_LBU:
+        case OPC_LH:
+        case OPC_LHU:
+        case OPC_LW:
+            emit_load(inst);
+            return false;
+        case OPC_SB:
+        case OPC_SH:
+        case OPC_SW:
+            emit_store(inst);
+            return false;
+        case OPC_LWC2:
+        case OPC_SWC2:
+            emit_vu_mem(inst);
+            return false;
+        default:
+            return false;
+        }
+    }
+
+    bool emit_special(uint32_t inst, uint16_t link) {
+        const uint8_t f = funct(inst);
+        switch (f) {
+        case FN_JR:
+        case FN_JALR:
+            load_gpr(eax, rs(inst));
+            and_(eax, 0xFFC);
+            mov(r12d, eax);
+            if (f == FN_JALR)
+                store_gpr_imm(rd(inst), link);
+            return false;
+        case FN_BREAK:
+            emit_interp(&Rsp::spec_break, inst);
+            return true;
+        default:
+            break;
+        }
+        if (rd(inst) == 0)
+            return false;
+        switch (f) {
+        case 0x00: // SLL
+        case 0x02: // SRL
+        case 0x03: // SRA
+            load_gpr(eax, rt(inst));
+            if (f == 0x00)
+                shl(eax, sa(inst));
+            else if (f == 0x02)
+                shr(eax, sa(inst));
+            else
+                sar(eax, sa(inst));
+            break;
+        case 0x04: // SLLV
+        case 0x06: // SRLV
+        case 0x07: // SRAV
+            load_gpr(eax, rt(inst));
+            load_gpr(ecx, rs(inst));
+            if (f == 0x04)
+                shl(eax, cl);
+            else if (f == 0x06)
+                shr(eax, cl);
+            else
+                sar(eax, cl);
+            break;
+        case 0x2A: // SLT
+        case 0x2B: // SLTU
+            load_gpr(eax, rs(inst));
+            load_gpr(ecx, rt(inst));
+            cmp(eax, ecx);
+            if (f == 0x2A)
+                setl(al);
+            else
+                setb(al);
+            movzx(eax, al);
+            break;
+        default: // ADD(U), SUB(U), AND, OR, XOR, NOR
+            load_gpr(eax, rs(inst));
+            load_gpr(ecx, rt(inst));
+            switch (f) {
+            case 0x20:
+            case 0x21:
+                add(eax, ecx);
+                break;
+            case 0x22:
+            case 0x23:
+                sub(eax, ecx);
+                break;
+            case 0x24:
+                and_(eax, ecx);
+                break;
+            case 0x25:
+                or_(eax, ecx);
+                break;
+            case 0x26:
+                xor_(eax, ecx);
+                break;
+            default:
+                or_(eax, ecx);
+                not_(eax);
+                break;
+            }
+            break;
+        }
+        store_gpr(rd(inst), eax);
+        return false;
+    }
+
+    // DMEM is big-endian and wraps at 4 KiB: one wide access + byte swap
+    // unless the access crosses the end, then byte by byte.
+    void emit_load(uint32_t inst) {
+        const uint8_t o = op(inst);
+        const int size = (o == OPC_LW) ? 4 : (o == OPC_LH || o == OPC_LHU) ? 2 : 1;
+        dmem_addr(rs(inst), imm_se(inst));
+        if (size == 1) {
+            if (o == OPC_LB)
+                movsx(ecx, byte[rbp + rax + dmem_off_]);
+            else
+                movzx(ecx, byte[rbp + rax + dmem_off_]);
+        } else {
+            Label wrap, done;
+            cmp(eax, 0x1000 - size);
+            ja(wrap, T_NEAR);
+            if (size == 4) {
+                mov(ecx, dword[rbp + rax + dmem_off_]);
+                bswap(ecx);
+            } else {
+                movzx(ecx, word[rbp + rax + dmem_off_]);
+                rol(cx, 8);
+            }
+            jmp(done, T_NEAR);
+            L(wrap);
+            xor_(ecx, ecx);
+            for (int k = 0; k < size; k++) {
+                if (k != 0) {
+                    shl(ecx, 8);
+                    inc(eax);
+                    and_(eax, 0xFFF);
+                }
+                movzx(edx, byte[rbp + rax + dmem_off_]);
+                or_(ecx, edx);
+            }
+            L(done);
+            if (o == OPC_LH)
+                movsx(ecx, cx);
+            else if (o == OPC_LHU)
+                movzx(ecx, cx);
+        }
+        store_gpr(rt(inst), ecx);
+    }
+
+    void emit_store(uint32_t inst) {
+        const uint8_t o = op(inst);
+        const int size = (o == OPC_SW) ? 4 : (o == OPC_SH) ? 2 : 1;
+        dmem_addr(rs(inst), imm_se(inst));
+        load_gpr(ecx, rt(inst));
+        if (size == 1) {
+            mov(byte[rbp + rax + dmem_off_], cl);
+            return;
+        }
+        Label wrap, done;
+        cmp(eax, 0x1000 - size);
+        ja(wrap, T_NEAR);
+        if (size == 4) {
+            bswap(ecx);
+            mov(dword[rbp + rax + dmem_off_], ecx);
+        } else {
+            rol(cx, 8);
+            mov(word[rbp + rax + dmem_off_], cx);
+        }
+        jmp(done, T_NEAR);
+        L(wrap);
+        for (int k = 0; k < size; k++) {
+            if (k != 0) {
+                inc(eax);
+                and_(eax, 0xFFF);
+            }
+            mov(edx, ecx);
+            shr(edx, 8 * (size - 1 - k));
+            mov(byte[rbp + rax + dmem_off_], dl);
+        }
+        L(done);
+    }
+
+    // LQV/SQV with element 0 on a 16-byte boundary is one 128-bit access;
+    // other addresses and every other LWC2/SWC2 op use vu_load/vu_store.
+    void emit_vu_mem(uint32_t inst) {
+        const bool load = op(inst) == OPC_LWC2;
+        const auto fn = load ? &vu_load : &vu_store;
+        const int vt = rt(inst);
+        const int element = (inst >> 7) & 0xF;
+        if (((inst >> 11) & 0x1F) != VU_LQV || element != 0) {
+            emit_interp(fn, inst);
+            return;
+        }
+        const int32_t offset =
+            (static_cast<int32_t>(static_cast<int8_t>((inst & 0x7F) << 1)) >> 1)
+            << 4;
+        // An unaligned LQV only replaces part of vt, so keep its old value.
+        const Xmm &v = load ? modify(vt) : use(vt);
+        dmem_addr(rs(inst), offset);
+        Label slow, done;
+        test(eax, 15);
+        jnz(slow, T_NEAR);
+        mov(rdx, reinterpret_cast<uintptr_t>(kSwap16));
+        if (load) {
+            movdqu(v, xword[rbp + rax + dmem_off_]);
+            pshufb(v, xword[rdx]);
+        } else {
+            movdqa(xmm0, v);
+            pshufb(xmm0, xword[rdx]);
+            movdqu(xword[rbp + rax + dmem_off_], xmm0);
+        }
+        jmp(done, T_NEAR);
+        L(slow);
+        {
+            // Keep dirty flags: the hot path still owes those write-backs.
+            for (int i = 0; i < kVecSlots; i++) {
+                if (slots_[i].reg >= 0 && slots_[i].dirty)
+                    movdqu(xword[rbp + vec_disp(slots_[i].reg)], kSlotRegs[i]);
+            }
+            call_helper(reinterpret_cast<const void *>(fn), inst);
+            reload_all();
+        }
+        L(done);
+    }
+
+    // Broadcast vt per the element field into xmm1 (or use the slot as is).
+    const Xmm &vt_operand(int vt, int element) {
+        const Xmm &t = use(vt);
+        if (element < 2)
+            return t;
+        movdqa(xmm1, t);
+        mov(rax, reinterpret_cast<uintptr_t>(kElementShuffle.ctrl[element]));
+        pshufb(xmm1, xword[rax]);
+        return xmm1;
+    }
+
+    // Per-lane 0 / 0xFFFF from the low byte of a 16-bit flag register.
+    void flag_lanes(const Xmm &dst, int32_t flag_off) {
+        movzx(eax, word[rbp + flag_off]);
+        movd(dst, eax);
+        pshuflw(dst, dst, 0);
+        pshufd(dst, dst, 0);
+        mov(rax, reinterpret_cast<uintptr_t>(kLaneBits));
+        pand(dst, xword[rax]);
+        pcmpeqw(dst, xword[rax]);
+    }
+
+    // acc += src (16-bit wrap); ov = 0xFFFF where it carried. Needs xmm5 = ~0.
+    void add_carry(const Xmm &acc, const Xmm &src, const Xmm &ov) {
+        movdqa(ov, acc);
+        paddusw(ov, src);
+        paddw(acc, src);
+        pcmpeqw(ov, acc);
+        pxor(ov, xmm5);
+    }
+
+    // Signed clamp of (hi:md) to 16 bits.
+    void sclamp(const Xmm &dst, const Xmm &md, const Xmm &hi, const Xmm &tmp) {
+        movdqa(dst, md);
+        punpcklwd(dst, hi);
+        movdqa(tmp, md);
+        punpckhwd(tmp, hi);
+        packssdw(dst, tmp);
+    }
+
+    // ACC.L if hi:md is a sign extension of md, else 0 / 0xFFFF by sign.
+    void uclamp(const Xmm &dst, const Xmm &lo, const Xmm &md, const Xmm &hi,
+                const Xmm &t1, const Xmm &t2) {
+        movdqa(t1, hi);
+        psraw(t1, 15);
+        movdqa(t2, md);
+        psraw(t2, 15);
+        pcmpeqw(t2, t1);
+        movdqa(dst, hi);
+        pcmpeqw(dst, t1);
+        pand(t2, dst);
+        pxor(dst, dst);
+        pcmpeqw(dst, t1);
+        movdqa(t1, t2);
+        pand(t1, lo);
+        pandn(t2, dst);
+        por(t1, t2);
+        movdqa(dst, t1);
+    }
+
+    // Same algorithms as rsp_vector_simd.cpp, on SSE4.1.
+    void emit_vu(uint32_t inst) {
+        const int vd = (inst >> 6) & 0x1F;
+        const int vs = (inst >> 11) & 0x1F;
+        const int vt = (inst >> 16) & 0x1F;
+        const int element = (inst >> 21) & 0xF;
+        const uint8_t f = funct(inst);
+
+        if (f == 0x1D) { // VSAR
+            if (element >= 8 && element <= 10)
+                movdqa(xmm0, use(ACC_H + 8 - element));
+            else
+                pxor(xmm0, xmm0);
+            movdqa(def(vd), xmm0);
+            return;
+        }
+
+        const Xmm &s = use(vs);
+        const Xmm &t = vt_operand(vt, element);
+
+        switch (f) {
+        case 0x28: // VAND
+        case 0x29: // VNAND
+        case 0x2A: // VOR
+        case 0x2B: // VNOR
+        case 0x2C: // VXOR
+        case 0x2D: // VNXOR
+            movdqa(xmm0, s);
+            if (f <= 0x29)
+                pand(xmm0, t);
+            else if (f <= 0x2B)
+                por(xmm0, t);
+            else
+                pxor(xmm0, t);
+            if (f & 1) {
+                pcmpeqw(xmm5, xmm5);
+                pxor(xmm0, xmm5);
+            }
+            movdqa(def(ACC_L), xmm0);
+            movdqa(def(vd), xmm0);
+            return;
+        case 0x27: // VMRG
+            flag_lanes(xmm2, vcc_off_);
+            movdqa(xmm0, s);
+            pand(xmm0, xmm2);
+            movdqa(xmm3, xmm2);
+            pandn(xmm3, t);
+            por(xmm0, xmm3);
+            movdqa(def(ACC_L), xmm0);
+            movdqa(def(vd), xmm0);
+            mov(word[rbp + vco_off_], 0);
+            return;
+        case 0x10: // VADD
+            flag_lanes(xmm2, vco_off_);
+            psrlw(xmm2, 15);
+            movdqa(xmm0, s);
+            paddw(xmm0, t);
+            paddw(xmm0, xmm2);
+            // clamp(s + t + c) == sat(sat(min + c) + max) for c in {0, 1}.
+            movdqa(xmm3, s);
+            pminsw(xmm3, t);
+            paddsw(xmm3, xmm2);
+            movdqa(xmm4, s);
+            pmaxsw(xmm4, t);
+            paddsw(xmm3, xmm4);
+            movdqa(def(ACC_L), xmm0);
+            movdqa(def(vd), xmm3);
+            mov(word[rbp + vco_off_], 0);
+            return;
+        case 0x11: // VSUB
+            flag_lanes(xmm2, vco_off_);
+            psrlw(xmm2, 15);
+            movdqa(xmm0, s);
+            psubw(xmm0, t);
+            psubw(xmm0, xmm2);
+            pmovsxwd(xmm3, s);
+            pmovsxwd(xmm4, t);
+            psubd(xmm3, xmm4);
+            pmovzxwd(xmm4, xmm2);
+            psubd(xmm3, xmm4);
+            pshufd(xmm4, s, 0xEE);
+            pmovsxwd(xmm4, xmm4);
+            pshufd(xmm5, t, 0xEE);
+            pmovsxwd(xmm5, xmm5);
+            psubd(xmm4, xmm5);
+            pshufd(xmm5, xmm2, 0xEE);
+            pmovzxwd(xmm5, xmm5);
+            psubd(xmm4, xmm5);
+            packssdw(xmm3, xmm4);
+            movdqa(def(ACC_L), xmm0);
+            movdqa(def(vd), xmm3);
+            mov(word[rbp + vco_off_], 0);
+            return;
+        default:
+            break;
+        }
+
+        const bool mac = (f & 0x08) != 0;
+        pcmpeqw(xmm5, xmm5);
+        switch (f & 0x07) {
+        case 0x00: // VMULF / VMACF
+        case 0x01: // VMULU / VMACU
+            if (!mac)
+                emit_vmulf(s, t, f & 1);
+            else
+                emit_vmacf(s, t, f & 1);
+            break;
+        case 0x04: { // VMUDL / VMADL
+            movdqa(xmm2, s);
+            pmulhuw(xmm2, t);
+            if (!mac) {
+                movdqa(def(ACC_L), xmm2);
+                const Xmm &am = def(ACC_M);
+                pxor(am, am);
+                const Xmm &ah = def(ACC_H);
+                pxor(ah, ah);
+                movdqa(xmm0, xmm2);
+                break;
+            }
+            const Xmm &al = modify(ACC_L);
+            const Xmm &am = modify(ACC_M);
+            const Xmm &ah = modify(ACC_H);
+            add_carry(al, xmm2, xmm3);
+            pxor(xmm4, xmm4);
+            psubw(xmm4, xmm3);
+            add_carry(am, xmm4, xmm3);
+            psubw(ah, xmm3);
+            uclamp(xmm0, al, am, ah, xmm3, xmm4);
+            break;
+        }
+        case 0x05: // VMUDM / VMADM
+        case 0x06: // VMUDN / VMADN
+        {
+            const bool vmudm = (f & 0x07) == 0x05;
+            movdqa(xmm0, s);
+            pmullw(xmm0, t);
+            movdqa(xmm2, s);
+            pmulhuw(xmm2, t);
+            // Signed operand: VMUDM's vs, VMUDN's vt.
+            movdqa(xmm3, vmudm ? s : t);
+            psraw(xmm3, 15);
+            pand(xmm3, vmudm ? t : s);
+            psubw(xmm2, xmm3);
+            if (!mac) {
+                movdqa(def(ACC_L), xmm0);
+                movdqa(def(ACC_M), xmm2);
+                const Xmm &ah = def(ACC_H);
+                movdqa(ah, xmm2);
+                psraw(ah, 15);
+                if (vmudm)
+                    movdqa(xmm0, xmm2);
+                break;
+            }
+            const Xmm &al = modify(ACC_L);
+            const Xmm &am = modify(ACC_M);
+            const Xmm &ah = modify(ACC_H);
+            add_carry(al, xmm0, xmm3);
+            psubw(xmm2, xmm3);
+            add_carry(am, xmm2, xmm3);
+            movdqa(xmm4, xmm2);
+            psraw(xmm4, 15);
+            paddw(ah, xmm4);
+            psubw(ah, xmm3);
+            if (vmudm)
+                sclamp(xmm0, am, ah, xmm4);
+            else
+                uclamp(xmm0, al, am, ah, xmm3, xmm4);
+            break;
+        }
+        case 0x07: { // VMUDH / VMADH
+            movdqa(xmm0, s);
+            pmullw(xmm0, t);
+            movdqa(xmm2, s);
+            pmulhw(xmm2, t);
+            if (!mac) {
+                const Xmm &al = def(ACC_L);
+                pxor(al, al);
+                const Xmm &am = def(ACC_M);
+                movdqa(am, xmm0);
+                const Xmm &ah = def(ACC_H);
+                movdqa(ah, xmm2);
+                sclamp(xmm0, am, ah, xmm4);
+                break;
+            }
+            const Xmm &am = modify(ACC_M);
+            const Xmm &ah = modify(ACC_H);
+            add_carry(am, xmm0, xmm3);
+            psubw(xmm2, xmm3);
+            paddw(ah, xmm2);
+            sclamp(xmm0, am, ah, xmm4);
+            break;
+        }
+        default:
+            break;
+        }
+        movdqa(def(vd), xmm0);
+    }
+
+    // Result in xmm0.
+    void emit_vmulf(const Xmm &s, const Xmm &t, bool vmulu) {
+        movdqa(xmm0, s);
+        pmullw(xmm0, t);
+        movdqa(xmm2, s);
+        pmulhw(xmm2, t);
+        movdqa(xmm3, xmm0);
+        psrlw(xmm3, 15);
+        paddw(xmm0, xmm0);
+        movdqa(xmm4, xmm0);
+        psrlw(xmm4, 15);
+        paddw(xmm3, xmm4);
+        const Xmm &al = def(ACC_L);
+        mov(rax, reinterpret_cast<uintptr_t>(kSign16));
+        movdqa(al, xmm0);
+        paddw(al, xword[rax]);
+        paddw(xmm2, xmm2);
+        const Xmm &am = def(ACC_M);
+        movdqa(am, xmm2);
+        paddw(am, xmm3);
+        movdqa(xmm4, s);
+        pcmpeqw(xmm4, t);
+        movdqa(xmm3, am);
+        psraw(xmm3, 15);
+        const Xmm &ah = def(ACC_H);
+        movdqa(ah, xmm4);
+        pandn(ah, xmm3);
+        if (vmulu) {
+            movdqa(xmm2, am);
+            por(xmm2, xmm3);
+            movdqa(xmm0, ah);
+            pandn(xmm0, xmm2);
+        } else {
+            pand(xmm4, xmm3);
+            movdqa(xmm0, am);
+            paddw(xmm0, xmm4);
+        }
+    }
+
+    // Result in xmm0; xmm5 = ~0.
+    void emit_vmacf(const Xmm &s, const Xmm &t, bool vmacu) {
+        movdqa(xmm0, s);
+        pmullw(xmm0, t);
+        movdqa(xmm2, s);
+        pmulhw(xmm2, t);
+        movdqa(xmm3, xmm2);
+        paddw(xmm3, xmm3);
+        movdqa(xmm4, xmm0);
+        psrlw(xmm4, 15);
+        psraw(xmm2, 15);
+        por(xmm3, xmm4);
+        paddw(xmm0, xmm0);
+        const Xmm &al = modify(ACC_L);
+        add_carry(al, xmm0, xmm4);
+        psubw(xmm3, xmm4);
+        pxor(xmm0, xmm0);
+        pcmpeqw(xmm0, xmm3);
+        pand(xmm0, xmm4);
+        psubw(xmm2, xmm0);
+        const Xmm &am = modify(ACC_M);
+        add_carry(am, xmm3, xmm4);
+        const Xmm &ah = modify(ACC_H);
+        paddw(ah, xmm2);
+        psubw(ah, xmm4);
+        if (vmacu) {
+            movdqa(xmm0, ah);
+            psraw(xmm0, 15);
+            movdqa(xmm2, am);
+            psraw(xmm2, 15);
+            por(xmm2, am);
+            pandn(xmm0, xmm2);
+            pxor(xmm3, xmm3);
+            movdqa(xmm4, ah);
+            pcmpgtw(xmm4, xmm3);
+            por(xmm0, xmm4);
+        } else {
+            sclamp(xmm0, am, ah, xmm4);
+        }
+    }
+};
+
+RspJit::RspJit() = default;
+RspJit::~RspJit() = default;
+
+bool RspJit::supported() const {
+    static const bool ok = [] {
+        Xbyak::util::Cpu cpu;
+        return cpu.has(Xbyak::util::Cpu::tSSSE3) &&
+               cpu.has(Xbyak::util::Cpu::tSSE41);
+    }();
+    return ok;
+}
+
+void RspJit::clear() {
+    if (emitter_)
+        emitter_->reset();
+    sets_.clear();
+    current_ = nullptr;
+    imem_dirty_ = true;
+}
+
+void RspJit::select_code_set(const Rsp &rsp) {
+    imem_dirty_ = false;
+    const uint64_t hash = hash_imem(rsp.sp_imem);
+    for (auto &s : sets_) {
+        if (s->hash == hash && s->imem == rsp.sp_imem) {
+            current_ = s.get();
+            current_->last_used = ++use_clock_;
+            return;
+        }
+    }
+    if (sets_.size() >= MAX_CODE_SETS) {
+        // Its code stays in the arena until the next flush.
+        auto lru = std::min_element(sets_.begin(), sets_.end(),
+                                    [](const auto &a, const auto &b) {
+                                        return a->last_used < b->last_used;
+                                    });
+        sets_.erase(lru);
+    }
+    auto set = std::make_unique<CodeSet>();
+    set->hash = hash;
+    set->imem = rsp.sp_imem;
+    set->last_used = ++use_clock_;
+    current_ = set.get();
+    sets_.push_back(std::move(set));
+}
+
+RspJit::Block *RspJit::compile(const Rsp &rsp, uint16_t pc) {
+    if (!emitter_)
+        emitter_ = std::make_unique<RspEmitter>(rsp, &imem_dirty_);
+    if (!emitter_->has_room()) {
+        Utils::debug("RSP JIT: flushing code arena ({} IMEM images)",
+                     sets_.size());
+        clear();
+        select_code_set(rsp);
+    }
+
+    const auto word = [&](uint16_t a) {
+        return Utils::read_from_byte_array32(current_->imem, a & 0xFFC);
+    };
+    std::vector<uint32_t> insts;
+    uint16_t a = pc & 0xFFC;
+    while (insts.size() < MAX_BLOCK_INSNS) {
+        const uint32_t inst = word(a);
+        if (!is_compilable(inst))
+            break;
+        // COP0 only ever opens a block; the threaded mode parks before it.
+        if (op(inst) == OPC_COP0 && !insts.empty())
+            break;
+        if (is_control(inst)) {
+            // Branch + delay slot, unless the slot holds another branch.
+            const uint32_t slot = word(static_cast<uint16_t>(a + 4));
+            if (insts.size() + 2 <= MAX_BLOCK_INSNS && is_compilable(slot) &&
+                !is_control(slot) && op(slot) != OPC_COP0) {
+                insts.push_back(inst);
+                insts.push_back(slot);
+            }
+            break;
+        }
+        insts.push_back(inst);
+        if (op(inst) == OPC_SPECIAL && funct(inst) == FN_BREAK)
+            break;
+        a = static_cast<uint16_t>((a + 4) & 0xFFC);
+    }
+
+    auto block = std::make_unique<Block>();
+    if (!insts.empty())
+        block->fn = emitter_->emit(insts, pc & 0xFFC, *block);
+    Block *raw = block.get();
+    current_->storage.push_back(std::move(block));
+    return raw;
+}
+
+const RspJit::Block &RspJit::lookup(Rsp &rsp, uint16_t pc) {
+    if (imem_dirty_ || !current_)
+        select_code_set(rsp);
+    const size_t idx = (pc & 0xFFC) >> 2;
+    if (Block *b = current_->blocks[idx])
+        return *b;
+    Block *b = compile(rsp, pc);
+    current_->blocks[idx] = b;
+    return *b;
+}
+
+RspJit &RspJit::get_instance() {
+    static RspJit instance;
+    return instance;
+}
+
+} // namespace Rsp
+} // namespace N64
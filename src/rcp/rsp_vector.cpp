@@ -2,12 +2,12 @@
 #include "rcp/rsp_rom.h"
 #include "rcp/vu_profile.h"
 #include "utils/log.h"
-#include "utils/work_profile.h"
 #include <algorithm>
 #include <array>
 #include <bit>
 #include <climits>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 
 namespace N64 {
@@ -204,8 +204,7 @@ void dmem_bulk_store(Rsp &rsp, uint32_t addr, const uint8_t *src, int n) {
 
 } // namespace
 
-void vu_load(Rsp &rsp, uint32_t inst) {
-    vu_profile_lwc2(inst);
+void vu_load_scalar(Rsp &rsp, uint32_t inst) {
     // LWC2 encoding: base, vt, opcode, element, offset
     // https://n64brew.dev/wiki/Reality_Signal_Processor/CPU_Core
     const int base = (inst >> 21) & 0x1F;
@@ -343,8 +342,7 @@ void vu_load(Rsp &rsp, uint32_t inst) {
     }
 }
 
-void vu_store(Rsp &rsp, uint32_t inst) {
-    vu_profile_swc2(inst);
+void vu_store_scalar(Rsp &rsp, uint32_t inst) {
     const int base = (inst >> 21) & 0x1F;
     const int vt = (inst >> 16) & 0x1F;
     const int opcode = (inst >> 11) & 0x1F;
@@ -1034,15 +1032,140 @@ void vu_execute_compute_scalar(Rsp &rsp, uint32_t inst) {
     }
 }
 
+#if N64_RSP_SIMD
+extern const VuKernels vu_kernels_sse41;
+#if N64_VU_AVX2
+extern const VuKernels vu_kernels_avx2;
+#endif
+#if N64_VU_AVX512
+extern const VuKernels vu_kernels_avx512;
+#endif
+#endif
+
+namespace {
+bool g_vu_simd = true;
+
+#if N64_RSP_SIMD
+struct VuIsa {
+    const VuKernels *kernels;
+    bool (*supported)();
+};
+
+// Widest first; the sse41 build is the baseline every SIMD binary needs.
+const VuIsa kVuIsas[] = {
+#if N64_VU_AVX512
+    {&vu_kernels_avx512,
+     [] {
+         return __builtin_cpu_supports("avx512f") &&
+                __builtin_cpu_supports("avx512cd") &&
+                __builtin_cpu_supports("avx512bw") &&
+                __builtin_cpu_supports("avx512dq") &&
+                __builtin_cpu_supports("avx512vl");
+     }},
+#endif
+#if N64_VU_AVX2
+    {&vu_kernels_avx2, [] { return __builtin_cpu_supports("avx2") != 0; }},
+#endif
+    {&vu_kernels_sse41, [] { return true; }},
+};
+
+const VuKernels *g_vu_kernels = &vu_kernels_sse41;
+bool g_vu_isa_selected = false;
+#endif
+} // namespace
+
+void set_vu_simd(bool on) {
+    g_vu_simd = on;
+#if N64_RSP_SIMD
+    if (on)
+        vu_select_isa();
+#endif
+}
+
+bool vu_simd() { return N64_RSP_SIMD && g_vu_simd; }
+
+#if N64_RSP_SIMD
+void vu_select_isa() {
+    if (g_vu_isa_selected)
+        return;
+    g_vu_isa_selected = true;
+    const char *env = std::getenv("N64_VU_ISA");
+    if (env && env[0] != '\0') {
+        if (set_vu_isa(env)) {
+            Utils::info("RSP VU: {} kernels, {} lanes (N64_VU_ISA)", vu_isa(),
+                        vu_lanes());
+            return;
+        }
+        Utils::warn("N64_VU_ISA={}: not built or not supported by this CPU",
+                    env);
+    }
+    for (const auto &isa : kVuIsas) {
+        if (isa.supported()) {
+            g_vu_kernels = isa.kernels;
+            break;
+        }
+    }
+    Utils::info("RSP VU: {} kernels, {} lanes", vu_isa(), vu_lanes());
+}
+
+bool set_vu_isa(const char *name) {
+    for (const auto &isa : kVuIsas) {
+        if (std::strcmp(isa.kernels->name, name) != 0)
+            continue;
+        if (!isa.supported())
+            return false;
+        g_vu_kernels = isa.kernels;
+        return true;
+    }
+    return false;
+}
+
+const char *vu_isa() { return g_vu_kernels->name; }
+
+int vu_lanes() { return g_vu_kernels->lanes; }
+
+void vu_execute_compute_simd(Rsp &rsp, uint32_t inst) {
+    g_vu_kernels->compute(rsp, inst);
+}
+
+void vu_load_simd(Rsp &rsp, uint32_t inst) { g_vu_kernels->load(rsp, inst); }
+
+void vu_store_simd(Rsp &rsp, uint32_t inst) { g_vu_kernels->store(rsp, inst); }
+#endif
+
 void vu_execute_compute(Rsp &rsp, uint32_t inst) {
     // Count only: per-op chrono here dwarfs real VU time at millions ops/s.
-    WorkProfile::add_vu_op();
+    rsp.count_vu_ops(1);
 #if N64_RSP_SIMD
-    vu_execute_compute_simd(rsp, inst);
-#else
-    vu_profile_compute(inst, false);
+    if (g_vu_simd) {
+        g_vu_kernels->compute(rsp, inst);
+        return;
+    }
+#endif
+    vu_profile_compute(rsp.vu_profile_counts(), inst, false);
     vu_execute_compute_scalar(rsp, inst);
+}
+
+void vu_load(Rsp &rsp, uint32_t inst) {
+#if N64_RSP_SIMD
+    if (g_vu_simd) {
+        g_vu_kernels->load(rsp, inst);
+        return;
+    }
+#endif
+    vu_profile_lwc2(rsp.vu_profile_counts(), inst, false);
+    vu_load_scalar(rsp, inst);
+}
+
+void vu_store(Rsp &rsp, uint32_t inst) {
+#if N64_RSP_SIMD
+    if (g_vu_simd) {
+        g_vu_kernels->store(rsp, inst);
+        return;
+    }
 #endif
+    vu_profile_swc2(rsp.vu_profile_counts(), inst, false);
+    vu_store_scalar(rsp, inst);
 }
 
 } // namespace Rsp
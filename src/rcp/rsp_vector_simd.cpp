@@ -2,12 +2,16 @@
 #include "rcp/rsp_rom.h"
 #include "rcp/rsp_simd.h"
 #include "rcp/vu_profile.h"
-#include "utils/log.h"
+#include <cstring>
+#include <vector>
 
 #if N64_RSP_SIMD
 
+N64_VU_TARGET_BEGIN
+
 namespace N64 {
 namespace Rsp {
+namespace N64_VU_NS {
 
 using namespace Simd;
 
@@ -166,6 +170,131 @@ Vu16 simd_vmudh_vmadh(Vi16 vs, Vi16 vt, bool vmadh, Vu16 &acc_l, Vu16 &acc_m,
     return sclamp_md_hi(acc_m, acc_h);
 }
 
+// 16-bit unsigned add carry as 0xFFFF lanes.
+__m128i carry_u16(__m128i a, __m128i b) {
+    const __m128i sum = _mm_add_epi16(a, b);
+    return _mm_cmpeq_epi16(_mm_cmpeq_epi16(_mm_adds_epu16(a, b), sum),
+                           _mm_setzero_si128());
+}
+
+// Low / high 16 bits of the 32-bit lanes of lo:hi (lanes 0..3, 4..7).
+__m128i low_halves(__m128i lo, __m128i hi) {
+    const __m128i m = _mm_set1_epi32(0xFFFF);
+    return _mm_packus_epi32(_mm_and_si128(lo, m), _mm_and_si128(hi, m));
+}
+
+__m128i high_halves(__m128i lo, __m128i hi) {
+    return _mm_packus_epi32(_mm_srli_epi32(lo, 16), _mm_srli_epi32(hi, 16));
+}
+
+// clamp_signed(product >> 1) & ~15 for VMULQ/VMACQ.
+__m128i q_result(__m128i lo, __m128i hi) {
+    return _mm_and_si128(
+        _mm_packs_epi32(_mm_srai_epi32(lo, 1), _mm_srai_epi32(hi, 1)),
+        _mm_set1_epi16(static_cast<short>(0xFFF0)));
+}
+
+__m128i simd_vcl(__m128i s, __m128i t, uint16_t &vcc, uint16_t vco,
+                 uint8_t vce) {
+    const __m128i ones = _mm_set1_epi32(-1);
+    const __m128i lo = flag_mask(vco);
+    const __m128i hi = flag_mask(vco >> 8);
+    const __m128i ce = flag_mask(vce);
+
+    const __m128i sum = _mm_add_epi16(s, t);
+    const __m128i no_carry = _mm_andnot_si128(carry_u16(s, t), ones);
+    const __m128i zero = _mm_cmpeq_epi16(sum, _mm_setzero_si128());
+    const __m128i le_new = _mm_blendv_epi8(_mm_and_si128(zero, no_carry),
+                                           _mm_or_si128(zero, no_carry), ce);
+    const __m128i ge_new = _mm_cmpeq_epi16(_mm_max_epu16(s, t), s);
+
+    // VCO.hi keeps the previous compare; VCO.lo picks which half is live.
+    const __m128i le = _mm_blendv_epi8(flag_mask(vcc), le_new,
+                                       _mm_andnot_si128(hi, lo));
+    // Plain and/or select: GCC 12 miscompiles this one as a blendv under
+    // -mavx512bw -mavx512vl.
+    const __m128i keep = _mm_or_si128(lo, hi);
+    const __m128i ge = _mm_or_si128(_mm_and_si128(keep, flag_mask(vcc >> 8)),
+                                    _mm_andnot_si128(keep, ge_new));
+    vcc = static_cast<uint16_t>(mask_flags(le) | (mask_flags(ge) << 8));
+
+    const __m128i neg_t = _mm_sub_epi16(_mm_setzero_si128(), t);
+    return _mm_blendv_epi8(_mm_blendv_epi8(s, t, ge),
+                           _mm_blendv_epi8(s, neg_t, le), lo);
+}
+
+__m128i simd_vcr(__m128i s, __m128i t, uint16_t &vcc) {
+    const __m128i sign = _mm_srai_epi16(_mm_xor_si128(s, t), 15);
+    const __m128i t_neg = _mm_srai_epi16(t, 15);
+    const __m128i t_le_s =
+        _mm_andnot_si128(_mm_cmpgt_epi16(t, s), _mm_set1_epi32(-1));
+    const __m128i ge = _mm_blendv_epi8(t_le_s, t_neg, sign);
+    const __m128i le =
+        _mm_blendv_epi8(t_neg, _mm_srai_epi16(_mm_add_epi16(s, t), 15), sign);
+    vcc = static_cast<uint16_t>(mask_flags(le) | (mask_flags(ge) << 8));
+    const __m128i check = _mm_blendv_epi8(ge, le, sign);
+    return _mm_blendv_epi8(s, _mm_xor_si128(t, sign), check);
+}
+
+// VRNDP/VRNDN: add vt (<< 16 for odd vs) to the 48-bit accumulator when
+// its sign matches the op.
+__m128i simd_vrnd(__m128i t, bool shift16, bool negative, __m128i &acc_l,
+                  __m128i &acc_m, __m128i &acc_h) {
+    const __m128i t_sign = _mm_srai_epi16(t, 15);
+    const __m128i pl = shift16 ? _mm_setzero_si128() : t;
+    const __m128i pm = shift16 ? t : t_sign;
+
+    const __m128i l = _mm_add_epi16(acc_l, pl);
+    const __m128i c1 = carry_u16(acc_l, pl);
+    const __m128i m1 = _mm_add_epi16(acc_m, pm);
+    const __m128i c2 = _mm_or_si128(
+        carry_u16(acc_m, pm),
+        _mm_and_si128(c1, _mm_cmpeq_epi16(m1, _mm_set1_epi32(-1))));
+    const __m128i m = _mm_sub_epi16(m1, c1);
+    const __m128i h = _mm_sub_epi16(_mm_add_epi16(acc_h, t_sign), c2);
+
+    __m128i take = _mm_srai_epi16(acc_h, 15);
+    if (!negative)
+        take = _mm_andnot_si128(take, _mm_set1_epi32(-1));
+    acc_l = _mm_blendv_epi8(acc_l, l, take);
+    acc_m = _mm_blendv_epi8(acc_m, m, take);
+    acc_h = _mm_blendv_epi8(acc_h, h, take);
+    return to_m128(sclamp_md_hi(from_m128(acc_m), from_m128(acc_h)));
+}
+
+__m128i simd_vmulq(__m128i s, __m128i t, __m128i &acc_l, __m128i &acc_m,
+                   __m128i &acc_h) {
+    const __m128i plo = _mm_mullo_epi16(s, t);
+    const __m128i phi = _mm_mulhi_epi16(s, t);
+    const __m128i round = _mm_set1_epi32(31);
+    __m128i p0 = _mm_unpacklo_epi16(plo, phi);
+    __m128i p1 = _mm_unpackhi_epi16(plo, phi);
+    p0 = _mm_add_epi32(p0, _mm_and_si128(_mm_srai_epi32(p0, 31), round));
+    p1 = _mm_add_epi32(p1, _mm_and_si128(_mm_srai_epi32(p1, 31), round));
+    acc_l = _mm_setzero_si128();
+    acc_m = low_halves(p0, p1);
+    acc_h = high_halves(p0, p1);
+    return q_result(p0, p1);
+}
+
+__m128i simd_vmacq(__m128i &acc_m, __m128i &acc_h) {
+    const auto adjust = [](__m128i p) {
+        const __m128i k32 = _mm_set1_epi32(32);
+        const __m128i clear =
+            _mm_cmpeq_epi32(_mm_and_si128(p, k32), _mm_setzero_si128());
+        const __m128i up = _mm_and_si128(clear, _mm_srai_epi32(p, 31));
+        const __m128i down =
+            _mm_and_si128(clear, _mm_cmpgt_epi32(p, _mm_set1_epi32(31)));
+        return _mm_sub_epi32(_mm_add_epi32(p, _mm_and_si128(up, k32)),
+                             _mm_and_si128(down, k32));
+    };
+    const __m128i p0 = adjust(_mm_unpacklo_epi16(acc_m, acc_h));
+    const __m128i p1 = adjust(_mm_unpackhi_epi16(acc_m, acc_h));
+    acc_m = low_halves(p0, p1);
+    acc_h = high_halves(p0, p1);
+    return q_result(p0, p1);
+}
+
 bool try_execute_simd(Rsp &rsp, uint32_t inst) {
     const int vd = (inst >> 6) & 0x1F;
     const int vs = (inst >> 11) & 0x1F;
@@ -399,8 +528,55 @@ bool try_execute_simd(Rsp &rsp, uint32_t inst) {
         return true;
     }
 
-        // VCL/VCR: keep scalar for now (flag mixing is awkward with eve logical
-        // types).
+    case 0x24:   // VCL
+    case 0x26: { // VCR
+        uint16_t vcc = rsp.vcc_ref();
+        const __m128i out =
+            funct == 0x24 ? simd_vcl(to_m128(vs_u), to_m128(vt_u), vcc,
+                                     rsp.vco_ref(), rsp.vce_ref())
+                          : simd_vcr(to_m128(vs_u), to_m128(vt_u), vcc);
+        store_vu(dest, from_m128(out));
+        set_acc_low(rsp, from_m128(out));
+        rsp.vcc_ref() = vcc;
+        rsp.vco_ref() = 0;
+        rsp.vce_ref() = 0;
+        return true;
+    }
+
+    case 0x02:   // VRNDP
+    case 0x0A: { // VRNDN
+        __m128i al = to_m128(load_acc_l(rsp));
+        __m128i am = to_m128(load_acc_m(rsp));
+        __m128i ah = to_m128(load_acc_h(rsp));
+        const __m128i out =
+            simd_vrnd(to_m128(vt_u), (vs & 1) != 0, funct == 0x0A, al, am, ah);
+        store_acc_l(rsp, from_m128(al));
+        store_acc_m(rsp, from_m128(am));
+        store_acc_h(rsp, from_m128(ah));
+        store_vu(dest, from_m128(out));
+        return true;
+    }
+
+    case 0x03: { // VMULQ
+        __m128i al, am, ah;
+        const __m128i out =
+            simd_vmulq(to_m128(vs_u), to_m128(vt_u), al, am, ah);
+        store_acc_l(rsp, from_m128(al));
+        store_acc_m(rsp, from_m128(am));
+        store_acc_h(rsp, from_m128(ah));
+        store_vu(dest, from_m128(out));
+        return true;
+    }
+
+    case 0x0B: { // VMACQ
+        __m128i am = to_m128(load_acc_m(rsp));
+        __m128i ah = to_m128(load_acc_h(rsp));
+        const __m128i out = simd_vmacq(am, ah);
+        store_acc_m(rsp, from_m128(am));
+        store_acc_h(rsp, from_m128(ah));
+        store_vu(dest, from_m128(out));
+        return true;
+    }
 
     case 0x1D: { // VSAR — select ACC H/M/L slice into vd
         Vu16 out(0);
@@ -489,6 +665,34 @@ bool try_execute_simd(Rsp &rsp, uint32_t inst) {
         return true;
     }
 
+    case 0x37: // VNOP
+        return true;
+
+    // Reserved opcodes behave like VZERO.
+    case 0x12:
+    case 0x16:
+    case 0x17:
+    case 0x18:
+    case 0x19:
+    case 0x1A:
+    case 0x1B:
+    case 0x1C:
+    case 0x1E:
+    case 0x1F:
+    case 0x2E:
+    case 0x2F:
+    case 0x38:
+    case 0x39:
+    case 0x3A:
+    case 0x3B:
+    case 0x3C:
+    case 0x3D:
+    case 0x3E:
+    case 0x3F:
+        set_acc_low(rsp, vs_u + vt_u);
+        store_vu(dest, Vu16(0));
+        return true;
+
     default:
         return false;
     }
@@ -496,14 +700,378 @@ bool try_execute_simd(Rsp &rsp, uint32_t inst) {
 
 } // namespace
 
-void vu_execute_compute_simd(Rsp &rsp, uint32_t inst) {
+void execute_compute(Rsp &rsp, uint32_t inst) {
     const bool hit = try_execute_simd(rsp, inst);
-    vu_profile_compute(inst, hit);
+    vu_profile_compute(rsp.vu_profile_counts(), inst, hit);
     if (!hit)
         vu_execute_compute_scalar(rsp, inst);
 }
 
+namespace {
+
+// Every LWC2/SWC2 form touches one 16-byte DMEM window (wrapping at 4 KiB).
+// Per (opcode, element, address & 15) a pshufb control moves window bytes
+// into native VuReg byte order (or back for stores) and a byte mask marks
+// what the op writes. The tables are built once from the scalar formulas.
+
+constexpr int kMemShift[12] = {0, 1, 2, 3, 4, 4, 3, 3, 4, 4, 4, 4};
+
+struct LoadShuffle {
+    __m128i ctrl;
+    __m128i mask;
+};
+
+struct StoreShuffle {
+    __m128i ctrl;  // from register bytes
+    __m128i ctrl7; // from the low byte of (lane >> 7)
+    __m128i mask;
+};
+
+size_t shuffle_index(int opcode, int element, uint32_t addr) {
+    return (static_cast<size_t>(opcode) << 8) |
+           static_cast<size_t>(element << 4) | (addr & 15);
+}
+
+// Byte maps under construction; `ctrl` is 0x80 (zero) until set.
+struct ByteMap {
+    alignas(16) uint8_t ctrl[16];
+    alignas(16) uint8_t ctrl7[16];
+    alignas(16) uint8_t mask[16] = {};
+
+    ByteMap() {
+        std::memset(ctrl, 0x80, sizeof(ctrl));
+        std::memset(ctrl7, 0x80, sizeof(ctrl7));
+    }
+    // Register byte `j` (big-endian order) <- window byte `src`.
+    void reg_byte(int j, int src) {
+        ctrl[static_cast<size_t>(j ^ 1)] = static_cast<uint8_t>(src & 15);
+        mask[static_cast<size_t>(j ^ 1)] = 0xFF;
+    }
+    // Lane `i` <- window byte `src` << 8.
+    void reg_lane(int i, int src) {
+        ctrl[static_cast<size_t>(2 * i + 1)] = static_cast<uint8_t>(src & 15);
+        mask[static_cast<size_t>(2 * i)] = 0xFF;
+        mask[static_cast<size_t>(2 * i + 1)] = 0xFF;
+    }
+    // Window byte `m` <- native register byte `src` (of lane >> 7 if `shr7`,
+    // zero if `src` < 0).
+    void window_byte(int m, int src, bool shr7 = false) {
+        const size_t k = static_cast<size_t>(m & 15);
+        if (src >= 0)
+            (shr7 ? ctrl7 : ctrl)[k] = static_cast<uint8_t>(src);
+        mask[k] = 0xFF;
+    }
+    static __m128i vec(const uint8_t *b) {
+        return _mm_load_si128(reinterpret_cast<const __m128i *>(b));
+    }
+};
+
+LoadShuffle make_load(int opcode, int e, int ofs) {
+    ByteMap m;
+    const int o7 = ofs & 7;
+    const auto bytes = [&](int n) {
+        for (int i = 0; i < n && e + i < 16; i++)
+            m.reg_byte(e + i, i);
+    };
+    switch (opcode) {
+    case 0x00: // LBV
+        bytes(1);
+        break;
+    case 0x01: // LSV
+        bytes(2);
+        break;
+    case 0x02: // LLV
+        bytes(4);
+        break;
+    case 0x03: // LDV
+        bytes(8);
+        break;
+    case 0x04: // LQV
+        bytes(16 - ofs);
+        break;
+    case 0x05: { // LRV
+        const int start = 16 - ofs + e;
+        for (int j = start; j < 16; j++)
+            m.reg_byte(j, j - start);
+    } break;
+    case 0x06: // LPV
+    case 0x07: // LUV
+        for (int i = 0; i < 8; i++)
+            m.reg_lane(i, 16 - e + i + o7);
+        break;
+    case 0x08: // LHV
+        for (int i = 0; i < 8; i++)
+            m.reg_lane(i, 16 - e + 2 * i + o7);
+        break;
+    case 0x09: { // LFV: all lanes shuffled, bytes [e, e + 8) kept
+        for (int k = 0; k < 4; k++) {
+            m.reg_lane(k, o7 - e + 4 * k + 16);
+            m.reg_lane(k + 4, o7 - e + 4 * k + 8 + 16);
+        }
+        for (int j = 0; j < 16; j++)
+            m.mask[static_cast<size_t>(j ^ 1)] = (j >= e && j < e + 8) ? 0xFF
+                                                                       : 0;
+    } break;
+    case 0x0B: { // LTV: window rotated into big-endian lanes
+        const int k = e + (ofs & 8);
+        for (int j = 0; j < 16; j++)
+            m.reg_byte(j, j + k);
+    } break;
+    default:
+        break;
+    }
+    return {ByteMap::vec(m.ctrl), ByteMap::vec(m.mask)};
+}
+
+// SFV lane order per element; other elements store zeros.
+constexpr int8_t kSfvLanes[16][4] = {
+    {0, 1, 2, 3},     {6, 7, 4, 5},     {-1, -1, -1, -1}, {-1, -1, -1, -1},
+    {1, 2, 3, 0},     {7, 4, 5, 6},     {-1, -1, -1, -1}, {-1, -1, -1, -1},
+    {4, 5, 6, 7},     {-1, -1, -1, -1}, {-1, -1, -1, -1}, {3, 0, 1, 2},
+    {5, 6, 7, 4},     {-1, -1, -1, -1}, {-1, -1, -1, -1}, {0, 1, 2, 3},
+};
+
+StoreShuffle make_store(int opcode, int e, int ofs) {
+    ByteMap m;
+    const int o7 = ofs & 7;
+    const auto bytes = [&](int n, int first) {
+        for (int i = 0; i < n; i++)
+            m.window_byte(i, ((first + i) & 15) ^ 1);
+    };
+    switch (opcode) {
+    case 0x00: // SBV
+        bytes(1, e);
+        break;
+    case 0x01: // SSV
+        bytes(2, e);
+        break;
+    case 0x02: // SLV
+        bytes(4, e);
+        break;
+    case 0x03: // SDV
+        bytes(8, e);
+        break;
+    case 0x04: // SQV
+        bytes(16 - ofs, e);
+        break;
+    case 0x05: // SRV
+        bytes(ofs, e + 16 - ofs);
+        break;
+    case 0x06: // SPV
+    case 0x07: // SUV
+        for (int i = 0; i < 8; i++) {
+            const int lane = (e + i) & 7;
+            const bool high = ((e + i) & 15) < 8;
+            if (high == (opcode == 0x06))
+                m.window_byte(i, 2 * lane + 1);
+            else
+                m.window_byte(i, 2 * lane, true);
+        }
+        break;
+    case 0x08: // SHV (register pre-rotated by `e`)
+        for (int i = 0; i < 8; i++)
+            m.window_byte(o7 + 2 * i, 2 * i, true);
+        break;
+    case 0x09: // SFV
+        for (int k = 0; k < 4; k++) {
+            const int lane = kSfvLanes[e][k];
+            m.window_byte(o7 + 4 * k, lane < 0 ? -1 : 2 * lane, true);
+        }
+        break;
+    case 0x0A: // SWV
+        for (int i = 0; i < 16; i++)
+            m.window_byte(o7 + i, ((e + i) & 15) ^ 1);
+        break;
+    case 0x0B: // STV (lanes gathered beforehand)
+        for (int i = 0; i < 16; i++)
+            m.window_byte(o7 + i, i ^ 1);
+        break;
+    default:
+        break;
+    }
+    return {ByteMap::vec(m.ctrl), ByteMap::vec(m.ctrl7), ByteMap::vec(m.mask)};
+}
+
+const std::vector<LoadShuffle> &load_shuffles() {
+    static const std::vector<LoadShuffle> table = [] {
+        std::vector<LoadShuffle> t(12 * 256);
+        for (int op = 0; op < 12; op++)
+            for (int e = 0; e < 16; e++)
+                for (uint32_t o = 0; o < 16; o++)
+                    t[shuffle_index(op, e, o)] = make_load(op, e, o);
+        return t;
+    }();
+    return table;
+}
+
+const std::vector<StoreShuffle> &store_shuffles() {
+    static const std::vector<StoreShuffle> table = [] {
+        std::vector<StoreShuffle> t(12 * 256);
+        for (int op = 0; op < 12; op++)
+            for (int e = 0; e < 16; e++)
+                for (uint32_t o = 0; o < 16; o++)
+                    t[shuffle_index(op, e, o)] = make_store(op, e, o);
+        return t;
+    }();
+    return table;
+}
+
+// Register bytes rotated left by `e` (SHV).
+struct RotateShuffles {
+    __m128i ctrl[16];
+    RotateShuffles() {
+        for (int r = 0; r < 16; r++) {
+            alignas(16) uint8_t c[16];
+            for (int j = 0; j < 16; j++)
+                c[static_cast<size_t>(j ^ 1)] =
+                    static_cast<uint8_t>(((j + r) & 15) ^ 1);
+            ctrl[r] = ByteMap::vec(c);
+        }
+    }
+};
+
+__m128i rotate_bytes(__m128i v, int e) {
+    static const RotateShuffles table;
+    return _mm_shuffle_epi8(v, table.ctrl[e]);
+}
+
+__m128i load_window(Rsp &rsp, uint32_t addr) {
+    const uint8_t *dmem = rsp.get_sp_dmem().data();
+    addr &= 0xFFF;
+    if (addr <= 0xFF0)
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(dmem + addr));
+    alignas(16) uint8_t buf[16];
+    for (uint32_t i = 0; i < 16; i++)
+        buf[i] = dmem[(addr + i) & 0xFFF];
+    return ByteMap::vec(buf);
+}
+
+void store_window(Rsp &rsp, uint32_t addr, __m128i w) {
+    uint8_t *dmem = rsp.get_sp_dmem().data();
+    addr &= 0xFFF;
+    if (addr <= 0xFF0) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dmem + addr), w);
+        return;
+    }
+    alignas(16) uint8_t buf[16];
+    _mm_store_si128(reinterpret_cast<__m128i *>(buf), w);
+    for (uint32_t i = 0; i < 16; i++)
+        dmem[(addr + i) & 0xFFF] = buf[i];
+}
+
+__m128i load_reg(const VuReg &r) {
+    return _mm_load_si128(reinterpret_cast<const __m128i *>(r.data()));
+}
+
+void store_reg(VuReg &r, __m128i v) {
+    _mm_store_si128(reinterpret_cast<__m128i *>(r.data()), v);
+}
+
+bool try_load_simd(Rsp &rsp, uint32_t inst) {
+    const int base = (inst >> 21) & 0x1F;
+    const int vt = (inst >> 16) & 0x1F;
+    const int opcode = (inst >> 11) & 0x1F;
+    const int element = (inst >> 7) & 0xF;
+    const int offset7 =
+        static_cast<int>(static_cast<int8_t>((inst & 0x7F) << 1) >> 1);
+    if (opcode >= 12 || opcode == 0x0A)
+        return false;
+
+    const uint32_t a = rsp.gpr(base) + (offset7 << kMemShift[opcode]);
+    uint32_t window = a;
+    if (opcode == 0x05)
+        window &= ~15u;
+    else if (opcode >= 0x06)
+        window &= ~7u;
+    const auto &sh = load_shuffles()[shuffle_index(opcode, element, a)];
+    __m128i x = _mm_shuffle_epi8(load_window(rsp, window), sh.ctrl);
+    if (opcode >= 0x07 && opcode <= 0x09) // LUV/LHV/LFV: << 7
+        x = _mm_srli_epi16(x, 1);
+
+    if (opcode == 0x0B) { // LTV: lane i goes to register vt + (i + e/2)
+        alignas(16) uint16_t lanes[8];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanes), x);
+        for (int i = 0; i < 8; i++) {
+            const int reg = (vt & 0x18) | ((i + (element >> 1)) & 7);
+            rsp.vreg(reg).set_lane(i, lanes[i]);
+        }
+        return true;
+    }
+    auto &v = rsp.vreg(vt);
+    store_reg(v, _mm_blendv_epi8(load_reg(v), x, sh.mask));
+    return true;
+}
+
+bool try_store_simd(Rsp &rsp, uint32_t inst) {
+    const int base = (inst >> 21) & 0x1F;
+    const int vt = (inst >> 16) & 0x1F;
+    const int opcode = (inst >> 11) & 0x1F;
+    const int element = (inst >> 7) & 0xF;
+    const int offset7 =
+        static_cast<int>(static_cast<int8_t>((inst & 0x7F) << 1) >> 1);
+    if (opcode >= 12)
+        return false;
+
+    const uint32_t a = rsp.gpr(base) + (offset7 << kMemShift[opcode]);
+    uint32_t window = a;
+    if (opcode == 0x05)
+        window &= ~15u;
+    else if (opcode >= 0x08)
+        window &= ~7u;
+
+    __m128i v;
+    if (opcode == 0x0B) { // STV: lane i from register vt + (i + e/2)
+        alignas(16) uint16_t lanes[8];
+        for (int i = 0; i < 8; i++) {
+            const int reg = (vt & 0x18) | ((i + (element >> 1)) & 7);
+            lanes[i] = rsp.vreg(reg).lane(i);
+        }
+        v = _mm_load_si128(reinterpret_cast<const __m128i *>(lanes));
+    } else {
+        v = load_reg(rsp.vreg(vt));
+        if (opcode == 0x08)
+            v = rotate_bytes(v, element);
+    }
+
+    const auto &sh = store_shuffles()[shuffle_index(opcode, element, a)];
+    __m128i x = _mm_shuffle_epi8(v, sh.ctrl);
+    if (opcode >= 0x06 && opcode <= 0x09) // SPV/SUV/SHV/SFV
+        x = _mm_or_si128(x, _mm_shuffle_epi8(_mm_srli_epi16(v, 7), sh.ctrl7));
+    store_window(rsp, window,
+                 _mm_blendv_epi8(load_window(rsp, window), x, sh.mask));
+    return true;
+}
+
+} // namespace
+
+void load(Rsp &rsp, uint32_t inst) {
+    const bool hit = try_load_simd(rsp, inst);
+    vu_profile_lwc2(rsp.vu_profile_counts(), inst, hit);
+    if (!hit)
+        vu_load_scalar(rsp, inst);
+}
+
+void store(Rsp &rsp, uint32_t inst) {
+    const bool hit = try_store_simd(rsp, inst);
+    vu_profile_swc2(rsp.vu_profile_counts(), inst, hit);
+    if (!hit)
+        vu_store_scalar(rsp, inst);
+}
+
+} // namespace N64_VU_NS
+
+extern const VuKernels N64_VU_CAT(vu_kernels_, N64_VU_BUILD_ISA);
+const VuKernels N64_VU_CAT(vu_kernels_, N64_VU_BUILD_ISA) = {
+    N64_VU_STR(N64_VU_BUILD_ISA),
+    static_cast<int>(eve::wide<std::int16_t>::size()),
+    &N64_VU_NS::execute_compute,
+    &N64_VU_NS::load,
+    &N64_VU_NS::store,
+};
+
 } // namespace Rsp
 } // namespace N64
 
+N64_VU_TARGET_END
+
 #endif // N64_RSP_SIMD
@@ -0,0 +1,52 @@
+#include "rcp/rsp_worker.h"
+
+namespace N64 {
+namespace Rsp {
+
+RspWorker::~RspWorker() {
+    if (!thread_.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+}
+
+void RspWorker::start(std::function<void()> job) {
+    if (!thread_.joinable())
+        thread_ = std::thread([this] { loop(); });
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        job_ = std::move(job);
+        busy_.store(true, std::memory_order_release);
+    }
+    cv_.notify_all();
+}
+
+void RspWorker::wait() {
+    if (!busy())
+        return;
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return !busy_.load(std::memory_order_relaxed); });
+}
+
+void RspWorker::loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [this] { return quit_ || job_; });
+        if (quit_)
+            return;
+        auto job = std::move(job_);
+        job_ = nullptr;
+        lock.unlock();
+        job();
+        lock.lock();
+        busy_.store(false, std::memory_order_release);
+        cv_.notify_all();
+    }
+}
+
+} // namespace Rsp
+} // namespace N64
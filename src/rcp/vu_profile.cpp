@@ -32,72 +32,83 @@ constexpr const char *kStoreNames[16] = {
     "SHV", "SFV", "SWV", "STV", "?",   "?",   "?",   "?",
 };
 
-struct State {
-    bool enabled{false};
-    bool inited{false};
-    std::array<uint64_t, 64> compute{};
-    std::array<uint64_t, 64> compute_scalar{};
-    std::array<uint64_t, 16> lwc2{};
-    std::array<uint64_t, 16> swc2{};
-    std::array<uint64_t, 8> cop2_move{}; // by rs sub
-    uint64_t total_compute{0};
-};
-
-State &state() {
-    static State s;
-    if (!s.inited) {
-        s.inited = true;
-        const char *e = std::getenv("N64_PROFILE_VU");
-        s.enabled = e && e[0] != '\0' && e[0] != '0';
-    }
-    return s;
+// Only touched on the CPU thread (merge and dump).
+VuProfileCounts g_totals;
+
+template <size_t N>
+void add_into(std::array<uint64_t, N> &dst,
+              const std::array<uint64_t, N> &src) {
+    for (size_t i = 0; i < N; i++)
+        dst[i] += src[i];
 }
 
 } // namespace
 
-bool vu_profile_enabled() { return state().enabled; }
+bool vu_profile_enabled() {
+    static const bool on = [] {
+        const char *e = std::getenv("N64_PROFILE_VU");
+        return e && e[0] != '\0' && e[0] != '0';
+    }();
+    return on;
+}
 
-void vu_profile_compute(uint32_t inst, bool used_simd) {
-    auto &s = state();
-    if (!s.enabled)
+void vu_profile_compute(VuProfileCounts &c, uint32_t inst, bool used_simd) {
+    if (!vu_profile_enabled())
         return;
     const int funct = inst & 0x3F;
-    s.compute[static_cast<size_t>(funct)]++;
-    s.total_compute++;
+    c.compute[static_cast<size_t>(funct)]++;
+    c.total_compute++;
     if (!used_simd)
-        s.compute_scalar[static_cast<size_t>(funct)]++;
+        c.compute_scalar[static_cast<size_t>(funct)]++;
 }
 
-void vu_profile_lwc2(uint32_t inst) {
-    auto &s = state();
-    if (!s.enabled)
+void vu_profile_lwc2(VuProfileCounts &c, uint32_t inst, bool used_simd) {
+    if (!vu_profile_enabled())
         return;
     const int opcode = (inst >> 11) & 0x1F;
-    if (opcode < 16)
-        s.lwc2[static_cast<size_t>(opcode)]++;
+    if (opcode >= 16)
+        return;
+    c.lwc2[static_cast<size_t>(opcode)]++;
+    if (!used_simd)
+        c.lwc2_scalar[static_cast<size_t>(opcode)]++;
 }
 
-void vu_profile_swc2(uint32_t inst) {
-    auto &s = state();
-    if (!s.enabled)
+void vu_profile_swc2(VuProfileCounts &c, uint32_t inst, bool used_simd) {
+    if (!vu_profile_enabled())
         return;
     const int opcode = (inst >> 11) & 0x1F;
-    if (opcode < 16)
-        s.swc2[static_cast<size_t>(opcode)]++;
+    if (opcode >= 16)
+        return;
+    c.swc2[static_cast<size_t>(opcode)]++;
+    if (!used_simd)
+        c.swc2_scalar[static_cast<size_t>(opcode)]++;
 }
 
-void vu_profile_cop2_move(uint8_t sub) {
-    auto &s = state();
-    if (!s.enabled)
+void vu_profile_cop2_move(VuProfileCounts &c, uint8_t sub) {
+    if (!vu_profile_enabled())
         return;
     if (sub < 8)
-        s.cop2_move[sub]++;
+        c.cop2_move[sub]++;
+}
+
+void vu_profile_merge(VuProfileCounts &c) {
+    if (!vu_profile_enabled())
+        return;
+    add_into(g_totals.compute, c.compute);
+    add_into(g_totals.compute_scalar, c.compute_scalar);
+    add_into(g_totals.lwc2, c.lwc2);
+    add_into(g_totals.lwc2_scalar, c.lwc2_scalar);
+    add_into(g_totals.swc2, c.swc2);
+    add_into(g_totals.swc2_scalar, c.swc2_scalar);
+    add_into(g_totals.cop2_move, c.cop2_move);
+    g_totals.total_compute += c.total_compute;
+    c = VuProfileCounts{};
 }
 
 void vu_profile_dump() {
-    auto &s = state();
-    if (!s.enabled)
+    if (!vu_profile_enabled())
         return;
+    const VuProfileCounts &s = g_totals;
 
     std::vector<std::pair<uint64_t, int>> ranked;
     ranked.reserve(64);
@@ -135,7 +146,9 @@ void vu_profile_dump() {
                   [](auto &a, auto &b) { return a.first > b.first; });
         for (size_t n = 0; n < lr.size() && n < 10; n++) {
             const int o = lr[n].second;
-            Utils::info("  LWC2 {:<4} count={}", kLoadNames[o], lr[n].first);
+            Utils::info("  LWC2 {:<4} count={} scalar_fallback={}",
+                        kLoadNames[o], lr[n].first,
+                        s.lwc2_scalar[static_cast<size_t>(o)]);
         }
     }
 
@@ -152,7 +165,9 @@ void vu_profile_dump() {
                   [](auto &a, auto &b) { return a.first > b.first; });
         for (size_t n = 0; n < sr.size() && n < 10; n++) {
             const int o = sr[n].second;
-            Utils::info("  SWC2 {:<4} count={}", kStoreNames[o], sr[n].first);
+            Utils::info("  SWC2 {:<4} count={} scalar_fallback={}",
+                        kStoreNames[o], sr[n].first,
+                        s.swc2_scalar[static_cast<size_t>(o)]);
         }
     }
 
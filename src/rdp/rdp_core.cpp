@@ -1,12 +1,15 @@
 #include "rdp/rdp_core.h"
 #include "memory/memory_map.h"
 #include "mmio/vi.h"
+#include "rdp/soft_rdp.h"
 #include "rdp_device.hpp"
+#include "utils/byte_array.h"
 #include "utils/log.h"
 #include "utils/work_profile.h"
 #include <algorithm>
 #include <atomic>
 #include <cstdint>
+#include <cstring>
 #include <mutex>
 #include <vector>
 
@@ -269,8 +272,17 @@ void init(Vulkan::Device &device, uint8_t *rdram, unsigned upscale) {
     }
 }
 
+void init_software(uint8_t *rdram) {
+    std::lock_guard lock(mutex());
+    g_rdp_dirty = true;
+    g_cpu_fb_dirty.store(true, std::memory_order_relaxed);
+    reset_deferred_sync_state();
+    g_soft_rdp().init(rdram);
+}
+
 void fini() {
     std::lock_guard lock(mutex());
+    g_soft_rdp().fini();
     if (g_command_processor)
         g_command_processor->set_sync_full_callback(nullptr, nullptr);
     delete g_command_processor;
@@ -284,8 +296,14 @@ bool ready() { return g_command_processor != nullptr; }
 
 void enqueue_command(int command_length, const uint32_t *buffer) {
     std::lock_guard lock(mutex());
-    if (!g_command_processor)
+    if (!g_command_processor) {
+        if (g_soft_rdp().active()) {
+            WorkProfile::Scoped soft(WorkProfile::Bucket::SoftRdp);
+            g_rdp_dirty = true;
+            g_soft_rdp().enqueue(command_length, buffer);
+        }
         return;
+    }
     g_rdp_dirty = true;
     if (command_length >= 2)
         track_command(buffer);
@@ -294,8 +312,13 @@ void enqueue_command(int command_length, const uint32_t *buffer) {
 
 void on_full_sync() {
     std::lock_guard lock(mutex());
-    if (!g_command_processor)
+    if (!g_command_processor) {
+        // The software path renders synchronously, so RDRAM is coherent
+        // before the DP interrupt and no deferred sync is needed.
+        WorkProfile::Scoped soft(WorkProfile::Bucket::SoftRdp);
+        g_soft_rdp().flush();
         return;
+    }
     const uint64_t signal = g_command_processor->signal_timeline();
     g_sync_signal.store(signal, std::memory_order_release);
 }
@@ -441,5 +464,59 @@ ScanoutResult scanout(const ViRegs &vi) {
     return out;
 }
 
+bool scanout_cpu(const ViRegs &vi, CpuFrame &out) {
+    std::lock_guard lock(mutex());
+    const uint8_t *rdram = g_soft_rdp().rdram();
+    const uint32_t type = vi.status & 3u;
+    const uint32_t origin = vi.origin & 0xFFFFFFu;
+    const uint32_t width = vi.width & 0xFFFu;
+    if (!rdram || type < 2 || origin == 0 || origin == 0x280 || width == 0)
+        return false;
+    g_soft_rdp().flush();
+
+    uint32_t h_video = vi.h_video;
+    if ((h_video & 0x03FF03FFu) == 0)
+        h_video = 0x006c02ec;
+    const uint32_t h_start = (h_video >> 16) & 0x3ff;
+    const uint32_t h_end = h_video & 0x3ff;
+    const uint32_t v_start = (vi.v_video >> 16) & 0x3ff;
+    const uint32_t v_end = vi.v_video & 0x3ff;
+    if (h_end <= h_start || v_end <= v_start)
+        return false;
+    // Framebuffer pixels covered by the active area; VI filters are not
+    // applied.
+    out.width = std::min((((h_end - h_start) * (vi.x_scale & 0xFFF)) >> 10),
+                         width);
+    out.height = (((v_end - v_start) >> 1) * (vi.y_scale & 0xFFF)) >> 10;
+    if (out.width == 0 || out.height == 0)
+        return false;
+
+    const uint32_t bpp = type == 3 ? 4 : 2;
+    out.rgb.resize(size_t{out.width} * out.height * 3);
+    uint8_t *dst = out.rgb.data();
+    for (uint32_t y = 0; y < out.height; y++) {
+        for (uint32_t x = 0; x < out.width; x++) {
+            const uint32_t addr =
+                (origin + (y * width + x) * bpp) & RDRAM_SIZE_MASK;
+            if (bpp == 4) {
+                uint32_t c;
+                std::memcpy(&c, rdram + (addr & ~3u), sizeof(c));
+                *dst++ = static_cast<uint8_t>(c >> 24);
+                *dst++ = static_cast<uint8_t>(c >> 16);
+                *dst++ = static_cast<uint8_t>(c >> 8);
+            } else {
+                uint16_t c;
+                std::memcpy(&c, rdram + Utils::half_address(addr & ~1u),
+                            sizeof(c));
+                for (const uint32_t shift : {11u, 6u, 1u}) {
+                    const uint32_t v = (c >> shift) & 0x1F;
+                    *dst++ = static_cast<uint8_t>((v << 3) | (v >> 2));
+                }
+            }
+        }
+    }
+    return true;
+}
+
 } // namespace Rdp
 } // namespace N64
@@ -0,0 +1,1242 @@
+#include "rdp/soft_rdp.h"
+#include "memory/memory_map.h"
+#include "utils/byte_array.h"
+#include "utils/log.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace N64 {
+namespace Rdp {
+
+namespace {
+constexpr uint32_t TMEM_SIZE = 0x1000;
+// Recorded words before a batch is rendered without waiting for SyncFull.
+constexpr size_t MAX_BATCH_WORDS = 1 << 20;
+
+// Command lengths in 32-bit words (same table as the DPC parser).
+constexpr std::array<uint8_t, 64> COMMAND_WORDS = {
+    2, 2, 2, 2, 2, 2, 2, 2, 8, 12, 24, 28, 24, 28, 40, 44, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2,  2,  2,  2,  2,  4,  4,  2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2,  2,  2,  2,  2,  2,  2,  2, 2, 2, 2};
+
+enum Op : uint32_t {
+    OP_TRIANGLE_FIRST = 0x08,
+    OP_TRIANGLE_LAST = 0x0F,
+    OP_TEXTURE_RECT = 0x24,
+    OP_TEXTURE_RECT_FLIP = 0x25,
+    OP_SET_KEY_GB = 0x2A,
+    OP_SET_KEY_R = 0x2B,
+    OP_SET_CONVERT = 0x2C,
+    OP_SET_SCISSOR = 0x2D,
+    OP_SET_PRIM_DEPTH = 0x2E,
+    OP_SET_OTHER_MODES = 0x2F,
+    OP_LOAD_TLUT = 0x30,
+    OP_SET_TILE_SIZE = 0x32,
+    OP_LOAD_BLOCK = 0x33,
+    OP_LOAD_TILE = 0x34,
+    OP_SET_TILE = 0x35,
+    OP_FILL_RECT = 0x36,
+    OP_SET_FILL_COLOR = 0x37,
+    OP_SET_FOG_COLOR = 0x38,
+    OP_SET_BLEND_COLOR = 0x39,
+    OP_SET_PRIM_COLOR = 0x3A,
+    OP_SET_ENV_COLOR = 0x3B,
+    OP_SET_COMBINE = 0x3C,
+    OP_SET_TEXTURE_IMAGE = 0x3D,
+    OP_SET_MASK_IMAGE = 0x3E,
+    OP_SET_COLOR_IMAGE = 0x3F,
+};
+
+enum CycleType : uint32_t {
+    CYCLE_1 = 0,
+    CYCLE_2 = 1,
+    CYCLE_COPY = 2,
+    CYCLE_FILL = 3,
+};
+
+int32_t sext(uint32_t value, unsigned bits) {
+    const unsigned shift = 32 - bits;
+    return static_cast<int32_t>(value << shift) >> shift;
+}
+
+int32_t clamp8(int32_t v) { return std::clamp(v, 0, 255); }
+
+// Whole bytes per pixel, rounding 4-bit up (conservative ranges only).
+uint32_t pixel_bytes(uint32_t size) { return size == 0 ? 1 : 1u << (size - 1); }
+
+uint32_t texel_bytes(uint32_t size, uint32_t texels) {
+    return size == 0 ? (texels + 1) / 2 : texels << (size - 1);
+}
+
+struct Rgba {
+    int32_t r{0};
+    int32_t g{0};
+    int32_t b{0};
+    int32_t a{0};
+};
+
+Rgba unpack_rgba32(uint32_t c) {
+    return {static_cast<int32_t>(c >> 24), static_cast<int32_t>((c >> 16) & 0xFF),
+            static_cast<int32_t>((c >> 8) & 0xFF),
+            static_cast<int32_t>(c & 0xFF)};
+}
+
+int32_t expand5(uint32_t c) { return static_cast<int32_t>((c << 3) | (c >> 2)); }
+
+Rgba unpack_rgba16(uint16_t c) {
+    return {expand5((c >> 11) & 0x1F), expand5((c >> 6) & 0x1F),
+            expand5((c >> 1) & 0x1F), (c & 1) ? 255 : 0};
+}
+
+uint16_t pack_rgba16(const Rgba &c, bool alpha) {
+    return static_cast<uint16_t>(((c.r >> 3) << 11) | ((c.g >> 3) << 6) |
+                                 ((c.b >> 3) << 1) | (alpha ? 1 : 0));
+}
+
+Rgba intensity(int32_t i, int32_t a) { return {i, i, i, a}; }
+
+// 18-bit depth <-> the 14-bit floating point value stored in the Z buffer.
+uint32_t z_compress(uint32_t z) {
+    uint32_t exp = 0;
+    while (exp < 7 && (z & (0x20000u >> exp)))
+        ++exp;
+    const uint32_t shift = exp < 6 ? 6 - exp : 0;
+    return (exp << 11) | ((z >> shift) & 0x7FF);
+}
+
+uint32_t z_decompress(uint32_t zc) {
+    static constexpr uint32_t base[8] = {0x00000, 0x20000, 0x30000, 0x38000,
+                                         0x3C000, 0x3E000, 0x3F000, 0x3F800};
+    const uint32_t exp = (zc >> 11) & 7;
+    const uint32_t shift = exp < 6 ? 6 - exp : 0;
+    return base[exp] + ((zc & 0x7FF) << shift);
+}
+} // namespace
+
+// One worker's view of the RDP: full command state and TMEM, rasterizing
+// only the scanlines whose bin it owns.
+class SoftRenderer {
+  public:
+    SoftRenderer(uint8_t *rdram, unsigned bin, unsigned bins)
+        : rdram_(rdram), bin_(bin), bins_(bins) {}
+
+    void run(const std::vector<uint32_t> &batch);
+
+  private:
+    struct Tile {
+        uint32_t fmt{0};
+        uint32_t size{0};
+        uint32_t line{0};
+        uint32_t tmem{0};
+        uint32_t palette{0};
+        bool ct{false};
+        bool mt{false};
+        bool cs{false};
+        bool ms{false};
+        uint32_t mask_t{0};
+        uint32_t shift_t{0};
+        uint32_t mask_s{0};
+        uint32_t shift_s{0};
+        uint32_t sl{0};
+        uint32_t tl{0};
+        uint32_t sh{0};
+        uint32_t th{0};
+    };
+
+    struct Modes {
+        uint32_t cycle_type{CYCLE_1};
+        bool persp_tex{false};
+        bool tlut_en{false};
+        bool tlut_ia{false};
+        bool bilerp{false};
+        uint32_t blend_p[2]{};
+        uint32_t blend_a[2]{};
+        uint32_t blend_m[2]{};
+        uint32_t blend_b[2]{};
+        bool force_blend{false};
+        bool image_read{false};
+        bool z_update{false};
+        bool z_compare{false};
+        bool z_decal{false};
+        bool z_prim{false};
+        bool alpha_compare{false};
+    };
+
+    struct Combiner {
+        uint32_t rgb_a[2]{};
+        uint32_t rgb_b[2]{};
+        uint32_t rgb_c[2]{};
+        uint32_t rgb_d[2]{};
+        uint32_t alpha_a[2]{};
+        uint32_t alpha_b[2]{};
+        uint32_t alpha_c[2]{};
+        uint32_t alpha_d[2]{};
+    };
+
+    struct Inputs {
+        Rgba combined;
+        Rgba tex0;
+        Rgba tex1;
+        Rgba shade;
+    };
+
+    void execute(uint32_t op, const uint32_t *w);
+    bool owns_line(int32_t y) const {
+        return (static_cast<uint32_t>(y) / SoftRdp::BIN_LINES) % bins_ == bin_;
+    }
+
+    // RDRAM (host-endian words).
+    uint8_t rd8(uint32_t addr) const {
+        return rdram_[Utils::byte_address(addr & RDRAM_SIZE_MASK)];
+    }
+    uint16_t rd16(uint32_t addr) const {
+        uint16_t v;
+        std::memcpy(&v, rdram_ + Utils::half_address(addr & RDRAM_SIZE_MASK & ~1u),
+                    sizeof(v));
+        return v;
+    }
+    uint32_t rd32(uint32_t addr) const {
+        uint32_t v;
+        std::memcpy(&v, rdram_ + (addr & RDRAM_SIZE_MASK & ~3u), sizeof(v));
+        return v;
+    }
+    void wr8(uint32_t addr, uint8_t v) {
+        rdram_[Utils::byte_address(addr & RDRAM_SIZE_MASK)] = v;
+    }
+    void wr16(uint32_t addr, uint16_t v) {
+        std::memcpy(rdram_ + Utils::half_address(addr & RDRAM_SIZE_MASK & ~1u), &v,
+                    sizeof(v));
+    }
+    void wr32(uint32_t addr, uint32_t v) {
+        std::memcpy(rdram_ + (addr & RDRAM_SIZE_MASK & ~3u), &v, sizeof(v));
+    }
+
+    // TMEM (big-endian bytes).
+    uint16_t tmem16(uint32_t addr) const {
+        return static_cast<uint16_t>((tmem_[addr & 0xFFF] << 8) |
+                                     tmem_[(addr + 1) & 0xFFF]);
+    }
+
+    void load_tile(const uint32_t *w);
+    void load_block(const uint32_t *w);
+    void load_tlut(const uint32_t *w);
+
+    Rgba fetch(const Tile &tile, int32_t s, int32_t t) const;
+    Rgba sample(uint32_t tile_index, int32_t s, int32_t t) const;
+
+    Rgba combine(unsigned cycle, const Inputs &in) const;
+    Rgba blend(unsigned cycle, const Rgba &in, int32_t in_alpha,
+               int32_t shade_alpha, const Rgba &mem, bool force) const;
+    void shade_pixel(int32_t x, int32_t y, const Rgba &shade, int32_t s,
+                     int32_t t, uint32_t z, bool use_z, uint32_t tile);
+    void fill_pixel(int32_t x, int32_t y);
+
+    void draw_triangle(uint32_t op, const uint32_t *w);
+    void draw_fill_rect(const uint32_t *w);
+    void draw_texture_rect(const uint32_t *w, bool flip);
+
+    uint8_t *rdram_;
+    unsigned bin_;
+    unsigned bins_;
+
+    std::array<uint8_t, TMEM_SIZE> tmem_{};
+    std::array<Tile, 8> tiles_{};
+    Modes modes_{};
+    Combiner combiner_{};
+
+    uint32_t color_addr_{0};
+    uint32_t color_size_{2};
+    uint32_t color_width_{0};
+    uint32_t mask_addr_{0};
+    uint32_t tex_addr_{0};
+    uint32_t tex_size_{2};
+    uint32_t tex_width_{0};
+
+    // Scissor in whole pixels, [x0, x1) x [y0, y1).
+    int32_t sc_x0_{0};
+    int32_t sc_y0_{0};
+    int32_t sc_x1_{0};
+    int32_t sc_y1_{0};
+
+    uint32_t fill_color_{0};
+    Rgba fog_color_{};
+    Rgba blend_color_{};
+    Rgba prim_color_{};
+    Rgba env_color_{};
+    int32_t prim_lod_frac_{0};
+    uint32_t prim_z_{0};
+    int32_t k4_{0};
+    int32_t k5_{0};
+};
+
+void SoftRenderer::run(const std::vector<uint32_t> &batch) {
+    size_t i = 0;
+    while (i < batch.size()) {
+        const uint32_t len = batch[i];
+        const uint32_t *w = &batch[i + 1];
+        execute((w[0] >> 24) & 0x3F, w);
+        i += 1 + len;
+    }
+}
+
+void SoftRenderer::execute(uint32_t op, const uint32_t *w) {
+    if (op >= OP_TRIANGLE_FIRST && op <= OP_TRIANGLE_LAST) {
+        draw_triangle(op, w);
+        return;
+    }
+    switch (op) {
+    case OP_TEXTURE_RECT:
+    case OP_TEXTURE_RECT_FLIP:
+        draw_texture_rect(w, op == OP_TEXTURE_RECT_FLIP);
+        break;
+    case OP_FILL_RECT:
+        draw_fill_rect(w);
+        break;
+    case OP_SET_CONVERT:
+        k4_ = static_cast<int32_t>((w[1] >> 9) & 0x1FF);
+        k5_ = static_cast<int32_t>(w[1] & 0x1FF);
+        break;
+    case OP_SET_SCISSOR:
+        sc_x0_ = static_cast<int32_t>((w[0] >> 12) & 0xFFF) >> 2;
+        sc_y0_ = static_cast<int32_t>(w[0] & 0xFFF) >> 2;
+        sc_x1_ = static_cast<int32_t>((w[1] >> 12) & 0xFFF) >> 2;
+        sc_y1_ = static_cast<int32_t>(w[1] & 0xFFF) >> 2;
+        break;
+    case OP_SET_PRIM_DEPTH:
+        prim_z_ = ((w[1] >> 16) & 0x7FFF) << 3;
+        break;
+    case OP_SET_OTHER_MODES:
+        modes_.cycle_type = (w[0] >> 20) & 3;
+        modes_.persp_tex = (w[0] >> 19) & 1;
+        modes_.tlut_en = (w[0] >> 15) & 1;
+        modes_.tlut_ia = (w[0] >> 14) & 1;
+        modes_.bilerp = (w[0] >> 13) & 1;
+        for (unsigned c = 0; c < 2; c++) {
+            modes_.blend_p[c] = (w[1] >> (30 - 2 * c)) & 3;
+            modes_.blend_a[c] = (w[1] >> (26 - 2 * c)) & 3;
+            modes_.blend_m[c] = (w[1] >> (22 - 2 * c)) & 3;
+            modes_.blend_b[c] = (w[1] >> (18 - 2 * c)) & 3;
+        }
+        modes_.force_blend = (w[1] >> 14) & 1;
+        modes_.z_decal = ((w[1] >> 10) & 3) == 3;
+        modes_.image_read = (w[1] >> 6) & 1;
+        modes_.z_update = (w[1] >> 5) & 1;
+        modes_.z_compare = (w[1] >> 4) & 1;
+        modes_.z_prim = (w[1] >> 2) & 1;
+        modes_.alpha_compare = w[1] & 1;
+        break;
+    case OP_LOAD_TLUT:
+        load_tlut(w);
+        break;
+    case OP_SET_TILE_SIZE:
+    case OP_LOAD_TILE: {
+        Tile &tile = tiles_[(w[1] >> 24) & 7];
+        tile.sl = (w[0] >> 12) & 0xFFF;
+        tile.tl = w[0] & 0xFFF;
+        tile.sh = (w[1] >> 12) & 0xFFF;
+        tile.th = w[1] & 0xFFF;
+        if (op == OP_LOAD_TILE)
+            load_tile(w);
+        break;
+    }
+    case OP_LOAD_BLOCK:
+        load_block(w);
+        break;
+    case OP_SET_TILE: {
+        Tile &tile = tiles_[(w[1] >> 24) & 7];
+        tile.fmt = (w[0] >> 21) & 7;
+        tile.size = (w[0] >> 19) & 3;
+        tile.line = (w[0] >> 9) & 0x1FF;
+        tile.tmem = w[0] & 0x1FF;
+        tile.palette = (w[1] >> 20) & 0xF;
+        tile.ct = (w[1] >> 19) & 1;
+        tile.mt = (w[1] >> 18) & 1;
+        tile.mask_t = (w[1] >> 14) & 0xF;
+        tile.shift_t = (w[1] >> 10) & 0xF;
+        tile.cs = (w[1] >> 9) & 1;
+        tile.ms = (w[1] >> 8) & 1;
+        tile.mask_s = (w[1] >> 4) & 0xF;
+        tile.shift_s = w[1] & 0xF;
+        break;
+    }
+    case OP_SET_FILL_COLOR:
+        fill_color_ = w[1];
+        break;
+    case OP_SET_FOG_COLOR:
+        fog_color_ = unpack_rgba32(w[1]);
+        break;
+    case OP_SET_BLEND_COLOR:
+        blend_color_ = unpack_rgba32(w[1]);
+        break;
+    case OP_SET_PRIM_COLOR:
+        prim_color_ = unpack_rgba32(w[1]);
+        prim_lod_frac_ = static_cast<int32_t>(w[0] & 0xFF);
+        break;
+    case OP_SET_ENV_COLOR:
+        env_color_ = unpack_rgba32(w[1]);
+        break;
+    case OP_SET_COMBINE:
+        combiner_.rgb_a[0] = (w[0] >> 20) & 0xF;
+        combiner_.rgb_c[0] = (w[0] >> 15) & 0x1F;
+        combiner_.alpha_a[0] = (w[0] >> 12) & 7;
+        combiner_.alpha_c[0] = (w[0] >> 9) & 7;
+        combiner_.rgb_a[1] = (w[0] >> 5) & 0xF;
+        combiner_.rgb_c[1] = w[0] & 0x1F;
+        combiner_.rgb_b[0] = (w[1] >> 28) & 0xF;
+        combiner_.rgb_b[1] = (w[1] >> 24) & 0xF;
+        combiner_.alpha_a[1] = (w[1] >> 21) & 7;
+        combiner_.alpha_c[1] = (w[1] >> 18) & 7;
+        combiner_.rgb_d[0] = (w[1] >> 15) & 7;
+        combiner_.alpha_b[0] = (w[1] >> 12) & 7;
+        combiner_.alpha_d[0] = (w[1] >> 9) & 7;
+        combiner_.rgb_d[1] = (w[1] >> 6) & 7;
+        combiner_.alpha_b[1] = (w[1] >> 3) & 7;
+        combiner_.alpha_d[1] = w[1] & 7;
+        break;
+    case OP_SET_TEXTURE_IMAGE:
+        tex_size_ = (w[0] >> 19) & 3;
+        tex_width_ = (w[0] & 0x3FF) + 1;
+        tex_addr_ = w[1] & 0x00FFFFFF;
+        break;
+    case OP_SET_MASK_IMAGE:
+        mask_addr_ = w[1] & 0x00FFFFFF;
+        break;
+    case OP_SET_COLOR_IMAGE:
+        color_size_ = (w[0] >> 19) & 3;
+        color_width_ = (w[0] & 0x3FF) + 1;
+        color_addr_ = w[1] & 0x00FFFFFF;
+        break;
+    default:
+        // Syncs, keying and no-ops.
+        break;
+    }
+}
+
+// Texture loads. TMEM rows are 64-bit words; odd rows have their 32-bit
+// halves swapped, and 32-bit texels are split into RG (low half of TMEM)
+// and BA (high half).
+void SoftRenderer::load_tile(const uint32_t *w) {
+    const Tile &tile = tiles_[(w[1] >> 24) & 7];
+    const uint32_t s0 = tile.sl >> 2;
+    const uint32_t t0 = tile.tl >> 2;
+    const uint32_t s1 = tile.sh >> 2;
+    const uint32_t t1 = tile.th >> 2;
+    if (s1 < s0 || t1 < t0)
+        return;
+    for (uint32_t t = t0; t <= t1; t++) {
+        const uint32_t row = t - t0;
+        const uint32_t base = tile.tmem * 8 + row * tile.line * 8;
+        const uint32_t swap = (row & 1) ? 4 : 0;
+        const uint32_t src = tex_addr_ + texel_bytes(tex_size_, t * tex_width_);
+        if (tex_size_ == 3) {
+            for (uint32_t s = s0; s <= s1; s++) {
+                const uint32_t texel = rd32(src + s * 4);
+                const uint32_t dst = ((base + (s - s0) * 2) ^ swap) & 0x7FF;
+                tmem_[dst] = static_cast<uint8_t>(texel >> 24);
+                tmem_[dst + 1] = static_cast<uint8_t>(texel >> 16);
+                tmem_[dst | 0x800] = static_cast<uint8_t>(texel >> 8);
+                tmem_[(dst + 1) | 0x800] = static_cast<uint8_t>(texel);
+            }
+            continue;
+        }
+        const uint32_t first = texel_bytes(tex_size_, s0) - (tex_size_ == 0 ? s0 & 1 : 0);
+        const uint32_t count = texel_bytes(tex_size_, s1 - s0 + 1);
+        for (uint32_t i = 0; i < count; i++)
+            tmem_[((base + i) ^ swap) & 0xFFF] = rd8(src + first + i);
+    }
+}
+
+void SoftRenderer::load_block(const uint32_t *w) {
+    Tile &tile = tiles_[(w[1] >> 24) & 7];
+    const uint32_t sl = (w[0] >> 12) & 0xFFF;
+    const uint32_t tl = w[0] & 0xFFF;
+    const uint32_t sh = (w[1] >> 12) & 0xFFF;
+    const uint32_t dxt = w[1] & 0xFFF;
+    tile.sl = sl;
+    tile.tl = tl;
+    tile.sh = sh;
+    tile.th = dxt;
+    if (sh < sl)
+        return;
+    const uint32_t texels = sh - sl + 1;
+    const uint32_t src =
+        tex_addr_ + texel_bytes(tex_size_, tl * tex_width_ + sl);
+    const uint32_t base = tile.tmem * 8;
+    if (tex_size_ == 3) {
+        for (uint32_t k = 0; k < texels; k++) {
+            const uint32_t line = ((k / 4) * dxt) >> 11;
+            const uint32_t swap = (line & 1) ? 4 : 0;
+            const uint32_t texel = rd32(src + k * 4);
+            const uint32_t dst = ((base + k * 2) ^ swap) & 0x7FF;
+            tmem_[dst] = static_cast<uint8_t>(texel >> 24);
+            tmem_[dst + 1] = static_cast<uint8_t>(texel >> 16);
+            tmem_[dst | 0x800] = static_cast<uint8_t>(texel >> 8);
+            tmem_[(dst + 1) | 0x800] = static_cast<uint8_t>(texel);
+        }
+        return;
+    }
+    const uint32_t bytes = texel_bytes(tex_size_, texels);
+    for (uint32_t i = 0; i < bytes; i++) {
+        const uint32_t line = ((i / 8) * dxt) >> 11;
+        const uint32_t swap = (line & 1) ? 4 : 0;
+        tmem_[((base + i) ^ swap) & 0xFFF] = rd8(src + i);
+    }
+}
+
+void SoftRenderer::load_tlut(const uint32_t *w) {
+    const Tile &tile = tiles_[(w[1] >> 24) & 7];
+    const uint32_t s0 = ((w[0] >> 12) & 0xFFF) >> 2;
+    const uint32_t t0 = (w[0] & 0xFFF) >> 2;
+    const uint32_t s1 = ((w[1] >> 12) & 0xFFF) >> 2;
+    if (s1 < s0)
+        return;
+    const uint32_t src = tex_addr_ + t0 * tex_width_ * 2;
+    for (uint32_t s = s0; s <= s1; s++) {
+        const uint16_t entry = rd16(src + s * 2);
+        // Each entry is replicated across the four TMEM banks.
+        const uint32_t dst = tile.tmem * 8 + (s - s0) * 8;
+        for (uint32_t bank = 0; bank < 4; bank++) {
+            tmem_[(dst + bank * 2) & 0xFFF] = static_cast<uint8_t>(entry >> 8);
+            tmem_[(dst + bank * 2 + 1) & 0xFFF] = static_cast<uint8_t>(entry);
+        }
+    }
+}
+
+Rgba SoftRenderer::fetch(const Tile &tile, int32_t s, int32_t t) const {
+    const uint32_t base = tile.tmem * 8 + static_cast<uint32_t>(t) * tile.line * 8;
+    const uint32_t swap = (t & 1) ? 4 : 0;
+    const uint32_t us = static_cast<uint32_t>(s);
+
+    uint32_t index = 0;
+    switch (tile.size) {
+    case 0: {
+        const uint8_t byte = tmem_[((base + us / 2) ^ swap) & 0xFFF];
+        index = (us & 1) ? byte & 0xF : byte >> 4;
+        if (modes_.tlut_en) {
+            index |= tile.palette << 4;
+            break;
+        }
+        const auto n = static_cast<int32_t>(index);
+        if (tile.fmt == 3) // IA4
+            return intensity(((n >> 1) * 255) / 7, (n & 1) ? 255 : 0);
+        return intensity(n * 17, n * 17);
+    }
+    case 1: {
+        index = tmem_[((base + us) ^ swap) & 0xFFF];
+        if (modes_.tlut_en)
+            break;
+        const auto n = static_cast<int32_t>(index);
+        if (tile.fmt == 3) // IA8
+            return intensity((n >> 4) * 17, (n & 0xF) * 17);
+        return intensity(n, n);
+    }
+    case 2: {
+        const uint32_t addr = (base + us * 2) ^ swap;
+        const uint16_t texel = tmem16(modes_.tlut_en ? addr & 0x7FF : addr);
+        if (modes_.tlut_en) {
+            index = texel >> 8;
+            break;
+        }
+        if (tile.fmt == 3) // IA16
+            return intensity(texel >> 8, texel & 0xFF);
+        return unpack_rgba16(texel);
+    }
+    default: {
+        const uint32_t addr = ((base + us * 2) ^ swap) & 0x7FF;
+        const uint16_t rg = tmem16(addr);
+        const uint16_t ba = tmem16(addr | 0x800);
+        return {rg >> 8, rg & 0xFF, ba >> 8, ba & 0xFF};
+    }
+    }
+
+    const uint16_t entry = tmem16(0x800 + (index & 0xFF) * 8);
+    if (modes_.tlut_ia)
+        return intensity(entry >> 8, entry & 0xFF);
+    return unpack_rgba16(entry);
+}
+
+namespace {
+int32_t shift_coord(int32_t c, uint32_t shift) {
+    if (shift == 0)
+        return c;
+    if (shift <= 10)
+        return c >> shift;
+    return c << (16 - shift);
+}
+
+int32_t wrap_coord(int32_t c, int32_t max, bool clamp, bool mirror,
+                   uint32_t mask) {
+    mask = std::min<uint32_t>(mask, 10);
+    if (clamp || mask == 0)
+        c = std::clamp(c, 0, std::max(max, 0));
+    if (mask) {
+        if (mirror && ((c >> mask) & 1))
+            c = ~c;
+        c &= (1 << mask) - 1;
+    }
+    return c;
+}
+
+Rgba lerp3(const Rgba &a, const Rgba &b, const Rgba &c, int32_t fb,
+           int32_t fc) {
+    // a + fb * (b - a) + fc * (c - a), fractions in 1/32.
+    return {a.r + (((b.r - a.r) * fb + (c.r - a.r) * fc + 16) >> 5),
+            a.g + (((b.g - a.g) * fb + (c.g - a.g) * fc + 16) >> 5),
+            a.b + (((b.b - a.b) * fb + (c.b - a.b) * fc + 16) >> 5),
+            a.a + (((b.a - a.a) * fb + (c.a - a.a) * fc + 16) >> 5)};
+}
+} // namespace
+
+// s, t in s10.5 texels. Bilinear mode uses the RDP's three-point filter.
+Rgba SoftRenderer::sample(uint32_t tile_index, int32_t s, int32_t t) const {
+    const Tile &tile = tiles_[tile_index & 7];
+    s = shift_coord(s, tile.shift_s) - static_cast<int32_t>(tile.sl << 3);
+    t = shift_coord(t, tile.shift_t) - static_cast<int32_t>(tile.tl << 3);
+    const int32_t max_s = static_cast<int32_t>(tile.sh >> 2) -
+                          static_cast<int32_t>(tile.sl >> 2);
+    const int32_t max_t = static_cast<int32_t>(tile.th >> 2) -
+                          static_cast<int32_t>(tile.tl >> 2);
+    auto texel = [&](int32_t ts, int32_t tt) {
+        return fetch(tile, wrap_coord(ts, max_s, tile.cs, tile.ms, tile.mask_s),
+                     wrap_coord(tt, max_t, tile.ct, tile.mt, tile.mask_t));
+    };
+
+    const int32_t s0 = s >> 5;
+    const int32_t t0 = t >> 5;
+    if (!modes_.bilerp || modes_.cycle_type == CYCLE_COPY)
+        return texel(s0, t0);
+
+    const int32_t fs = s & 31;
+    const int32_t ft = t & 31;
+    if (fs + ft < 32)
+        return lerp3(texel(s0, t0), texel(s0 + 1, t0), texel(s0, t0 + 1), fs,
+                     ft);
+    return lerp3(texel(s0 + 1, t0 + 1), texel(s0, t0 + 1), texel(s0 + 1, t0),
+                 32 - fs, 32 - ft);
+}
+
+// (A - B) * C + D per channel. One-cycle mode uses the second cycle's
+// selectors, like the hardware.
+Rgba SoftRenderer::combine(unsigned cycle, const Inputs &in) const {
+    const Combiner &cc = combiner_;
+    const Rgba one{256, 256, 256, 256};
+    const Rgba zero{};
+
+    auto color = [&](uint32_t sel, bool sub_b) -> Rgba {
+        switch (sel) {
+        case 0:
+            return in.combined;
+        case 1:
+            return in.tex0;
+        case 2:
+            return in.tex1;
+        case 3:
+            return prim_color_;
+        case 4:
+            return in.shade;
+        case 5:
+            return env_color_;
+        case 6:
+            return sub_b ? zero : one; // key center is not emulated
+        case 7:
+            return sub_b ? Rgba{k4_, k4_, k4_, 0} : zero; // noise
+        default:
+            return zero;
+        }
+    };
+    auto scalar = [](int32_t v) { return Rgba{v, v, v, v}; };
+    auto mul = [&](uint32_t sel) -> Rgba {
+        switch (sel) {
+        case 0:
+            return in.combined;
+        case 1:
+            return in.tex0;
+        case 2:
+            return in.tex1;
+        case 3:
+            return prim_color_;
+        case 4:
+            return in.shade;
+        case 5:
+            return env_color_;
+        case 7:
+            return scalar(in.combined.a);
+        case 8:
+            return scalar(in.tex0.a);
+        case 9:
+            return scalar(in.tex1.a);
+        case 10:
+            return scalar(prim_color_.a);
+        case 11:
+            return scalar(in.shade.a);
+        case 12:
+            return scalar(env_color_.a);
+        case 14:
+            return scalar(prim_lod_frac_);
+        case 15:
+            return scalar(k5_);
+        default:
+            return zero; // key scale, LOD fraction
+        }
+    };
+    auto alpha = [&](uint32_t sel, bool is_mul) -> int32_t {
+        switch (sel) {
+        case 0:
+            return is_mul ? 0 : in.combined.a;
+        case 1:
+            return in.tex0.a;
+        case 2:
+            return in.tex1.a;
+        case 3:
+            return prim_color_.a;
+        case 4:
+            return in.shade.a;
+        case 5:
+            return env_color_.a;
+        case 6:
+            return is_mul ? prim_lod_frac_ : 256;
+        default:
+            return 0;
+        }
+    };
+    auto eval = [](int32_t a, int32_t b, int32_t c, int32_t d) {
+        return clamp8(((a - b) * c + (d << 8) + 0x80) >> 8);
+    };
+
+    const Rgba a = color(cc.rgb_a[cycle], false);
+    const Rgba b = color(cc.rgb_b[cycle], true);
+    const Rgba c = mul(cc.rgb_c[cycle]);
+    const uint32_t d_sel = cc.rgb_d[cycle];
+    const Rgba d = d_sel == 6 ? one : d_sel == 7 ? zero : color(d_sel, false);
+
+    Rgba out;
+    out.r = eval(a.r, b.r, c.r, d.r);
+    out.g = eval(a.g, b.g, c.g, d.g);
+    out.b = eval(a.b, b.b, c.b, d.b);
+    out.a = eval(alpha(cc.alpha_a[cycle], false), alpha(cc.alpha_b[cycle], false),
+                 alpha(cc.alpha_c[cycle], true), alpha(cc.alpha_d[cycle], false));
+    return out;
+}
+
+// P * A + M * B. Without force_blend the final cycle passes P through:
+// coverage is not tracked, so there are no antialiased edges to blend.
+Rgba SoftRenderer::blend(unsigned cycle, const Rgba &in, int32_t in_alpha,
+                         int32_t shade_alpha, const Rgba &mem,
+                         bool force) const {
+    auto color = [&](uint32_t sel) -> const Rgba & {
+        switch (sel) {
+        case 0:
+            return in;
+        case 1:
+            return mem;
+        case 2:
+            return blend_color_;
+        default:
+            return fog_color_;
+        }
+    };
+    const Rgba &p = color(modes_.blend_p[cycle]);
+    if (!force)
+        return p;
+    const Rgba &m = color(modes_.blend_m[cycle]);
+
+    int32_t a = 0;
+    switch (modes_.blend_a[cycle]) {
+    case 0:
+        a = in_alpha;
+        break;
+    case 1:
+        a = fog_color_.a;
+        break;
+    case 2:
+        a = shade_alpha;
+        break;
+    default:
+        break;
+    }
+    int32_t b = 0;
+    switch (modes_.blend_b[cycle]) {
+    case 0:
+        b = 255 - a;
+        break;
+    case 1:
+        b = mem.a;
+        break;
+    case 2:
+        b = 255;
+        break;
+    default:
+        break;
+    }
+    return {clamp8((p.r * a + m.r * b) >> 8), clamp8((p.g * a + m.g * b) >> 8),
+            clamp8((p.b * a + m.b * b) >> 8), in.a};
+}
+
+void SoftRenderer::shade_pixel(int32_t x, int32_t y, const Rgba &shade,
+                               int32_t s, int32_t t, uint32_t z, bool use_z,
+                               uint32_t tile) {
+    if (color_size_ < 2)
+        return; // 8-bit targets are only drawn in fill mode
+    const bool two_cycle = modes_.cycle_type == CYCLE_2;
+    const uint32_t pixel = static_cast<uint32_t>(y) * color_width_ +
+                           static_cast<uint32_t>(x);
+    const uint32_t zaddr = mask_addr_ + pixel * 2;
+
+    if (use_z && modes_.z_prim)
+        z = prim_z_;
+    if (use_z && modes_.z_compare) {
+        const uint32_t mem_z = z_decompress(rd16(zaddr) >> 2);
+        if (modes_.z_decal ? (z > mem_z + 0x100 || z + 0x100 < mem_z)
+                           : z > mem_z)
+            return;
+    }
+
+    Inputs in;
+    in.shade = shade;
+    in.tex0 = sample(tile, s, t);
+    in.tex1 = two_cycle ? sample(tile + 1, s, t) : in.tex0;
+    Rgba out = combine(0, in);
+    if (two_cycle) {
+        in.combined = out;
+        out = combine(1, in);
+    } else {
+        out = combine(1, in);
+    }
+
+    if (modes_.alpha_compare && out.a < blend_color_.a)
+        return;
+
+    const uint32_t caddr = color_addr_ + pixel * (color_size_ == 3 ? 4 : 2);
+    Rgba mem;
+    if (color_size_ == 3) {
+        mem = unpack_rgba32(rd32(caddr));
+    } else {
+        mem = unpack_rgba16(rd16(caddr));
+        mem.a = mem.a ? 0xE0 : 0;
+    }
+
+    Rgba color = out;
+    if (two_cycle)
+        color = blend(0, color, out.a, shade.a, mem, true);
+    color = blend(two_cycle ? 1 : 0, color, out.a, shade.a, mem,
+                  modes_.force_blend);
+
+    if (color_size_ == 3) {
+        wr32(caddr, (static_cast<uint32_t>(color.r) << 24) |
+                        (static_cast<uint32_t>(color.g) << 16) |
+                        (static_cast<uint32_t>(color.b) << 8) | 0xE0);
+    } else {
+        wr16(caddr, pack_rgba16(color, true));
+    }
+    if (use_z && modes_.z_update)
+        wr16(zaddr, static_cast<uint16_t>(z_compress(z) << 2));
+}
+
+void SoftRenderer::fill_pixel(int32_t x, int32_t y) {
+    const uint32_t pixel = static_cast<uint32_t>(y) * color_width_ +
+                           static_cast<uint32_t>(x);
+    switch (color_size_) {
+    case 1:
+        wr8(color_addr_ + pixel,
+            static_cast<uint8_t>(fill_color_ >> (8 * (3 - (x & 3)))));
+        break;
+    case 2:
+        wr16(color_addr_ + pixel * 2,
+             static_cast<uint16_t>((x & 1) ? fill_color_ : fill_color_ >> 16));
+        break;
+    case 3:
+        wr32(color_addr_ + pixel * 4, fill_color_);
+        break;
+    default:
+        break;
+    }
+}
+
+void SoftRenderer::draw_fill_rect(const uint32_t *w) {
+    const bool inclusive = modes_.cycle_type >= CYCLE_COPY;
+    const int32_t x0 = std::max(static_cast<int32_t>((w[1] >> 12) & 0xFFF) >> 2, sc_x0_);
+    const int32_t y0 = std::max(static_cast<int32_t>(w[1] & 0xFFF) >> 2, sc_y0_);
+    const int32_t x1 = std::min((static_cast<int32_t>((w[0] >> 12) & 0xFFF) >> 2) +
+                                    (inclusive ? 1 : 0),
+                                sc_x1_);
+    const int32_t y1 = std::min((static_cast<int32_t>(w[0] & 0xFFF) >> 2) +
+                                    (inclusive ? 1 : 0),
+                                sc_y1_);
+    const Rgba shade{};
+    for (int32_t y = y0; y < y1; y++) {
+        if (!owns_line(y))
+            continue;
+        for (int32_t x = x0; x < x1; x++) {
+            if (modes_.cycle_type == CYCLE_FILL)
+                fill_pixel(x, y);
+            else
+                shade_pixel(x, y, shade, 0, 0, prim_z_, modes_.z_prim, 0);
+        }
+    }
+}
+
+void SoftRenderer::draw_texture_rect(const uint32_t *w, bool flip) {
+    const bool copy = modes_.cycle_type == CYCLE_COPY;
+    const bool inclusive = modes_.cycle_type >= CYCLE_COPY;
+    const uint32_t tile = (w[1] >> 24) & 7;
+    const int32_t xh = static_cast<int32_t>((w[1] >> 12) & 0xFFF) >> 2;
+    const int32_t yh = static_cast<int32_t>(w[1] & 0xFFF) >> 2;
+    const int32_t xl = static_cast<int32_t>((w[0] >> 12) & 0xFFF) >> 2;
+    const int32_t yl = static_cast<int32_t>(w[0] & 0xFFF) >> 2;
+    const int32_t s_start = sext(w[2] >> 16, 16);
+    const int32_t t_start = sext(w[2] & 0xFFFF, 16);
+    int32_t dsdx = sext(w[3] >> 16, 16);
+    const int32_t dtdy = sext(w[3] & 0xFFFF, 16);
+    if (copy)
+        dsdx >>= 2; // four pixels per clock
+
+    const int32_t x0 = std::max(xh, sc_x0_);
+    const int32_t y0 = std::max(yh, sc_y0_);
+    const int32_t x1 = std::min(xl + (inclusive ? 1 : 0), sc_x1_);
+    const int32_t y1 = std::min(yl + (inclusive ? 1 : 0), sc_y1_);
+    const Rgba shade{};
+    for (int32_t y = y0; y < y1; y++) {
+        if (!owns_line(y))
+            continue;
+        for (int32_t x = x0; x < x1; x++) {
+            // s10.5 + s5.10 steps.
+            const int32_t step_x = x - xh;
+            const int32_t step_y = y - yh;
+            const int32_t s = flip ? s_start + ((dsdx * step_y) >> 5)
+                                   : s_start + ((dsdx * step_x) >> 5);
+            const int32_t t = flip ? t_start + ((dtdy * step_x) >> 5)
+                                   : t_start + ((dtdy * step_y) >> 5);
+            if (!copy) {
+                shade_pixel(x, y, shade, s, t, prim_z_, modes_.z_prim, tile);
+                continue;
+            }
+            const Rgba texel = sample(tile, s, t);
+            if (modes_.alpha_compare && texel.a == 0)
+                continue;
+            const uint32_t pixel = static_cast<uint32_t>(y) * color_width_ +
+                                   static_cast<uint32_t>(x);
+            if (color_size_ == 2)
+                wr16(color_addr_ + pixel * 2, pack_rgba16(texel, texel.a != 0));
+            else if (color_size_ == 3)
+                wr32(color_addr_ + pixel * 4,
+                     (static_cast<uint32_t>(texel.r) << 24) |
+                         (static_cast<uint32_t>(texel.g) << 16) |
+                         (static_cast<uint32_t>(texel.b) << 8) |
+                         static_cast<uint32_t>(texel.a));
+            else if (color_size_ == 1)
+                wr8(color_addr_ + pixel, static_cast<uint8_t>(texel.r));
+        }
+    }
+}
+
+namespace {
+// Attribute in s15.16 with its x and edge (per scanline) derivatives.
+struct Attr {
+    int32_t base{0};
+    int32_t dx{0};
+    int32_t de{0};
+};
+
+// Coefficient blocks store four integer halves, then four fractions.
+void read_attrs(const uint32_t *w, Attr *out, unsigned count) {
+    auto fixed = [&](unsigned int_word, unsigned frac_word, unsigned lane) {
+        const uint32_t hi = lane ? w[int_word] & 0xFFFF : w[int_word] >> 16;
+        const uint32_t lo = lane ? w[frac_word] & 0xFFFF : w[frac_word] >> 16;
+        return static_cast<int32_t>((hi << 16) | lo);
+    };
+    for (unsigned i = 0; i < count; i++) {
+        const unsigned word = i / 2;
+        const unsigned lane = i & 1;
+        out[i].base = fixed(word, word + 4, lane);
+        out[i].dx = fixed(word + 2, word + 6, lane);
+        out[i].de = fixed(word + 8, word + 12, lane);
+    }
+}
+
+int64_t mul16(int32_t a, int64_t b) { return (static_cast<int64_t>(a) * b) >> 16; }
+} // namespace
+
+void SoftRenderer::draw_triangle(uint32_t op, const uint32_t *w) {
+    const bool shaded = op & 4;
+    const bool textured = op & 2;
+    const bool zbuffered = op & 1;
+    const bool left_major = (w[0] >> 23) & 1;
+    const uint32_t tile = (w[0] >> 16) & 7;
+    const int32_t yl = sext(w[0] & 0x3FFF, 14);
+    const int32_t ym = sext((w[1] >> 16) & 0x3FFF, 14);
+    const int32_t yh = sext(w[1] & 0x3FFF, 14);
+    const auto xl = static_cast<int32_t>(w[2]);
+    const auto dxldy = static_cast<int32_t>(w[3]);
+    const auto xh = static_cast<int32_t>(w[4]);
+    const auto dxhdy = static_cast<int32_t>(w[5]);
+    const auto xm = static_cast<int32_t>(w[6]);
+    const auto dxmdy = static_cast<int32_t>(w[7]);
+
+    // r, g, b, a / s, t, w / z.
+    Attr shade[4];
+    Attr tex[3];
+    Attr depth;
+    const uint32_t *coef = w + 8;
+    if (shaded) {
+        read_attrs(coef, shade, 4);
+        coef += 16;
+    }
+    if (textured) {
+        read_attrs(coef, tex, 3);
+        coef += 16;
+    }
+    if (zbuffered)
+        depth = {static_cast<int32_t>(coef[0]), static_cast<int32_t>(coef[1]),
+                 static_cast<int32_t>(coef[2])};
+
+    const bool fill = modes_.cycle_type == CYCLE_FILL;
+    if (modes_.cycle_type == CYCLE_COPY)
+        return; // copy mode only supports rectangles
+
+    const int32_t y_top = yh >> 2;
+    const int32_t y_first = std::max(y_top, sc_y0_);
+    const int32_t y_last = std::min((yl + 3) >> 2, sc_y1_);
+    for (int32_t y = y_first; y < y_last; y++) {
+        // Sample each scanline at its centre (quarter-line units).
+        const int32_t yq = y * 4 + 2;
+        if (yq < yh || yq >= yl || !owns_line(y))
+            continue;
+        const int64_t dy = static_cast<int64_t>(yq - y_top * 4) << 14;
+        const int64_t major = xh + mul16(dxhdy, dy);
+        const int64_t minor =
+            yq < ym ? xm + mul16(dxmdy, dy)
+                    : xl + mul16(dxldy, static_cast<int64_t>(yq - ym) << 14);
+        const int64_t lo = left_major ? major : minor;
+        const int64_t hi = left_major ? minor : major;
+        // Pixels whose centre lies in [lo, hi).
+        const auto x_begin = static_cast<int32_t>(
+            std::max<int64_t>((lo - 0x8000 + 0xFFFF) >> 16, sc_x0_));
+        const auto x_end = static_cast<int32_t>(
+            std::min<int64_t>((hi - 0x8000 + 0xFFFF) >> 16, sc_x1_));
+        if (x_begin >= x_end)
+            continue;
+
+        // Attributes at the first pixel: walk the major edge, then across.
+        const int64_t xoff = (static_cast<int64_t>(x_begin) << 16) + 0x8000 - major;
+        auto start = [&](const Attr &a) {
+            return a.base + mul16(a.de, dy) + mul16(a.dx, xoff);
+        };
+        int64_t sv[4] = {};
+        int64_t tv[3] = {};
+        int64_t zv = 0;
+        if (shaded)
+            for (int i = 0; i < 4; i++)
+                sv[i] = start(shade[i]);
+        if (textured)
+            for (int i = 0; i < 3; i++)
+                tv[i] = start(tex[i]);
+        if (zbuffered)
+            zv = start(depth);
+
+        for (int32_t x = x_begin; x < x_end; x++) {
+            if (fill) {
+                fill_pixel(x, y);
+                continue;
+            }
+            Rgba c;
+            if (shaded)
+                c = {clamp8(static_cast<int32_t>(sv[0] >> 16)),
+                     clamp8(static_cast<int32_t>(sv[1] >> 16)),
+                     clamp8(static_cast<int32_t>(sv[2] >> 16)),
+                     clamp8(static_cast<int32_t>(sv[3] >> 16))};
+            int32_t s = 0;
+            int32_t t = 0;
+            if (textured) {
+                if (modes_.persp_tex) {
+                    const int64_t wv = std::max<int64_t>(tv[2], 1);
+                    s = static_cast<int32_t>((tv[0] * 0x8000) / wv);
+                    t = static_cast<int32_t>((tv[1] * 0x8000) / wv);
+                } else {
+                    s = static_cast<int32_t>(tv[0] >> 16);
+                    t = static_cast<int32_t>(tv[1] >> 16);
+                }
+            }
+            const auto z = static_cast<uint32_t>(
+                std::clamp<int64_t>(zv >> 13, 0, 0x3FFFF));
+            shade_pixel(x, y, c, s, t, z, zbuffered, tile);
+
+            for (int i = 0; i < 4; i++)
+                sv[i] += shade[i].dx;
+            for (int i = 0; i < 3; i++)
+                tv[i] += tex[i].dx;
+            zv += depth.dx;
+        }
+    }
+}
+
+SoftRdp::SoftRdp() = default;
+
+SoftRdp::~SoftRdp() { fini(); }
+
+SoftRdp &SoftRdp::get_instance() {
+    static SoftRdp instance;
+    return instance;
+}
+
+void SoftRdp::init(uint8_t *rdram, unsigned threads) {
+    fini();
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+        if (const char *e = std::getenv("N64_SOFT_RDP_THREADS"); e && e[0])
+            threads = static_cast<unsigned>(std::strtoul(e, nullptr, 10));
+    }
+    threads = std::clamp(threads, 1u, MAX_THREADS);
+
+    rdram_ = rdram;
+    for (unsigned i = 0; i < threads; i++)
+        renderers_.push_back(std::make_unique<SoftRenderer>(rdram, i, threads));
+    quit_ = false;
+    for (unsigned i = 1; i < threads; i++)
+        threads_.emplace_back([this, i] { worker_loop(i); });
+    Utils::debug("Software RDP: {} thread(s)", threads);
+}
+
+void SoftRdp::fini() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    cv_.notify_all();
+    for (auto &t : threads_)
+        t.join();
+    threads_.clear();
+    renderers_.clear();
+    batch_.clear();
+    written_.clear();
+    rdram_ = nullptr;
+    color_addr_ = mask_addr_ = tex_addr_ = 0;
+    z_enabled_ = false;
+}
+
+void SoftRdp::worker_loop(unsigned index) {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        cv_.wait(lock, [&] { return quit_ || generation_ != seen; });
+        if (quit_)
+            return;
+        seen = generation_;
+        lock.unlock();
+        renderers_[index]->run(batch_);
+        lock.lock();
+        if (--running_ == 0)
+            done_cv_.notify_all();
+    }
+}
+
+void SoftRdp::enqueue(int command_length, const uint32_t *words) {
+    if (!rdram_ || command_length < 2)
+        return;
+    const uint32_t op = (words[0] >> 24) & 0x3F;
+    const auto len = std::min<uint32_t>(static_cast<uint32_t>(command_length),
+                                        COMMAND_WORDS[op]);
+    track(words);
+    batch_.push_back(len);
+    batch_.insert(batch_.end(), words, words + len);
+    if (batch_.size() >= MAX_BATCH_WORDS)
+        flush();
+}
+
+void SoftRdp::flush() {
+    if (batch_.empty())
+        return;
+    if (!threads_.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = static_cast<unsigned>(threads_.size());
+            ++generation_;
+        }
+        cv_.notify_all();
+    }
+    renderers_[0]->run(batch_);
+    if (!threads_.empty()) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this] { return running_ == 0; });
+    }
+    batch_.clear();
+    written_.clear();
+}
+
+// Workers render a batch in parallel, so a texture load in the batch must not
+// read pixels an earlier command of the same batch draws: render first.
+void SoftRdp::track(const uint32_t *w) {
+    const uint32_t op = (w[0] >> 24) & 0x3F;
+    switch (op) {
+    case OP_SET_COLOR_IMAGE:
+        color_bytes_ = pixel_bytes((w[0] >> 19) & 3);
+        color_width_ = (w[0] & 0x3FF) + 1;
+        color_addr_ = w[1] & 0x00FFFFFF;
+        break;
+    case OP_SET_MASK_IMAGE:
+        mask_addr_ = w[1] & 0x00FFFFFF;
+        break;
+    case OP_SET_TEXTURE_IMAGE:
+        tex_bytes_ = pixel_bytes((w[0] >> 19) & 3);
+        tex_width_ = (w[0] & 0x3FF) + 1;
+        tex_addr_ = w[1] & 0x00FFFFFF;
+        break;
+    case OP_SET_SCISSOR:
+        scissor_yl_ = ((w[1] & 0xFFF) >> 2) + 1;
+        break;
+    case OP_SET_OTHER_MODES:
+        z_enabled_ = ((w[1] >> 4) & 3) != 0;
+        break;
+    case OP_TEXTURE_RECT:
+    case OP_TEXTURE_RECT_FLIP:
+    case OP_FILL_RECT: {
+        const uint32_t line = color_width_ * color_bytes_;
+        add_written(color_addr_, color_addr_ + line * scissor_yl_);
+        break;
+    }
+    case OP_LOAD_TLUT:
+    case OP_LOAD_TILE: {
+        const uint32_t line = tex_width_ * tex_bytes_;
+        const uint32_t t0 = (w[0] & 0xFFF) >> 2;
+        const uint32_t t1 = ((w[1] & 0xFFF) >> 2) + 1;
+        if (reads_batch_output(tex_addr_ + t0 * line, tex_addr_ + t1 * line))
+            flush();
+        break;
+    }
+    case OP_LOAD_BLOCK: {
+        const uint32_t sl = (w[0] >> 12) & 0xFFF;
+        const uint32_t sh = (w[1] >> 12) & 0xFFF;
+        const uint32_t begin =
+            tex_addr_ + ((w[0] & 0xFFF) * tex_width_ + sl) * tex_bytes_;
+        if (reads_batch_output(begin, begin + (sh + 1 - std::min(sl, sh)) * tex_bytes_))
+            flush();
+        break;
+    }
+    default:
+        if (op >= OP_TRIANGLE_FIRST && op <= OP_TRIANGLE_LAST) {
+            const uint32_t line = color_width_ * color_bytes_;
+            add_written(color_addr_, color_addr_ + line * scissor_yl_);
+            if (z_enabled_ && (op & 1))
+                add_written(mask_addr_, mask_addr_ + color_width_ * 2 * scissor_yl_);
+        }
+        break;
+    }
+}
+
+bool SoftRdp::reads_batch_output(uint32_t begin, uint32_t end) const {
+    return std::any_of(written_.begin(), written_.end(), [&](const Range &r) {
+        return begin < r.end && r.begin < end;
+    });
+}
+
+void SoftRdp::add_written(uint32_t begin, uint32_t end) {
+    for (const Range &r : written_)
+        if (r.begin == begin && r.end == end)
+            return;
+    written_.push_back({begin, end});
+}
+
+} // namespace Rdp
+} // namespace N64
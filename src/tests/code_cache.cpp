@@ -0,0 +1,74 @@
+#include "cpu/jit/code_cache.h"
+#include "test.h"
+#include <cstdint>
+
+namespace {
+int dummy_block() { return 1; }
+} // namespace
+
+namespace selftest {
+void code_cache_test() {
+    using N64::Cpu::Jit::CodeCache;
+    using N64::Cpu::Jit::CompiledBlock;
+
+    CodeCache cache;
+    const auto add = [&](uint32_t paddr, uint16_t insts) {
+        CompiledBlock *b = cache.new_block(paddr);
+        cache.insert(b, &dummy_block, insts);
+        return b;
+    };
+    CompiledBlock *a = add(0x1000, 8); // 0x1000..0x1020
+    CompiledBlock *b = add(0x1FF8, 4); // delay slot runs onto the next page
+    CompiledBlock *c = add(0x1100, 4);
+    test_eq(true, cache.page_has_code(0x2000));
+
+    // Data right after a block, or in a code-free granule, kills nothing.
+    test_eq(0u, cache.invalidate_range(0x1020, 4));
+    test_eq(0u, cache.invalidate_range(0x1040, 0x40));
+    test_eq(true, cache.lookup(0x1000) == a);
+
+    // A write to the second page still finds the block that spans it.
+    test_eq(1u, cache.invalidate_range(0x2004, 4));
+    test_eq(true, cache.lookup(0x1FF8) == nullptr);
+    test_eq(false, cache.page_has_code(0x2000));
+
+    // Dropped blocks can be revived until a new block takes their place.
+    test_eq(true, cache.find_stale(0x1FF8) == b);
+    cache.revive(b);
+    test_eq(true, cache.lookup(0x1FF8) == b);
+    test_eq(true, cache.page_has_code(0x2000));
+
+    test_eq(3u, cache.invalidate_page(0x1000));
+    test_eq(true, cache.lookup(0x1100) == nullptr);
+    test_eq(true, cache.find_stale(0x1100) == c);
+    CompiledBlock *d = add(0x1100, 2);
+    test_eq(true, cache.find_stale(0x1100) == nullptr);
+    test_eq(true, cache.lookup(0x1100) == d);
+
+    // A trace is dropped by writes to any block it joined, including ones
+    // below its entry.
+    CompiledBlock *t = cache.new_block(0x1200);
+    cache.insert_trace(t, &dummy_block, 8, 0x1180, 0x1220);
+    test_eq(0u, cache.invalidate_range(0x1220, 4));
+    test_eq(1u, cache.invalidate_range(0x1184, 4));
+    test_eq(true, cache.lookup(0x1200) == nullptr);
+    test_eq(true, cache.find_stale(0x1200) == t);
+
+    // Over the block budget a new generation starts; the one after that
+    // evicts the oldest slab with its blocks.
+    CodeCache small;
+    small.set_limits(0, 4);
+    for (uint32_t i = 0; i < 6; i++) {
+        CompiledBlock *blk = small.new_block(0x3000 + i * 0x100);
+        small.insert(blk, &dummy_block, 4);
+    }
+    test_eq(true, small.lookup(0x3000) == nullptr);
+    test_eq(true, small.lookup(0x3400) != nullptr);
+    test_eq(true, small.lookup(0x3500) != nullptr);
+    test_eq(0u, small.invalidate_range(0x3000, 0x10));
+    const CodeCache::Stats st = small.stats();
+    test_eq(size_t{2}, st.blocks);
+    test_eq(uint64_t{1}, st.evicted_slabs);
+    test_eq(uint64_t{4}, st.evicted_blocks);
+}
+} // namespace selftest
@@ -0,0 +1,50 @@
+#include "mmio/controller_input.h"
+#include "test.h"
+
+namespace {
+using N64::Mmio::N64ControllerState;
+using selftest::test_eq;
+
+int g_hook_channel = -1;
+N64ControllerState g_hook_live{};
+
+// A held A + Start with the stick pushed right and down.
+N64ControllerState inject(int channel, const N64ControllerState &live) {
+    g_hook_channel = channel;
+    g_hook_live = live;
+    return {0x90, 0x00, 100, -60};
+}
+
+void expect_state(const N64ControllerState &want,
+                  const N64ControllerState &got) {
+    test_eq(want.byte1, got.byte1);
+    test_eq(want.byte2, got.byte2);
+    test_eq(want.joy_x, got.joy_x);
+    test_eq(want.joy_y, got.joy_y);
+}
+} // namespace
+
+namespace selftest {
+void controller_input_test() {
+    using namespace N64::Input;
+    const N64ControllerState live{0x00, 0x20, -5, 7};
+    set_controller_state(2, live);
+    expect_state(live, read_for_pif(2));
+
+    // The hook sees the live state and the game reads what it returns.
+    set_pif_read_hook(&inject);
+    expect_state({0x90, 0x00, 100, -60}, read_for_pif(2));
+    test_eq(2, g_hook_channel);
+    expect_state(live, g_hook_live);
+    expect_state(live, get_controller_state(2));
+
+    // Unhooked, reads see the live state again.
+    set_pif_read_hook(nullptr);
+    expect_state(live, read_for_pif(2));
+
+    // Out-of-range channels are ignored and read as released.
+    set_controller_state(kMaxControllers, live);
+    expect_state({}, get_controller_state(kMaxControllers));
+    set_controller_state(2, {});
+}
+} // namespace selftest
@@ -0,0 +1,69 @@
+#include "utils/dma_copy.h"
+#include "test.h"
+#include "utils/byte_array.h"
+#include <cstdint>
+#include <vector>
+
+namespace {
+using Utils::DmaLayout;
+
+uint32_t index_of(uint32_t addr, DmaLayout layout) {
+    return layout == DmaLayout::HostWords ? Utils::byte_address(addr) : addr;
+}
+
+std::vector<uint8_t> pattern(size_t size) {
+    std::vector<uint8_t> v(size);
+    for (size_t i = 0; i < v.size(); i++)
+        v[i] = static_cast<uint8_t>(i * 7 + 3);
+    return v;
+}
+} // namespace
+
+namespace selftest {
+void dma_copy_test() {
+    constexpr DmaLayout layouts[] = {DmaLayout::HostWords,
+                                     DmaLayout::BigEndian};
+    const std::vector<uint8_t> src = pattern(128);
+
+    // Every alignment and layout pair matches a byte-by-byte copy.
+    for (DmaLayout dst_layout : layouts) {
+        for (DmaLayout src_layout : layouts) {
+            for (uint32_t dst_addr = 0; dst_addr < 8; dst_addr++) {
+                for (uint32_t src_addr = 0; src_addr < 8; src_addr++) {
+                    for (uint32_t len = 0; len < 80; len += 3) {
+                        std::vector<uint8_t> got(96, 0xEE);
+                        std::vector<uint8_t> want(96, 0xEE);
+                        Utils::dma_copy(got, dst_addr, dst_layout, src,
+                                        src_addr, src_layout, len);
+                        for (uint32_t i = 0; i < len; i++)
+                            want[index_of(dst_addr + i, dst_layout)] =
+                                src[index_of(src_addr + i, src_layout)];
+                        test_eq(true, got == want);
+                    }
+                }
+            }
+        }
+    }
+
+    // Word-aligned host words to big-endian is a byte swap per word.
+    {
+        std::vector<uint8_t> dst(8);
+        const std::vector<uint8_t> words = {0x44, 0x33, 0x22, 0x11,
+                                            0x88, 0x77, 0x66, 0x55};
+        Utils::dma_copy(dst, 0, DmaLayout::BigEndian, words, 0,
+                        DmaLayout::HostWords, 8);
+        test_eq(0x11223344u, Utils::read_from_byte_array32_be(dst, 0));
+        test_eq(0x55667788u, Utils::read_from_byte_array32_be(dst, 4));
+    }
+
+    // Offsets wrap around the end of each span.
+    {
+        std::vector<uint8_t> dst(32, 0);
+        Utils::dma_copy_wrapped(dst, 28, DmaLayout::HostWords, src, 124,
+                                DmaLayout::BigEndian, 12);
+        for (uint32_t i = 0; i < 12; i++)
+            test_eq(src[(124 + i) % 128],
+                    Utils::read_from_byte_array8(dst, (28 + i) % 32));
+    }
+}
+} // namespace selftest
@@ -0,0 +1,76 @@
+#include "memory/fastmem.h"
+#include "cpu/jit/code_cache.h"
+#include "memory/memory_map.h"
+#include "test.h"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+int dummy_block() { return 1; }
+} // namespace
+
+namespace selftest {
+void fastmem_test() {
+    namespace Fastmem = N64::Fastmem;
+    using N64::Cpu::Jit::CodeCache;
+    using N64::Cpu::Jit::FaultSite;
+
+    // Fault sites resolve to their slow path and are patched into a JMP,
+    // with or without a fastmem arena.
+    {
+        CodeCache cache;
+        uint8_t *code = cache.alloc_exec(64);
+        std::memset(code, 0x90, 64);
+        cache.add_fault_sites(code, {{4, 20, 40}});
+        const auto at = reinterpret_cast<uintptr_t>(code);
+        test_eq(uintptr_t{0}, cache.patch_fault_site(at + 3));
+        test_eq(uintptr_t{0}, cache.patch_fault_site(at + 20));
+        test_eq(at + 40, cache.patch_fault_site(at + 12));
+        test_eq(0xE9, static_cast<int>(code[4]));
+        int32_t rel = 0;
+        std::memcpy(&rel, code + 5, sizeof(rel));
+        test_eq(40 - 9, rel);
+        test_eq(uint64_t{1}, cache.stats().fault_patches);
+    }
+
+    uint8_t *rdram = Fastmem::alloc_rdram(N64::RDRAM_SIZE);
+    test_eq(true, Fastmem::may_hold_code(0x1000)); // off: always probe
+    if (!Fastmem::set_enabled(true))
+        return; // host without fastmem
+    uint8_t *base = Fastmem::base();
+
+    // The arena and the RDRAM pointer are views of the same pages.
+    rdram[0x1234] = 0x5A;
+    test_eq(0x5A, static_cast<int>(base[0x1234]));
+    base[0x7FFFFF] = 0xA5;
+    test_eq(0xA5, static_cast<int>(rdram[0x7FFFFF]));
+
+    // A page stays marked while any owner holds it.
+    Fastmem::set_code_page(0x2000, Fastmem::CODE_JIT, true);
+    Fastmem::set_code_page(0x2000, Fastmem::CODE_DECODE, true);
+    test_eq(true, Fastmem::may_hold_code(0x2FFC));
+    test_eq(false, Fastmem::may_hold_code(0x3000));
+    Fastmem::set_code_page(0x2000, Fastmem::CODE_JIT, false);
+    test_eq(true, Fastmem::may_hold_code(0x2000));
+    Fastmem::clear_code_pages(Fastmem::CODE_DECODE);
+    test_eq(false, Fastmem::may_hold_code(0x2000));
+    test_eq(true, Fastmem::may_hold_code(N64::RDRAM_SIZE));
+
+    // Compiled blocks mark their pages until dropped.
+    {
+        CodeCache cache;
+        cache.insert(cache.new_block(0x4000), &dummy_block, 4);
+        test_eq(true, Fastmem::may_hold_code(0x4000));
+        test_eq(1u, cache.invalidate_range(0x4000, 4));
+        test_eq(false, Fastmem::may_hold_code(0x4000));
+        cache.insert(cache.new_block(0x5000), &dummy_block, 4);
+    }
+    test_eq(false, Fastmem::may_hold_code(0x5000)); // cleared with the cache
+
+    // Unprotected again: the arena takes writes everywhere.
+    base[0x2000] = 1;
+    test_eq(1, static_cast<int>(rdram[0x2000]));
+    Fastmem::set_enabled(false);
+    test_eq(true, Fastmem::may_hold_code(0x6000));
+}
+} // namespace selftest
@@ -0,0 +1,101 @@
+#include "cpu/jit/ir_disk_cache.h"
+#include "test.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace selftest {
+void ir_disk_cache_test() {
+    using N64::Cpu::Jit::IrBlock;
+    using N64::Cpu::Jit::IrDiskCache;
+    using N64::Cpu::Jit::IrOp;
+    using N64::Cpu::Jit::IrOpKind;
+    namespace fs = std::filesystem;
+
+    const fs::path dir = fs::temp_directory_path() / "kamo64-ir-disk-cache";
+    fs::remove_all(dir);
+    const std::string path = (dir / "test.jit").string();
+
+    IrBlock b;
+    b.vaddr = 0x80001000;
+    b.paddr = 0x1000;
+    b.fr = true;
+    b.ends_with_branch = true;
+    b.successors[0] = {0x80002000, 0x2000};
+    b.num_successors = 1;
+    IrOp op{};
+    op.kind = IrOpKind::Addiu;
+    op.rs = 4;
+    op.rt = 5;
+    op.imm = 0x10;
+    b.ops.push_back(op);
+    op.kind = IrOpKind::J;
+    op.target = 0x800;
+    b.ops.push_back(op);
+
+    // Round trip through the file; nothing is read until the first find.
+    {
+        IrDiskCache c;
+        c.open(path, 0x11, 0x22);
+        test_eq(true, c.find(0x1000) == nullptr);
+        c.store(b, 0xabcdef);
+        test_eq(true, c.save());
+    }
+    {
+        IrDiskCache c;
+        c.open(path, 0x11, 0x22);
+        test_eq(0u, c.size());
+        const IrDiskCache::Entry *e = c.find(0x1000);
+        test_eq(true, e != nullptr);
+        test_eq(0xabcdefull, e->checksum);
+        test_eq(0x80001000u, e->ir.vaddr);
+        test_eq(true, e->ir.fr);
+        test_eq(true, e->ir.ends_with_branch);
+        test_eq(1, e->ir.num_successors);
+        test_eq(0x2000u, e->ir.successors[0].paddr);
+        test_eq(2u, e->ir.ops.size());
+        test_eq(true, e->ir.ops[0].kind == IrOpKind::Addiu);
+        test_eq(0x10, e->ir.ops[0].imm);
+        test_eq(0x800u, e->ir.ops[1].target);
+    }
+
+    // A bool byte other than 0 or 1 rejects the file. Block.fr follows
+    // the 28-byte header and the block's paddr and vaddr.
+    {
+        std::vector<uint8_t> data;
+        {
+            std::ifstream in(path, std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(in),
+                        std::istreambuf_iterator<char>());
+        }
+        test_eq(1, data.at(36));
+        data[36] = 2;
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(data.data()),
+                      static_cast<std::streamsize>(data.size()));
+        }
+        IrDiskCache c;
+        c.open(path, 0x11, 0x22);
+        test_eq(true, c.find(0x1000) == nullptr);
+    }
+
+    // Another ROM never sees the entries.
+    {
+        IrDiskCache c;
+        c.open(path, 0x11, 0x23);
+        test_eq(true, c.find(0x1000) == nullptr);
+    }
+
+    // Disabled cache stores nothing.
+    {
+        IrDiskCache c;
+        c.store(b, 1);
+        test_eq(false, c.enabled());
+        test_eq(0u, c.size());
+    }
+    fs::remove_all(dir);
+}
+} // namespace selftest
@@ -0,0 +1,91 @@
+#include "cpu/jit/ir_opt.h"
+#include "test.h"
+#include <cstdint>
+
+namespace {
+using N64::Cpu::Jit::IrBlock;
+using N64::Cpu::Jit::IrOp;
+using N64::Cpu::Jit::IrOpKind;
+
+IrOp make(IrOpKind kind, uint8_t rd, uint8_t rs, uint8_t rt, uint16_t imm = 0) {
+    IrOp op{};
+    op.kind = kind;
+    op.rd = rd;
+    op.rs = rs;
+    op.rt = rt;
+    op.imm = imm;
+    return op;
+}
+} // namespace
+
+namespace selftest {
+void ir_opt_test() {
+    using N64::Cpu::Jit::IrOptStats;
+    using N64::Cpu::Jit::optimize_block;
+
+    // lui/ori pair fused into one constant, then used as a load base.
+    IrBlock b;
+    b.ops.push_back(make(IrOpKind::Lui, 0, 0, 8, 0x8000));
+    b.ops.push_back(make(IrOpKind::Ori, 0, 8, 8, 0x1234));
+    b.ops.push_back(make(IrOpKind::Lw, 0, 8, 9, 0x10));
+    b.ops.push_back(make(IrOpKind::Addu, 0, 9, 9, 0)); // writes $zero
+    b.ops.push_back(make(IrOpKind::Or, 10, 9, 0));     // copy of $9
+    b.ops.push_back(make(IrOpKind::Addu, 11, 10, 10));
+    b.ops.push_back(make(IrOpKind::Jr, 0, 31, 0));
+    IrOptStats st;
+    optimize_block(b, &st);
+
+    test_eq(7u, b.ops.size());
+    test_eq(true, b.ops[0].kind == IrOpKind::Nop); // dead after the fold
+    test_eq(true, b.ops[1].kind == IrOpKind::LoadConst);
+    test_eq(8, b.ops[1].rd);
+    test_eq(0x80001234u, b.ops[1].target);
+    test_eq(true, b.ops[2].const_paddr);
+    test_eq(0x1244u, b.ops[2].paddr);
+    test_eq(true, b.ops[3].kind == IrOpKind::Nop);
+    test_eq(9, b.ops[5].rs);
+    test_eq(9, b.ops[5].rt);
+    test_eq(1u, st.r0_folded);
+    test_eq(1u, st.consts_folded);
+    test_eq(2u, st.copies);
+    test_eq(1u, st.dead_writes);
+    test_eq(1u, st.const_addrs);
+
+    // KUSEG and out-of-RDRAM addresses keep the TLB path; a write read by
+    // a later memory op stays live.
+    IrBlock c;
+    c.ops.push_back(make(IrOpKind::Lui, 0, 0, 4, 0x0040));
+    c.ops.push_back(make(IrOpKind::Sw, 0, 4, 5, 0));
+    c.ops.push_back(make(IrOpKind::Lui, 0, 0, 4, 0xA480));
+    c.ops.push_back(make(IrOpKind::Sw, 0, 4, 5, 0));
+    optimize_block(c);
+    test_eq(true, c.ops[0].kind == IrOpKind::Lui);
+    test_eq(false, c.ops[1].const_paddr);
+    test_eq(false, c.ops[3].const_paddr);
+
+    // A trace may leave at a seam, so a write the next block overwrites
+    // still has to happen.
+    IrBlock t;
+    t.ops.push_back(make(IrOpKind::Addu, 8, 4, 5));
+    t.ops.push_back(make(IrOpKind::Addu, 8, 6, 7));
+    t.seams.push_back({1, 0x80001000u});
+    optimize_block(t);
+    test_eq(true, t.ops[0].kind == IrOpKind::Addu);
+
+    // DSRAV shifts by rs & 63; SC writes rt, so an earlier constant for
+    // it is forgotten and LL/SC addresses are never pre-resolved.
+    IrBlock d;
+    d.ops.push_back(make(IrOpKind::Lui, 0, 0, 4, 0x8000));
+    d.ops.push_back(make(IrOpKind::Addiu, 0, 0, 5, 0x7F));
+    d.ops.push_back(make(IrOpKind::Dsrav, 6, 5, 4));
+    d.ops.push_back(make(IrOpKind::Addiu, 0, 0, 7, 1));
+    d.ops.push_back(make(IrOpKind::Sc, 0, 4, 7, 0));
+    d.ops.push_back(make(IrOpKind::Addu, 8, 7, 7));
+    d.ops.push_back(make(IrOpKind::Jr, 0, 31, 0));
+    optimize_block(d);
+    test_eq(true, d.ops[2].kind == IrOpKind::LoadConst);
+    test_eq(0xFFFFFFFFu, d.ops[2].target);
+    test_eq(false, d.ops[4].const_paddr);
+    test_eq(true, d.ops[5].kind == IrOpKind::Addu);
+}
+} // namespace selftest
@@ -0,0 +1,68 @@
+#include "utils/state_io.h"
+#include "test.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace selftest {
+void state_io_test() {
+    constexpr uint32_t TAG_A = Utils::state_tag("AAAA");
+    constexpr uint32_t TAG_B = Utils::state_tag("BBBB");
+
+    std::vector<uint8_t> buf;
+    Utils::StateWriter w(buf);
+    size_t at = w.begin_section(TAG_A);
+    w.pod(uint64_t{0x1122334455667788});
+    w.pod(std::array<uint16_t, 3>{1, 2, 3});
+    w.end_section(at);
+    at = w.begin_section(TAG_B);
+    w.pod(true);
+    w.end_section(at);
+
+    // Round trip.
+    {
+        Utils::StateReader r(buf);
+        size_t end = r.enter_section(TAG_A);
+        uint64_t v = 0;
+        std::array<uint16_t, 3> a{};
+        r.pod(v);
+        r.pod(a);
+        r.leave_section(end);
+        test_eq(true, r.ok());
+        test_eq(0x1122334455667788ull, v);
+        test_eq(3, a[2]);
+        end = r.enter_section(TAG_B);
+        bool b = false;
+        r.pod(b);
+        r.leave_section(end);
+        test_eq(true, r.ok());
+        test_eq(true, b);
+        test_eq(0u, r.remaining());
+    }
+
+    // Under-consumed section and wrong tag both fail.
+    {
+        Utils::StateReader r(buf);
+        const size_t end = r.enter_section(TAG_A);
+        uint64_t v = 0;
+        r.pod(v);
+        r.leave_section(end);
+        test_eq(false, r.ok());
+    }
+    {
+        Utils::StateReader r(buf);
+        r.enter_section(TAG_B);
+        test_eq(false, r.ok());
+    }
+
+    // Truncated input latches failure and leaves the target untouched.
+    {
+        Utils::StateReader r(std::span<const uint8_t>(buf.data(), 10));
+        r.enter_section(TAG_A);
+        uint64_t v = 42;
+        r.pod(v);
+        test_eq(false, r.ok());
+        test_eq(42u, v);
+    }
+}
+} // namespace selftest
@@ -13,6 +13,13 @@ namespace selftest {
 void run_all() {
     mult_test();
     bitfield_test();
+    state_io_test();
+    ir_opt_test();
+    code_cache_test();
+    ir_disk_cache_test();
+    fastmem_test();
+    dma_copy_test();
+    controller_input_test();
 }
 } // namespace selftest
 
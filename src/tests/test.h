@@ -19,6 +19,13 @@ void test_eq(T expect, U actual,
 
 void mult_test();
 void bitfield_test();
+void state_io_test();
+void ir_opt_test();
+void code_cache_test();
+void ir_disk_cache_test();
+void fastmem_test();
+void dma_copy_test();
+void controller_input_test();
 } // namespace selftest
 
 #endif // INCLUDE_GUARD_CEEB0D18_51A9_4EB2_B535_F45E29AFC936
@@ -4,6 +4,7 @@
 #include "mmio/controller_input.h"
 #include "mmio/vi.h"
 #include "n64_system/n64_system.h"
+#include "n64_system/save_state.h"
 #include "ui/audio_sdl.h"
 #include "ui/gui.h"
 #include "ui/imgui_layer.h"
@@ -176,6 +177,28 @@ bool event_hook(const SDL_Event &e) {
         return true;
     }
 
+    // Hold Tab in the game window to fast-forward (unthrottled).
+    if ((e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) &&
+        e.key.keysym.sym == SDLK_TAB) {
+        const bool down = e.type == SDL_KEYDOWN;
+        if (!down || (g_game_window &&
+                      e.key.windowID == SDL_GetWindowID(g_game_window))) {
+            if (N64System::fast_forward() != down)
+                N64System::set_fast_forward(down);
+            return true;
+        }
+    }
+
+    if (e.type == SDL_KEYDOWN && !e.key.repeat &&
+        g_gui.mode == AppMode::Running &&
+        (e.key.keysym.sym == SDLK_F5 || e.key.keysym.sym == SDLK_F7)) {
+        if (e.key.keysym.sym == SDLK_F5)
+            g_gui.request_save_state = true;
+        else
+            g_gui.request_load_state = true;
+        return true;
+    }
+
     if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F11 &&
         !e.key.repeat) {
         SDL_Window *target = g_game_window ? g_game_window : g_menu_window;
@@ -388,6 +411,21 @@ void App::run() {
 
         N64System::step(config);
 
+        if (g_gui.request_save_state || g_gui.request_load_state) {
+            const std::string path =
+                g_memory().cart_save_path("quick.state");
+            if (g_gui.request_save_state) {
+                std::error_code ec;
+                std::filesystem::create_directories(
+                    std::filesystem::path(path).parent_path(), ec);
+                N64System::save_state_file(path);
+            } else {
+                N64System::load_state_file(path);
+            }
+            g_gui.request_save_state = false;
+            g_gui.request_load_state = false;
+        }
+
         if (g_gui.request_stop || g_gui.request_quit) {
             const bool quit = g_gui.request_quit;
             stop_game(wsi, platform);
@@ -4,6 +4,10 @@
 #include "mmio/controller_input.h"
 #include "mmio/vi.h"
 #include "n64_system/n64_system.h"
+#include "n64_system/save_state.h"
+#include "n64_system/scheduler.h"
+#include "rcp/audio_hle.h"
+#include "rdp/rdp_core.h"
 #include "ui/app_paths.h"
 #include "ui/audio_sdl.h"
 #include "ui/input_sdl.h"
@@ -13,7 +17,12 @@
 #include "video/present.h"
 #include <SDL.h>
 #include <SDL_vulkan.h>
+#include <cstdio>
 #include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
 
 namespace N64 {
 namespace Ui {
@@ -24,6 +33,10 @@ constexpr int kWindowHeight = kWindowWidth * 3 / 4;
 
 Vulkan::WSI *g_wsi = nullptr;
 
+std::filesystem::path g_dump_dir;
+uint64_t g_dump_index = 0;
+uint64_t g_headless_fields = 0;
+
 void init_cart_save_data_dir() {
     if (const std::string dir = app_data_dir(); !dir.empty())
         N64::g_memory().set_data_dir(dir);
@@ -36,8 +49,103 @@ void on_field_present(N64::Mmio::VI::VI &vi) {
     Video::present_field(*g_wsi, vi, false);
 }
 
+// Headless --dump-frames: one binary PPM per VI field.
+void on_dump_field(N64::Mmio::VI::VI &vi) {
+    Rdp::ViRegs regs;
+    regs.status = vi.reg_status;
+    regs.origin = vi.reg_origin;
+    regs.width = vi.reg_width;
+    regs.h_video = vi.reg_h_video;
+    regs.v_video = vi.reg_v_video;
+    regs.x_scale = vi.reg_x_scale;
+    regs.y_scale = vi.reg_y_scale;
+    static Rdp::CpuFrame frame;
+    if (!Rdp::scanout_cpu(regs, frame))
+        return;
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%06llu.ppm",
+                  static_cast<unsigned long long>(g_dump_index++));
+    std::ofstream out(g_dump_dir / name, std::ios::binary);
+    if (!out) {
+        Utils::warn("Failed to write {}", (g_dump_dir / name).string());
+        return;
+    }
+    out << "P6\n" << frame.width << ' ' << frame.height << "\n255\n";
+    out.write(reinterpret_cast<const char *>(frame.rgb.data()),
+              static_cast<std::streamsize>(frame.rgb.size()));
+}
+
+void on_headless_field(N64::Mmio::VI::VI &vi) {
+    ++g_headless_fields;
+    if (!g_dump_dir.empty())
+        on_dump_field(vi);
+}
+
 void host_controller_poll() { poll_and_inject_controller(false); }
 
+// Headless --input-script: controller 1 holds each state from its field on.
+struct ScriptStep {
+    uint64_t field;
+    N64::Mmio::N64ControllerState state;
+};
+std::vector<ScriptStep> g_input_script;
+
+// One `FIELD BUTTONS [X Y]` line; BUTTONS is byte1 << 8 | byte2 in hex.
+bool parse_script_line(const std::string &line, ScriptStep &step) {
+    std::istringstream in(line);
+    unsigned buttons = 0;
+    int x = 0, y = 0;
+    if (!(in >> step.field >> std::hex >> buttons >> std::dec))
+        return false;
+    if (!(in >> std::ws).eof() && !(in >> x >> y))
+        return false;
+    if (!(in >> std::ws).eof() || buttons > 0xFFFF || x < -128 || x > 127 ||
+        y < -128 || y > 127)
+        return false;
+    step.state = {static_cast<uint8_t>(buttons >> 8),
+                  static_cast<uint8_t>(buttons), static_cast<int8_t>(x),
+                  static_cast<int8_t>(y)};
+    return true;
+}
+
+bool load_input_script(const std::string &path) {
+    std::ifstream in(path);
+    if (!in) {
+        Utils::critical("Cannot read input script {}", path);
+        return false;
+    }
+    g_input_script.clear();
+    std::string line;
+    for (int n = 1; std::getline(in, line); n++) {
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+        ScriptStep step{};
+        if (!parse_script_line(line, step) ||
+            (!g_input_script.empty() &&
+             step.field < g_input_script.back().field)) {
+            Utils::critical("{}:{}: expected FIELD BUTTONS [X Y] in field "
+                            "order",
+                            path, n);
+            return false;
+        }
+        g_input_script.push_back(step);
+    }
+    Utils::info("Input script: {} ({} steps)", path, g_input_script.size());
+    return true;
+}
+
+void scripted_controller_poll() {
+    N64::Mmio::N64ControllerState state{};
+    for (const ScriptStep &step : g_input_script) {
+        if (step.field > g_headless_fields)
+            break;
+        state = step.state;
+    }
+    Input::set_controller_state(0, state);
+}
+
 N64System::PresentCounters on_present_stats() {
     const auto s = Video::take_present_stats();
     return {s.presented, s.skipped};
@@ -96,14 +204,45 @@ AppCore::~AppCore() {
 
 void AppCore::run_headless() {
     Utils::info("Running headless (no window / no Vulkan)");
-    N64System::set_field_present(nullptr);
+    if (config.soft_rdp || !config.dump_frames_dir.empty())
+        Rdp::init_software(N64::g_memory().get_rdram().data());
+    if (!config.dump_frames_dir.empty()) {
+        g_dump_dir = config.dump_frames_dir;
+        std::error_code ec;
+        std::filesystem::create_directories(g_dump_dir, ec);
+        if (ec) {
+            Utils::critical("Cannot create {}: {}", g_dump_dir.string(),
+                            ec.message());
+            exit(-1);
+        }
+    }
+    if (!config.input_script.empty()) {
+        if (!load_input_script(config.input_script))
+            exit(-1);
+        Input::set_host_poll(&scripted_controller_poll);
+    }
+    N64System::set_field_present(&on_headless_field);
     N64System::set_present_stats_fn(nullptr);
     N64System::set_up(config);
-    while (true)
+    while (config.max_fields == 0 || g_headless_fields < config.max_fields)
         N64System::step(config);
+    const uint64_t hash = N64System::state_hash();
+    Utils::info("Stopped after {} fields at cycle {}, state hash {:016x}",
+                g_headless_fields, N64::g_scheduler().get_current_time(),
+                hash);
+    const bool hle_ok = N64::Rsp::audio_hle_compare_passed();
+    if (!config.final_state.empty() &&
+        !N64System::save_state_file(config.final_state))
+        exit(-1);
+    N64System::shutdown();
+    N64System::set_field_present(nullptr);
+    if (!hle_ok)
+        exit(-1);
 }
 
 void AppCore::run_windowed() {
+    if (config.soft_rdp || !config.dump_frames_dir.empty())
+        Utils::warn("--soft-rdp / --dump-frames only apply with --headless");
     ensure_prdp_vulkan_icd();
     ensure_swapchain_depth();
 
@@ -6,7 +6,27 @@
 namespace N64 {
 namespace Ui {
 
+namespace {
+// "--name=N" with lo <= N <= hi.
+bool parse_count(std::string_view arg, unsigned long lo, unsigned long hi,
+                 unsigned &out) {
+    const size_t eq = arg.find('=');
+    const std::string n_s(arg.substr(eq + 1));
+    char *end = nullptr;
+    const unsigned long n = std::strtoul(n_s.c_str(), &end, 0);
+    if (end == n_s.c_str() || *end != '\0' || n < lo || n > hi) {
+        std::cerr << "Error: invalid " << arg.substr(0, eq) << " value `"
+                  << n_s << "` (expected " << lo << ".." << hi << ")"
+                  << std::endl;
+        return false;
+    }
+    out = static_cast<unsigned>(n);
+    return true;
+}
+} // namespace
+
 bool apply_command_line(N64System::Config &config, int argc, char *argv[]) {
+    bool speed_given = false;
     for (int i = 1; i < argc; ++i) {
         const std::string_view current = argv[i];
         if (current == "--log") {
@@ -41,12 +61,48 @@ bool apply_command_line(N64System::Config &config, int argc, char *argv[]) {
             config.headless = true;
         } else if (current == "--headless") {
             config.headless = true;
+        } else if (current.starts_with("--fields=")) {
+            if (!parse_count(current, 1, 1u << 24, config.max_fields))
+                return false;
         } else if (current == "--debug") {
             config.debug = true;
         } else if (current == "--jit") {
             config.cpu_backend = N64System::CpuBackend::Jit;
         } else if (current == "--no-jit") {
             config.cpu_backend = N64System::CpuBackend::Interpreter;
+        } else if (current == "--jit-link") {
+            config.jit_link = true;
+        } else if (current == "--no-jit-link") {
+            config.jit_link = false;
+        } else if (current == "--jit-opt") {
+            config.jit_opt = true;
+        } else if (current == "--no-jit-opt") {
+            config.jit_opt = false;
+        } else if (current.starts_with("--jit-cache-mb=")) {
+            if (!parse_count(current, 4, 1024, config.jit_cache_mb))
+                return false;
+        } else if (current.starts_with("--jit-cache-blocks=")) {
+            if (!parse_count(current, 16, 1u << 20, config.jit_cache_blocks))
+                return false;
+        } else if (current.starts_with("--jit-tier=")) {
+            if (!parse_count(current, 0, 1u << 16, config.jit_tier))
+                return false;
+        } else if (current == "--jit-trace") {
+            config.jit_trace = true;
+        } else if (current == "--no-jit-trace") {
+            config.jit_trace = false;
+        } else if (current == "--jit-disk-cache") {
+            config.jit_disk_cache = true;
+        } else if (current.starts_with("--jit-disk-cache=")) {
+            config.jit_disk_cache = true;
+            config.jit_disk_cache_dir =
+                current.substr(std::string("--jit-disk-cache=").size());
+        } else if (current == "--no-jit-disk-cache") {
+            config.jit_disk_cache = false;
+        } else if (current == "--fastmem") {
+            config.fastmem = true;
+        } else if (current == "--no-fastmem") {
+            config.fastmem = false;
         } else if (current.starts_with("--upscale=")) {
             std::string_view n_str =
                 current.substr(std::string("--upscale=").size());
@@ -60,6 +116,84 @@ bool apply_command_line(N64System::Config &config, int argc, char *argv[]) {
                 return false;
             }
             config.upscale = static_cast<unsigned>(n);
+        } else if (current.starts_with("--speed=")) {
+            std::string_view s_str =
+                current.substr(std::string("--speed=").size());
+            if (s_str == "unlimited") {
+                config.speed = 0.0;
+            } else {
+                // Accept "2", "2x", "0.5x".
+                std::string s_s(s_str);
+                if (!s_s.empty() && (s_s.back() == 'x' || s_s.back() == 'X'))
+                    s_s.pop_back();
+                char *end = nullptr;
+                const double v = std::strtod(s_s.c_str(), &end);
+                if (end == s_s.c_str() || *end != '\0' || !(v > 0.0) ||
+                    v > 100.0) {
+                    std::cerr << "Error: invalid --speed value `" << s_str
+                              << "` (expected unlimited or N.x, 0 < N <= 100)"
+                              << std::endl;
+                    return false;
+                }
+                config.speed = v;
+            }
+            speed_given = true;
+        } else if (current == "--rsp-lazy") {
+            config.rsp_lazy = true;
+        } else if (current == "--no-rsp-lazy") {
+            config.rsp_lazy = false;
+        } else if (current == "--rsp-jit") {
+            config.rsp_jit = true;
+        } else if (current == "--no-rsp-jit") {
+            config.rsp_jit = false;
+        } else if (current == "--rsp-simd") {
+            config.rsp_simd = true;
+        } else if (current == "--no-rsp-simd") {
+            config.rsp_simd = false;
+        } else if (current == "--rsp-threaded") {
+            config.rsp_threaded = true;
+        } else if (current == "--rsp-threaded-check") {
+            config.rsp_threaded_check = true;
+        } else if (current == "--no-rsp-threaded") {
+            config.rsp_threaded = false;
+            config.rsp_threaded_check = false;
+        } else if (current == "--audio-hle") {
+            config.audio_hle = true;
+        } else if (current == "--audio-hle-compare") {
+            config.audio_hle_compare = true;
+        } else if (current == "--no-audio-hle") {
+            config.audio_hle = false;
+            config.audio_hle_compare = false;
+        } else if (current == "--soft-rdp") {
+            config.soft_rdp = true;
+        } else if (current == "--no-soft-rdp") {
+            config.soft_rdp = false;
+        } else if (current.starts_with("--dump-frames=")) {
+            config.dump_frames_dir =
+                std::string(current.substr(std::string("--dump-frames=").size()));
+            if (config.dump_frames_dir.empty()) {
+                std::cerr << "Error: --dump-frames requires a directory"
+                          << std::endl;
+                return false;
+            }
+        } else if (current.starts_with("--input-script=")) {
+            config.input_script =
+                std::string(current.substr(std::string("--input-script=").size()));
+        } else if (current.starts_with("--record-movie=")) {
+            config.movie_record =
+                std::string(current.substr(std::string("--record-movie=").size()));
+        } else if (current.starts_with("--movie-state=")) {
+            config.movie_state =
+                std::string(current.substr(std::string("--movie-state=").size()));
+        } else if (current.starts_with("--play-movie=")) {
+            config.movie_play =
+                std::string(current.substr(std::string("--play-movie=").size()));
+        } else if (current.starts_with("--load-state=")) {
+            config.start_state =
+                std::string(current.substr(std::string("--load-state=").size()));
+        } else if (current.starts_with("--save-state=")) {
+            config.final_state =
+                std::string(current.substr(std::string("--save-state=").size()));
         } else if (current == "--frame-interp") {
             config.frame_interp = true;
         } else if (current == "--no-frame-interp") {
@@ -132,6 +266,49 @@ bool apply_command_line(N64System::Config &config, int argc, char *argv[]) {
     }
 #endif
 
+    if (!config.movie_record.empty() && !config.movie_play.empty()) {
+        std::cerr << "Error: --record-movie and --play-movie are exclusive"
+                  << std::endl;
+        return false;
+    }
+    if (!config.movie_state.empty() && config.movie_record.empty()) {
+        std::cerr << "Error: --movie-state requires --record-movie"
+                  << std::endl;
+        return false;
+    }
+
+    if (!config.start_state.empty() &&
+        (!config.movie_record.empty() || !config.movie_play.empty())) {
+        std::cerr << "Error: --load-state cannot be combined with a movie "
+                     "(use --movie-state)"
+                  << std::endl;
+        return false;
+    }
+
+    if (!config.input_script.empty() && !config.movie_play.empty()) {
+        std::cerr << "Error: --input-script and --play-movie are exclusive"
+                  << std::endl;
+        return false;
+    }
+
+    if (config.max_fields && !config.headless) {
+        std::cerr << "Error: --fields requires --headless" << std::endl;
+        return false;
+    }
+    if (!config.input_script.empty() && !config.headless) {
+        std::cerr << "Error: --input-script requires --headless" << std::endl;
+        return false;
+    }
+    if (!config.final_state.empty() && !config.max_fields) {
+        std::cerr << "Error: --save-state requires --fields" << std::endl;
+        return false;
+    }
+
+    // Test ROMs and field-limited runs only report results; don't pace them
+    // to real time.
+    if ((config.test_mode || config.max_fields) && !speed_given)
+        config.speed = 0.0;
+
     if (config.headless && config.rom_filepath.empty()) {
         std::cerr << "Error: ROM path required for --headless/--test"
                   << std::endl;
@@ -153,6 +153,43 @@ bool parse_toml_file(const std::string &path, N64System::Config &config,
                 config.cpu_backend = *v ? N64System::CpuBackend::Jit
                                         : N64System::CpuBackend::Interpreter;
             }
+            if (auto v = (*cpu)["jit_link"].value<bool>())
+                config.jit_link = *v;
+            if (auto v = (*cpu)["jit_opt"].value<bool>())
+                config.jit_opt = *v;
+            if (auto v = (*cpu)["jit_cache_mb"].value<int64_t>()) {
+                if (*v >= 4 && *v <= 1024)
+                    config.jit_cache_mb = static_cast<unsigned>(*v);
+            }
+            if (auto v = (*cpu)["jit_cache_blocks"].value<int64_t>()) {
+                if (*v >= 16 && *v <= (1 << 20))
+                    config.jit_cache_blocks = static_cast<unsigned>(*v);
+            }
+            if (auto v = (*cpu)["jit_tier"].value<int64_t>()) {
+                if (*v >= 0 && *v <= (1 << 16))
+                    config.jit_tier = static_cast<unsigned>(*v);
+            }
+            if (auto v = (*cpu)["jit_trace"].value<bool>())
+                config.jit_trace = *v;
+            if (auto v = (*cpu)["jit_disk_cache"].value<bool>())
+                config.jit_disk_cache = *v;
+            if (auto v = (*cpu)["fastmem"].value<bool>())
+                config.fastmem = *v;
+        }
+        if (auto *emu = tbl["emulation"].as_table()) {
+            // 0 = unlimited.
+            if (auto v = (*emu)["speed"].value<double>()) {
+                if (*v >= 0.0 && *v <= 100.0)
+                    config.speed = *v;
+            }
+            if (auto v = (*emu)["rsp_lazy"].value<bool>())
+                config.rsp_lazy = *v;
+            if (auto v = (*emu)["rsp_jit"].value<bool>())
+                config.rsp_jit = *v;
+            if (auto v = (*emu)["rsp_threaded"].value<bool>())
+                config.rsp_threaded = *v;
+            if (auto v = (*emu)["audio_hle"].value<bool>())
+                config.audio_hle = *v;
         }
         if (auto *u = tbl["ui"].as_table()) {
             if (auto v = (*u)["last_rom_dir"].value<std::string>())
@@ -282,6 +319,23 @@ bool save_toml(const N64System::Config &config, const UiSettings &ui) {
     toml::table cpu;
     cpu.insert_or_assign("jit",
                          config.cpu_backend == N64System::CpuBackend::Jit);
+    cpu.insert_or_assign("jit_link", config.jit_link);
+    cpu.insert_or_assign("jit_opt", config.jit_opt);
+    cpu.insert_or_assign("jit_cache_mb",
+                         static_cast<int64_t>(config.jit_cache_mb));
+    cpu.insert_or_assign("jit_cache_blocks",
+                         static_cast<int64_t>(config.jit_cache_blocks));
+    cpu.insert_or_assign("jit_tier", static_cast<int64_t>(config.jit_tier));
+    cpu.insert_or_assign("jit_trace", config.jit_trace);
+    cpu.insert_or_assign("jit_disk_cache", config.jit_disk_cache);
+    cpu.insert_or_assign("fastmem", config.fastmem);
+
+    toml::table emulation;
+    emulation.insert_or_assign("speed", config.speed);
+    emulation.insert_or_assign("rsp_lazy", config.rsp_lazy);
+    emulation.insert_or_assign("rsp_jit", config.rsp_jit);
+    emulation.insert_or_assign("rsp_threaded", config.rsp_threaded);
+    emulation.insert_or_assign("audio_hle", config.audio_hle);
 
     toml::table ui_tbl;
     ui_tbl.insert_or_assign("last_rom_dir", ui.last_rom_dir);
@@ -314,6 +368,7 @@ bool save_toml(const N64System::Config &config, const UiSettings &ui) {
     toml::table tbl;
     tbl.insert_or_assign("video", std::move(video));
     tbl.insert_or_assign("cpu", std::move(cpu));
+    tbl.insert_or_assign("emulation", std::move(emulation));
     tbl.insert_or_assign("ui", std::move(ui_tbl));
     tbl.insert_or_assign("audio", std::move(audio));
     tbl.insert_or_assign("input", std::move(input));
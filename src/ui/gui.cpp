@@ -393,6 +393,39 @@ void draw_emu_settings(GuiState &state) {
                 "Dynarec for the main CPU. Faster than the interpreter; "
                 "turn off for debugging.");
 
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::AlignTextToFramePadding();
+        ImGui::TextUnformatted("Speed:");
+        ImGui::TableSetColumnIndex(1);
+        ImGui::SetNextItemWidth(120.0f);
+        constexpr struct {
+            double speed;
+            const char *label;
+        } kSpeeds[] = {{0.5, "50%"},  {1.0, "100%"},       {2.0, "200%"},
+                       {4.0, "400%"}, {0.0, "Unlimited"}};
+        const char *speed_label = "Custom";
+        for (const auto &s : kSpeeds) {
+            if (cfg.speed == s.speed)
+                speed_label = s.label;
+        }
+        if (ImGui::BeginCombo("##speed", speed_label)) {
+            for (const auto &s : kSpeeds) {
+                const bool sel = cfg.speed == s.speed;
+                if (ImGui::Selectable(s.label, sel) && !sel) {
+                    cfg.speed = s.speed;
+                    save_settings(state);
+                }
+                if (sel)
+                    ImGui::SetItemDefaultFocus();
+            }
+            ImGui::EndCombo();
+        }
+        if (ImGui::IsItemHovered(ImGuiHoveredFlags_DelayNormal))
+            ImGui::SetTooltip(
+                "Emulation speed relative to real time. Audio is muted when "
+                "unlimited. Hold Tab in the game window to fast-forward.");
+
         ImGui::EndTable();
     }
 
@@ -887,6 +920,10 @@ void gui_draw(GuiState &state) {
             const bool running = state.mode == AppMode::Running;
             if (ImGui::MenuItem("Stop", nullptr, false, running))
                 state.request_stop = true;
+            if (ImGui::MenuItem("Save State", "F5", false, running))
+                state.request_save_state = true;
+            if (ImGui::MenuItem("Load State", "F7", false, running))
+                state.request_load_state = true;
             ImGui::Separator();
             if (ImGui::MenuItem("Video Settings"))
                 state.show_video_settings = true;
@@ -0,0 +1,109 @@
+#include "utils/dma_copy.h"
+#include "utils/byte_array.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+namespace Utils {
+
+namespace {
+
+uint32_t index_of(uint32_t addr, DmaLayout layout) {
+    return layout == DmaLayout::HostWords ? byte_address(addr) : addr;
+}
+
+void copy_bytes(std::span<uint8_t> dst, uint32_t dst_addr, DmaLayout dst_layout,
+                std::span<const uint8_t> src, uint32_t src_addr,
+                DmaLayout src_layout, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++)
+        dst[index_of(dst_addr + i, dst_layout)] =
+            src[index_of(src_addr + i, src_layout)];
+}
+
+uint32_t bswap32(uint32_t w) {
+    return ((w & 0x000000FFu) << 24) | ((w & 0x0000FF00u) << 8) |
+           ((w & 0x00FF0000u) >> 8) | ((w & 0xFF000000u) >> 24);
+}
+
+// Host-order words <-> big-endian words: a byte swap within each word.
+void swap_words(uint8_t *dst, const uint8_t *src, uint32_t words) {
+    uint32_t i = 0;
+#if defined(__SSSE3__)
+    const __m128i shuffle =
+        _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    for (; i + 4 <= words; i += 4) {
+        const __m128i v =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4),
+                         _mm_shuffle_epi8(v, shuffle));
+    }
+#endif
+    for (; i < words; i++) {
+        uint32_t w = 0;
+        std::memcpy(&w, src + i * 4, sizeof(uint32_t));
+        w = bswap32(w);
+        std::memcpy(dst + i * 4, &w, sizeof(uint32_t));
+    }
+}
+
+} // namespace
+
+void dma_copy(std::span<uint8_t> dst, uint32_t dst_addr, DmaLayout dst_layout,
+              std::span<const uint8_t> src, uint32_t src_addr,
+              DmaLayout src_layout, uint32_t length) {
+    if (length == 0)
+        return;
+    assert(dst_addr + uint64_t{length} <= dst.size());
+    assert(src_addr + uint64_t{length} <= src.size());
+
+    if (dst_layout == DmaLayout::BigEndian &&
+        src_layout == DmaLayout::BigEndian) {
+        std::memcpy(dst.data() + dst_addr, src.data() + src_addr, length);
+        return;
+    }
+    if ((dst_addr ^ src_addr) & 3) {
+        copy_bytes(dst, dst_addr, dst_layout, src, src_addr, src_layout,
+                   length);
+        return;
+    }
+
+    const uint32_t head = std::min((4 - (dst_addr & 3)) & 3, length);
+    copy_bytes(dst, dst_addr, dst_layout, src, src_addr, src_layout, head);
+    dst_addr += head;
+    src_addr += head;
+    length -= head;
+
+    // Both offsets are word aligned now, so a word sits at the same index
+    // in either layout; only its byte order may differ.
+    const uint32_t body = length & ~3u;
+    if (dst_layout == src_layout)
+        std::memcpy(dst.data() + dst_addr, src.data() + src_addr, body);
+    else
+        swap_words(dst.data() + dst_addr, src.data() + src_addr, body / 4);
+
+    copy_bytes(dst, dst_addr + body, dst_layout, src, src_addr + body,
+               src_layout, length - body);
+}
+
+void dma_copy_wrapped(std::span<uint8_t> dst, uint32_t dst_addr,
+                      DmaLayout dst_layout, std::span<const uint8_t> src,
+                      uint32_t src_addr, DmaLayout src_layout,
+                      uint32_t length) {
+    const auto dst_size = static_cast<uint32_t>(dst.size());
+    const auto src_size = static_cast<uint32_t>(src.size());
+    while (length > 0) {
+        dst_addr %= dst_size;
+        src_addr %= src_size;
+        const uint32_t chunk =
+            std::min({length, dst_size - dst_addr, src_size - src_addr});
+        dma_copy(dst, dst_addr, dst_layout, src, src_addr, src_layout, chunk);
+        dst_addr += chunk;
+        src_addr += chunk;
+        length -= chunk;
+    }
+}
+
+} // namespace Utils
@@ -0,0 +1,33 @@
+# Runs EMU on ROM twice, once with BASE_ARGS and once with BASE_ARGS plus
+# ALT_ARGS, and fails unless both pass with byte-identical logs. With MATCH
+# set, only the log lines matching that regex are compared, and there must
+# be at least one.
+#   cmake -DEMU=... -DROM=... -DBASE_ARGS="a;b" -DALT_ARGS="c" [-DMATCH=re]
+#         -P compare_runs.cmake
+
+foreach(run base alt)
+    if(run STREQUAL "alt")
+        set(args ${BASE_ARGS} ${ALT_ARGS})
+    else()
+        set(args ${BASE_ARGS})
+    endif()
+    execute_process(
+        COMMAND "${EMU}" ${args} "${ROM}"
+        RESULT_VARIABLE result_${run}
+        OUTPUT_VARIABLE out_${run}
+        ERROR_VARIABLE out_${run})
+    if(NOT result_${run} EQUAL 0)
+        message(FATAL_ERROR "${run} run failed (${result_${run}}):\n${out_${run}}")
+    endif()
+    if(MATCH)
+        string(REGEX MATCHALL "${MATCH}" lines "${out_${run}}")
+        if(NOT lines)
+            message(FATAL_ERROR "${run} run logged nothing matching ${MATCH}:\n${out_${run}}")
+        endif()
+        set(out_${run} "${lines}")
+    endif()
+endforeach()
+
+if(NOT out_base STREQUAL out_alt)
+    message(FATAL_ERROR "Runs differ.\n--- base\n${out_base}\n--- with ${ALT_ARGS}\n${out_alt}")
+endif()
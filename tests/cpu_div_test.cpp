@@ -0,0 +1,119 @@
+#include "cpu/cached_interp.h"
+#include "cpu/cpu.h"
+#if defined(N64_JIT_X64)
+#include "cpu/jit/jit.h"
+#endif
+#include "memory/bus.h"
+#include "memory/memory.h"
+#include "mmio/mi.h"
+#include "mmu/tlb.h"
+#include "n64_system/scheduler.h"
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+
+// Division edge cases (zero divisor, INT_MIN / -1) must give the hardware
+// LO/HI in the interpreter and in the dynarec alike.
+
+namespace {
+
+using namespace N64;
+
+constexpr uint32_t kDiv = 0x1A;
+constexpr uint32_t kDivu = 0x1B;
+constexpr uint32_t kDdiv = 0x1E;
+constexpr uint32_t kDdivu = 0x1F;
+
+constexpr uint64_t kOnes = ~uint64_t{0};
+constexpr uint64_t kMin64 = uint64_t{1} << 63;
+constexpr uint64_t kMin32 = 0xFFFF'FFFF'8000'0000;
+
+struct Case {
+    const char *name;
+    uint32_t funct;
+    uint64_t rs;
+    uint64_t rt;
+    uint64_t lo;
+    uint64_t hi;
+};
+
+const Case kCases[] = {
+    {"ddiv 7/0", kDdiv, 7, 0, kOnes, 7},
+    {"ddiv -7/0", kDdiv, uint64_t(-7), 0, 1, uint64_t(-7)},
+    {"ddiv 0/0", kDdiv, 0, 0, kOnes, 0},
+    {"ddiv min/-1", kDdiv, kMin64, kOnes, kMin64, 0},
+    {"ddiv min/0", kDdiv, kMin64, 0, 1, kMin64},
+    {"ddiv -7/2", kDdiv, uint64_t(-7), 2, uint64_t(-3), uint64_t(-1)},
+    {"ddivu 7/0", kDdivu, 7, 0, kOnes, 7},
+    {"ddivu ~0/0", kDdivu, kOnes, 0, kOnes, kOnes},
+    {"div -7/0", kDiv, uint64_t(-7), 0, 1, uint64_t(-7)},
+    {"div min/-1", kDiv, kMin32, kOnes, kMin32, 0},
+    {"divu 7/0", kDivu, 7, 0, kOnes, 7},
+};
+
+uint32_t special(int rs, int rt, int rd, uint32_t funct) {
+    return (rs << 21) | (rt << 16) | (rd << 11) | funct;
+}
+
+// The division, MFLO r3, MFHI r4, then a branch to itself.
+void load_program(uint32_t funct) {
+    const uint32_t code[] = {
+        special(1, 2, 0, funct), special(0, 0, 3, 0x12),
+        special(0, 0, 4, 0x10),  0x1000FFFF,
+        0,
+    };
+    for (uint32_t i = 0; i < std::size(code); i++)
+        Memory::write_paddr32(0x1000 + i * 4, code[i]);
+}
+
+void reset(const Case &c) {
+    g_scheduler().init();
+    g_memory().reset();
+    g_tlb().reset();
+    g_cpu().reset();
+    g_mi().reset();
+    Cpu::CachedInterp::reset();
+#if defined(N64_JIT_X64)
+    Cpu::Jit::g_dynarec().reset();
+#endif
+    load_program(c.funct);
+    g_cpu().set_pc64(0x80001000);
+    g_cpu().gpr.write(1, c.rs);
+    g_cpu().gpr.write(2, c.rt);
+}
+
+int check(const char *engine, const Case &c) {
+    const auto &cpu = g_cpu();
+    if (cpu.lo == c.lo && cpu.hi == c.hi && cpu.gpr.read(3) == c.lo &&
+        cpu.gpr.read(4) == c.hi)
+        return 0;
+    std::fprintf(stderr,
+                 "%s %s: LO %016" PRIx64 " HI %016" PRIx64
+                 ", expected %016" PRIx64 " %016" PRIx64 "\n",
+                 engine, c.name, cpu.lo, cpu.hi, c.lo, c.hi);
+    return 1;
+}
+
+} // namespace
+
+int main() {
+    int failures = 0;
+    for (const Case &c : kCases) {
+        reset(c);
+        for (int i = 0; i < 3; i++)
+            Cpu::CachedInterp::step_one();
+        failures += check("interpreter", c);
+#if defined(N64_JIT_X64)
+        reset(c);
+        Cpu::Jit::g_dynarec().run(16);
+        failures += check("jit", c);
+#endif
+    }
+    if (failures) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("cpu_div_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,47 @@
+# Runs EMU headless on ROM for FIELDS fields with --dump-frames, once on one
+# software RDP thread and once on four, and fails unless both last frames
+# are byte-identical and not a single flat colour. With EXPECT set, the last
+# frame must also have that SHA-256.
+#   cmake -DEMU=... -DROM=... -DFIELDS=N -DOUT=dir [-DEXPECT=sha256]
+#         -P frame_check.cmake
+
+foreach(threads 1 4)
+    set(dir ${OUT}/threads_${threads})
+    file(REMOVE_RECURSE ${dir})
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E env N64_SOFT_RDP_THREADS=${threads}
+                "${EMU}" --log-level=off --headless --fields=${FIELDS}
+                --dump-frames=${dir} "${ROM}"
+        RESULT_VARIABLE result
+        OUTPUT_VARIABLE out
+        ERROR_VARIABLE out)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${threads}-thread run failed (${result}):\n${out}")
+    endif()
+    file(GLOB frames ${dir}/frame_*.ppm)
+    if(NOT frames)
+        message(FATAL_ERROR "${threads}-thread run wrote no frames")
+    endif()
+    list(SORT frames)
+    list(GET frames -1 last_${threads})
+    file(SHA256 ${last_${threads}} hash_${threads})
+endforeach()
+
+if(NOT hash_1 STREQUAL hash_4)
+    message(FATAL_ERROR "Last frames differ: ${last_1} vs ${last_4}")
+endif()
+
+# Pixels follow the "255\n" header; a flat frame is one pixel repeated.
+file(READ ${last_1} ppm HEX)
+string(FIND "${ppm}" "3235350a" header)
+math(EXPR pixels "${header} + 8")
+string(SUBSTRING "${ppm}" ${pixels} -1 rgb)
+string(SUBSTRING "${rgb}" 0 6 first)
+string(REPLACE "${first}" "" rest "${rgb}")
+if(NOT rest)
+    message(FATAL_ERROR "${last_1} is a single flat colour (#${first})")
+endif()
+
+if(EXPECT AND NOT hash_1 STREQUAL EXPECT)
+    message(FATAL_ERROR "${last_1}: SHA-256 ${hash_1}, expected ${EXPECT}")
+endif()
@@ -0,0 +1,47 @@
+# Records a movie of ROM for FIELDS headless fields with controller 1 driven
+# by INPUT (an --input-script file), replays it without the script, and fails
+# unless the replay used recorded controller reads, never desynced, and
+# ended on the same cycle with the same RDRAM and SP memory hash. A third run
+# with no input must end with a different hash, so the match shows the
+# replayed input reached the game.
+#   cmake -DEMU=... -DROM=... -DFIELDS=N -DMOVIE=file -DINPUT=file
+#         -P movie_replay.cmake
+
+set(stop_line "Stopped after [0-9]+ fields at cycle [0-9]+, state hash [0-9a-f]+")
+foreach(run record play idle)
+    if(run STREQUAL "record")
+        set(args --record-movie=${MOVIE} --input-script=${INPUT})
+    elseif(run STREQUAL "play")
+        set(args --play-movie=${MOVIE})
+    else()
+        set(args)
+    endif()
+    execute_process(
+        COMMAND "${EMU}" --log-level=info --headless --fields=${FIELDS}
+                ${args} "${ROM}"
+        RESULT_VARIABLE result
+        OUTPUT_VARIABLE out_${run}
+        ERROR_VARIABLE out_${run})
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${run} run failed (${result}):\n${out_${run}}")
+    endif()
+    string(REGEX MATCH "${stop_line}" stop_${run} "${out_${run}}")
+    if(NOT stop_${run})
+        message(FATAL_ERROR "${run} run did not stop cleanly:\n${out_${run}}")
+    endif()
+endforeach()
+
+if(NOT out_play MATCHES "Playing movie: [^\n]* \\([1-9][0-9]* reads\\)")
+    message(FATAL_ERROR "Recording has no controller reads:\n${out_play}")
+endif()
+if(out_play MATCHES "Movie: desync")
+    message(FATAL_ERROR "Replay desynced:\n${out_play}")
+endif()
+if(NOT stop_record STREQUAL stop_play)
+    message(FATAL_ERROR "Replay differs.\n--- record\n${stop_record}\n--- play\n${stop_play}")
+endif()
+string(REGEX MATCH "state hash [0-9a-f]+" hash_play "${stop_play}")
+string(REGEX MATCH "state hash [0-9a-f]+" hash_idle "${stop_idle}")
+if(hash_play STREQUAL hash_idle)
+    message(FATAL_ERROR "Replay ends as a run with no input does (${hash_play}); the input never reached the game")
+endif()
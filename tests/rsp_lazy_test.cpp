@@ -0,0 +1,111 @@
+#include "cpu/cached_interp.h"
+#include "memory/bus.h"
+#include "memory/memory.h"
+#include "memory/memory_map.h"
+#include "mmio/mi.h"
+#include "n64_system/scheduler.h"
+#include "rcp/dpc.h"
+#include "rcp/rsp.h"
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+
+// A deferred RSP task must read what an eager one would, even from a buffer
+// it only finds through a command list: nothing tells the RSP about that
+// page before the task runs, so the CPU overwriting it in the meantime has
+// to be caught by the write itself.
+
+namespace {
+
+using namespace N64;
+
+constexpr uint32_t kList = 0x1000;   // OSTask data_ptr: one buffer pointer
+constexpr uint32_t kBuffer = 0x3000; // named only by the list
+constexpr uint32_t kOut = 0x5000;   // OSTask output_buff
+constexpr uint32_t kBefore = 0x11111111;
+constexpr uint32_t kAfter = 0x22222222;
+
+uint32_t ori(int rt, uint16_t imm) { return (0x0Du << 26) | (rt << 16) | imm; }
+uint32_t mtc0(int rt, int rd) {
+    return (0x10u << 26) | (0x04u << 21) | (rt << 16) | (rd << 11);
+}
+uint32_t lw(int rt, uint16_t offset) {
+    return (0x23u << 26) | (rt << 16) | offset;
+}
+
+// Reads the list, then the buffer it points at, and copies the buffer to
+// kOut. Every SP DMA ends a slice, so the buffer is read in the second one.
+constexpr uint32_t kBreak = 0x0000000D;
+const uint32_t kUcode[] = {
+    ori(1, kList), mtc0(0, 0), mtc0(1, 1), ori(2, 7), mtc0(2, 2), // list
+    lw(3, 0),      ori(4, 0x100), mtc0(4, 0), mtc0(3, 1),
+    mtc0(2, 2), // buffer
+    mtc0(4, 0),    ori(5, kOut),  mtc0(5, 1), mtc0(2, 3), // out
+    kBreak,
+};
+
+// The CPU steps the scheduler a cycle at a time.
+void advance(uint64_t cycles) {
+    for (uint64_t i = 0; i < cycles; i++)
+        g_scheduler().tick();
+}
+
+void reset(bool lazy, bool threaded) {
+    g_scheduler().init();
+    g_memory().reset();
+    Cpu::CachedInterp::reset();
+    g_rsp().reset();
+    g_rsp().set_lazy(lazy);
+    g_rsp().set_threaded(threaded, false);
+    g_dpc().reset();
+    g_mi().reset();
+}
+
+int run(const char *mode, bool lazy, bool threaded) {
+    reset(lazy, threaded);
+    Memory::write_paddr32(kList, kBuffer);
+    Memory::write_paddr32(kBuffer, kBefore);
+    Memory::write_paddr32(kOut, 0);
+    for (uint32_t i = 0; i < std::size(kUcode); i++)
+        Memory::write_paddr32(PHYS_SPIMEM_BASE + i * 4, kUcode[i]);
+    Memory::write_paddr32(PHYS_SPDMEM_BASE + 0xFE8, kOut);
+    Memory::write_paddr32(PHYS_SPDMEM_BASE + 0xFEC, kOut + 8);
+    Memory::write_paddr32(PHYS_SPDMEM_BASE + 0xFF0, kList);
+    Memory::write_paddr32(PHYS_SPDMEM_BASE + 0xFF4, 8);
+    Memory::write_paddr32(Rsp::PADDR_SP_PC, 0);
+    // MI masks every interrupt, so lazy and threaded modes may defer.
+    Memory::write_paddr32(Rsp::PADDR_SP_STATUS, 0x1 | 0x4);
+    const bool deferred = g_rsp().task_pending();
+    if ((lazy || threaded) != deferred) {
+        std::fprintf(stderr, "%s: task %sdeferred\n", mode,
+                     deferred ? "" : "not ");
+        return 1;
+    }
+
+    // Well after the second slice's eager start, overwrite the buffer.
+    advance(100);
+    Memory::write_paddr32(kBuffer, kAfter);
+    advance(1000);
+    const uint32_t out = Memory::read_paddr32(kOut);
+    if (!g_rsp().halted() || out != kBefore) {
+        std::fprintf(stderr, "%s: task read %08x, expected %08x\n", mode, out,
+                     kBefore);
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+int main() {
+    int failures = 0;
+    failures += run("eager", false, false);
+    failures += run("lazy", true, false);
+    failures += run("threaded", false, true);
+    if (failures) {
+        std::fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    std::printf("rsp_lazy_test: ok\n");
+    return 0;
+}
@@ -96,27 +96,108 @@ bool same_vu_state(const Rsp &a, const Rsp &b, int vd, std::string &why) {
     return true;
 }
 
-const int kSimdFuncts[] = {
-    0x00, 0x01, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0C, 0x0D,
-    0x0E, 0x0F, 0x10, 0x11, 0x13, 0x14, 0x15, 0x1D, 0x20, 0x21,
-    0x22, 0x23, 0x25, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D,
-    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36,
-};
+uint32_t encode_ls(int opcode, int base, int vt, int element, int offset7) {
+    // LWC2/SWC2: base 21..25, vt 16..20, opcode 11..15, element 7..10,
+    // offset 0..6
+    return (static_cast<uint32_t>(base & 0x1F) << 21) |
+           (static_cast<uint32_t>(vt & 0x1F) << 16) |
+           (static_cast<uint32_t>(opcode & 0x1F) << 11) |
+           (static_cast<uint32_t>(element & 0xF) << 7) |
+           (static_cast<uint32_t>(offset7 & 0x7F));
+}
 
-} // namespace
+void randomize_dmem(Rsp &rsp, std::mt19937_64 &rng) {
+    auto &dmem = rsp.get_sp_dmem();
+    for (size_t i = 0; i < dmem.size(); i += 8) {
+        const uint64_t r = rng();
+        std::memcpy(dmem.data() + i, &r, 8);
+    }
+}
 
-int main() {
-    std::mt19937_64 rng(0x52535053494dull);
+bool same_vregs_and_dmem(Rsp &a, Rsp &b, std::string &why) {
+    for (int i = 0; i < 32; i++) {
+        for (int l = 0; l < 8; l++) {
+            if (a.vreg(i).lane(l) != b.vreg(i).lane(l)) {
+                why = "v" + std::to_string(i) + " lane " + std::to_string(l);
+                return false;
+            }
+        }
+    }
+    if (a.get_sp_dmem() != b.get_sp_dmem()) {
+        why = "dmem";
+        return false;
+    }
+    return true;
+}
 
-    Rsp scalar;
-    Rsp simd;
-    scalar.reset();
-    simd.reset();
+// LWC2/SWC2 address shift per opcode (LBV/SBV .. LTV/STV).
+constexpr int kLsShift[12] = {0, 1, 2, 3, 4, 4, 3, 3, 4, 4, 4, 4};
+
+// Every element x address-offset pair of every load/store, with addresses
+// at the end of DMEM (wrap) and above 4 KiB included.
+int run_load_store_cases(Rsp &scalar, Rsp &simd, std::mt19937_64 &rng,
+                         bool load) {
+    int failures = 0;
+    for (int opcode = 0; opcode < 12; opcode++) {
+        if (load && opcode == 0x0A) // no LWV
+            continue;
+        for (int element = 0; element < 16; element++) {
+            for (uint32_t ofs = 0; ofs < 16; ofs++) {
+                for (int r = 0; r < 4; r++) {
+                    randomize_vu_state(scalar, rng);
+                    randomize_dmem(scalar, rng);
+                    copy_vu_state(simd, scalar);
+                    simd.get_sp_dmem() = scalar.get_sp_dmem();
+
+                    const int base = 1 + static_cast<int>(rng() % 31);
+                    const int vt = static_cast<int>(rng() % 32);
+                    const int offset7 = static_cast<int>(rng() % 128) - 64;
+                    const uint32_t line =
+                        r == 0 ? 0xFF0u
+                               : static_cast<uint32_t>(rng() % 256) * 16;
+                    const uint32_t addr =
+                        line + ofs + static_cast<uint32_t>(rng() & 0x3000);
+                    const uint32_t gpr =
+                        addr - static_cast<uint32_t>(offset7
+                                                     << kLsShift[opcode]);
+                    scalar.set_gpr(base, gpr);
+                    simd.set_gpr(base, gpr);
+
+                    const uint32_t inst =
+                        encode_ls(opcode, base, vt, element, offset7);
+                    if (load) {
+                        N64::Rsp::vu_load_scalar(scalar, inst);
+                        N64::Rsp::vu_load_simd(simd, inst);
+                    } else {
+                        N64::Rsp::vu_store_scalar(scalar, inst);
+                        N64::Rsp::vu_store_simd(simd, inst);
+                    }
+
+                    std::string why;
+                    if (!same_vregs_and_dmem(scalar, simd, why)) {
+                        std::fprintf(stderr,
+                                     "mismatch %s opcode=%#x elem=%d "
+                                     "addr=%#x vt=%d (%s)\n",
+                                     load ? "LWC2" : "SWC2", opcode, element,
+                                     addr, vt, why.c_str());
+                        if (++failures >= 20)
+                            return failures;
+                    }
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+constexpr int kCasesPerOp = 4000;
 
-    constexpr int kCasesPerOp = 4000;
+// Compute ops, the broadcast patterns and loads/stores against the
+// currently selected SIMD build.
+int run_isa_cases(Rsp &scalar, Rsp &simd, std::mt19937_64 &rng) {
     int failures = 0;
 
-    for (int funct : kSimdFuncts) {
+    for (int funct = 0; funct < 64; funct++) {
         for (int c = 0; c < kCasesPerOp; c++) {
             randomize_vu_state(scalar, rng);
             copy_vu_state(simd, scalar);
@@ -192,11 +273,54 @@ int main() {
         }
     }
 
+    failures += run_load_store_cases(scalar, simd, rng, true);
+    failures += run_load_store_cases(scalar, simd, rng, false);
+
+    return failures;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937_64 rng(0x52535053494dull);
+
+    Rsp scalar;
+    Rsp simd;
+    scalar.reset();
+    simd.reset();
+
+    int failures = 0;
+    int isas = 0;
+    // Every kernel build this CPU can run.
+    const struct {
+        const char *name;
+        int lanes;
+    } builds[] = {{"sse41", 8}, {"avx2", 16}, {"avx512", 32}};
+    for (const auto &[isa, lanes] : builds) {
+        if (!N64::Rsp::set_vu_isa(isa)) {
+            std::printf("rsp_vu_diff_test: %s not available, skipped\n", isa);
+            continue;
+        }
+        isas++;
+        // EVE must have been built for the ISA, not the baseline.
+        if (N64::Rsp::vu_lanes() < lanes) {
+            std::fprintf(stderr, "%s: %d-lane registers, expected %d\n", isa,
+                         N64::Rsp::vu_lanes(), lanes);
+            failures++;
+            continue;
+        }
+        const int f = run_isa_cases(scalar, simd, rng);
+        if (f)
+            std::fprintf(stderr, "%s: %d failures\n", isa, f);
+        failures += f;
+    }
+
     if (failures) {
         std::fprintf(stderr, "%d failures\n", failures);
         return 1;
     }
-    std::printf("rsp_vu_diff_test: ok (%zu ops x %d cases)\n",
-                sizeof(kSimdFuncts) / sizeof(kSimdFuncts[0]), kCasesPerOp);
+    std::printf("rsp_vu_diff_test: ok (%d kernel builds; 64 ops x %d cases, "
+                "LWC2/SWC2 element x offset)\n",
+                isas, kCasesPerOp);
     return 0;
 }
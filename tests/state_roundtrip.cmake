@@ -0,0 +1,31 @@
+# Runs ROM headless for FIELDS fields and saves a state, then resumes from
+# that state for FIELDS more, and fails unless the resumed run ends on the
+# same cycle with the same RDRAM and SP memory hash as one straight run of
+# twice as many fields.
+#   cmake -DEMU=... -DROM=... -DFIELDS=N -DSTATE=file [-DARGS="a;b"]
+#         -P state_roundtrip.cmake
+
+math(EXPR both "${FIELDS} * 2")
+set(args_save --fields=${FIELDS} --save-state=${STATE})
+set(args_straight --fields=${both})
+set(args_resume --fields=${FIELDS} --load-state=${STATE})
+foreach(run save straight resume)
+    execute_process(
+        COMMAND "${EMU}" --log-level=info --headless ${ARGS} ${args_${run}}
+                "${ROM}"
+        RESULT_VARIABLE result
+        OUTPUT_VARIABLE out
+        ERROR_VARIABLE out)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${run} run failed (${result}):\n${out}")
+    endif()
+    string(REGEX MATCH "at cycle [0-9]+, state hash [0-9a-f]+" end_${run}
+           "${out}")
+    if(NOT end_${run})
+        message(FATAL_ERROR "${run} run did not stop cleanly:\n${out}")
+    endif()
+endforeach()
+
+if(NOT end_straight STREQUAL end_resume)
+    message(FATAL_ERROR "Resumed run differs.\n--- straight\n${end_straight}\n--- resumed\n${end_resume}")
+endif()